@@ -206,137 +206,149 @@ namespace EspGenerator
             return null;
         }
 
-        public static int Export(string outputPath, string jsonString)
+        private static IEnumerable<JObject> ReadJsonRecords(TextReader reader)
         {
-            //var currentDirectory = Environment.CurrentDirectory;
-            var currentDirectory = Environment.CurrentDirectory + "\\Data\\SKSE\\plugins\\EspGenerator\\";
-            AppDomain.CurrentDomain.SetData("APP_CONTEXT_BASE_DIRECTORY", currentDirectory);
-
-            var streamWriter = new StreamWriter(currentDirectory + "EspGenerator.log");
-            streamWriter.WriteLine($"Writing {jsonString} to {outputPath}");
-            
-            try
+            string? line;
+            while ((line = reader.ReadLine()) != null)
             {
-                var serializerSettings = new JsonSerializerSettings
+                if (line.Length != 0)
                 {
-                    Formatting = Formatting.Indented,
-                    ReferenceLoopHandling = ReferenceLoopHandling.Ignore,
-                };
-                serializerSettings.AddMutagenConverters();
-                serializerSettings.Converters.Add(new PercentJsonConverter());
-                serializerSettings.Converters.Add(new AssetLinkJsonConverter());
-                serializerSettings.Converters.Add(new ExtendedListConverter());
+                    yield return JObject.Parse(line);
+                }
+            }
+        }
 
-                var jsonSerializer = JsonSerializer.Create(serializerSettings);
+        private static IEnumerable<JObject> ReadRemaining(IEnumerator<JObject> records)
+        {
+            while (records.MoveNext())
+            {
+                yield return records.Current;
+            }
+        }
+
+        private static void Generate(string outputPath, IEnumerable<ModKey> modKeys, IEnumerable<JObject> records, StreamWriter streamWriter)
+        {
+            var serializerSettings = new JsonSerializerSettings
+            {
+                Formatting = Formatting.Indented,
+                ReferenceLoopHandling = ReferenceLoopHandling.Ignore,
+            };
+            serializerSettings.AddMutagenConverters();
+            serializerSettings.Converters.Add(new PercentJsonConverter());
+            serializerSettings.Converters.Add(new AssetLinkJsonConverter());
+            serializerSettings.Converters.Add(new ExtendedListConverter());
 
-                var esp = new SkyrimMod(ModKey.FromNameAndExtension(Path.GetFileName(outputPath)), SkyrimRelease.SkyrimSE);
+            var jsonSerializer = JsonSerializer.Create(serializerSettings);
 
-                ConstructorInfo ctor = typeof(GameEnvironmentBuilder).GetTypeInfo().DeclaredConstructors.ToArray()[1];
-                var envBuilder = ctor.Invoke(new object[] { new GameReleaseInjection(GameRelease.SkyrimSE), new DataDirectoryInjection(new DirectoryPath(Environment.CurrentDirectory + "\\Data\\")), null, null, null }) as GameEnvironmentBuilder;
-                //var envBuilder = ctor.Invoke(new object[] { new GameReleaseInjection(GameRelease.SkyrimSE), new DataDirectoryInjection(new DirectoryPath("D:\\Games\\Steam\\steamapps\\common\\Skyrim Special Edition\\Data\\")), null, null, null }) as GameEnvironmentBuilder;
-                //var envBuilder = GameEnvironmentBuilder.Create(GameRelease.SkyrimSE);
+            var esp = new SkyrimMod(ModKey.FromNameAndExtension(Path.GetFileName(outputPath)), SkyrimRelease.SkyrimSE);
 
-                JToken[] json = JToken.Parse(jsonString).ToArray();
-                
-                HashSet<ModKey> modKeys = new HashSet<ModKey>();
-                foreach (JObject token in json.ToArray())
+            ConstructorInfo ctor = typeof(GameEnvironmentBuilder).GetTypeInfo().DeclaredConstructors.ToArray()[1];
+            var envBuilder = ctor.Invoke(new object[] { new GameReleaseInjection(GameRelease.SkyrimSE), new DataDirectoryInjection(new DirectoryPath(Environment.CurrentDirectory + "\\Data\\")), null, null, null }) as GameEnvironmentBuilder;
+            //var envBuilder = ctor.Invoke(new object[] { new GameReleaseInjection(GameRelease.SkyrimSE), new DataDirectoryInjection(new DirectoryPath("D:\\Games\\Steam\\steamapps\\common\\Skyrim Special Edition\\Data\\")), null, null, null }) as GameEnvironmentBuilder;
+            //var envBuilder = GameEnvironmentBuilder.Create(GameRelease.SkyrimSE);
+
+            var env = envBuilder.WithLoadOrder(modKeys.ToArray()).WithOutputMod(esp).Build();
+
+            var cellData = new Dictionary<FormKey, CellContainer>();
+            foreach (JObject token in records)
+            {
+                var formKey = token["FormKey"].ToObject<FormKey>(jsonSerializer);
+                var recordData = token["Form"].ToString();
+
+                var link = formKey.ToLink<IMajorRecordGetter>();
+                if (link.TryResolve(env.LinkCache, out var foundRecord))
                 {
-                    modKeys.Add(ModKey.FromFileName(token["Master"].ToString()));
-                    modKeys.Add(ModKey.FromFileName(token["Override"].ToString()));
-                    foreach (var reference in token["References"].ToArray())
+                    var srcMod = env.LoadOrder[foundRecord.FormKey.ModKey].Mod as ISkyrimModGetter;
+                    if (foundRecord is ICellGetter originalCell)
                     {
-                        modKeys.Add(ModKey.FromFileName(reference.ToString()));
+                        if (!cellData.TryGetValue(originalCell.FormKey, out var cellContainer))
+                        {
+                            cellContainer = MakeCellContainer(srcMod, originalCell);
+                            if (cellContainer != null)
+                            {
+                                cellData.Add(originalCell.FormKey, cellContainer);
+                            }
+                        }
+                        if (cellContainer != null)
+                        {
+                            try
+                            {
+                                JsonConvert.PopulateObject(recordData, cellContainer.Cell, serializerSettings);
+                            }
+                            catch (Exception e) { streamWriter.WriteLine(e.ToString()); }
+                        }
                     }
-                }
-                
-                var env = envBuilder.WithLoadOrder(modKeys.ToArray()).WithOutputMod(esp).Build();
-
-                var cellData = new Dictionary<FormKey, CellContainer>();
-                foreach (JObject token in json.ToArray())
-                {
-                    var formKey = token["FormKey"].ToObject<FormKey>(jsonSerializer);
-                    var recordData = token["Form"].ToString();
-
-                    var link = formKey.ToLink<IMajorRecordGetter>();
-                    if (link.TryResolve(env.LinkCache, out var foundRecord))
+                    else if (foundRecord is IPlacedGetter originalPlaced)
                     {
-                        var srcMod = env.LoadOrder[foundRecord.FormKey.ModKey].Mod as ISkyrimModGetter;
-                        if (foundRecord is ICellGetter originalCell)
+                        var cellFormKey = token["Form"]["Cell"].ToObject<FormKey>(jsonSerializer);
+                        var cellLink = cellFormKey.ToLink<IMajorRecordGetter>();
+                        if (cellLink.TryResolve(env.LinkCache, out ICellGetter foundCell))
                         {
-                            if (!cellData.TryGetValue(originalCell.FormKey, out var cellContainer))
+                            if (!cellData.TryGetValue(foundCell.FormKey, out var cellContainer))
                             {
-                                cellContainer = MakeCellContainer(srcMod, originalCell);
+                                cellContainer = MakeCellContainer(srcMod, foundCell);
                                 if (cellContainer != null)
                                 {
-                                    cellData.Add(originalCell.FormKey, cellContainer);
+                                    cellData.Add(foundCell.FormKey, cellContainer);
                                 }
                             }
                             if (cellContainer != null)
                             {
+                                bool isPersistent = (originalPlaced.MajorRecordFlagsRaw & 0x400u) > 0;
+                                IPlaced placedDuplicate = originalPlaced.Duplicate(formKey) as IPlaced;
                                 try
                                 {
-                                    JsonConvert.PopulateObject(recordData, cellContainer.Cell, serializerSettings);
+                                    JsonConvert.PopulateObject(recordData, placedDuplicate, serializerSettings);
                                 }
                                 catch (Exception e) { streamWriter.WriteLine(e.ToString()); }
-                            }
-                        }
-                        else if (foundRecord is IPlacedGetter originalPlaced)
-                        {
-                            var cellFormKey = token["Form"]["Cell"].ToObject<FormKey>(jsonSerializer);
-                            var cellLink = cellFormKey.ToLink<IMajorRecordGetter>();
-                            if (cellLink.TryResolve(env.LinkCache, out ICellGetter foundCell))
-                            {
-                                if (!cellData.TryGetValue(foundCell.FormKey, out var cellContainer))
+                                if (isPersistent)
                                 {
-                                    cellContainer = MakeCellContainer(srcMod, foundCell);
-                                    if (cellContainer != null)
-                                    {
-                                        cellData.Add(foundCell.FormKey, cellContainer);
-                                    }
+                                    cellContainer.Cell.Persistent.Add(placedDuplicate);
                                 }
-                                if (cellContainer != null)
+                                else
                                 {
-                                    bool isPersistent = (originalPlaced.MajorRecordFlagsRaw & 0x400u) > 0;
-                                    IPlaced placedDuplicate = originalPlaced.Duplicate(formKey) as IPlaced;
-                                    try
-                                    {
-                                        JsonConvert.PopulateObject(recordData, placedDuplicate, serializerSettings);
-                                    }
-                                    catch (Exception e) { streamWriter.WriteLine(e.ToString()); }
-                                    if (isPersistent)
-                                    {
-                                        cellContainer.Cell.Persistent.Add(placedDuplicate);
-                                    }
-                                    else
-                                    {
-                                        cellContainer.Cell.Temporary.Add(placedDuplicate);
-                                    }
+                                    cellContainer.Cell.Temporary.Add(placedDuplicate);
                                 }
                             }
                         }
-                        else
+                    }
+                    else
+                    {
+                        var record = foundRecord.Duplicate(formKey);
+                        try
                         {
-                            var record = foundRecord.Duplicate(formKey);
-                            try
-                            {
-                                JsonConvert.PopulateObject(recordData, record, serializerSettings);
-                            }
-                            catch(Exception e) { streamWriter.WriteLine(e.ToString()); }
-                            var group = esp.TryGetTopLevelGroup(record.GetType());
-                            if (!(group is null))
-                            {
-                                group.AddUntyped(record);
-                            }
+                            JsonConvert.PopulateObject(recordData, record, serializerSettings);
+                        }
+                        catch(Exception e) { streamWriter.WriteLine(e.ToString()); }
+                        var group = esp.TryGetTopLevelGroup(record.GetType());
+                        if (!(group is null))
+                        {
+                            group.AddUntyped(record);
                         }
                     }
                 }
+            }
 
-                foreach (var (formKey, cellContainer) in cellData)
-                {
-                    cellContainer.AddToMod(esp);
-                }
+            foreach (var (formKey, cellContainer) in cellData)
+            {
+                cellContainer.AddToMod(esp);
+            }
 
-                esp.WriteToBinary(outputPath);
+            esp.WriteToBinary(outputPath);
+        }
+
+        private static int Run(string outputPath, string description, Action<StreamWriter> generate)
+        {
+            //var currentDirectory = Environment.CurrentDirectory;
+            var currentDirectory = Environment.CurrentDirectory + "\\Data\\SKSE\\plugins\\EspGenerator\\";
+            AppDomain.CurrentDomain.SetData("APP_CONTEXT_BASE_DIRECTORY", currentDirectory);
+
+            var streamWriter = new StreamWriter(currentDirectory + "EspGenerator.log");
+            streamWriter.WriteLine($"Writing {description} to {outputPath}");
+
+            try
+            {
+                generate(streamWriter);
 
                 streamWriter.Close();
                 return 0;
@@ -348,5 +360,62 @@ namespace EspGenerator
                 return 1;
             }
         }
+
+        public static int Export(string outputPath, string jsonString)
+        {
+            return Run(outputPath, $"{jsonString.Length} characters of JSON", streamWriter =>
+            {
+                var records = JToken.Parse(jsonString).Cast<JObject>().ToArray();
+
+                HashSet<ModKey> modKeys = new HashSet<ModKey>();
+                foreach (JObject token in records)
+                {
+                    modKeys.Add(ModKey.FromFileName(token["Master"].ToString()));
+                    modKeys.Add(ModKey.FromFileName(token["Override"].ToString()));
+                    foreach (var reference in token["References"].ToArray())
+                    {
+                        modKeys.Add(ModKey.FromFileName(reference.ToString()));
+                    }
+                }
+
+                Generate(outputPath, modKeys, records, streamWriter);
+            });
+        }
+
+        // Records file holds binary records, or JSON lines when the editor dumps them for debugging.
+        // First record lists the plugins to load, the others are parsed one at a time as they are
+        // read.
+        public static int ExportStream(string outputPath, string recordsPath)
+        {
+            return Run(outputPath, recordsPath, streamWriter =>
+            {
+                IDisposable reader;
+                IEnumerable<JObject> records;
+                if (RecordFileReader.IsRecordFile(recordsPath))
+                {
+                    var recordReader = new RecordFileReader(recordsPath);
+                    reader = recordReader;
+                    records = recordReader.ReadRecords();
+                }
+                else
+                {
+                    var textReader = new StreamReader(recordsPath);
+                    reader = textReader;
+                    records = ReadJsonRecords(textReader);
+                }
+
+                using (reader)
+                {
+                    using var enumerator = records.GetEnumerator();
+                    if (!enumerator.MoveNext())
+                    {
+                        throw new InvalidDataException($"{recordsPath} has no records");
+                    }
+                    var modKeys = enumerator.Current["ModKeys"].Select(x => ModKey.FromFileName(x.ToString())).ToHashSet();
+
+                    Generate(outputPath, modKeys, ReadRemaining(enumerator), streamWriter);
+                }
+            });
+        }
     }
 }
@@ -0,0 +1,157 @@
+using System.Text;
+using Newtonsoft.Json.Linq;
+
+namespace EspGenerator
+{
+    // Reads records written by IngameEditor/Serialization/RecordFormat.cpp, which describes the
+    // layout. Records are decoded one at a time in the order they were written.
+    public sealed class RecordFileReader : IDisposable
+    {
+        public const uint Magic = 0x52454953;
+        public const ushort Version = 1;
+
+        private enum ValueType : byte
+        {
+            Null,
+            False,
+            True,
+            Int32,
+            Int64,
+            UInt32,
+            UInt64,
+            Float32,
+            Float64,
+            String,
+            Color,
+            Array,
+            Object,
+        }
+
+        private readonly BinaryReader reader;
+        private readonly string[] keys;
+        private readonly long[] recordOffsets;
+
+        public static bool IsRecordFile(string path)
+        {
+            using var stream = File.OpenRead(path);
+            var magic = new byte[sizeof(uint)];
+            return stream.Read(magic, 0, magic.Length) == magic.Length && BitConverter.ToUInt32(magic, 0) == Magic;
+        }
+
+        public RecordFileReader(string path)
+        {
+            reader = new BinaryReader(File.OpenRead(path), Encoding.UTF8);
+
+            var magic = reader.ReadUInt32();
+            var version = reader.ReadUInt16();
+            reader.ReadUInt16();
+            var recordCount = reader.ReadUInt32();
+            var keyCount = reader.ReadUInt32();
+            var keyTableOffset = reader.ReadUInt64();
+            var recordTableOffset = reader.ReadUInt64();
+            if (magic != Magic || version != Version)
+            {
+                reader.Dispose();
+                throw new InvalidDataException($"{path} is not a version {Version} record file");
+            }
+
+            reader.BaseStream.Position = (long)keyTableOffset;
+            keys = new string[keyCount];
+            for (var index = 0; index < keyCount; ++index)
+            {
+                keys[index] = ReadString();
+            }
+
+            reader.BaseStream.Position = (long)recordTableOffset;
+            recordOffsets = new long[recordCount];
+            for (var index = 0; index < recordCount; ++index)
+            {
+                recordOffsets[index] = (long)reader.ReadUInt64();
+            }
+        }
+
+        public IEnumerable<JObject> ReadRecords()
+        {
+            foreach (var offset in recordOffsets)
+            {
+                reader.BaseStream.Position = offset;
+                if (ReadValue() is not JObject record)
+                {
+                    throw new InvalidDataException($"Record at {offset} is not an object");
+                }
+                yield return record;
+            }
+        }
+
+        public void Dispose()
+        {
+            reader.Dispose();
+        }
+
+        private string ReadString()
+        {
+            var length = reader.ReadUInt32();
+            return Encoding.UTF8.GetString(reader.ReadBytes((int)length));
+        }
+
+        private JToken ReadValue()
+        {
+            var type = (ValueType)reader.ReadByte();
+            switch (type)
+            {
+                case ValueType.Null:
+                    return JValue.CreateNull();
+                case ValueType.False:
+                    return new JValue(false);
+                case ValueType.True:
+                    return new JValue(true);
+                case ValueType.Int32:
+                    return new JValue((long)reader.ReadInt32());
+                case ValueType.Int64:
+                    return new JValue(reader.ReadInt64());
+                case ValueType.UInt32:
+                    return new JValue((long)reader.ReadUInt32());
+                case ValueType.UInt64:
+                    return new JValue(reader.ReadUInt64());
+                case ValueType.Float32:
+                    return new JValue((double)reader.ReadSingle());
+                case ValueType.Float64:
+                    return new JValue(reader.ReadDouble());
+                case ValueType.String:
+                    return new JValue(ReadString());
+                case ValueType.Color:
+                    {
+                        var alpha = reader.ReadByte();
+                        var red = reader.ReadByte();
+                        var green = reader.ReadByte();
+                        var blue = reader.ReadByte();
+                        return new JValue($"{alpha}, {red}, {green}, {blue}");
+                    }
+                case ValueType.Array:
+                    {
+                        var count = reader.ReadUInt32();
+                        reader.ReadUInt32();
+                        var array = new JArray();
+                        for (var index = 0; index < count; ++index)
+                        {
+                            array.Add(ReadValue());
+                        }
+                        return array;
+                    }
+                case ValueType.Object:
+                    {
+                        var count = reader.ReadUInt32();
+                        reader.ReadUInt32();
+                        var obj = new JObject();
+                        for (var index = 0; index < count; ++index)
+                        {
+                            var key = keys[reader.ReadUInt32()];
+                            obj[key] = ReadValue();
+                        }
+                        return obj;
+                    }
+            }
+            throw new InvalidDataException($"Unknown record value type {type}");
+        }
+    }
+}
@@ -6,3 +6,8 @@ extern "C" __declspec(dllexport) int Export(const char* outputPath, const char*
 {
 	return EspGenerator::EspGenerator::Export(gcnew String(outputPath), gcnew String(jsonString));
 }
+
+extern "C" __declspec(dllexport) int ExportStream(const char* outputPath, const char* recordsPath)
+{
+	return EspGenerator::EspGenerator::ExportStream(gcnew String(outputPath), gcnew String(recordsPath));
+}
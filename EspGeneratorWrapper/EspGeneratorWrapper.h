@@ -5,3 +5,4 @@
 using namespace System;
 
 extern "C" __declspec(dllexport) int Export(const char* outputPath, const char* jsonString);
+extern "C" __declspec(dllexport) int ExportStream(const char* outputPath, const char* recordsPath);
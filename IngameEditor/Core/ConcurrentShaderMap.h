@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace SIE
+{
+	template <typename T>
+	class ConcurrentShaderMap
+	{
+	public:
+		// Bookkeeping stored next to each value, only read and written under the write lock
+		// except for lastUseFrame which readers update.
+		struct EntryInfo
+		{
+			uint64_t cost = 0;
+			uint64_t group = 0;
+			uint64_t lastUseFrame = 0;
+		};
+
+		ConcurrentShaderMap() :
+			table(new Table(InitialCapacity))
+		{}
+
+		~ConcurrentShaderMap()
+		{
+			Clear();
+			delete table.load(std::memory_order_relaxed);
+		}
+
+		ConcurrentShaderMap(const ConcurrentShaderMap&) = delete;
+		ConcurrentShaderMap& operator=(const ConcurrentShaderMap&) = delete;
+
+		T* Find(uint32_t key) const
+		{
+			const Slot* slot = FindSlot(key);
+			return slot != nullptr ? slot->value.load(std::memory_order_acquire) : nullptr;
+		}
+
+		// Same as Find, additionally marks the entry as used in useFrame.
+		T* Find(uint32_t key, uint64_t useFrame) const
+		{
+			Slot* slot = FindSlot(key);
+			if (slot == nullptr)
+			{
+				return nullptr;
+			}
+			if (slot->lastUseFrame.load(std::memory_order_relaxed) != useFrame)
+			{
+				slot->lastUseFrame.store(useFrame, std::memory_order_relaxed);
+			}
+			return slot->value.load(std::memory_order_acquire);
+		}
+
+		// Takes ownership of value only if key was not present, otherwise value is left untouched
+		// and the already stored object is returned.
+		std::pair<T*, bool> Insert(uint32_t key, std::unique_ptr<T>&& value,
+			const EntryInfo& info = {})
+		{
+			std::lock_guard lock(writeMutex);
+
+			if (T* existing = Find(key))
+			{
+				return { existing, false };
+			}
+
+			return { Publish(key, std::move(value), info), true };
+		}
+
+		// Atomically publishes value under key and returns the previously stored object, which
+		// readers may still be using until the caller decides it is safe to destroy it.
+		std::pair<T*, std::unique_ptr<T>> Replace(uint32_t key, std::unique_ptr<T>&& value,
+			const EntryInfo& info = {}, EntryInfo* replacedInfo = nullptr)
+		{
+			std::lock_guard lock(writeMutex);
+
+			if (Slot* slot = FindSlot(key))
+			{
+				if (replacedInfo != nullptr)
+				{
+					*replacedInfo = GetInfo(*slot);
+				}
+				SetInfo(*slot, info);
+				T* result = value.release();
+				return { result,
+					std::unique_ptr<T>(slot->value.exchange(result, std::memory_order_acq_rel)) };
+			}
+
+			return { Publish(key, std::move(value), info), nullptr };
+		}
+
+		// Unpublishes key and returns its object, which readers may still be using until the
+		// caller decides it is safe to destroy it.
+		std::unique_ptr<T> Remove(uint32_t key, EntryInfo* removedInfo = nullptr)
+		{
+			std::lock_guard lock(writeMutex);
+
+			Slot* slot = FindSlot(key);
+			if (slot == nullptr)
+			{
+				return nullptr;
+			}
+			if (removedInfo != nullptr)
+			{
+				*removedInfo = GetInfo(*slot);
+			}
+
+			// Slot keeps a tombstone so that probing for other keys continues past it, it is only
+			// reused after the table is rebuilt.
+			slot->key.store(TombstoneKey, std::memory_order_release);
+			--size;
+			++tombstones;
+			return std::unique_ptr<T>(slot->value.exchange(nullptr, std::memory_order_acq_rel));
+		}
+
+		template <typename Func>
+		void ForEach(Func&& func) const
+		{
+			ForEachEntry([&func](uint32_t key, T& value, const EntryInfo&) { func(key, value); });
+		}
+
+		template <typename Func>
+		void ForEachEntry(Func&& func) const
+		{
+			std::lock_guard lock(writeMutex);
+
+			const Table* currentTable = table.load(std::memory_order_relaxed);
+			for (size_t index = 0; index < currentTable->capacity; ++index)
+			{
+				const auto& slot = currentTable->slots[index];
+				const uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+				if (slotKey != EmptyKey && slotKey != TombstoneKey)
+				{
+					func(static_cast<uint32_t>(slotKey - 1),
+						*slot.value.load(std::memory_order_relaxed), GetInfo(slot));
+				}
+			}
+		}
+
+		size_t GetSize() const
+		{
+			std::lock_guard lock(writeMutex);
+			return size;
+		}
+
+		// Tables replaced by growth or rebuilding are destroyed once the epoch, advanced by the
+		// owner once per frame, is far enough from the one they were retired in.
+		void ReleaseRetiredTables(uint64_t currentEpoch)
+		{
+			constexpr uint64_t RetiredTableDelay = 3;
+
+			std::lock_guard lock(writeMutex);
+			epoch = currentEpoch;
+			std::erase_if(retiredTables, [currentEpoch](const RetiredTable& retiredTable) {
+				return retiredTable.epoch + RetiredTableDelay < currentEpoch;
+			});
+		}
+
+		// Must not race with Find, objects and retired tables are destroyed immediately.
+		void Clear()
+		{
+			std::lock_guard lock(writeMutex);
+
+			Table* currentTable = table.load(std::memory_order_relaxed);
+			for (size_t index = 0; index < currentTable->capacity; ++index)
+			{
+				auto& slot = currentTable->slots[index];
+				delete slot.value.exchange(nullptr, std::memory_order_relaxed);
+				slot.key.store(EmptyKey, std::memory_order_relaxed);
+			}
+			size = 0;
+			tombstones = 0;
+			retiredTables.clear();
+		}
+
+	private:
+		static constexpr size_t InitialCapacity = 64;
+		static constexpr uint64_t EmptyKey = 0;
+		static constexpr uint64_t TombstoneKey = ~0ull;
+
+		struct Slot
+		{
+			std::atomic<uint64_t> key = EmptyKey;
+			std::atomic<T*> value = nullptr;
+			mutable std::atomic<uint64_t> lastUseFrame = 0;
+			uint64_t cost = 0;
+			uint64_t group = 0;
+		};
+
+		struct Table
+		{
+			explicit Table(size_t aCapacity) :
+				capacity(aCapacity), slots(std::make_unique<Slot[]>(aCapacity))
+			{}
+
+			size_t capacity;
+			std::unique_ptr<Slot[]> slots;
+		};
+
+		struct RetiredTable
+		{
+			std::unique_ptr<Table> table;
+			uint64_t epoch = 0;
+		};
+
+		static uint64_t ToStoredKey(uint32_t key) { return static_cast<uint64_t>(key) + 1; }
+
+		static size_t GetHash(uint32_t key)
+		{
+			return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> 32);
+		}
+
+		static EntryInfo GetInfo(const Slot& slot)
+		{
+			return { slot.cost, slot.group, slot.lastUseFrame.load(std::memory_order_relaxed) };
+		}
+
+		static void SetInfo(Slot& slot, const EntryInfo& info)
+		{
+			slot.cost = info.cost;
+			slot.group = info.group;
+			slot.lastUseFrame.store(info.lastUseFrame, std::memory_order_relaxed);
+		}
+
+		static Slot& FindFreeSlot(Table& targetTable, uint32_t key)
+		{
+			const size_t mask = targetTable.capacity - 1;
+			size_t index = GetHash(key) & mask;
+			while (targetTable.slots[index].key.load(std::memory_order_relaxed) != EmptyKey)
+			{
+				index = (index + 1) & mask;
+			}
+			return targetTable.slots[index];
+		}
+
+		Slot* FindSlot(uint32_t key) const
+		{
+			Table* currentTable = table.load(std::memory_order_acquire);
+			const uint64_t storedKey = ToStoredKey(key);
+			const size_t mask = currentTable->capacity - 1;
+			for (size_t index = GetHash(key) & mask, probe = 0; probe < currentTable->capacity;
+				 index = (index + 1) & mask, ++probe)
+			{
+				auto& slot = currentTable->slots[index];
+				const uint64_t slotKey = slot.key.load(std::memory_order_acquire);
+				if (slotKey == storedKey)
+				{
+					return &slot;
+				}
+				if (slotKey == EmptyKey)
+				{
+					break;
+				}
+			}
+			return nullptr;
+		}
+
+		T* Publish(uint32_t key, std::unique_ptr<T>&& value, const EntryInfo& info)
+		{
+			Table* currentTable = table.load(std::memory_order_relaxed);
+			if ((size + tombstones + 1) * 2 > currentTable->capacity)
+			{
+				currentTable = Rebuild(*currentTable);
+			}
+
+			T* result = value.release();
+			auto& slot = FindFreeSlot(*currentTable, key);
+			SetInfo(slot, info);
+			slot.value.store(result, std::memory_order_release);
+			slot.key.store(ToStoredKey(key), std::memory_order_release);
+			++size;
+
+			return result;
+		}
+
+		// Grows the table or, when it is mostly filled with tombstones, rebuilds it at the same
+		// capacity.
+		Table* Rebuild(Table& oldTable)
+		{
+			auto newTable = new Table(std::max(InitialCapacity, std::bit_ceil((size + 1) * 4)));
+			for (size_t index = 0; index < oldTable.capacity; ++index)
+			{
+				const auto& oldSlot = oldTable.slots[index];
+				const uint64_t slotKey = oldSlot.key.load(std::memory_order_relaxed);
+				if (slotKey != EmptyKey && slotKey != TombstoneKey)
+				{
+					auto& newSlot = FindFreeSlot(*newTable, static_cast<uint32_t>(slotKey - 1));
+					SetInfo(newSlot, GetInfo(oldSlot));
+					newSlot.value.store(oldSlot.value.load(std::memory_order_relaxed),
+						std::memory_order_relaxed);
+					newSlot.key.store(slotKey, std::memory_order_relaxed);
+				}
+			}
+
+			// Readers may still be probing the old table, so it is kept alive for a few epochs.
+			table.store(newTable, std::memory_order_release);
+			retiredTables.push_back({ std::unique_ptr<Table>(&oldTable), epoch });
+			tombstones = 0;
+			return newTable;
+		}
+
+		std::atomic<Table*> table;
+		std::vector<RetiredTable> retiredTables;
+		size_t size = 0;
+		size_t tombstones = 0;
+		uint64_t epoch = 0;
+		mutable std::mutex writeMutex;
+	};
+}
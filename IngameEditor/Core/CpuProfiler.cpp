@@ -0,0 +1,161 @@
+#include "Core/CpuProfiler.h"
+
+#include "Core/ShaderCache.h"
+
+namespace SIE
+{
+	namespace SCpuProfiler
+	{
+		constexpr uint32_t DroppedEvent = UINT32_MAX;
+	}
+
+	thread_local CpuProfiler::ThreadBuffer* CpuProfiler::currentThreadBuffer = nullptr;
+
+	bool CpuProfiler::IsEnabled() const
+	{
+		return isEnabled;
+	}
+
+	void CpuProfiler::SetEnabled(bool value)
+	{
+		isEnabled = value;
+	}
+
+	CpuProfiler::NameId CpuProfiler::InternName(std::string_view name)
+	{
+		std::lock_guard lock(namesMutex);
+		if (const auto it = nameIds.find(name); it != nameIds.end())
+		{
+			return it->second;
+		}
+		const auto nameId = static_cast<NameId>(names.size());
+		const auto& storedName = names.emplace_back(name);
+		nameIds.emplace(storedName, nameId);
+		return nameId;
+	}
+
+	std::string CpuProfiler::GetName(NameId name) const
+	{
+		std::lock_guard lock(namesMutex);
+		return name < names.size() ? names[name] : std::string();
+	}
+
+	void CpuProfiler::OnFrame()
+	{
+		const uint64_t timestamp = ShaderCache::GetTimestamp();
+		{
+			std::lock_guard lock(threadBuffersMutex);
+			frameStarts = { frameStarts[1], timestamp };
+		}
+		++frameIndex;
+
+		if (isProfiling)
+		{
+			// Render thread finishes its frame here, others when they open their next scope.
+			CompleteFrame(GetThreadBuffer());
+		}
+		isProfiling = isEnabled;
+	}
+
+	void CpuProfiler::BeginScope(NameId name)
+	{
+		if (!isProfiling.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		auto& buffer = GetThreadBuffer();
+		if (buffer.frameIndex != frameIndex.load(std::memory_order_relaxed))
+		{
+			CompleteFrame(buffer);
+		}
+
+		if (buffer.depth < MaxDepth)
+		{
+			if (buffer.events.size() < EventsPerFrame)
+			{
+				buffer.openEvents[buffer.depth] = static_cast<uint32_t>(buffer.events.size());
+				buffer.events.push_back({ ShaderCache::GetTimestamp(), 0, name,
+					static_cast<uint16_t>(buffer.depth) });
+			}
+			else
+			{
+				buffer.openEvents[buffer.depth] = SCpuProfiler::DroppedEvent;
+				++buffer.droppedEvents;
+			}
+		}
+		++buffer.depth;
+	}
+
+	void CpuProfiler::EndScope()
+	{
+		if (!isProfiling.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		auto& buffer = GetThreadBuffer();
+		// Scope may have begun before profiling did or in an already completed frame.
+		if (buffer.depth == 0)
+		{
+			return;
+		}
+
+		--buffer.depth;
+		if (buffer.depth < MaxDepth && buffer.openEvents[buffer.depth] != SCpuProfiler::DroppedEvent)
+		{
+			buffer.events[buffer.openEvents[buffer.depth]].end = ShaderCache::GetTimestamp();
+		}
+	}
+
+	CpuProfiler::Frame CpuProfiler::GetLastFrame() const
+	{
+		Frame result;
+		result.index = frameIndex - 1;
+
+		std::lock_guard lock(threadBuffersMutex);
+		result.start = frameStarts[0];
+		result.end = frameStarts[1];
+		for (const auto& buffer : threadBuffers)
+		{
+			std::lock_guard completedLock(buffer->completedMutex);
+			if (buffer->completedFrameIndex == result.index && !buffer->completedEvents.empty())
+			{
+				result.threads.push_back(
+					{ buffer->threadId, buffer->completedEvents, buffer->completedDroppedEvents });
+			}
+		}
+		return result;
+	}
+
+	CpuProfiler::ThreadBuffer& CpuProfiler::GetThreadBuffer()
+	{
+		if (currentThreadBuffer == nullptr)
+		{
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->threadId = std::this_thread::get_id();
+			buffer->frameIndex = frameIndex;
+			buffer->events.reserve(EventsPerFrame);
+			buffer->completedEvents.reserve(EventsPerFrame);
+
+			std::lock_guard lock(threadBuffersMutex);
+			currentThreadBuffer = buffer.get();
+			threadBuffers.push_back(std::move(buffer));
+		}
+		return *currentThreadBuffer;
+	}
+
+	void CpuProfiler::CompleteFrame(ThreadBuffer& buffer)
+	{
+		{
+			std::lock_guard lock(buffer.completedMutex);
+			std::swap(buffer.events, buffer.completedEvents);
+			buffer.completedFrameIndex = buffer.frameIndex;
+			buffer.completedDroppedEvents = buffer.droppedEvents;
+		}
+		buffer.events.clear();
+		buffer.frameIndex = frameIndex;
+		buffer.depth = 0;
+		buffer.droppedEvents = 0;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace SIE
+{
+	// Hierarchical TSC based scopes written into preallocated per thread buffers. The last
+	// completed frame of every thread is kept for the GUI timeline.
+	class CpuProfiler
+	{
+	public:
+		using NameId = uint16_t;
+
+		struct Event
+		{
+			uint64_t start = 0;
+			uint64_t end = 0;
+			NameId name = 0;
+			uint16_t depth = 0;
+		};
+
+		struct ThreadTimeline
+		{
+			std::thread::id threadId;
+			std::vector<Event> events;
+			uint32_t droppedEvents = 0;
+		};
+
+		struct Frame
+		{
+			uint64_t index = 0;
+			uint64_t start = 0;
+			uint64_t end = 0;
+			std::vector<ThreadTimeline> threads;
+		};
+
+		static CpuProfiler& Instance()
+		{
+			static CpuProfiler instance;
+			return instance;
+		}
+
+		// Profiling starts and stops on the next frame.
+		bool IsEnabled() const;
+		void SetEnabled(bool value);
+
+		// Names are never removed, hooks intern theirs once into a static.
+		NameId InternName(std::string_view name);
+		std::string GetName(NameId name) const;
+
+		void OnFrame();
+		void BeginScope(NameId name);
+		void EndScope();
+
+		Frame GetLastFrame() const;
+
+	private:
+		static constexpr size_t EventsPerFrame = 1 << 16;
+		static constexpr uint32_t MaxDepth = 64;
+
+		struct ThreadBuffer
+		{
+			std::thread::id threadId;
+			uint64_t frameIndex = 0;
+			std::vector<Event> events;
+			std::array<uint32_t, MaxDepth> openEvents{};
+			uint32_t depth = 0;
+			uint32_t droppedEvents = 0;
+
+			mutable std::mutex completedMutex;
+			std::vector<Event> completedEvents;
+			uint64_t completedFrameIndex = 0;
+			uint32_t completedDroppedEvents = 0;
+		};
+
+		CpuProfiler() = default;
+
+		ThreadBuffer& GetThreadBuffer();
+		void CompleteFrame(ThreadBuffer& buffer);
+
+		static thread_local ThreadBuffer* currentThreadBuffer;
+
+		bool isEnabled = false;
+		std::atomic<bool> isProfiling = false;
+		std::atomic<uint64_t> frameIndex = 0;
+		std::array<uint64_t, 2> frameStarts{};
+
+		std::deque<std::string> names;
+		std::unordered_map<std::string_view, NameId> nameIds;
+		mutable std::mutex namesMutex;
+
+		std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+		mutable std::mutex threadBuffersMutex;
+	};
+}
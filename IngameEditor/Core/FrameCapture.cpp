@@ -0,0 +1,41 @@
+#include "Core/FrameCapture.h"
+
+#include <fstream>
+
+namespace SIE
+{
+	bool ReadFrameCapture(const std::filesystem::path& path, FrameCapture& capture)
+	{
+		capture.records.clear();
+
+		std::ifstream file(path, std::ios::binary);
+		auto& header = capture.header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			header.magic != FrameCaptureHeader::Magic ||
+			header.version != FrameCaptureHeader::Version ||
+			header.recordSize != sizeof(FrameCaptureRecord) || header.capacity == 0)
+		{
+			return false;
+		}
+
+		std::vector<FrameCaptureRecord> ring(header.capacity);
+		if (!file.read(reinterpret_cast<char*>(ring.data()),
+				static_cast<std::streamsize>(ring.size() * sizeof(FrameCaptureRecord))))
+		{
+			return false;
+		}
+
+		if (header.writeIndex <= header.capacity)
+		{
+			capture.records.assign(ring.begin(), ring.begin() + header.writeIndex);
+		}
+		else
+		{
+			const auto oldest = ring.begin() + header.writeIndex % header.capacity;
+			capture.records.reserve(ring.size());
+			capture.records.insert(capture.records.end(), oldest, ring.end());
+			capture.records.insert(capture.records.end(), ring.begin(), oldest);
+		}
+		return true;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace SIE
+{
+	enum class FrameCaptureRecordType : uint8_t
+	{
+		Frame,
+		Scope,
+		Draw,
+	};
+
+	enum class FrameCaptureScope : uint8_t
+	{
+		Renderer,
+		RenderBatches,
+		FinishAccumulatingDispatch,
+		AccumulatorUnk2B,
+		Depth,
+		Shadowmasks,
+		World,
+		FirstPersonView,
+		WaterEffects,
+		PlayerView,
+		Total,
+	};
+
+	// Scopes and draws are written when they end, timestamp is the moment they began.
+	struct FrameCaptureRecord
+	{
+		uint64_t timestamp = 0;
+		uint32_t frameIndex = 0;
+		uint32_t duration = 0;
+		uint32_t passEnum = 0;
+		uint32_t vertexDescriptor = 0;
+		uint32_t pixelDescriptor = 0;
+		uint32_t renderFlags = 0;
+		// Bucket for draws and batches, renderer index for renderer scopes.
+		uint16_t index = 0;
+		FrameCaptureRecordType type = FrameCaptureRecordType::Frame;
+		// RE::BSShader::Type for draws, FrameCaptureScope for scopes.
+		uint8_t kind = 0;
+		uint8_t depth = 0;
+		uint8_t reserved[3]{};
+	};
+	static_assert(sizeof(FrameCaptureRecord) == 40);
+
+	struct FrameCaptureHeader
+	{
+		static constexpr uint32_t Magic = 0x46454953;  // SIEF
+		static constexpr uint32_t Version = 1;
+
+		uint32_t magic = Magic;
+		uint32_t version = Version;
+		uint32_t recordSize = sizeof(FrameCaptureRecord);
+		uint32_t capacity = 0;
+		// Total number of records written, the ring holds the last capacity of them.
+		uint64_t writeIndex = 0;
+		double timestampsPerNanosecond = 0.;
+	};
+	static_assert(sizeof(FrameCaptureHeader) == 32);
+
+	struct FrameCapture
+	{
+		FrameCaptureHeader header;
+		std::vector<FrameCaptureRecord> records;
+	};
+
+	// Returns records still held by the ring in the order they were written.
+	bool ReadFrameCapture(const std::filesystem::path& path, FrameCapture& capture);
+}
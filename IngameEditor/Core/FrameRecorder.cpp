@@ -0,0 +1,238 @@
+#include "Core/FrameRecorder.h"
+
+#include "Core/ShaderCache.h"
+
+#include <Windows.h>
+
+namespace SIE
+{
+	namespace SFrameRecorder
+	{
+		constexpr const char* CapturePath = "Data/SKSE/plugins/SIE/FrameCapture.bin";
+		constexpr uint32_t MaxScopeDepth = 64;
+
+		struct ThreadState
+		{
+			std::array<uint64_t, MaxScopeDepth> scopeStarts{};
+			uint32_t scopeDepth = 0;
+			uint64_t drawStart = 0;
+			uint32_t vertexDescriptor = 0;
+			uint32_t pixelDescriptor = 0;
+			uint16_t bucketIndex = 0;
+		};
+
+		static thread_local ThreadState threadState;
+
+		static uint32_t GetDuration(uint64_t startTimestamp)
+		{
+			const uint64_t duration = ShaderCache::GetTimestamp() - startTimestamp;
+			return duration < UINT32_MAX ? static_cast<uint32_t>(duration) : UINT32_MAX;
+		}
+	}
+
+	FrameRecorder::FrameRecorder() :
+		path(SFrameRecorder::CapturePath)
+	{}
+
+	FrameRecorder::~FrameRecorder()
+	{
+		Close();
+	}
+
+	bool FrameRecorder::IsEnabled() const
+	{
+		return isEnabled;
+	}
+
+	void FrameRecorder::SetEnabled(bool value)
+	{
+		isEnabled = value;
+	}
+
+	size_t FrameRecorder::GetCapacity() const
+	{
+		return capacity;
+	}
+
+	void FrameRecorder::SetCapacity(size_t value)
+	{
+		capacity = std::clamp<size_t>(value, 1 << 10, UINT32_MAX);
+	}
+
+	const std::filesystem::path& FrameRecorder::GetPath() const
+	{
+		return path;
+	}
+
+	void FrameRecorder::OnFrame()
+	{
+		if (isEnabled != IsRecording())
+		{
+			if (!isEnabled)
+			{
+				Close();
+			}
+			else if (!Open())
+			{
+				isEnabled = false;
+			}
+		}
+		if (!IsRecording())
+		{
+			return;
+		}
+
+		header->timestampsPerNanosecond = ShaderCache::Instance().GetTimestampsPerNanosecond();
+		++frameIndex;
+		FrameCaptureRecord record;
+		record.timestamp = ShaderCache::GetTimestamp();
+		record.type = FrameCaptureRecordType::Frame;
+		Append(record);
+	}
+
+	void FrameRecorder::BeginScope()
+	{
+		if (!IsRecording())
+		{
+			return;
+		}
+
+		auto& state = SFrameRecorder::threadState;
+		if (state.scopeDepth < SFrameRecorder::MaxScopeDepth)
+		{
+			state.scopeStarts[state.scopeDepth] = ShaderCache::GetTimestamp();
+		}
+		++state.scopeDepth;
+	}
+
+	void FrameRecorder::EndScope(FrameCaptureScope scope, uint32_t index, uint32_t renderFlags)
+	{
+		auto& state = SFrameRecorder::threadState;
+		// Scope may have begun before recording did.
+		if (!IsRecording() || state.scopeDepth == 0)
+		{
+			return;
+		}
+
+		--state.scopeDepth;
+		if (state.scopeDepth >= SFrameRecorder::MaxScopeDepth)
+		{
+			return;
+		}
+
+		FrameCaptureRecord record;
+		record.timestamp = state.scopeStarts[state.scopeDepth];
+		record.duration = SFrameRecorder::GetDuration(record.timestamp);
+		record.renderFlags = renderFlags;
+		record.index = static_cast<uint16_t>(index);
+		record.type = FrameCaptureRecordType::Scope;
+		record.kind = static_cast<uint8_t>(scope);
+		record.depth = static_cast<uint8_t>(state.scopeDepth);
+		Append(record);
+	}
+
+	void FrameRecorder::SetBucket(uint32_t bucketIndex)
+	{
+		SFrameRecorder::threadState.bucketIndex = static_cast<uint16_t>(bucketIndex);
+	}
+
+	void FrameRecorder::SetTechnique(uint32_t vertexDescriptor, uint32_t pixelDescriptor)
+	{
+		auto& state = SFrameRecorder::threadState;
+		state.vertexDescriptor = vertexDescriptor;
+		state.pixelDescriptor = pixelDescriptor;
+	}
+
+	void FrameRecorder::BeginDraw()
+	{
+		if (IsRecording())
+		{
+			SFrameRecorder::threadState.drawStart = ShaderCache::GetTimestamp();
+		}
+	}
+
+	void FrameRecorder::EndDraw(RE::BSShader::Type shaderType, uint32_t passEnum,
+		uint32_t renderFlags)
+	{
+		const auto& state = SFrameRecorder::threadState;
+		if (!IsRecording() || state.drawStart == 0)
+		{
+			return;
+		}
+
+		FrameCaptureRecord record;
+		record.timestamp = state.drawStart;
+		record.duration = SFrameRecorder::GetDuration(record.timestamp);
+		record.passEnum = passEnum;
+		record.vertexDescriptor = state.vertexDescriptor;
+		record.pixelDescriptor = state.pixelDescriptor;
+		record.renderFlags = renderFlags;
+		record.index = state.bucketIndex;
+		record.type = FrameCaptureRecordType::Draw;
+		record.kind = static_cast<uint8_t>(shaderType);
+		record.depth = static_cast<uint8_t>(state.scopeDepth < SFrameRecorder::MaxScopeDepth ?
+												state.scopeDepth :
+												SFrameRecorder::MaxScopeDepth);
+		Append(record);
+	}
+
+	bool FrameRecorder::Open()
+	{
+		std::error_code errorCode;
+		std::filesystem::create_directories(path.parent_path(), errorCode);
+
+		const uint64_t fileSize = sizeof(FrameCaptureHeader) + capacity * sizeof(FrameCaptureRecord);
+		file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			file = nullptr;
+			logger::error("Failed to create frame capture file {}", path.string());
+			return false;
+		}
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize), nullptr);
+		void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, fileSize) :
+		                                  nullptr;
+		if (view == nullptr)
+		{
+			logger::error("Failed to map frame capture file {}", path.string());
+			Close();
+			return false;
+		}
+
+		header = new (view) FrameCaptureHeader;
+		header->capacity = static_cast<uint32_t>(capacity);
+		records = reinterpret_cast<FrameCaptureRecord*>(header + 1);
+		frameIndex = 0;
+		return true;
+	}
+
+	void FrameRecorder::Close()
+	{
+		if (header != nullptr)
+		{
+			UnmapViewOfFile(header);
+		}
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		if (file != nullptr)
+		{
+			CloseHandle(file);
+		}
+		header = nullptr;
+		records = nullptr;
+		mapping = nullptr;
+		file = nullptr;
+	}
+
+	void FrameRecorder::Append(FrameCaptureRecord& record)
+	{
+		record.frameIndex = frameIndex;
+		const uint64_t writeIndex =
+			std::atomic_ref(header->writeIndex).fetch_add(1, std::memory_order_relaxed);
+		records[writeIndex % header->capacity] = record;
+	}
+}
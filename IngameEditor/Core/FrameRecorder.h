@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Core/FrameCapture.h"
+
+#include <RE/B/BSShader.h>
+
+namespace SIE
+{
+	// Streams per frame scope and draw records of the render thread into a memory mapped ring
+	// file, which is read offline by Tools/FrameCaptureAnalyzer.
+	class FrameRecorder
+	{
+	public:
+		static FrameRecorder& Instance()
+		{
+			static FrameRecorder instance;
+			return instance;
+		}
+
+		// Recording starts and stops on the next frame.
+		bool IsEnabled() const;
+		void SetEnabled(bool value);
+		// Ring size in records, applied when recording starts.
+		size_t GetCapacity() const;
+		void SetCapacity(size_t value);
+		const std::filesystem::path& GetPath() const;
+		bool IsRecording() const { return records != nullptr; }
+
+		void OnFrame();
+
+		void BeginScope();
+		void EndScope(FrameCaptureScope scope, uint32_t index = 0, uint32_t renderFlags = 0);
+		void SetBucket(uint32_t bucketIndex);
+		void SetTechnique(uint32_t vertexDescriptor, uint32_t pixelDescriptor);
+		void BeginDraw();
+		void EndDraw(RE::BSShader::Type shaderType, uint32_t passEnum, uint32_t renderFlags);
+
+	private:
+		FrameRecorder();
+		~FrameRecorder();
+
+		bool Open();
+		void Close();
+		void Append(FrameCaptureRecord& record);
+
+		std::filesystem::path path;
+		bool isEnabled = false;
+		size_t capacity = 1 << 20;
+		uint32_t frameIndex = 0;
+
+		void* file = nullptr;
+		void* mapping = nullptr;
+		FrameCaptureHeader* header = nullptr;
+		FrameCaptureRecord* records = nullptr;
+	};
+}
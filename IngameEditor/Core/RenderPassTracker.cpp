@@ -0,0 +1,143 @@
+#include "Core/RenderPassTracker.h"
+
+#include <RE/B/BSRenderPass.h>
+
+namespace SIE
+{
+	namespace SRenderPassTracker
+	{
+		struct RenderPassCache
+		{
+			struct Pool
+			{
+				RE::BSRenderPass* passes;
+				RE::BSLight** lights;
+				RE::BSRenderPass* firstAvailable;
+				RE::BSRenderPass* lastAvailable;
+				RE::BSSpinLock lock;
+			};
+
+			std::array<Pool, RenderPassTracker::PoolCount> pools;
+		};
+	}
+
+	RenderPassTracker::RenderPassTracker()
+	{
+		for (auto& poolSlotTypes : slotTypes)
+		{
+			poolSlotTypes.fill(FreeSlot);
+		}
+	}
+
+	bool RenderPassTracker::IsEnabled() const
+	{
+		return isEnabled;
+	}
+
+	void RenderPassTracker::SetEnabled(bool value)
+	{
+		isEnabled = value;
+	}
+
+	size_t RenderPassTracker::GetPassesPerFrame() const
+	{
+		return passesPerFrame;
+	}
+
+	void RenderPassTracker::SetPassesPerFrame(size_t value)
+	{
+		passesPerFrame = std::clamp<size_t>(value, 256, PoolCount * PassCount);
+	}
+
+	size_t RenderPassTracker::GetSweepFrameCount() const
+	{
+		return (PoolCount * PassCount + passesPerFrame - 1) / passesPerFrame;
+	}
+
+	void RenderPassTracker::OnFrame()
+	{
+		static const REL::Relocation<SRenderPassTracker::RenderPassCache*> renderPassCache(
+			RELOCATION_ID(528206, 415150));
+
+		if (!isEnabled)
+		{
+			return;
+		}
+
+		for (size_t index = 0; index < passesPerFrame; ++index)
+		{
+			const size_t poolIndex = sweepPosition / PassCount;
+			const size_t passIndex = sweepPosition % PassCount;
+			const RE::BSRenderPass& pass = (*renderPassCache).pools[poolIndex].passes[passIndex];
+
+			uint8_t slotType = FreeSlot;
+			if (pass.passEnum != 0)
+			{
+				slotType = pass.shaderProperty != nullptr ?
+				               static_cast<uint8_t>(pass.shader->shaderType.get()) :
+				               static_cast<uint8_t>(RE::BSShader::Type::Total);
+			}
+			Track(poolIndex, passIndex, slotType);
+
+			if (++sweepPosition == PoolCount * PassCount)
+			{
+				FinishSweep();
+			}
+		}
+	}
+
+	void RenderPassTracker::ResetHighWater()
+	{
+		for (auto& pool : pools)
+		{
+			pool.highWater = pool.used;
+			pool.totalHighWater = pool.totalUsed;
+		}
+	}
+
+	const RenderPassTracker::PoolStatistics& RenderPassTracker::GetPoolStatistics(
+		size_t poolIndex) const
+	{
+		return pools[poolIndex];
+	}
+
+	void RenderPassTracker::GetHistory(std::array<float, HistorySize>& slotChanges) const
+	{
+		for (size_t index = 0; index < HistorySize; ++index)
+		{
+			const size_t historyIndex = (historyPosition + index) % HistorySize;
+			slotChanges[index] = static_cast<float>(slotChangeHistory[historyIndex]);
+		}
+	}
+
+	void RenderPassTracker::Track(size_t poolIndex, size_t passIndex, uint8_t slotType)
+	{
+		auto& previousSlotType = slotTypes[poolIndex][passIndex];
+		if (previousSlotType == slotType)
+		{
+			return;
+		}
+
+		auto& pool = pools[poolIndex];
+		if (previousSlotType != FreeSlot)
+		{
+			--pool.used[previousSlotType];
+			--pool.totalUsed;
+		}
+		if (slotType != FreeSlot)
+		{
+			pool.highWater[slotType] = std::max(pool.highWater[slotType], ++pool.used[slotType]);
+			pool.totalHighWater = std::max(pool.totalHighWater, ++pool.totalUsed);
+		}
+		previousSlotType = slotType;
+		++sweepSlotChanges;
+	}
+
+	void RenderPassTracker::FinishSweep()
+	{
+		slotChangeHistory[historyPosition] = sweepSlotChanges;
+		historyPosition = (historyPosition + 1) % HistorySize;
+		sweepSlotChanges = 0;
+		sweepPosition = 0;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <RE/B/BSShader.h>
+
+namespace SIE
+{
+	// Render pass pool occupancy maintained incrementally: every frame a bounded slice of both
+	// pools is compared against the state seen on the previous sweep and counters are adjusted
+	// by the difference.
+	class RenderPassTracker
+	{
+	public:
+		static constexpr size_t PoolCount = 2;
+		static constexpr size_t PassCount = 65535;
+		// Last one counts used passes without a shader property.
+		static constexpr size_t TypeCount = static_cast<size_t>(RE::BSShader::Type::Total) + 1;
+		static constexpr size_t HistorySize = 128;
+
+		struct PoolStatistics
+		{
+			std::array<uint32_t, TypeCount> used{};
+			// Approximate, a sweep samples the slots of a pool across several frames.
+			std::array<uint32_t, TypeCount> highWater{};
+			uint32_t totalUsed = 0;
+			uint32_t totalHighWater = 0;
+		};
+
+		static RenderPassTracker& Instance()
+		{
+			static RenderPassTracker instance;
+			return instance;
+		}
+
+		bool IsEnabled() const;
+		void SetEnabled(bool value);
+		size_t GetPassesPerFrame() const;
+		void SetPassesPerFrame(size_t value);
+		// Frames one sweep over all passes of both pools takes.
+		size_t GetSweepFrameCount() const;
+
+		void OnFrame();
+		void ResetHighWater();
+
+		const PoolStatistics& GetPoolStatistics(size_t poolIndex) const;
+		// Slots whose type changed since the previous sweep for each of the last sweeps, oldest
+		// first. Passes allocated and freed between two visits of their slot are not seen.
+		void GetHistory(std::array<float, HistorySize>& slotChanges) const;
+
+	private:
+		static constexpr uint8_t FreeSlot = 0xFF;
+
+		RenderPassTracker();
+
+		void Track(size_t poolIndex, size_t passIndex, uint8_t slotType);
+		void FinishSweep();
+
+		bool isEnabled = false;
+		size_t passesPerFrame = 8192;
+		size_t sweepPosition = 0;
+		uint32_t sweepSlotChanges = 0;
+
+		std::array<std::array<uint8_t, PassCount>, PoolCount> slotTypes;
+		std::array<PoolStatistics, PoolCount> pools;
+
+		std::array<uint32_t, HistorySize> slotChangeHistory{};
+		size_t historyPosition = 0;
+	};
+}
@@ -1,5 +1,8 @@
 #include "Core/ShaderCache.h"
 
+#include "Core/ShaderConstantNameTable.h"
+#include "Core/ShaderDescriptorSchema.h"
+
 #include <RE/B/BSImageSpaceShader.h>
 #include <RE/I/ImageSpaceManager.h>
 #include <RE/V/VertexDesc.h>
@@ -24,6 +27,9 @@ namespace SIE
 		constexpr const char* GeometryShaderProfile = "hs_5_0";
 		constexpr const char* HullShaderProfile = "hs_5_0";
 		constexpr const char* DomainShaderProfile = "ds_5_0";
+		constexpr const char* DiskCachePath = "Data/SKSE/plugins/SIE/ShaderCache";
+		constexpr const char* TracePath = "Data/SKSE/plugins/SIE/ShaderTrace.bin";
+		constexpr const char* ManifestPath = "Data/SKSE/plugins/SIE/ShaderManifest.bin";
 
 		static std::wstring GetShaderPath(const std::string_view& name) 
 		{ 
@@ -49,2681 +55,3065 @@ namespace SIE
 			}
 		}
 
-		uint32_t GetTechnique(uint32_t descriptor)
-		{
-			return 0x3F & (descriptor >> 24);
-		}
-
-		enum class LightingShaderTechniques
-		{
-			None					= 0,
-			Envmap					= 1,
-			Glowmap					= 2,
-			Parallax				= 3,
-			Facegen					= 4,
-			FacegenRGBTint			= 5,
-			Hair					= 6,
-			ParallaxOcc				= 7,
-			MTLand					= 8,
-			LODLand					= 9,
-			Snow					= 10,	// unused
-			MultilayerParallax		= 11,
-			TreeAnim				= 12,
-			LODObjects				= 13,
-			MultiIndexSparkle		= 14,
-			LODObjectHD				= 15,
-			Eye						= 16,
-			Cloud					= 17,	// unused
-			LODLandNoise			= 18,
-			MTLandLODBlend			= 19,
-			Outline					= 20,
-		};
-
-		enum class LightingShaderFlags
-		{
-			VC						= 1 << 0,
-			Skinned					= 1 << 1,
-			ModelSpaceNormals		= 1 << 2,
-			// flags 3 to 8 are unused
-			Specular				= 1 << 9,
-			SoftLighting			= 1 << 10,
-			RimLighting				= 1 << 11,
-			BackLighting			= 1 << 12,
-			ShadowDir				= 1 << 13,
-			DefShadow				= 1 << 14,
-			ProjectedUV				= 1 << 15,
-			AnisoLighting			= 1 << 16,
-			AmbientSpecular			= 1 << 17,
-			WorldMap				= 1 << 18,
-			BaseObjectIsSnow		= 1 << 19,
-			DoAlphaTest				= 1 << 20,
-			Snow					= 1 << 21,
-			CharacterLight			= 1 << 22,
-			AdditionalAlphaMask		= 1 << 23,
-		};
-
-		static void GetLightingShaderDefines(uint32_t descriptor,
-			D3D_SHADER_MACRO* defines)
-		{
-			static REL::Relocation<void(uint32_t, D3D_SHADER_MACRO*)> VanillaGetLightingShaderDefines(
-				RELOCATION_ID(101631, 108698));
-
-			const auto technique =
-				static_cast<LightingShaderTechniques>(GetTechnique(descriptor));
-
-			if (technique == LightingShaderTechniques::Outline)
-			{
-				defines[0] = { "OUTLINE", nullptr };
-				++defines;
-			}
-
-			VanillaGetLightingShaderDefines(descriptor, defines);
-		}
-
-		enum class BloodSplatterShaderTechniques
-		{
-			Splatter = 0,
-			Flare = 1,
-		};
-
-		static void GetBloodSplaterShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			if (descriptor == static_cast<uint32_t>(BloodSplatterShaderTechniques::Splatter))
-			{
-				defines[0] = { "SPLATTER", nullptr };
-				++defines;
-			}
-			else if (descriptor == static_cast<uint32_t>(BloodSplatterShaderTechniques::Flare))
-			{
-				defines[0] = { "FLARE", nullptr };
-				++defines;
-			}
-			defines[0] = { nullptr, nullptr };
-		}
-
-		enum class DistantTreeShaderTechniques
-		{
-			DistantTreeBlock = 0,
-			Depth = 1,
-		};
-
-		enum class DistantTreeShaderFlags
-		{
-			AlphaTest = 0x10000,
-		};
-
-		static void GetDistantTreeShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			const auto technique = descriptor & 1;
-			if (technique == static_cast<uint32_t>(DistantTreeShaderTechniques::Depth))
-			{
-				defines[0] = { "RENDER_DEPTH", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(DistantTreeShaderFlags::AlphaTest))
-			{
-				defines[0] = { "DO_ALPHA_TEST", nullptr };
-				++defines;
-			}
-			defines[0] = { nullptr, nullptr };
-		}
+		static constexpr auto ImagespaceRules = [] {
+			using enum RE::ImageSpaceManager::ImageSpaceEffectEnum;
 
-		enum class SkyShaderTechniques
-		{
-			SunOcclude = 0,
-			SunGlare = 1,
-			MoonAndStarsMask = 2,
-			Stars = 3,
-			Clouds = 4,
-			CloudsLerp = 5,
-			CloudsFade = 6,
-			Texture = 7,
-			Sky = 8,
-		};
+			DescriptorRuleTable<256> table;
+			const auto add = [&table](uint32_t descriptor, const char* name,
+								 const char* definition = nullptr) {
+				table.Add(DescriptorRule::Equal(descriptor, name, definition));
+			};
+			const auto value = [](RE::ImageSpaceManager::ImageSpaceEffectEnum effect) {
+				return static_cast<uint32_t>(effect);
+			};
 
-		static void GetSkyShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			const auto technique = static_cast<SkyShaderTechniques>(descriptor);
-			switch (technique)
+			add(value(ISBlur), "BLUR_RADIUS", "0");
+			for (uint32_t descriptor = value(ISBlur3); descriptor <= value(ISBrightPassBlur15);
+				 ++descriptor)
 			{
-			case SkyShaderTechniques::SunOcclude:
-				{
-					defines[0] = { "OCCLUSION", nullptr };
-					++defines;
-					break;
-				}
-			case SkyShaderTechniques::SunGlare:
-				{
-					defines[0] = { "TEX", nullptr };
-					defines[1] = { "DITHER", nullptr };
-					defines += 2;
-					break;
-				}
-			case SkyShaderTechniques::MoonAndStarsMask:
+				constexpr uint32_t BlurRadiusCount = 7;
+				const uint32_t blurIndex = descriptor - value(ISBlur3);
+				add(descriptor, "BLUR_RADIUS",
+					DescriptorFieldValues[3 + 2 * (blurIndex % BlurRadiusCount)]);
+				if (blurIndex / BlurRadiusCount == 1)
 				{
-					defines[0] = { "TEX", nullptr };
-					defines[1] = { "MOONMASK", nullptr };
-					defines += 2;
-					break;
+					add(descriptor, "BLUR_NON_HDR");
 				}
-			case SkyShaderTechniques::Stars:
+				else if (blurIndex / BlurRadiusCount == 2)
 				{
-					defines[0] = { "HORIZFADE", nullptr };
-					++defines;
-					break;
+					add(descriptor, "BLUR_BRIGHT_PASS");
 				}
-			case SkyShaderTechniques::Clouds:
+			}
+
+			add(value(ISDisplayDepth), "DISPLAY_DEPTH");
+			add(value(ISSimpleColor), "SIMPLE_COLOR");
+			add(value(ISCopyDynamicFetchDisabled), "DYNAMIC_FETCH_DISABLED");
+			add(value(ISCopyGrayScale), "GRAY_SCALE");
+			add(value(ISCopyTextureMask), "TEXTURE_MASK");
+			add(value(ISCompositeLensFlare), "VOLUMETRIC_LIGHTING");
+			add(value(ISCompositeVolumetricLighting), "LENS_FLARE");
+			add(value(ISCompositeLensFlareVolumetricLighting), "VOLUMETRIC_LIGHTING");
+			add(value(ISCompositeLensFlareVolumetricLighting), "LENS_FLARE");
+
+			for (uint32_t descriptor = value(ISDepthOfField);
+				 descriptor <= value(ISDistantBlurMaskedFogged); ++descriptor)
+			{
+				add(descriptor, descriptor <= value(ISDepthOfFieldMaskedFogged) ? "DOF" :
+				                                                                  "DISTANT_BLUR");
+				if (descriptor != value(ISDepthOfField) && descriptor != value(ISDistantBlur))
 				{
-					defines[0] = { "TEX", nullptr };
-					defines[1] = { "CLOUDS", nullptr };
-					defines += 2;
-					break;
+					add(descriptor, "FOGGED");
 				}
-			case SkyShaderTechniques::CloudsLerp:
+				if (descriptor == value(ISDepthOfFieldMaskedFogged) ||
+					descriptor == value(ISDistantBlurMaskedFogged))
 				{
-					defines[0] = { "TEX", nullptr };
-					defines[1] = { "CLOUDS", nullptr };
-					defines[2] = { "TEXLERP", nullptr };
-					defines += 3;
-					break;
+					add(descriptor, "MASKED");
 				}
-			case SkyShaderTechniques::CloudsFade:
+			}
+
+			add(value(ISDownsampleIgnoreBrightest), "IGNORE_BRIGHTEST");
+			add(value(ISHDRTonemapBlendCinematic), "TONEMAP");
+			add(value(ISHDRTonemapBlendCinematicFade), "TONEMAP");
+			add(value(ISHDRTonemapBlendCinematicFade), "FADE");
+
+			for (uint32_t descriptor = value(ISHDRDownSample16);
+				 descriptor <= value(ISHDRDownSample16LightAdapt); ++descriptor)
+			{
+				add(descriptor, "DOWNSAMPLE");
+				const bool isSixteenSamples = descriptor == value(ISHDRDownSample16) ||
+				                              descriptor == value(ISHDRDownSample16Lum) ||
+				                              descriptor == value(ISHDRDownSample16LightAdapt) ||
+				                              descriptor == value(ISHDRDownSample16LumClamp);
+				add(descriptor, "SAMPLES_COUNT", isSixteenSamples ? "16" : "4");
+				if (descriptor == value(ISHDRDownSample4RGB2Lum))
 				{
-					defines[0] = { "TEX", nullptr };
-					defines[1] = { "CLOUDS", nullptr };
-					defines[2] = { "TEXFADE", nullptr };
-					defines += 3;
-					break;
+					add(descriptor, "RGB2LUM");
 				}
-			case SkyShaderTechniques::Texture:
+				else if (descriptor == value(ISHDRDownSample16Lum) ||
+						 descriptor == value(ISHDRDownSample16LumClamp))
 				{
-					defines[0] = { "TEX", nullptr };
-					++defines;
-					break;
+					add(descriptor, "LUM");
 				}
-			case SkyShaderTechniques::Sky:
+				else if (descriptor == value(ISHDRDownSample16LightAdapt) ||
+						 descriptor == value(ISHDRDownSample4LightAdapt))
 				{
-					defines[0] = { "DITHER", nullptr };
-					++defines;
-					break;
+					add(descriptor, "LIGHT_ADAPT");
 				}
 			}
-			
-			defines[0] = { nullptr, nullptr };
-		}
 
-		enum class GrassShaderTechniques
-		{
-			VertLit = 0,
-			FlatLit = 1,
-			FlatLitSlope = 2,
-			VertLitSlope = 3,
-			VertLitBillboard = 4,
-			FlatLitBillboard = 5,
-			FlatLitSlopeBillboard = 6,
-			VertLitSlopeBillboard = 7,
-			RenderDepth = 8,
-		};
+			add(value(ISLightingCompositeMenu), "MENU");
+			add(value(ISLightingCompositeNoDirectionalLight), "NO_DIRECTIONAL_LIGHT");
+			add(value(ISWaterBlendHeightmaps), "BLEND_HEIGHTMAPS");
+			add(value(ISWaterDisplacementClearSimulation), "CLEAR_SIMULATION");
+			add(value(ISWaterDisplacementNormals), "NORMALS");
+			add(value(ISWaterDisplacementRainRipple), "RAIN_RIPPLE");
+			add(value(ISWaterDisplacementTexOffset), "TEX_OFFSET");
+			add(value(ISWaterSmoothHeightmap), "SMOOTH_HEIGHTMAP");
+			add(value(ISWaterRainHeightmap), "RAIN_HEIGHTMAP");
+			add(value(ISWaterWadingHeightmap), "WADING_HEIGHTMAP");
+			add(value(ISWorldMapNoSkyBlur), "NO_SKY_BLUR");
+			add(value(ISMinifyContrast), "CONTRAST");
+			add(value(ISNoiseNormalmap), "NORMALMAP");
+			add(value(ISNoiseScrollAndBlend), "SCROLL_AND_BLEND");
+			add(value(ISRadialBlur), "SAMPLES_COUNT", "2");
+			add(value(ISRadialBlurHigh), "SAMPLES_COUNT", "10");
+			add(value(ISRadialBlurMedium), "SAMPLES_COUNT", "6");
 
-		enum class GrassShaderFlags
-		{
-			AlphaTest = 0x10000,
-		};
+			return table;
+		}();
 
-		static void GetGrassShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
+		constexpr ShaderDescriptorSchema ImagespaceShaderSchema = { ImagespaceRules.GetRules(), 0,
+			{} };
+
+		static const ShaderDescriptorSchema* GetDescriptorSchema(RE::BSShader::Type type)
 		{
-			const auto technique = descriptor & 0b1111;
-			if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLit))
-			{
-				defines[0] = { "VERTLIT", nullptr };
-				++defines;
-			}
-			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::FlatLitSlope))
-			{
-				defines[0] = { "SLOPE", nullptr };
-				++defines;
-			}
-			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLitSlope))
-			{
-				defines[0] = { "VERTLIT", nullptr };
-				++defines;
-			}
-			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLitBillboard))
-			{
-				defines[0] = { "VERTLIT", nullptr };
-				++defines;
-				defines[0] = { "BILLBOARD", nullptr };
-				++defines;
-			}
-			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::FlatLitBillboard))
-			{
-				defines[0] = { "BILLBOARD", nullptr };
-				++defines;
-			}
-			else if (technique ==
-					 static_cast<uint32_t>(GrassShaderTechniques::FlatLitSlopeBillboard))
-			{
-				defines[0] = { "SLOPE", nullptr };
-				++defines;
-				defines[0] = { "BILLBOARD", nullptr };
-				++defines;
-			}
-			else if (technique ==
-					 static_cast<uint32_t>(GrassShaderTechniques::VertLitSlopeBillboard))
-			{
-				defines[0] = { "VERTLIT", nullptr };
-				++defines;
-				defines[0] = { "SLOPE", nullptr };
-				++defines;
-				defines[0] = { "BILLBOARD", nullptr };
-				++defines;
-			}
-			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::RenderDepth))
-			{
-				defines[0] = { "RENDER_DEPTH", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(GrassShaderFlags::AlphaTest))
+			switch (type)
 			{
-				defines[0] = { "DO_ALPHA_TEST", nullptr };
-				++defines;
+			case RE::BSShader::Type::Grass:
+				return &GrassShaderSchema;
+			case RE::BSShader::Type::Sky:
+				return &SkyShaderSchema;
+			case RE::BSShader::Type::Water:
+				return &WaterShaderSchema;
+			case RE::BSShader::Type::BloodSplatter:
+				return &BloodSplatterShaderSchema;
+			case RE::BSShader::Type::ImageSpace:
+				return &ImagespaceShaderSchema;
+			case RE::BSShader::Type::Lighting:
+				return &LightingShaderSchema;
+			case RE::BSShader::Type::DistantTree:
+				return &DistantTreeShaderSchema;
+			case RE::BSShader::Type::Particle:
+				return &ParticleShaderSchema;
+			case RE::BSShader::Type::Effect:
+				return &EffectShaderSchema;
+			case RE::BSShader::Type::Utility:
+				return &UtilityShaderSchema;
 			}
-			defines[0] = { nullptr, nullptr };
+			return nullptr;
 		}
 
-		enum class ParticleShaderTechniques
-		{
-			Particles = 0,
-			ParticlesGryColor = 1,
-			ParticlesGryAlpha = 2,
-			ParticlesGryColorAlpha = 3,
-			EnvCubeSnow = 4,
-			EnvCubeRain = 5,
-		};
+		static_assert(sizeof(ShaderDefine) == sizeof(D3D_SHADER_MACRO) &&
+					  offsetof(ShaderDefine, name) == offsetof(D3D_SHADER_MACRO, Name) &&
+					  offsetof(ShaderDefine, definition) == offsetof(D3D_SHADER_MACRO, Definition));
 
-		static void GetParticleShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
+		static std::array<std::array<ShaderConstantNameTable,
+							  static_cast<size_t>(ShaderClass::Total)>,
+			static_cast<size_t>(RE::BSShader::Type::Total)>
+			GetConstantNameTables()
 		{
-			const auto technique = static_cast<ParticleShaderTechniques>(descriptor);
-			switch (technique)
-			{
-			case ParticleShaderTechniques::ParticlesGryColor:
-				{
-					defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
-					++defines;
-					break;
-				}
-			case ParticleShaderTechniques::ParticlesGryAlpha:
-				{
-					defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
-					++defines;
-					break;
-				}
-			case ParticleShaderTechniques::ParticlesGryColorAlpha:
-				{
-					defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
-					defines[1] = { "GRAYSCALE_TO_ALPHA", nullptr };
-					defines += 2;
-					break;
-				}
-			case ParticleShaderTechniques::EnvCubeSnow:
-				{
-					defines[0] = { "ENVCUBE", nullptr };
-					defines[1] = { "SNOW", nullptr };
-					defines += 2;
-					break;
-				}
-			case ParticleShaderTechniques::EnvCubeRain:
-				{
-					defines[0] = { "ENVCUBE", nullptr };
-					defines[1] = { "RAIN", nullptr };
-					defines += 2;
-					break;
-				}
-			}
+			std::array<std::array<ShaderConstantNameTable,
+						   static_cast<size_t>(ShaderClass::Total)>,
+				static_cast<size_t>(RE::BSShader::Type::Total)>
+				result;
 
-			defines[0] = { nullptr, nullptr };
-		}
-
-		enum class EffectShaderFlags
-		{
-			Vc						= 1 << 0,
-			TexCoord				= 1 << 1,
-			TexCoordIndex			= 1 << 2,
-			Skinned					= 1 << 3,
-			Normals					= 1 << 4,
-			BinormalTangent			= 1 << 5,
-			Texture					= 1 << 6,
-			IndexedTexture			= 1 << 7,
-			Falloff					= 1 << 8,
-			AddBlend				= 1 << 10,
-			MultBlend				= 1 << 11,
-			Particles				= 1 << 12,
-			StripParticles			= 1 << 13,
-			Blood					= 1 << 14,
-			Membrane				= 1 << 15,
-			Lighting				= 1 << 16,
-			ProjectedUv				= 1 << 17,
-			Soft					= 1 << 18,
-			GrayscaleToColor		= 1 << 19,
-			GrayscaleToAlpha		= 1 << 20,
-			IgnoreTexAlpha			= 1 << 21,
-			MultBlendDecal			= 1 << 22,
-			AlphaTest				= 1 << 23,
-			SkyObject				= 1 << 24,
-			MsnSpuSkinned			= 1 << 25,
-			MotionVectorsNormals	= 1 << 26,
-		};
+			auto& lightingVS =
+				result[static_cast<size_t>(RE::BSShader::Type::Lighting)][static_cast<size_t>(ShaderClass::Vertex)];
+			lightingVS = {
+				{ "HighDetailRange", 12 },
+				{ "FogParam", 13 },
+				{ "FogNearColor", 14 },
+				{ "FogFarColor", 15 },
+				{ "LeftEyeCenter", 9 },
+				{ "RightEyeCenter", 10 },
+				{ "TexcoordOffset", 11 },
+				{ "World", 0 },
+				{ "PreviousWorld", 1 },
+				{ "EyePosition", 2 },
+				{ "LandBlendParams", 3 },
+				{ "TreeParams", 4 },
+				{ "WindTimers", 5 },
+				{ "TextureProj", 6 },
+				{ "IndexScale", 7 },
+				{ "WorldMapOverlayParameters", 8 },
+				{ "Bones", 16 },
+			};
 
-		static void GetEffectShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Vc))
-			{
-				defines[0] = { "VC", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::TexCoord))
-			{
-				defines[0] = { "TEXCOORD", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::TexCoordIndex))
-			{
-				defines[0] = { "TEXCOORD_INDEX", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Skinned))
-			{
-				defines[0] = { "SKINNED", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Normals))
-			{
-				defines[0] = { "NORMALS", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::BinormalTangent))
-			{
-				defines[0] = { "BINORMAL_TANGENT", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Texture))
-			{
-				defines[0] = { "TEXTURE", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::IndexedTexture))
-			{
-				defines[0] = { "INDEXED_TEXTURE", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Falloff))
-			{
-				defines[0] = { "FALLOFF", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::AddBlend))
-			{
-				defines[0] = { "ADDBLEND", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MultBlend))
-			{
-				defines[0] = { "MULTBLEND", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Particles))
-			{
-				defines[0] = { "PARTICLES", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::StripParticles))
-			{
-				defines[0] = { "STRIP_PARTICLES", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Blood))
-			{
-				defines[0] = { "BLOOD", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Membrane))
-			{
-				defines[0] = { "MEMBRANE", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Lighting))
-			{
-				defines[0] = { "LIGHTING", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::ProjectedUv))
-			{
-				defines[0] = { "PROJECTED_UV", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Soft))
-			{
-				defines[0] = { "SOFT", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::GrayscaleToColor))
-			{
-				defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::GrayscaleToAlpha))
-			{
-				defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::IgnoreTexAlpha))
-			{
-				defines[0] = { "IGNORE_TEX_ALPHA", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MultBlendDecal))
-			{
-				defines[0] = { "MULTBLEND_DECAL", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::AlphaTest))
-			{
-				defines[0] = { "ALPHA_TEST", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::SkyObject))
-			{
-				defines[0] = { "SKY_OBJECT", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MsnSpuSkinned))
-			{
-				defines[0] = { "MSN_SPU_SKINNED", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MotionVectorsNormals))
-			{
-				defines[0] = { "MOTIONVECTORS_NORMALS", nullptr };
-				++defines;
-			}
+			auto& lightingPS = result[static_cast<size_t>(RE::BSShader::Type::Lighting)]
+									 [static_cast<size_t>(ShaderClass::Pixel)];
+			lightingPS = {
+				{ "VPOSOffset", 11 },
+				{ "FogColor", 19 },
+				{ "ColourOutputClamp", 20 },
+				{ "EnvmapData", 21 },
+				{ "ParallaxOccData", 22 },
+				{ "TintColor", 23 },
+				{ "LODTexParams", 24 },
+				{ "SpecularColor", 25 },
+				{ "SparkleParams", 26 },
+				{ "MultiLayerParallaxData", 27 },
+				{ "LightingEffectParams", 28 },
+				{ "IBLParams", 29 },
+				{ "LandscapeTexture1to4IsSnow", 30 },
+				{ "LandscapeTexture5to6IsSnow", 31 },
+				{ "LandscapeTexture1to4IsSpecPower", 32 },
+				{ "LandscapeTexture5to6IsSpecPower", 33 },
+				{ "SnowRimLightParameters", 34 },
+				{ "CharacterLightParams", 35 },
+				{ "NumLightNumShadowLight", 0 },
+				{ "PointLightPosition", 1 },
+				{ "PointLightColor", 2 },
+				{ "DirLightDirection", 3 },
+				{ "DirLightColor", 4 },
+				{ "DirectionalAmbient", 5 },
+				{ "AmbientSpecularTintAndFresnelPower", 6 },
+				{ "MaterialData", 7 },
+				{ "EmitColor", 8 },
+				{ "AlphaTestRef", 9 },
+				{ "ShadowLightMaskSelect", 10 },
+				{ "ProjectedUVParams", 12 },
+				{ "ProjectedUVParams2", 13 },
+				{ "ProjectedUVParams3", 14 },
+				{ "SplitDistance", 15 },
+				{ "SSRParams", 16 },
+				{ "WorldMapOverlayParametersPS", 17 },
+				{ "AmbientColor", 18 },
+			};
 
-			defines[0] = { nullptr, nullptr };
-		}
+			auto& bloodSplatterVS = result[static_cast<size_t>(RE::BSShader::Type::BloodSplatter)]
+									 [static_cast<size_t>(ShaderClass::Vertex)];
+			bloodSplatterVS = {
+				{ "WorldViewProj", 0 },
+				{ "LightLoc", 1 },
+				{ "Ctrl", 2 },
+			};
 
-		enum class WaterShaderTechniques
-		{
-			Underwater = 8,
-			Lod = 9,
-			Stencil = 10,
-			Simple = 11,
-		};
+			auto& bloodSplatterPS = result[static_cast<size_t>(RE::BSShader::Type::BloodSplatter)]
+										  [static_cast<size_t>(ShaderClass::Pixel)];
+			bloodSplatterPS = {
+				{ "Alpha", 0 },
+			};
 
-		enum class WaterShaderFlags
-		{
-			Vc = 1 << 0,
-			NormalTexCoord = 1 << 1,
-			Reflections = 1 << 2,
-			Refractions = 1 << 3,
-			Depth = 1 << 4,
-			Interior = 1 << 5,
-			Wading = 1 << 6,
-			VertexAlphaDepth = 1 << 7,
-			Cubemap = 1 << 8,
-			Flowmap = 1 << 9,
-			BlendNormals = 1 << 10,
-		};
+			auto& distantTreeVS = result[static_cast<size_t>(RE::BSShader::Type::DistantTree)]
+										  [static_cast<size_t>(ShaderClass::Vertex)];
+			distantTreeVS = {
+				{ "WorldViewProj", 1 },
+				{ "World", 2 },
+				{ "PreviousWorld", 3 },
+				{ "FogParam", 4 },
+			};
 
-		static void GetWaterShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			defines[0] = { "WATER", nullptr };
-			defines[1] = { "FOG", nullptr };
-			defines += 2;
+			auto& distantTreePS = result[static_cast<size_t>(RE::BSShader::Type::DistantTree)]
+										  [static_cast<size_t>(ShaderClass::Pixel)];
+			distantTreePS = {
+				{ "DiffuseColor", 0 },
+				{ "AmbientColor", 1 },
+			};
 
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Vc))
+			auto& skyVS = result[static_cast<size_t>(RE::BSShader::Type::Sky)]
+										[static_cast<size_t>(ShaderClass::Vertex)];
+			skyVS = {
+				{ "WorldViewProj", 0 },
+				{ "World", 1 },
+				{ "PreviousWorld", 2 },
+				{ "BlendColor", 3 },
+				{ "EyePosition", 4 },
+				{ "TexCoordOff", 5 },
+				{ "VParams", 6 },
+			};
+
+			auto& skyPS = result[static_cast<size_t>(RE::BSShader::Type::Sky)]
+										[static_cast<size_t>(ShaderClass::Pixel)];
+			skyPS = {
+				{ "PParams", 0 },
+			};
+
+			auto& grassVS = result[static_cast<size_t>(RE::BSShader::Type::Grass)]
+										[static_cast<size_t>(ShaderClass::Vertex)];
+			grassVS = {
+				{ "WorldViewProj", 0 },
+				{ "WorldView", 1 },
+				{ "World", 2 },
+				{ "PreviousWorld", 3 },
+				{ "FogNearColor", 4 },
+				{ "WindVector", 5 },
+				{ "WindTimer", 6 },
+				{ "DirLightDirection", 7 },
+				{ "PreviousWindTimer", 8 },
+				{ "DirLightColor", 9 },
+				{ "AlphaParam1", 10 },
+				{ "AmbientColor", 11 },
+				{ "AlphaParam2", 12 },
+				{ "ScaleMask", 13 },
+				{ "ShadowClampValue", 14 },
+			};
+
+			auto& particleVS = result[static_cast<size_t>(RE::BSShader::Type::Particle)]
+								[static_cast<size_t>(ShaderClass::Vertex)];
+			particleVS = {
+				{ "WorldViewProj", 0 },
+				{ "PrevWorldViewProj", 1 },
+				{ "PrecipitationOcclusionWorldViewProj", 2 },
+				{ "fVars0", 3 },
+				{ "fVars1", 4 },
+				{ "fVars2", 5 },
+				{ "fVars3", 6 },
+				{ "fVars4", 7 },
+				{ "Color1", 8 },
+				{ "Color2", 9 },
+				{ "Color3", 10 },
+				{ "Velocity", 11 },
+				{ "Acceleration", 12 },
+				{ "ScaleAdjust", 13 },
+				{ "Wind", 14 },
+			};
+
+			auto& particlePS = result[static_cast<size_t>(RE::BSShader::Type::Particle)]
+								[static_cast<size_t>(ShaderClass::Pixel)];
+			particlePS = {
+				{ "ColorScale", 0 },
+				{ "TextureSize", 1 },
+			};
+
+			auto& effectVS = result[static_cast<size_t>(RE::BSShader::Type::Effect)]
+									 [static_cast<size_t>(ShaderClass::Vertex)];
+			effectVS = {
+				{ "World", 0 },
+				{ "PreviousWorld", 1 },
+				{ "Bones", 2 },
+				{ "EyePosition", 3 },
+				{ "FogParam", 4 },
+				{ "FogNearColor", 5 },
+				{ "FogFarColor", 6 },
+				{ "FalloffData", 7 },
+				{ "SoftMateralVSParams", 8 },
+				{ "TexcoordOffset", 9 },
+				{ "TexcoordOffsetMembrane", 10 },
+				{ "SubTexOffset", 11 },
+				{ "PosAdjust", 12 },
+				{ "MatProj", 13 },
+			};
+
+			auto& effectPS = result[static_cast<size_t>(RE::BSShader::Type::Effect)]
+									 [static_cast<size_t>(ShaderClass::Pixel)];
+			effectPS = {
+				{ "PropertyColor", 0 },
+				{ "AlphaTestRef", 1 },
+				{ "MembraneRimColor", 2 },
+				{ "MembraneVars", 3 },
+				{ "PLightPositionX", 4 },
+				{ "PLightPositionY", 5 },
+				{ "PLightPositionZ", 6 },
+				{ "PLightingRadiusInverseSquared", 7 },
+				{ "PLightColorR", 8 },
+				{ "PLightColorG", 9 },
+				{ "PLightColorB", 10 },
+				{ "DLightColor", 11 },
+				{ "VPOSOffset", 12 },
+				{ "CameraData", 13 },
+				{ "FilteringParam", 14 },
+				{ "BaseColor", 15 },
+				{ "BaseColorScale", 16 },
+				{ "LightingInfluence", 17 },
+			};
+
+			auto& waterVS = result[static_cast<size_t>(RE::BSShader::Type::Water)]
+								   [static_cast<size_t>(ShaderClass::Vertex)];
+			waterVS = {
+				{ "WorldViewProj", 0 },
+				{ "World", 1 },
+				{ "PreviousWorld", 2 },
+				{ "QPosAdjust", 3 },
+				{ "ObjectUV", 4 },
+				{ "NormalsScroll0", 5 },
+				{ "NormalsScroll1", 6 },
+				{ "NormalsScale", 7 },
+				{ "VSFogParam", 8 },
+				{ "VSFogNearColor", 9 },
+				{ "VSFogFarColor", 10 },
+				{ "CellTexCoordOffset", 11 },
+				{ "SubTexOffset", 12 },
+				{ "PosAdjust", 13 },
+				{ "MatProj", 14 },
+			};
+
+			auto& waterPS = result[static_cast<size_t>(RE::BSShader::Type::Water)]
+								   [static_cast<size_t>(ShaderClass::Pixel)];
+			waterPS = {
+				{ "TextureProj", 0 },
+				{ "ShallowColor", 1 },
+				{ "DeepColor", 2 },
+				{ "ReflectionColor", 3 },
+				{ "FresnelRI", 4 },
+				{ "BlendRadius", 5 },
+				{ "PosAdjust", 6 },
+				{ "ReflectPlane", 7 },
+				{ "CameraData", 8 },
+				{ "ProjData", 9 },
+				{ "VarAmounts", 10 },
+				{ "FogParam", 11 },
+				{ "FogNearColor", 12 },
+				{ "FogFarColor", 13 },
+				{ "SunDir", 14 },
+				{ "SunColor", 15 },
+				{ "NumLights", 16 },
+				{ "LightPos", 17 },
+				{ "LightColor", 18 },
+				{ "WaterParams", 19 },
+				{ "DepthControl", 20 },
+				{ "SSRParams", 21 },
+				{ "SSRParams2", 22 },
+				{ "NormalsAmplitude", 23 },
+				{ "VPOSOffset", 24 },
+			};
+
+			auto& utilityVS = result[static_cast<size_t>(RE::BSShader::Type::Utility)]
+									[static_cast<size_t>(ShaderClass::Vertex)];
+			utilityVS = {
+				{ "World", 0 },
+				{ "TexcoordOffset", 1 },
+				{ "EyePos", 2 },
+				{ "HighDetailRange", 3 },
+				{ "ParabolaParam", 4 },
+				{ "ShadowFadeParam", 5 },
+				{ "TreeParams", 6 },
+				{ "WaterParams", 7 },
+				{ "Bones", 8 },
+			};
+
+			auto& utilityPS = result[static_cast<size_t>(RE::BSShader::Type::Utility)]
+								  [static_cast<size_t>(ShaderClass::Pixel)];
+			utilityPS = {
+				{ "AlphaTestRef", 0 },
+				{ "RefractionPower", 1 },
+				{ "DebugColor", 2 },
+				{ "BaseColor", 3 },
+				{ "PropertyColor", 4 },
+				{ "FocusShadowMapProj", 5 },
+				{ "ShadowMapProj", 6 },
+				{ "ShadowSampleParam", 7 },
+				{ "ShadowLightParam", 8 },
+				{ "ShadowFadeParam", 9 },
+				{ "VPOSOffset", 10 },
+				{ "EndSplitDistances", 11 },
+				{ "StartSplitDistances", 12 },
+				{ "FocusShadowFadeParam", 13 },
+			};
+
+			return result;
+		}
+
+		static std::array<ShaderConstantNameTable, static_cast<size_t>(ShaderClass::Total)>
+			GetImagespaceConstantNameTables(const RE::BSImagespaceShader& shader)
+		{
+			std::array<ShaderConstantNameTable, static_cast<size_t>(ShaderClass::Total)> result;
+			const auto getNames = [](const auto& constantNames) {
+				std::vector<ShaderConstantNameTable::Name> names;
+				names.reserve(constantNames.size());
+				for (size_t nameIndex = 0; nameIndex < constantNames.size(); ++nameIndex)
+				{
+					names.push_back({ constantNames[nameIndex].c_str(), static_cast<int32_t>(nameIndex) });
+				}
+				return names;
+			};
+			result[static_cast<size_t>(ShaderClass::Vertex)] =
+				ShaderConstantNameTable(getNames(shader.vsConstantNames));
+			result[static_cast<size_t>(ShaderClass::Pixel)] =
+				ShaderConstantNameTable(getNames(shader.psConstantNames));
+			return result;
+		}
+
+		// Offsets reflected into a shader's constant table depend on the constant names of the
+		// imagespace effect, which every effect has its own of.
+		static uint64_t HashImagespaceConstantNames(ShaderClass shaderClass,
+			const RE::BSImagespaceShader& shader, uint64_t seed)
+		{
+			const auto hashNames = [seed](const auto& constantNames) {
+				const uint64_t count = constantNames.size();
+				uint64_t hash = HashBytes(&count, sizeof(count), seed);
+				for (const auto& name : constantNames)
+				{
+					hash = HashString(name.c_str(), hash);
+				}
+				return hash;
+			};
+			switch (shaderClass)
 			{
-				defines[0] = { "VC", nullptr };
-				++defines;
+			case ShaderClass::Vertex:
+				return hashNames(shader.vsConstantNames);
+			case ShaderClass::Pixel:
+				return hashNames(shader.psConstantNames);
+			default:
+				return seed;
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::NormalTexCoord))
+		}
+
+		static const ShaderConstantNameTable& GetConstantNameTable(ShaderClass shaderClass,
+			const RE::BSShader& shader)
+		{
+			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
 			{
-				defines[0] = { "NORMAL_TEXCOORD", nullptr };
-				++defines;
+				// Imagespace shaders are created once by the game, their names never change.
+				static std::mutex imagespaceMutex;
+				static std::unordered_map<const RE::BSShader*,
+					std::array<ShaderConstantNameTable, static_cast<size_t>(ShaderClass::Total)>>
+					imagespaceTables;
+
+				std::lock_guard lockGuard(imagespaceMutex);
+				auto it = imagespaceTables.find(&shader);
+				if (it == imagespaceTables.end())
+				{
+					it = imagespaceTables
+					         .emplace(&shader, GetImagespaceConstantNameTables(
+													static_cast<const RE::BSImagespaceShader&>(shader)))
+					         .first;
+				}
+				return it->second[static_cast<size_t>(shaderClass)];
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Reflections))
+
+			static const auto constantNameTables = GetConstantNameTables();
+			return constantNameTables[static_cast<size_t>(shader.shaderType.get())]
+									 [static_cast<size_t>(shaderClass)];
+		}
+
+		static void AddAttribute(uint64_t& desc, RE::BSGraphics::Vertex::Attribute attribute) 
+		{ 
+			desc |= ((1ull << (44 + attribute)) | (1ull << (54 + attribute)) |
+					 (0b1111ull << (4 * attribute + 4)));
+		}
+
+		static void ReflectConstantBuffers(ID3D11ShaderReflection& reflector,
+			std::array<uint32_t, 3>& bufferSizes,
+			std::vector<int8_t>& constantOffsets,
+			uint64_t& vertexDesc,
+			ShaderClass shaderClass, uint32_t descriptor, const RE::BSShader& shader)
+		{
+			D3D11_SHADER_DESC desc;
+			if (FAILED(reflector.GetDesc(&desc)))
 			{
-				defines[0] = { "REFLECTIONS", nullptr };
-				++defines;
+				logger::error("Failed to get shader descriptor for {} shader {}::{}",
+					magic_enum::enum_name(shaderClass), magic_enum::enum_name(shader.shaderType.get()),
+					descriptor);
+				return;
+			}
+
+			if (shaderClass == ShaderClass::Vertex)
+			{
+				vertexDesc = 0b1111;
+				bool hasTexcoord2 = false;
+				bool hasTexcoord3 = false;
+				for (uint32_t inputIndex = 0; inputIndex < desc.InputParameters; ++inputIndex)
+				{
+					D3D11_SIGNATURE_PARAMETER_DESC inputDesc;
+					if (FAILED(reflector.GetInputParameterDesc(inputIndex, &inputDesc)))
+					{
+						logger::error(
+							"Failed to get input parameter {} descriptor for {} shader {}::{}",
+							inputIndex, magic_enum::enum_name(shaderClass),
+							magic_enum::enum_name(shader.shaderType.get()),
+							descriptor);
+					}
+					else
+					{
+						std::string_view semanticName = inputDesc.SemanticName;
+						if (semanticName == "POSITION" && inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_POSITION);
+						}
+						else if (semanticName == "TEXCOORD" &&
+								 inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_TEXCOORD0);
+						}
+						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex == 1)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_TEXCOORD1);
+						}
+						else if (semanticName == "NORMAL" &&
+								 inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_NORMAL);
+						}
+						else if (semanticName == "BINORMAL" && inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_BINORMAL);
+						}
+						else if (semanticName == "COLOR" &&
+								 inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_COLOR);
+						}
+						else if (semanticName == "BLENDWEIGHT" && inputDesc.SemanticIndex == 0)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_SKINNING);
+						}
+						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex >= 4 &&
+								 inputDesc.SemanticIndex <= 7)
+						{
+							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_INSTANCEDATA);
+						}
+						else if (semanticName == "TEXCOORD" &&
+								 inputDesc.SemanticIndex == 2)
+						{
+							hasTexcoord2 = true;
+						}
+						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex == 3)
+						{
+							hasTexcoord3 = true;
+						}
+					}
+				}
+				if (hasTexcoord2)
+				{
+					if (hasTexcoord3)
+					{
+						AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_LANDDATA);
+					}
+					else
+					{
+						AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_EYEDATA);
+					}
+				}
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Refractions))
+
+			if (desc.ConstantBuffers <= 0)
 			{
-				defines[0] = { "REFRACTIONS", nullptr };
-				++defines;
+				return;
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Depth))
+
+			const auto& constantNameTable = GetConstantNameTable(shaderClass, shader);
+			auto mapBufferConsts =
+				[&](const char* bufferName, uint32_t& bufferSize)
+			{
+				auto bufferReflector = reflector.GetConstantBufferByName(bufferName);
+				if (bufferReflector == nullptr)
+				{
+					logger::warn("Buffer {} not found for {} shader {}::{}",
+						bufferName, magic_enum::enum_name(shaderClass),
+						magic_enum::enum_name(shader.shaderType.get()),
+						descriptor);
+					return;
+				}
+
+				D3D11_SHADER_BUFFER_DESC bufferDesc;
+				if (FAILED(bufferReflector->GetDesc(&bufferDesc)))
+				{
+					logger::warn("Failed to get buffer {} descriptor for {} shader {}::{}",
+						bufferName, magic_enum::enum_name(shaderClass),
+						magic_enum::enum_name(shader.shaderType.get()),
+						descriptor);
+					return;
+				}
+
+				for (uint32_t i = 0; i < bufferDesc.Variables; i++)
+				{
+					ID3D11ShaderReflectionVariable* var = bufferReflector->GetVariableByIndex(i);
+
+					D3D11_SHADER_VARIABLE_DESC varDesc;
+					if (FAILED(var->GetDesc(&varDesc)))
+					{
+						logger::error("Failed to get variable descriptor for {} shader {}::{}",
+							magic_enum::enum_name(shaderClass),
+							magic_enum::enum_name(shader.shaderType.get()),
+							descriptor);
+						continue;
+					}
+
+					const auto* entry = constantNameTable.Find(varDesc.Name);
+					const bool variableFound = entry != nullptr && entry->index != -1;
+					if (variableFound)
+					{
+						constantOffsets[entry->index] = varDesc.StartOffset / 4;
+					}
+
+					D3D11_SHADER_TYPE_DESC varTypeDesc;
+					if (shader.shaderType != RE::BSShader::Type::ImageSpace ||
+						FAILED(var->GetType()->GetDesc(&varTypeDesc)) || varTypeDesc.Elements == 0)
+					{
+						if (!variableFound)
+						{
+							logger::error("Unknown variable name {} in {} shader {}::{}", varDesc.Name,
+								magic_enum::enum_name(shaderClass),
+								magic_enum::enum_name(shader.shaderType.get()), descriptor);
+						}
+						continue;
+					}
+
+					// Imagespace arrays are either named as a whole ("Name[Size]") or their
+					// elements are named separately, the first one without a subscript.
+					if (!variableFound)
+					{
+						const auto variableArrayIndex = entry != nullptr ?
+						                                    constantNameTable.GetElementIndex(*entry,
+																varTypeDesc.Elements) :
+						                                    -1;
+						if (variableArrayIndex != -1)
+						{
+							constantOffsets[variableArrayIndex] = varDesc.StartOffset / 4;
+						}
+						else
+						{
+							logger::error("Unknown variable name {}[{}] in {} shader {}::{}",
+								varDesc.Name, varTypeDesc.Elements, magic_enum::enum_name(shaderClass),
+								magic_enum::enum_name(shader.shaderType.get()), descriptor);
+						}
+						continue;
+					}
+
+					const auto elementSize = varDesc.Size / varTypeDesc.Elements;
+					uint32_t mappedElements = 1;
+					for (const auto& element : constantNameTable.GetElements(*entry))
+					{
+						if (element.arrayIndex > 0 && element.arrayIndex < varTypeDesc.Elements)
+						{
+							constantOffsets[element.index] =
+								(varDesc.StartOffset + elementSize * element.arrayIndex) / 4;
+							++mappedElements;
+						}
+					}
+					if (mappedElements != varTypeDesc.Elements)
+					{
+						logger::error("Only {} of {} elements of variable {} are known in {} shader {}::{}",
+							mappedElements, varTypeDesc.Elements, varDesc.Name,
+							magic_enum::enum_name(shaderClass),
+							magic_enum::enum_name(shader.shaderType.get()), descriptor);
+					}
+				}
+
+				bufferSize = ((bufferDesc.Size + 15) & ~15) / 16;
+			};
+
+			mapBufferConsts("PerTechnique", bufferSizes[0]);
+			mapBufferConsts("PerMaterial", bufferSizes[1]);
+			mapBufferConsts("PerGeometry", bufferSizes[2]);
+		}
+
+		static std::string_view GetShaderName(const RE::BSShader& shader)
+		{
+			return shader.shaderType == RE::BSShader::Type::ImageSpace ?
+			           std::string_view(static_cast<const RE::BSImagespaceShader&>(shader).originalShaderName) :
+			           shader.fxpFilename;
+		}
+
+		static std::filesystem::path::string_type GetSourcePath(const RE::BSShader& shader)
+		{
+			return std::filesystem::path(GetShaderPath(GetShaderName(shader)))
+			    .lexically_normal()
+			    .native();
+		}
+
+		static std::array<ShaderDefine, 64> GetDefines(ShaderClass shaderClass,
+			const RE::BSShader& shader, uint32_t descriptor)
+		{
+			std::array<ShaderDefine, 64> defines;
+			size_t count = 0;
+			if (shaderClass == ShaderClass::Vertex)
 			{
-				defines[0] = { "DEPTH", nullptr };
-				++defines;
+				defines[count++] = { "VSHADER", nullptr };
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Interior))
+			else if (shaderClass == ShaderClass::Pixel)
 			{
-				defines[0] = { "INTERIOR", nullptr };
-				++defines;
+				defines[count++] = { "PSHADER", nullptr };
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Wading))
+			else if (shaderClass == ShaderClass::Geometry)
 			{
-				defines[0] = { "WADING", nullptr };
-				++defines;
+				defines[count++] = { "GSHADER", nullptr };
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::VertexAlphaDepth))
+			else if (shaderClass == ShaderClass::Hull)
 			{
-				defines[0] = { "VERTEX_ALPHA_DEPTH", nullptr };
-				++defines;
+				defines[count++] = { "HSHADER", nullptr };
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Cubemap))
+			else if (shaderClass == ShaderClass::Domain)
 			{
-				defines[0] = { "CUBEMAP", nullptr };
-				++defines;
+				defines[count++] = { "DSHADER", nullptr };
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Flowmap))
+			if (const auto schema = GetDescriptorSchema(shader.shaderType.get()))
 			{
-				defines[0] = { "FLOWMAP", nullptr };
-				++defines;
+				// Last element is kept as the terminator expected by the compiler.
+				count += DecodeDescriptor(*schema, descriptor,
+					std::span(defines).subspan(count, defines.size() - count - 1));
 			}
-			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::BlendNormals))
+
+			// Many descriptors only differ in define order or in repeated defines, sorting
+			// lets them share one compiled shader.
+			count = CanonicalizeDefines(std::span(defines).first(count));
+			std::fill(defines.begin() + count, defines.end(), ShaderDefine{});
+
+			return defines;
+		}
+
+		struct EvictionCandidate
+		{
+			ShaderClass shaderClass = ShaderClass::Vertex;
+			size_t typeIndex = 0;
+			uint32_t descriptor = 0;
+			uint64_t lastUseFrame = 0;
+		};
+
+		// nextCandidateFrame is lowered to the first frame in which a shader that is still too
+		// recently used would become a candidate.
+		template <typename ShaderMaps>
+		static void CollectEvictionCandidates(ShaderClass shaderClass, const ShaderMaps& shaderMaps,
+			uint64_t currentFrame, uint64_t minIdleFrames, std::vector<EvictionCandidate>& candidates,
+			uint64_t& nextCandidateFrame)
+		{
+			for (size_t typeIndex = 0; typeIndex < shaderMaps.size(); ++typeIndex)
 			{
-				defines[0] = { "BLEND_NORMALS", nullptr };
-				++defines;
+				shaderMaps[typeIndex].ForEachEntry(
+					[&](uint32_t descriptor, const auto&, const auto& entryInfo) {
+						if (entryInfo.lastUseFrame + minIdleFrames < currentFrame)
+						{
+							candidates.push_back(
+								{ shaderClass, typeIndex, descriptor, entryInfo.lastUseFrame });
+						}
+						else if (entryInfo.lastUseFrame + minIdleFrames + 1 < nextCandidateFrame)
+						{
+							nextCandidateFrame = entryInfo.lastUseFrame + minIdleFrames + 1;
+						}
+					});
 			}
+		}
+
+		struct ShaderPermutation
+		{
+			std::array<ShaderDefine, 64> defines;
+			std::string definesString;
+			ShaderCacheKey key;
+		};
 
-			const auto technique = (descriptor >> 11) & 0xF;
-			if (technique == static_cast<uint32_t>(WaterShaderTechniques::Underwater))
+		static ShaderPermutation MakePermutation(ShaderClass shaderClass,
+			const RE::BSShader& shader, uint32_t descriptor)
+		{
+			ShaderPermutation result;
+			result.defines = GetDefines(shaderClass, shader, descriptor);
+			result.definesString = MergeDefinesString(result.defines);
+			result.key.shaderType = static_cast<uint32_t>(shader.shaderType.get());
+			result.key.shaderClass = static_cast<uint32_t>(shaderClass);
+			uint64_t nameHash = HashString(GetShaderName(shader));
+			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
 			{
-				defines[0] = { "UNDERWATER", nullptr };
-				++defines;
+				nameHash = HashImagespaceConstantNames(shaderClass,
+					static_cast<const RE::BSImagespaceShader&>(shader), nameHash);
 			}
-			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Lod))
+			result.key.definesHash = HashString(result.definesString, nameHash);
+			return result;
+		}
+
+		// Serves includes from the shared source store, one instance per compilation. Opened
+		// files are kept alive until the compilation finishes.
+		class ShaderIncludeHandler : public ID3DInclude
+		{
+		public:
+			ShaderIncludeHandler(ShaderSourceStore& aSourceStore,
+				std::shared_ptr<const ShaderSourceFile> rootFile) :
+				sourceStore(aSourceStore)
 			{
-				defines[0] = { "LOD", nullptr };
-				++defines;
+				openedFiles.push_back(std::move(rootFile));
 			}
-			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Stencil))
+
+			HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID parentData,
+				LPCVOID* data, UINT* size) override
 			{
-				defines[0] = { "STENCIL", nullptr };
-				++defines;
+				const auto parentIt = std::find_if(openedFiles.cbegin(), openedFiles.cend(),
+					[parentData](const std::shared_ptr<const ShaderSourceFile>& file) {
+						return file->text.data() == parentData;
+					});
+				const auto& parentFile = parentIt != openedFiles.cend() ? *parentIt : openedFiles.front();
+
+				auto file = sourceStore.Get(parentFile->path.parent_path() / fileName);
+				if (file == nullptr)
+				{
+					return E_FAIL;
+				}
+				*data = file->text.data();
+				*size = static_cast<UINT>(file->text.size());
+				openedFiles.push_back(std::move(file));
+				return S_OK;
 			}
-			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Simple))
+
+			HRESULT __stdcall Close(LPCVOID) override
 			{
-				defines[0] = { "SIMPLE", nullptr };
-				++defines;
+				return S_OK;
 			}
-			else if (technique < 8)
+
+		private:
+			ShaderSourceStore& sourceStore;
+			std::vector<std::shared_ptr<const ShaderSourceFile>> openedFiles;
+		};
+
+		static ID3DBlob* CompileShader(ShaderClass shaderClass, const RE::BSShader& shader,
+			uint32_t descriptor, const std::array<ShaderDefine, 64>& defines,
+			ShaderSourceStore& sourceStore)
+		{
+			const auto type = shader.shaderType.get();
+			auto sourceFile = sourceStore.Get(GetSourcePath(shader));
+			if (sourceFile == nullptr)
 			{
-				static constexpr std::array<const char*, 8> numLightDefines = { { "0", "1", "2", "3", "4",
-					"5", "6", "7" } };
-				defines[0] = { "SPECULAR", nullptr };
-				defines[1] = { "NUM_SPECULAR_LIGHTS", numLightDefines[technique] };
-				defines += 2;
+				logger::error("Failed to read source of {} shader {}::{}",
+					magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor);
+				return nullptr;
 			}
 
-			defines[0] = { nullptr, nullptr };
-		}
+			//logger::info("{}, {}", descriptor, MergeDefinesString(defines));
 
-		static void GetImagespaceShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			using enum RE::ImageSpaceManager::ImageSpaceEffectEnum;
+			const std::string sourceName = sourceFile->path.string();
+			const std::string_view sourceText = sourceFile->text;
+			ShaderIncludeHandler includeHandler(sourceStore, std::move(sourceFile));
+
+			ID3DBlob* shaderBlob = nullptr;
+			ID3DBlob* errorBlob = nullptr;
+			const uint32_t flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+			const HRESULT compileResult = D3DCompile(sourceText.data(), sourceText.size(),
+				sourceName.c_str(), reinterpret_cast<const D3D_SHADER_MACRO*>(defines.data()),
+				&includeHandler, "main", GetShaderProfile(shaderClass), flags, 0, &shaderBlob,
+				&errorBlob);
 
-			const auto descEnum =
-				static_cast<RE::ImageSpaceManager::ImageSpaceEffectEnum>(descriptor);
-			if ((descriptor >= static_cast<uint32_t>(ISBlur3) &&
-					descriptor <= static_cast<uint32_t>(ISBrightPassBlur15)) ||
-				descEnum == ISBlur)
+			if (FAILED(compileResult))
 			{
-				if (descEnum == ISBlur)
+				if (errorBlob != nullptr)
+				{
+					logger::error("Failed to compile {} shader {}::{}: {}",
+						magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor,
+						static_cast<char*>(errorBlob->GetBufferPointer()));
+					errorBlob->Release();
+				}
+				if (const auto schema = GetDescriptorSchema(type);
+					schema != nullptr && !IsValidDescriptor(*schema, descriptor))
 				{
-					defines[0] = { "BLUR_RADIUS", "0" };
-					++defines;
+					logger::warn("Descriptor {:08X} of {} shader is not described by its schema",
+						descriptor, magic_enum::enum_name(type));
 				}
-				else
+				if (shaderBlob != nullptr)
 				{
-					static constexpr std::array<const char*, 7> blurRadiusDefines = { { "3", "5",
-						"7", "9", "11", "13", "15" } };
-					const size_t blurRadius = static_cast<size_t>(
-						(descriptor - static_cast<uint32_t>(ISBlur3)) % blurRadiusDefines.size());
-					defines[0] = { "BLUR_RADIUS", blurRadiusDefines[blurRadius] };
-					++defines;
-					const size_t blurType = static_cast<size_t>(
-						(descriptor - static_cast<uint32_t>(ISBlur3)) / blurRadiusDefines.size());
-					if (blurType == 1)
-					{
-						defines[0] = { "BLUR_NON_HDR", nullptr };
-						++defines;
-					}
-					else if (blurType == 2)
-					{
-						defines[0] = { "BLUR_BRIGHT_PASS", nullptr };
-						++defines;
-					}
+					shaderBlob->Release();
 				}
+
+				return nullptr;
 			}
-			else if (descEnum == ISDisplayDepth)
-			{
-				defines[0] = { "DISPLAY_DEPTH", nullptr };
-				++defines;
-			}
-			else if (descEnum == ISSimpleColor)
+			logger::info("Compiled {} shader {}::{}", magic_enum::enum_name(shaderClass),
+				magic_enum::enum_name(type), descriptor);
+
+			return shaderBlob;
+		}
+
+		static std::optional<ShaderReflectionData> ReflectShader(ShaderClass shaderClass,
+			const RE::BSShader& shader, uint32_t descriptor, ID3DBlob& shaderData,
+			size_t constantTableSize)
+		{
+			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
+			const auto reflectionResult = D3DReflect(shaderData.GetBufferPointer(),
+				shaderData.GetBufferSize(), IID_PPV_ARGS(&reflector));
+			if (FAILED(reflectionResult))
 			{
-				defines[0] = { "SIMPLE_COLOR", nullptr };
-				++defines;
+				logger::error("Failed to reflect {} shader {}::{}",
+					magic_enum::enum_name(shaderClass),
+					magic_enum::enum_name(shader.shaderType.get()), descriptor);
+				return std::nullopt;
 			}
-			else if (descEnum == ISCopyDynamicFetchDisabled)
+
+			ShaderReflectionData result;
+			result.constantTable.resize(constantTableSize, 0);
+			ReflectConstantBuffers(*reflector.Get(), result.bufferSizes, result.constantTable,
+				result.vertexDesc, shaderClass, descriptor, shader);
+			return result;
+		}
+
+		std::unique_ptr<RE::BSGraphics::VertexShader> CreateVertexShader(
+			const ShaderCacheEntry& shaderEntry, uint32_t descriptor)
+		{
+			static const auto perTechniqueBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524755, 411371));
+			static const auto perMaterialBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524757, 411373));
+			static const auto perGeometryBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524759, 411375));
+			static const auto bufferData = REL::Relocation<void*>(RELOCATION_ID(524965, 411446));
+
+			const auto& byteCode = shaderEntry.byteCode;
+			const auto& reflection = shaderEntry.reflection;
+
+			auto rawPtr =
+				new uint8_t[sizeof(RE::BSGraphics::VertexShader) + byteCode.size()];
+			auto shaderPtr = new (rawPtr) RE::BSGraphics::VertexShader;
+			memcpy(rawPtr + sizeof(RE::BSGraphics::VertexShader), byteCode.data(),
+				byteCode.size());
+			auto newShader = std::unique_ptr<RE::BSGraphics::VertexShader>(shaderPtr);
+			newShader->byteCodeSize = byteCode.size();
+			newShader->id = descriptor;
+			newShader->shaderDesc = reflection.vertexDesc;
+
+			std::copy_n(reflection.constantTable.cbegin(), newShader->constantTable.size(),
+				newShader->constantTable.begin());
+			if (reflection.bufferSizes[0] != 0)
 			{
-				defines[0] = { "DYNAMIC_FETCH_DISABLED", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer =
+					perTechniqueBuffersArray.get()[reflection.bufferSizes[0]];
 			}
-			else if (descEnum == ISCopyGrayScale)
+			else
 			{
-				defines[0] = { "GRAY_SCALE", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer = nullptr;
+				newShader->constantBuffers[0].data = bufferData.get();
 			}
-			else if (descEnum == ISCopyTextureMask)
+			if (reflection.bufferSizes[1] != 0)
 			{
-				defines[0] = { "TEXTURE_MASK", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer =
+					perMaterialBuffersArray.get()[reflection.bufferSizes[1]];
 			}
-			else if (descEnum == ISCompositeLensFlare)
+			else
 			{
-				defines[0] = { "VOLUMETRIC_LIGHTING", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer = nullptr;
+				newShader->constantBuffers[1].data = bufferData.get();
 			}
-			else if (descEnum == ISCompositeVolumetricLighting)
+			if (reflection.bufferSizes[2] != 0)
 			{
-				defines[0] = { "LENS_FLARE", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer =
+					perGeometryBuffersArray.get()[reflection.bufferSizes[2]];
 			}
-			else if (descEnum == ISCompositeLensFlareVolumetricLighting)
+			else
 			{
-				defines[0] = { "VOLUMETRIC_LIGHTING", nullptr };
-				++defines;
-				defines[0] = { "LENS_FLARE", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer = nullptr;
+				newShader->constantBuffers[2].data = bufferData.get();
 			}
-			else if (descriptor >= static_cast<uint32_t>(ISDepthOfField) &&
-					 descriptor <= static_cast<uint32_t>(ISDistantBlurMaskedFogged))
-			{
-				if (descriptor >= static_cast<uint32_t>(ISDepthOfField) &&
-					descriptor <= static_cast<uint32_t>(ISDepthOfFieldMaskedFogged))
 
-				{
-					defines[0] = { "DOF", nullptr };
-					++defines;
-				}
-				else
-				{
-					defines[0] = { "DISTANT_BLUR", nullptr };
-					++defines;
-				}
-				if (descEnum != ISDepthOfField && descEnum != ISDistantBlur)
-				{
-					defines[0] = { "FOGGED", nullptr };
-					++defines;
-				}
-				if (descEnum == ISDepthOfFieldMaskedFogged || descEnum == ISDistantBlurMaskedFogged)
-				{
-					defines[0] = { "MASKED", nullptr };
-					++defines;
-				}
-			}
-			else if (descEnum == ISDownsampleIgnoreBrightest)
+			return newShader;
+		}
+
+		std::unique_ptr<RE::BSGraphics::PixelShader> CreatePixelShader(
+			const ShaderCacheEntry& shaderEntry, uint32_t descriptor)
+		{
+			static const auto perTechniqueBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524761, 411377));
+			static const auto perMaterialBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524763, 411379));
+			static const auto perGeometryBuffersArray =
+				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524765, 411381));
+			static const auto bufferData = REL::Relocation<void*>(RELOCATION_ID(524967, 411448));
+
+			const auto& reflection = shaderEntry.reflection;
+
+			auto newShader = std::make_unique<RE::BSGraphics::PixelShader>();
+			newShader->id = descriptor;
+
+			std::copy_n(reflection.constantTable.cbegin(), newShader->constantTable.size(),
+				newShader->constantTable.begin());
+			if (reflection.bufferSizes[0] != 0)
 			{
-				defines[0] = { "IGNORE_BRIGHTEST", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer =
+					perTechniqueBuffersArray.get()[reflection.bufferSizes[0]];
 			}
-			else if (descEnum == ISHDRTonemapBlendCinematic)
+			else
 			{
-				defines[0] = { "TONEMAP", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer = nullptr;
+				newShader->constantBuffers[0].data = bufferData.get();
 			}
-			else if (descEnum == ISHDRTonemapBlendCinematicFade)
+			if (reflection.bufferSizes[1] != 0)
 			{
-				defines[0] = { "TONEMAP", nullptr };
-				++defines;
-				defines[0] = { "FADE", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer =
+					perMaterialBuffersArray.get()[reflection.bufferSizes[1]];
 			}
-			else if (descriptor >= static_cast<uint32_t>(ISHDRDownSample16) &&
-					 descriptor <= static_cast<uint32_t>(ISHDRDownSample16LightAdapt))
+			else
 			{
-				defines[0] = { "DOWNSAMPLE", nullptr };
-				++defines;
-				if (descEnum == ISHDRDownSample16 || descEnum == ISHDRDownSample16Lum ||
-					descEnum == ISHDRDownSample16LightAdapt ||
-					descEnum == ISHDRDownSample16LumClamp)
-				{
-					defines[0] = { "SAMPLES_COUNT", "16" };
-					++defines;
-				}
-				else
-				{
-					defines[0] = { "SAMPLES_COUNT", "4" };
-					++defines;
-				}
-				if (descEnum == ISHDRDownSample4RGB2Lum)
-				{
-					defines[0] = { "RGB2LUM", nullptr };
-					++defines;
-				}
-				else if (descEnum == ISHDRDownSample16Lum || descEnum == ISHDRDownSample16LumClamp)
-				{
-					defines[0] = { "LUM", nullptr };
-					++defines;
-				}
-				else if (descEnum == ISHDRDownSample16LightAdapt ||
-						 descEnum == ISHDRDownSample4LightAdapt)
-				{
-					defines[0] = { "LIGHT_ADAPT", nullptr };
-					++defines;
-				}
+				newShader->constantBuffers[1].buffer = nullptr;
+				newShader->constantBuffers[1].data = bufferData.get();
 			}
-			else if (descEnum == ISLightingCompositeMenu)
+			if (reflection.bufferSizes[2] != 0)
 			{
-				defines[0] = { "MENU", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer =
+					perGeometryBuffersArray.get()[reflection.bufferSizes[2]];
 			}
-			else if (descEnum == ISLightingCompositeNoDirectionalLight)
+			else
 			{
-				defines[0] = { "NO_DIRECTIONAL_LIGHT", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer = nullptr;
+				newShader->constantBuffers[2].data = bufferData.get();
 			}
-			else if (descEnum == ISWaterBlendHeightmaps)
+
+			return newShader;
+		}
+
+		template<size_t Count>
+		std::array<Microsoft::WRL::ComPtr<REX::W32::ID3D11Buffer>, Count>
+			CreateDynamicConstantBuffers(REX::W32::ID3D11Device& device)
+		{
+			std::array<Microsoft::WRL::ComPtr<REX::W32::ID3D11Buffer>, Count> result;
+
+			REX::W32::D3D11_BUFFER_DESC descriptor;
+			descriptor.usage = REX::W32::D3D11_USAGE_DYNAMIC;
+			descriptor.bindFlags = REX::W32::D3D11_BIND_CONSTANT_BUFFER;
+			descriptor.cpuAccessFlags = REX::W32::D3D11_CPU_ACCESS_WRITE;
+			descriptor.miscFlags = 0; 
+			descriptor.structureByteStride = 0;
+			for (UINT bufferIndex = 0; bufferIndex < Count; ++bufferIndex)
 			{
-				defines[0] = { "BLEND_HEIGHTMAPS", nullptr };
-				++defines;
+				descriptor.byteWidth = 4 * sizeof(float) * (bufferIndex + 1);
+				REX::W32::ID3D11Buffer* buffer;
+				device.CreateBuffer(&descriptor, nullptr, &buffer);
+				result[bufferIndex] = buffer;
 			}
-			else if (descEnum == ISWaterDisplacementClearSimulation)
+
+			return result;
+		}
+
+		std::unique_ptr<HullShader> CreateHullShader(const ShaderCacheEntry& shaderEntry,
+			uint32_t descriptor)
+		{
+			static const auto device =
+				REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
+			static const auto perTechniqueBuffersArray =
+				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
+			static const auto perMaterialBuffersArray =
+				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
+			static const auto perGeometryBuffersArray =
+				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
+			static std::array<float, HullShader::MaxConstants * 4> bufferData;
+
+			const auto& reflection = shaderEntry.reflection;
+
+			auto newShader = std::make_unique<HullShader>();
+			newShader->id = descriptor;
+
+			std::copy_n(reflection.constantTable.cbegin(), newShader->constantTable.size(),
+				newShader->constantTable.begin());
+			if (reflection.bufferSizes[0] != 0 &&
+				reflection.bufferSizes[0] < perTechniqueBuffersArray.size())
 			{
-				defines[0] = { "CLEAR_SIMULATION", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer =
+					perTechniqueBuffersArray[reflection.bufferSizes[0]].Get();
 			}
-			else if (descEnum == ISWaterDisplacementNormals)
+			else
 			{
-				defines[0] = { "NORMALS", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer = nullptr;
+				newShader->constantBuffers[0].data = bufferData.data();
 			}
-			else if (descEnum == ISWaterDisplacementRainRipple)
+			if (reflection.bufferSizes[1] != 0 &&
+				reflection.bufferSizes[1] < perMaterialBuffersArray.size())
 			{
-				defines[0] = { "RAIN_RIPPLE", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer =
+					perMaterialBuffersArray[reflection.bufferSizes[1]].Get();
 			}
-			else if (descEnum == ISWaterDisplacementTexOffset)
+			else
 			{
-				defines[0] = { "TEX_OFFSET", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer = nullptr;
+				newShader->constantBuffers[1].data = bufferData.data();
 			}
-			else if (descEnum == ISWaterSmoothHeightmap)
+			if (reflection.bufferSizes[2] != 0 &&
+				reflection.bufferSizes[2] < perGeometryBuffersArray.size())
 			{
-				defines[0] = { "SMOOTH_HEIGHTMAP", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer =
+					perGeometryBuffersArray[reflection.bufferSizes[2]].Get();
 			}
-			else if (descEnum == ISWaterRainHeightmap)
+			else
 			{
-				defines[0] = { "RAIN_HEIGHTMAP", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer = nullptr;
+				newShader->constantBuffers[2].data = bufferData.data();
 			}
-			else if (descEnum == ISWaterWadingHeightmap)
+
+			return newShader;
+		}
+
+		std::unique_ptr<DomainShader> CreateDomainShader(const ShaderCacheEntry& shaderEntry,
+			uint32_t descriptor)
+		{
+			static const auto device =
+				REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
+			static const auto perTechniqueBuffersArray =
+				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
+			static const auto perMaterialBuffersArray =
+				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
+			static const auto perGeometryBuffersArray =
+				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
+			static std::array<float, DomainShader::MaxConstants * 4> bufferData;
+
+			const auto& reflection = shaderEntry.reflection;
+
+			auto newShader = std::make_unique<DomainShader>();
+			newShader->id = descriptor;
+
+			std::copy_n(reflection.constantTable.cbegin(), newShader->constantTable.size(),
+				newShader->constantTable.begin());
+			if (reflection.bufferSizes[0] != 0 &&
+				reflection.bufferSizes[0] < perTechniqueBuffersArray.size())
 			{
-				defines[0] = { "WADING_HEIGHTMAP", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer =
+					perTechniqueBuffersArray[reflection.bufferSizes[0]].Get();
 			}
-			else if (descEnum == ISWorldMapNoSkyBlur)
+			else
 			{
-				defines[0] = { "NO_SKY_BLUR", nullptr };
-				++defines;
+				newShader->constantBuffers[0].buffer = nullptr;
+				newShader->constantBuffers[0].data = bufferData.data();
 			}
-			else if (descEnum == ISMinifyContrast)
+			if (reflection.bufferSizes[1] != 0 &&
+				reflection.bufferSizes[1] < perMaterialBuffersArray.size())
 			{
-				defines[0] = { "CONTRAST", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer =
+					perMaterialBuffersArray[reflection.bufferSizes[1]].Get();
 			}
-			else if (descEnum == ISNoiseNormalmap)
+			else
 			{
-				defines[0] = { "NORMALMAP", nullptr };
-				++defines;
+				newShader->constantBuffers[1].buffer = nullptr;
+				newShader->constantBuffers[1].data = bufferData.data();
 			}
-			else if (descEnum == ISNoiseScrollAndBlend)
+			if (reflection.bufferSizes[2] != 0 &&
+				reflection.bufferSizes[2] < perGeometryBuffersArray.size())
 			{
-				defines[0] = { "SCROLL_AND_BLEND", nullptr };
-				++defines;
+				newShader->constantBuffers[2].buffer =
+					perGeometryBuffersArray[reflection.bufferSizes[2]].Get();
 			}
-			else if (descEnum == ISRadialBlur)
+			else
 			{
-				defines[0] = { "SAMPLES_COUNT", "2" };
-				++defines;
+				newShader->constantBuffers[2].buffer = nullptr;
+				newShader->constantBuffers[2].data = bufferData.data();
 			}
-			else if (descEnum == ISRadialBlurHigh)
+
+			return newShader;
+		}
+
+		static bool IsSupportedShader(const RE::BSShader& shader, uint32_t descriptor)
+		{
+			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
 			{
-				defines[0] = { "SAMPLES_COUNT", "10" };
-				++defines;
+				return descriptor != std::numeric_limits<uint32_t>::max();
 			}
-			else if (descEnum == ISRadialBlurMedium)
+			return true;
+		}
+
+		static uint32_t GetImagespaceShaderDescriptor(const RE::BSImagespaceShader& imagespaceShader)
+		{
+			using enum RE::ImageSpaceManager::ImageSpaceEffectEnum;
+
+			static const std::unordered_map<std::string_view, uint32_t> descriptors{
+				{ "BSImagespaceShaderISBlur", static_cast<uint32_t>(ISBlur) },
+				{ "BSImagespaceShaderBlur3", static_cast<uint32_t>(ISBlur3) },
+				{ "BSImagespaceShaderBlur5", static_cast<uint32_t>(ISBlur5) },
+				{ "BSImagespaceShaderBlur7", static_cast<uint32_t>(ISBlur7) },
+				{ "BSImagespaceShaderBlur9", static_cast<uint32_t>(ISBlur9) },
+				{ "BSImagespaceShaderBlur11", static_cast<uint32_t>(ISBlur11) },
+				{ "BSImagespaceShaderBlur13", static_cast<uint32_t>(ISBlur13) },
+				{ "BSImagespaceShaderBlur15", static_cast<uint32_t>(ISBlur15) },
+				{ "BSImagespaceShaderBrightPassBlur3", static_cast<uint32_t>(ISBrightPassBlur3) },
+				{ "BSImagespaceShaderBrightPassBlur5", static_cast<uint32_t>(ISBrightPassBlur5) },
+				{ "BSImagespaceShaderBrightPassBlur7", static_cast<uint32_t>(ISBrightPassBlur7) },
+				{ "BSImagespaceShaderBrightPassBlur9", static_cast<uint32_t>(ISBrightPassBlur9) },
+				{ "BSImagespaceShaderBrightPassBlur11", static_cast<uint32_t>(ISBrightPassBlur11) },
+				{ "BSImagespaceShaderBrightPassBlur13", static_cast<uint32_t>(ISBrightPassBlur13) },
+				{ "BSImagespaceShaderBrightPassBlur15", static_cast<uint32_t>(ISBrightPassBlur15) },
+				{ "BSImagespaceShaderNonHDRBlur3", static_cast<uint32_t>(ISNonHDRBlur3) },
+				{ "BSImagespaceShaderNonHDRBlur5", static_cast<uint32_t>(ISNonHDRBlur5) },
+				{ "BSImagespaceShaderNonHDRBlur7", static_cast<uint32_t>(ISNonHDRBlur7) },
+				{ "BSImagespaceShaderNonHDRBlur9", static_cast<uint32_t>(ISNonHDRBlur9) },
+				{ "BSImagespaceShaderNonHDRBlur11", static_cast<uint32_t>(ISNonHDRBlur11) },
+				{ "BSImagespaceShaderNonHDRBlur13", static_cast<uint32_t>(ISNonHDRBlur13) },
+				{ "BSImagespaceShaderNonHDRBlur15", static_cast<uint32_t>(ISNonHDRBlur15) },
+				{ "BSImagespaceShaderISBasicCopy", static_cast<uint32_t>(ISBasicCopy) },
+				{ "BSImagespaceShaderISSimpleColor", static_cast<uint32_t>(ISSimpleColor) },
+				{ "BSImagespaceShaderApplyReflections", static_cast<uint32_t>(ISApplyReflections) },
+				{ "BSImagespaceShaderISExp", static_cast<uint32_t>(ISExp) },
+				{ "BSImagespaceShaderISDisplayDepth", static_cast<uint32_t>(ISDisplayDepth) },
+				{ "BSImagespaceShaderAlphaBlend", static_cast<uint32_t>(ISAlphaBlend) },
+				{ "BSImagespaceShaderWaterFlow", static_cast<uint32_t>(ISWaterFlow) },
+				{ "BSImagespaceShaderISWaterBlend", static_cast<uint32_t>(ISWaterBlend) },
+				{ "BSImagespaceShaderGreyScale", static_cast<uint32_t>(ISCopyGrayScale) },
+				{ "BSImagespaceShaderCopy", static_cast<uint32_t>(ISCopy) },
+				{ "BSImagespaceShaderCopyScaleBias", static_cast<uint32_t>(ISCopyScaleBias) },
+				{ "BSImagespaceShaderCopyCustomViewport",
+					static_cast<uint32_t>(ISCopyCustomViewport) },
+				{ "BSImagespaceShaderCopyTextureMask", static_cast<uint32_t>(ISCopyTextureMask) },
+				{ "BSImagespaceShaderCopyDynamicFetchDisabled",
+					static_cast<uint32_t>(ISCopyDynamicFetchDisabled) },
+				{ "BSImagespaceShaderISCompositeVolumetricLighting",
+					static_cast<uint32_t>(ISCompositeVolumetricLighting) },
+				{ "BSImagespaceShaderISCompositeLensFlare",
+					static_cast<uint32_t>(ISCompositeLensFlare) },
+				{ "BSImagespaceShaderISCompositeLensFlareVolumetricLighting",
+					static_cast<uint32_t>(ISCompositeLensFlareVolumetricLighting) },
+				{ "BSImagespaceShaderISDebugSnow", static_cast<uint32_t>(ISDebugSnow) },
+				{ "BSImagespaceShaderDepthOfField", static_cast<uint32_t>(ISDepthOfField) },
+				{ "BSImagespaceShaderDepthOfFieldFogged",
+					static_cast<uint32_t>(ISDepthOfFieldFogged) },
+				{ "BSImagespaceShaderDepthOfFieldMaskedFogged",
+					static_cast<uint32_t>(ISDepthOfFieldMaskedFogged) },
+				{ "BSImagespaceShaderDistantBlur", static_cast<uint32_t>(ISDistantBlur) },
+				{ "BSImagespaceShaderDistantBlurFogged",
+					static_cast<uint32_t>(ISDistantBlurFogged) },
+				{ "BSImagespaceShaderDistantBlurMaskedFogged",
+					static_cast<uint32_t>(ISDistantBlurMaskedFogged) },
+				{ "BSImagespaceShaderDoubleVision", static_cast<uint32_t>(ISDoubleVision) },
+				{ "BSImagespaceShaderISDownsample", static_cast<uint32_t>(ISDownsample) },
+				{ "BSImagespaceShaderISDownsampleIgnoreBrightest",
+					static_cast<uint32_t>(ISDownsampleIgnoreBrightest) },
+				{ "BSImagespaceShaderISUpsampleDynamicResolution",
+					static_cast<uint32_t>(ISUpsampleDynamicResolution) },
+				{ "BSImageSpaceShaderVolumetricLighting",
+					static_cast<uint32_t>(ISVolumetricLighting) },
+				{ "BSImagespaceShaderHDRDownSample4", static_cast<uint32_t>(ISHDRDownSample4) },
+				{ "BSImagespaceShaderHDRDownSample4LightAdapt",
+					static_cast<uint32_t>(ISHDRDownSample4LightAdapt) },
+				{ "BSImagespaceShaderHDRDownSample4LumClamp",
+					static_cast<uint32_t>(ISHDRDownSample4LumClamp) },
+				{ "BSImagespaceShaderHDRDownSample4RGB2Lum",
+					static_cast<uint32_t>(ISHDRDownSample4RGB2Lum) },
+				{ "BSImagespaceShaderHDRDownSample16", static_cast<uint32_t>(ISHDRDownSample16) },
+				{ "BSImagespaceShaderHDRDownSample16LightAdapt",
+					static_cast<uint32_t>(ISHDRDownSample16LightAdapt) },
+				{ "BSImagespaceShaderHDRDownSample16Lum",
+					static_cast<uint32_t>(ISHDRDownSample16Lum) },
+				{ "BSImagespaceShaderHDRDownSample16LumClamp",
+					static_cast<uint32_t>(ISHDRDownSample16LumClamp) },
+				{ "BSImagespaceShaderHDRTonemapBlendCinematic",
+					static_cast<uint32_t>(ISHDRTonemapBlendCinematic) },
+				{ "BSImagespaceShaderHDRTonemapBlendCinematicFade",
+					static_cast<uint32_t>(ISHDRTonemapBlendCinematicFade) },
+				{ "BSImagespaceShaderISIBLensFlares", static_cast<uint32_t>(ISIBLensFlares) },
+				{ "BSImagespaceShaderISLightingComposite",
+					static_cast<uint32_t>(ISLightingComposite) },
+				{ "BSImagespaceShaderISLightingCompositeMenu",
+					static_cast<uint32_t>(ISLightingCompositeMenu) },
+				{ "BSImagespaceShaderISLightingCompositeNoDirectionalLight",
+					static_cast<uint32_t>(ISLightingCompositeNoDirectionalLight) },
+				{ "BSImagespaceShaderLocalMap", static_cast<uint32_t>(ISLocalMap) },
+				{ "BSISWaterBlendHeightmaps", static_cast<uint32_t>(ISWaterBlendHeightmaps) },
+				{ "BSISWaterDisplacementClearSimulation",
+					static_cast<uint32_t>(ISWaterDisplacementClearSimulation) },
+				{ "BSISWaterDisplacementNormals",
+					static_cast<uint32_t>(ISWaterDisplacementNormals) },
+				{ "BSISWaterDisplacementRainRipple",
+					static_cast<uint32_t>(ISWaterDisplacementRainRipple) },
+				{ "BSISWaterDisplacementTexOffset",
+					static_cast<uint32_t>(ISWaterDisplacementTexOffset) },
+				{ "BSISWaterWadingHeightmap", static_cast<uint32_t>(ISWaterWadingHeightmap) },
+				{ "BSISWaterRainHeightmap", static_cast<uint32_t>(ISWaterRainHeightmap) },
+				{ "BSISWaterSmoothHeightmap", static_cast<uint32_t>(ISWaterSmoothHeightmap) },
+				{ "BSISWaterWadingHeightmap", static_cast<uint32_t>(ISWaterWadingHeightmap) },
+				{ "BSImagespaceShaderMap", static_cast<uint32_t>(ISMap) },
+				{ "BSImagespaceShaderMap", static_cast<uint32_t>(ISMap) },
+				{ "BSImagespaceShaderWorldMap", static_cast<uint32_t>(ISWorldMap) },
+				{ "BSImagespaceShaderWorldMapNoSkyBlur",
+					static_cast<uint32_t>(ISWorldMapNoSkyBlur) },
+				{ "BSImagespaceShaderISMinify", static_cast<uint32_t>(ISMinify) },
+				{ "BSImagespaceShaderISMinifyContrast", static_cast<uint32_t>(ISMinifyContrast) },
+				{ "BSImagespaceShaderNoiseNormalmap", static_cast<uint32_t>(ISNoiseNormalmap) },
+				{ "BSImagespaceShaderNoiseScrollAndBlend",
+					static_cast<uint32_t>(ISNoiseScrollAndBlend) },
+				{ "BSImagespaceShaderRadialBlur",
+					static_cast<uint32_t>(ISRadialBlur) },
+				{ "BSImagespaceShaderRadialBlurHigh", static_cast<uint32_t>(ISRadialBlurHigh) },
+				{ "BSImagespaceShaderRadialBlurMedium", static_cast<uint32_t>(ISRadialBlurMedium) },
+				{ "BSImagespaceShaderRefraction", static_cast<uint32_t>(ISRefraction) },
+			};
+
+			auto it = descriptors.find(imagespaceShader.name);
+			if (it == descriptors.cend())
 			{
-				defines[0] = { "SAMPLES_COUNT", "6" };
-				++defines;
+				return std::numeric_limits<uint32_t>::max();
 			}
-			defines[0] = { nullptr, nullptr };
+			return it->second;
 		}
 
-		enum class UtilityShaderFlags : uint64_t
+		// Imagespace shaders are cached by effect, unknown effects are left to the game.
+		static std::optional<uint32_t> GetCacheDescriptor(const RE::BSShader& shader,
+			uint32_t rawDescriptor)
 		{
-			Vc = 1 << 0,
-			Texture = 1 << 1,
-			Skinned = 1 << 2,
-			Normals = 1 << 3,
-			BinormalTangent = 1 << 4,
-			AlphaTest = 1 << 7,
-			LodLandscape = 1 << 8,
-			RenderNormal = 1 << 9,
-			RenderNormalFalloff = 1 << 10,
-			RenderNormalClamp = 1 << 11,
-			RenderNormalClear = 1 << 12,
-			RenderDepth = 1 << 13,
-			RenderShadowmap = 1 << 14,
-			RenderShadowmapClamped = 1 << 15,
-			GrayscaleToAlpha = 1 << 15,
-			RenderShadowmapPb = 1 << 16,
-			AdditionalAlphaMask = 1 << 16,
-			DepthWriteDecals = 1 << 17,
-			DebugShadowSplit = 1 << 18,
-			DebugColor = 1 << 19,
-			GrayscaleMask = 1 << 20,
-			RenderShadowmask = 1 << 21,
-			RenderShadowmaskSpot = 1 << 22,
-			RenderShadowmaskPb = 1 << 23,
-			RenderShadowmaskDpb = 1 << 24,
-			RenderBaseTexture = 1 << 25,
-			TreeAnim = 1 << 26,
-			LodObject = 1 << 27,
-			LocalMapFogOfWar = 1 << 28,
-			OpaqueEffect = 1 << 29,
-		};
-
-		static void GetUtilityShaderDefines(uint32_t descriptor, D3D_SHADER_MACRO* defines)
-		{
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Vc))
-			{
-				defines[0] = { "VC", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Texture))
-			{
-				defines[0] = { "TEXTURE", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Skinned))
-			{
-				defines[0] = { "SKINNED", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Normals))
+			uint32_t descriptor = rawDescriptor;
+			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
 			{
-				defines[0] = { "NORMALS", nullptr };
-				++defines;
+				descriptor = GetImagespaceShaderDescriptor(
+					static_cast<const RE::BSImagespaceShader&>(shader));
 			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::AlphaTest))
+			if (!IsSupportedShader(shader, descriptor))
 			{
-				defines[0] = { "ALPHA_TEST", nullptr };
-				++defines;
+				return std::nullopt;
 			}
+			return descriptor;
+		}
+	}
 
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LodLandscape))
-			{
-				if (descriptor &
-					(static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask) |
-						static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot)))
-				{
-					defines[0] = { "FOCUS_SHADOW", nullptr };
-				}
-				else
-				{
-					defines[0] = { "LOD_LANDSCAPE", nullptr };
-				}
-				++defines;
-			}
+	template <typename T>
+	struct SharedShader
+	{
+		std::mutex mutex;
+		bool isInitialized = false;
+		std::optional<ShaderCacheEntry> entry;
+		Microsoft::WRL::ComPtr<std::remove_pointer_t<decltype(T::shader)>> shader;
+		std::filesystem::path::string_type sourcePath;
+		uint64_t key = 0;
+		size_t typeIndex = 0;
+		// Number of published descriptors using the shader and the entry bytecode charged to the
+		// cache while there are any, guarded by sharedShadersMutex.
+		size_t useCount = 0;
+		size_t chargedSize = 0;
+	};
+
+	template <typename T>
+	T* ShaderCache::FindShader(ShaderClass shaderClass, const RE::BSShader& shader,
+		uint32_t descriptor,
+		std::array<ConcurrentShaderMap<T>, static_cast<size_t>(RE::BSShader::Type::Total)>& shaders)
+	{
+		if (hasPendingTraceRecords[static_cast<size_t>(shader.shaderType.underlying())])
+		{
+			EnqueueTraceRecords(shader, descriptor);
+		}
 
-			if ((descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
-				!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
-			{
-				defines[0] = { "RENDER_NORMAL", nullptr };
-				++defines;
-			}
-			else if (!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
-					 (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
-			{
-				defines[0] = { "RENDER_NORMAL_CLEAR", nullptr };
-				++defines;
-			}
-			else if ((descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
-				(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
-			{
-				defines[0] = { "STENCIL_ABOVE_WATER", nullptr };
-				++defines;
-			}
+		if (auto cachedShader =
+				shaders[static_cast<size_t>(shader.shaderType.underlying())].Find(descriptor,
+					GetFrameIndex()))
+		{
+			RecordAccess(shaderClass, shader, true);
+			return cachedShader;
+		}
 
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalFalloff))
-			{
-				defines[0] = { "RENDER_NORMAL_FALLOFF", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClamp))
-			{
-				defines[0] = { "RENDER_NORMAL_CLAMP", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderDepth))
-			{
-				defines[0] = { "RENDER_DEPTH", nullptr };
-				++defines;
-			}
-			
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::OpaqueEffect))
-			{
-				defines[0] = { "OPAQUE_EFFECT", nullptr };
-				++defines;
-				if (!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap)) &&
-					(descriptor & static_cast<uint32_t>(UtilityShaderFlags::AdditionalAlphaMask)))
-				{
-					defines[0] = { "ADDITIONAL_ALPHA_MASK", nullptr };
-					++defines;
-				}
-				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::GrayscaleToAlpha))
-				{
-					defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
-					++defines;
-				}
-			}
-			else
-			{
-				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap))
-				{
-					defines[0] = { "RENDER_SHADOWMAP", nullptr };
-					++defines;
-					if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmapPb))
-					{
-						defines[0] = { "RENDER_SHADOWMAP_PB", nullptr };
-						++defines;
-					}
-				}
-				else if (descriptor &
-						 static_cast<uint32_t>(UtilityShaderFlags::AdditionalAlphaMask))
-				{
-					defines[0] = { "ADDITIONAL_ALPHA_MASK", nullptr };
-					++defines;
-				}
-				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmapClamped))
-				{
-					defines[0] = { "RENDER_SHADOWMAP_CLAMPED", nullptr };
-					++defines;
-				}
-			}
+		RecordAccess(shaderClass, shader, false);
+		RecordTrace(shaderClass, shader, descriptor);
+		return nullptr;
+	}
 
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::GrayscaleMask))
-			{
-				defines[0] = { "GRAYSCALE_MASK", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask))
-			{
-				defines[0] = { "RENDER_SHADOWMASK", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot))
-			{
-				defines[0] = { "RENDER_SHADOWMASKSPOT", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskPb))
-			{
-				defines[0] = { "RENDER_SHADOWMASKPB", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskDpb))
-			{
-				defines[0] = { "RENDER_SHADOWMASKDPB", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderBaseTexture))
-			{
-				defines[0] = { "RENDER_BASE_TEXTURE", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::TreeAnim))
-			{
-				defines[0] = { "TREE_ANIM", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LodObject))
-			{
-				defines[0] = { "LOD_OBJECT", nullptr };
-				++defines;
-			}
-			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LocalMapFogOfWar))
-			{
-				defines[0] = { "LOCALMAP_FOGOFWAR", nullptr };
-				++defines;
-			}
+	RE::BSGraphics::VertexShader* ShaderCache::GetVertexShader(const RE::BSShader& shader,
+		uint32_t rawDescriptor)
+	{
+		const auto descriptor = SShaderCache::GetCacheDescriptor(shader, rawDescriptor);
+		if (!descriptor.has_value())
+		{
+			return nullptr;
+		}
 
-			if (descriptor & (static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask) |
-								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskDpb) |
-								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskPb) |
-								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot)))
-			{
-				static constexpr std::array<const char*, 5> shadowFilters = { { "0", "1", "2",
-					"3", "4" } };
-				const size_t shadowFilterIndex = std::clamp((descriptor >> 17) & 0b111, 0u, 4u);
-				defines[0] = { "SHADOWFILTER", shadowFilters[shadowFilterIndex] };
-				++defines;
-			}
-			else if ((!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::OpaqueEffect)) &&
-						 (descriptor &
-							 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap))) ||
-					 (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderDepth)))
-			{
-				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::DepthWriteDecals))
-				{
-					defines[0] = { "DEPTH_WRITE_DECALS", nullptr };
-					++defines;
-				}
-			}
-			else
-			{
-				if (descriptor & (static_cast<uint32_t>(UtilityShaderFlags::DepthWriteDecals) |
-									 static_cast<uint32_t>(UtilityShaderFlags::DebugColor)))
-				{
-					defines[0] = { "DEBUG_COLOR", nullptr };
-					++defines;
-				}
-				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::DebugShadowSplit))
-				{
-					defines[0] = { "DEBUG_SHADOWSPLIT", nullptr };
-					++defines;
-				}
-			}
+		if (auto cachedShader = FindShader(ShaderClass::Vertex, shader, *descriptor, vertexShaders))
+		{
+			return cachedShader;
+		}
 
-			defines[0] = { "SHADOWSPLITCOUNT", "3" };
-			++defines;
+		if (IsAsync())
+		{
+			compilationSet.Add({ ShaderClass::Vertex, shader, *descriptor }, GetFrameIndex());
+		}
+		else
+		{
+			return MakeAndAddVertexShader(shader, *descriptor);
+		}
 
-			if ((descriptor & 0x14000) != 0x14000 &&
-				((descriptor & 0x20004000) == 0x4000 || (descriptor & 0x1E02000) == 0x2000) &&
-				!(descriptor & 0x80) && (descriptor & 0x14000) != 0x10000)
-			{
-				defines[0] = { "NO_PIXEL_SHADER", nullptr };
-				++defines;
-			}
+		return nullptr;
+	}
 
-			defines[0] = { nullptr, nullptr };
+	RE::BSGraphics::PixelShader* ShaderCache::GetPixelShader(const RE::BSShader& shader,
+		uint32_t rawDescriptor)
+	{
+		const auto descriptor = SShaderCache::GetCacheDescriptor(shader, rawDescriptor);
+		if (!descriptor.has_value())
+		{
+			return nullptr;
 		}
 
-		static void GetShaderDefines(RE::BSShader::Type type, uint32_t descriptor,
-			D3D_SHADER_MACRO* defines)
+		if (auto cachedShader = FindShader(ShaderClass::Pixel, shader, *descriptor, pixelShaders))
 		{
-			switch (type)
-			{
-			case RE::BSShader::Type::Grass:
-				GetGrassShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Sky:
-				GetSkyShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Water:
-				GetWaterShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::BloodSplatter:
-				GetBloodSplaterShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::ImageSpace:
-				GetImagespaceShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Lighting:
-				GetLightingShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::DistantTree:
-				GetDistantTreeShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Particle:
-				GetParticleShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Effect:
-				GetEffectShaderDefines(descriptor, defines);
-				break;
-			case RE::BSShader::Type::Utility:
-				GetUtilityShaderDefines(descriptor, defines);
-				break;
-			}
+			return cachedShader;
 		}
 
-		static std::array<std::array<std::unordered_map<std::string, int32_t>,
-							  static_cast<size_t>(ShaderClass::Total)>,
-			static_cast<size_t>(RE::BSShader::Type::Total)>
-			GetVariableIndices()
+		if (IsAsync())
 		{
-			std::array<std::array<std::unordered_map<std::string, int32_t>,
-						   static_cast<size_t>(ShaderClass::Total)>,
-				static_cast<size_t>(RE::BSShader::Type::Total)>
-				result;
-
-			auto& lightingVS =
-				result[static_cast<size_t>(RE::BSShader::Type::Lighting)][static_cast<size_t>(ShaderClass::Vertex)];
-			lightingVS = {
-				{ "HighDetailRange", 12 },
-				{ "FogParam", 13 },
-				{ "FogNearColor", 14 },
-				{ "FogFarColor", 15 },
-				{ "LeftEyeCenter", 9 },
-				{ "RightEyeCenter", 10 },
-				{ "TexcoordOffset", 11 },
-				{ "World", 0 },
-				{ "PreviousWorld", 1 },
-				{ "EyePosition", 2 },
-				{ "LandBlendParams", 3 },
-				{ "TreeParams", 4 },
-				{ "WindTimers", 5 },
-				{ "TextureProj", 6 },
-				{ "IndexScale", 7 },
-				{ "WorldMapOverlayParameters", 8 },
-				{ "Bones", 16 },
-			};
+			compilationSet.Add({ ShaderClass::Pixel, shader, *descriptor }, GetFrameIndex());
+		}
+		else
+		{
+			return MakeAndAddPixelShader(shader, *descriptor);
+		}
 
-			auto& lightingPS = result[static_cast<size_t>(RE::BSShader::Type::Lighting)]
-									 [static_cast<size_t>(ShaderClass::Pixel)];
-			lightingPS = {
-				{ "VPOSOffset", 11 },
-				{ "FogColor", 19 },
-				{ "ColourOutputClamp", 20 },
-				{ "EnvmapData", 21 },
-				{ "ParallaxOccData", 22 },
-				{ "TintColor", 23 },
-				{ "LODTexParams", 24 },
-				{ "SpecularColor", 25 },
-				{ "SparkleParams", 26 },
-				{ "MultiLayerParallaxData", 27 },
-				{ "LightingEffectParams", 28 },
-				{ "IBLParams", 29 },
-				{ "LandscapeTexture1to4IsSnow", 30 },
-				{ "LandscapeTexture5to6IsSnow", 31 },
-				{ "LandscapeTexture1to4IsSpecPower", 32 },
-				{ "LandscapeTexture5to6IsSpecPower", 33 },
-				{ "SnowRimLightParameters", 34 },
-				{ "CharacterLightParams", 35 },
-				{ "NumLightNumShadowLight", 0 },
-				{ "PointLightPosition", 1 },
-				{ "PointLightColor", 2 },
-				{ "DirLightDirection", 3 },
-				{ "DirLightColor", 4 },
-				{ "DirectionalAmbient", 5 },
-				{ "AmbientSpecularTintAndFresnelPower", 6 },
-				{ "MaterialData", 7 },
-				{ "EmitColor", 8 },
-				{ "AlphaTestRef", 9 },
-				{ "ShadowLightMaskSelect", 10 },
-				{ "ProjectedUVParams", 12 },
-				{ "ProjectedUVParams2", 13 },
-				{ "ProjectedUVParams3", 14 },
-				{ "SplitDistance", 15 },
-				{ "SSRParams", 16 },
-				{ "WorldMapOverlayParametersPS", 17 },
-				{ "AmbientColor", 18 },
-			};
+		return nullptr;
+	}
 
-			auto& bloodSplatterVS = result[static_cast<size_t>(RE::BSShader::Type::BloodSplatter)]
-									 [static_cast<size_t>(ShaderClass::Vertex)];
-			bloodSplatterVS = {
-				{ "WorldViewProj", 0 },
-				{ "LightLoc", 1 },
-				{ "Ctrl", 2 },
-			};
+	HullShader* ShaderCache::GetHullShader(const RE::BSShader& shader,
+		uint32_t rawDescriptor)
+	{
+		const auto descriptor = SShaderCache::GetCacheDescriptor(shader, rawDescriptor);
+		if (!descriptor.has_value())
+		{
+			return nullptr;
+		}
 
-			auto& bloodSplatterPS = result[static_cast<size_t>(RE::BSShader::Type::BloodSplatter)]
-										  [static_cast<size_t>(ShaderClass::Pixel)];
-			bloodSplatterPS = {
-				{ "Alpha", 0 },
-			};
+		if (auto cachedShader = FindShader(ShaderClass::Hull, shader, *descriptor, hullShaders))
+		{
+			return cachedShader;
+		}
 
-			auto& distantTreeVS = result[static_cast<size_t>(RE::BSShader::Type::DistantTree)]
-										  [static_cast<size_t>(ShaderClass::Vertex)];
-			distantTreeVS = {
-				{ "WorldViewProj", 1 },
-				{ "World", 2 },
-				{ "PreviousWorld", 3 },
-				{ "FogParam", 4 },
-			};
+		if (IsAsync())
+		{
+			compilationSet.Add({ ShaderClass::Hull, shader, *descriptor }, GetFrameIndex());
+		}
+		else
+		{
+			return MakeAndAddHullShader(shader, *descriptor);
+		}
 
-			auto& distantTreePS = result[static_cast<size_t>(RE::BSShader::Type::DistantTree)]
-										  [static_cast<size_t>(ShaderClass::Pixel)];
-			distantTreePS = {
-				{ "DiffuseColor", 0 },
-				{ "AmbientColor", 1 },
-			};
+		return nullptr;
+	}
 
-			auto& skyVS = result[static_cast<size_t>(RE::BSShader::Type::Sky)]
-										[static_cast<size_t>(ShaderClass::Vertex)];
-			skyVS = {
-				{ "WorldViewProj", 0 },
-				{ "World", 1 },
-				{ "PreviousWorld", 2 },
-				{ "BlendColor", 3 },
-				{ "EyePosition", 4 },
-				{ "TexCoordOff", 5 },
-				{ "VParams", 6 },
-			};
+	DomainShader* ShaderCache::GetDomainShader(const RE::BSShader& shader,
+		uint32_t rawDescriptor)
+	{
+		const auto descriptor = SShaderCache::GetCacheDescriptor(shader, rawDescriptor);
+		if (!descriptor.has_value())
+		{
+			return nullptr;
+		}
 
-			auto& skyPS = result[static_cast<size_t>(RE::BSShader::Type::Sky)]
-										[static_cast<size_t>(ShaderClass::Pixel)];
-			skyPS = {
-				{ "PParams", 0 },
-			};
+		if (auto cachedShader = FindShader(ShaderClass::Domain, shader, *descriptor, domainShaders))
+		{
+			return cachedShader;
+		}
 
-			auto& grassVS = result[static_cast<size_t>(RE::BSShader::Type::Grass)]
-										[static_cast<size_t>(ShaderClass::Vertex)];
-			grassVS = {
-				{ "WorldViewProj", 0 },
-				{ "WorldView", 1 },
-				{ "World", 2 },
-				{ "PreviousWorld", 3 },
-				{ "FogNearColor", 4 },
-				{ "WindVector", 5 },
-				{ "WindTimer", 6 },
-				{ "DirLightDirection", 7 },
-				{ "PreviousWindTimer", 8 },
-				{ "DirLightColor", 9 },
-				{ "AlphaParam1", 10 },
-				{ "AmbientColor", 11 },
-				{ "AlphaParam2", 12 },
-				{ "ScaleMask", 13 },
-				{ "ShadowClampValue", 14 },
-			};
+		if (IsAsync())
+		{
+			compilationSet.Add({ ShaderClass::Domain, shader, *descriptor }, GetFrameIndex());
+		}
+		else
+		{
+			return MakeAndAddDomainShader(shader, *descriptor);
+		}
 
-			auto& particleVS = result[static_cast<size_t>(RE::BSShader::Type::Particle)]
-								[static_cast<size_t>(ShaderClass::Vertex)];
-			particleVS = {
-				{ "WorldViewProj", 0 },
-				{ "PrevWorldViewProj", 1 },
-				{ "PrecipitationOcclusionWorldViewProj", 2 },
-				{ "fVars0", 3 },
-				{ "fVars1", 4 },
-				{ "fVars2", 5 },
-				{ "fVars3", 6 },
-				{ "fVars4", 7 },
-				{ "Color1", 8 },
-				{ "Color2", 9 },
-				{ "Color3", 10 },
-				{ "Velocity", 11 },
-				{ "Acceleration", 12 },
-				{ "ScaleAdjust", 13 },
-				{ "Wind", 14 },
-			};
+		return nullptr;
+	}
 
-			auto& particlePS = result[static_cast<size_t>(RE::BSShader::Type::Particle)]
-								[static_cast<size_t>(ShaderClass::Pixel)];
-			particlePS = {
-				{ "ColorScale", 0 },
-				{ "TextureSize", 1 },
-			};
+	std::pair<RE::BSGraphics::VertexShader*, RE::BSGraphics::PixelShader*>
+		ShaderCache::GetTechnique(const RE::BSShader& shader, uint32_t rawVertexDescriptor,
+			uint32_t rawPixelDescriptor)
+	{
+		const auto vertexDescriptor = SShaderCache::GetCacheDescriptor(shader, rawVertexDescriptor);
+		const auto pixelDescriptor = SShaderCache::GetCacheDescriptor(shader, rawPixelDescriptor);
+		if (!vertexDescriptor.has_value() || !pixelDescriptor.has_value())
+		{
+			return { nullptr, nullptr };
+		}
 
-			auto& effectVS = result[static_cast<size_t>(RE::BSShader::Type::Effect)]
-									 [static_cast<size_t>(ShaderClass::Vertex)];
-			effectVS = {
-				{ "World", 0 },
-				{ "PreviousWorld", 1 },
-				{ "Bones", 2 },
-				{ "EyePosition", 3 },
-				{ "FogParam", 4 },
-				{ "FogNearColor", 5 },
-				{ "FogFarColor", 6 },
-				{ "FalloffData", 7 },
-				{ "SoftMateralVSParams", 8 },
-				{ "TexcoordOffset", 9 },
-				{ "TexcoordOffsetMembrane", 10 },
-				{ "SubTexOffset", 11 },
-				{ "PosAdjust", 12 },
-				{ "MatProj", 13 },
-			};
+		auto vertexShader = FindShader(ShaderClass::Vertex, shader, *vertexDescriptor, vertexShaders);
+		auto pixelShader = FindShader(ShaderClass::Pixel, shader, *pixelDescriptor, pixelShaders);
+		if (vertexShader != nullptr && pixelShader != nullptr)
+		{
+			return { vertexShader, pixelShader };
+		}
 
-			auto& effectPS = result[static_cast<size_t>(RE::BSShader::Type::Effect)]
-									 [static_cast<size_t>(ShaderClass::Pixel)];
-			effectPS = {
-				{ "PropertyColor", 0 },
-				{ "AlphaTestRef", 1 },
-				{ "MembraneRimColor", 2 },
-				{ "MembraneVars", 3 },
-				{ "PLightPositionX", 4 },
-				{ "PLightPositionY", 5 },
-				{ "PLightPositionZ", 6 },
-				{ "PLightingRadiusInverseSquared", 7 },
-				{ "PLightColorR", 8 },
-				{ "PLightColorG", 9 },
-				{ "PLightColorB", 10 },
-				{ "DLightColor", 11 },
-				{ "VPOSOffset", 12 },
-				{ "CameraData", 13 },
-				{ "FilteringParam", 14 },
-				{ "BaseColor", 15 },
-				{ "BaseColorScale", 16 },
-				{ "LightingInfluence", 17 },
-			};
+		if (IsAsync())
+		{
+			compilationSet.Add({ shader, *vertexDescriptor, *pixelDescriptor }, GetFrameIndex());
+			return { nullptr, nullptr };
+		}
 
-			auto& waterVS = result[static_cast<size_t>(RE::BSShader::Type::Water)]
-								   [static_cast<size_t>(ShaderClass::Vertex)];
-			waterVS = {
-				{ "WorldViewProj", 0 },
-				{ "World", 1 },
-				{ "PreviousWorld", 2 },
-				{ "QPosAdjust", 3 },
-				{ "ObjectUV", 4 },
-				{ "NormalsScroll0", 5 },
-				{ "NormalsScroll1", 6 },
-				{ "NormalsScale", 7 },
-				{ "VSFogParam", 8 },
-				{ "VSFogNearColor", 9 },
-				{ "VSFogFarColor", 10 },
-				{ "CellTexCoordOffset", 11 },
-				{ "SubTexOffset", 12 },
-				{ "PosAdjust", 13 },
-				{ "MatProj", 14 },
-			};
+		return MakeAndAddTechnique(shader, *vertexDescriptor, *pixelDescriptor);
+	}
 
-			auto& waterPS = result[static_cast<size_t>(RE::BSShader::Type::Water)]
-								   [static_cast<size_t>(ShaderClass::Pixel)];
-			waterPS = {
-				{ "TextureProj", 0 },
-				{ "ShallowColor", 1 },
-				{ "DeepColor", 2 },
-				{ "ReflectionColor", 3 },
-				{ "FresnelRI", 4 },
-				{ "BlendRadius", 5 },
-				{ "PosAdjust", 6 },
-				{ "ReflectPlane", 7 },
-				{ "CameraData", 8 },
-				{ "ProjData", 9 },
-				{ "VarAmounts", 10 },
-				{ "FogParam", 11 },
-				{ "FogNearColor", 12 },
-				{ "FogFarColor", 13 },
-				{ "SunDir", 14 },
-				{ "SunColor", 15 },
-				{ "NumLights", 16 },
-				{ "LightPos", 17 },
-				{ "LightColor", 18 },
-				{ "WaterParams", 19 },
-				{ "DepthControl", 20 },
-				{ "SSRParams", 21 },
-				{ "SSRParams2", 22 },
-				{ "NormalsAmplitude", 23 },
-				{ "VPOSOffset", 24 },
-			};
+	ShaderCache::~ShaderCache() 
+	{ 
+		sourceWatcherThread.request_stop();
+		sourceWatcherThread.join();
+		FlushTrace();
+		ResizeCompilationThreads(0);
+		Clear();
+	}
 
-			auto& utilityVS = result[static_cast<size_t>(RE::BSShader::Type::Utility)]
-									[static_cast<size_t>(ShaderClass::Vertex)];
-			utilityVS = {
-				{ "World", 0 },
-				{ "TexcoordOffset", 1 },
-				{ "EyePos", 2 },
-				{ "HighDetailRange", 3 },
-				{ "ParabolaParam", 4 },
-				{ "ShadowFadeParam", 5 },
-				{ "TreeParams", 6 },
-				{ "WaterParams", 7 },
-				{ "Bones", 8 },
-			};
+	bool ShaderCache::IsEnabledForClass(ShaderClass shaderClass) const 
+	{
+		return isEnabled && !(disabledClasses & (1 << static_cast<uint32_t>(shaderClass)));
+	}
 
-			auto& utilityPS = result[static_cast<size_t>(RE::BSShader::Type::Utility)]
-								  [static_cast<size_t>(ShaderClass::Pixel)];
-			utilityPS = {
-				{ "AlphaTestRef", 0 },
-				{ "RefractionPower", 1 },
-				{ "DebugColor", 2 },
-				{ "BaseColor", 3 },
-				{ "PropertyColor", 4 },
-				{ "FocusShadowMapProj", 5 },
-				{ "ShadowMapProj", 6 },
-				{ "ShadowSampleParam", 7 },
-				{ "ShadowLightParam", 8 },
-				{ "ShadowFadeParam", 9 },
-				{ "VPOSOffset", 10 },
-				{ "EndSplitDistances", 11 },
-				{ "StartSplitDistances", 12 },
-				{ "FocusShadowFadeParam", 13 },
-			};
+	void ShaderCache::SetEnabledForClass(ShaderClass shaderClass, bool value)
+	{
+		if (value)
+		{
+			disabledClasses &= ~(1 << static_cast<uint32_t>(shaderClass));
+		}
+		else
+		{
+			disabledClasses |= (1 << static_cast<uint32_t>(shaderClass));
+		}
+	}
 
-			return result;
+	void ShaderCache::Clear()
+	{
+		std::unique_lock lock(clearMutex);
+		++compilationGeneration;
+
+		for (auto& shaders : vertexShaders)
+		{
+			shaders.ForEach([](uint32_t, auto& shader) { shader.shader->Release(); });
+			shaders.Clear();
+		}
+		for (auto& shaders : pixelShaders)
+		{
+			shaders.ForEach([](uint32_t, auto& shader) { shader.shader->Release(); });
+			shaders.Clear();
+		}
+		for (auto& shaders : hullShaders)
+		{
+			shaders.ForEach([](uint32_t, auto& shader) { shader.shader->Release(); });
+			shaders.Clear();
+		}
+		for (auto& shaders : domainShaders)
+		{
+			shaders.ForEach([](uint32_t, auto& shader) { shader.shader->Release(); });
+			shaders.Clear();
 		}
 
-		static int32_t GetVariableIndex(ShaderClass shaderClass, const RE::BSShader& shader, const char* name)
+		for (auto& classCounters : counters)
 		{
-			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
+			for (auto& typeCounters : classCounters)
 			{
-				const auto& imagespaceShader = static_cast<const RE::BSImagespaceShader&>(shader);
-
-				if (shaderClass == ShaderClass::Vertex)
-				{
-					for (size_t nameIndex = 0; nameIndex < imagespaceShader.vsConstantNames.size();
-						 ++nameIndex)
-					{
-						if (std::string_view(imagespaceShader.vsConstantNames[nameIndex].c_str()) ==
-							name)
-						{
-							return static_cast<int32_t>(nameIndex);
-						}
-					}
-				}
-				else if (shaderClass == ShaderClass::Pixel)
-				{
-					for (size_t nameIndex = 0; nameIndex < imagespaceShader.psConstantNames.size(); ++nameIndex)
-					{
-						if (std::string_view(imagespaceShader.psConstantNames[nameIndex].c_str()) == name)
-						{
-							return static_cast<int32_t>(nameIndex);
-						}
-					}
-				}
+				typeCounters.byteCodeSize = 0;
 			}
-			else
-			{
-				static auto variableNames = GetVariableIndices();
+		}
+		cachedByteCodeSize = 0;
 
-				const auto& names = variableNames[static_cast<size_t>(shader.shaderType.get())]
-												 [static_cast<size_t>(shaderClass)];
-				auto it = names.find(name);
-				if (it != names.cend())
-				{
-					return it->second;
-				}
-			}
-			return -1;
+		{
+			std::lock_guard sharedShadersLock(sharedShadersMutex);
+			sharedVertexShaders.clear();
+			sharedPixelShaders.clear();
+			sharedHullShaders.clear();
+			sharedDomainShaders.clear();
 		}
 
-		static std::string MergeDefinesString(const std::array<D3D_SHADER_MACRO, 64>& defines)
-		{ 
-			std::string result;
-			for (const auto& def : defines)
+		{
+			std::lock_guard reloadTargetsLock(reloadTargetsMutex);
+			reloadTargets.clear();
+		}
+		ReleaseRetiredShaders(true);
+
+		compilationSet.Clear();
+		sourceHasher.Reset();
+		sourceStore.Clear();
+	}
+
+	bool ShaderCache::IsEnabled() const
+	{ 
+		return isEnabled;
+	}
+
+	void ShaderCache::SetEnabled(bool value)
+	{ 
+		isEnabled = value;
+	}
+
+	bool ShaderCache::IsAsync() const
+	{ 
+		return isAsync;
+	}
+
+	void ShaderCache::SetAsync(bool value)
+	{ 
+		isAsync = value;
+	}
+
+	bool ShaderCache::IsDiskCacheEnabled() const
+	{
+		return isDiskCacheEnabled;
+	}
+
+	void ShaderCache::SetDiskCacheEnabled(bool value)
+	{
+		isDiskCacheEnabled = value;
+	}
+
+	void ShaderCache::ClearDiskCache()
+	{
+		diskCache.Clear();
+	}
+
+	bool ShaderCache::IsHotReloadEnabled() const
+	{
+		return isHotReloadEnabled;
+	}
+
+	void ShaderCache::SetHotReloadEnabled(bool value)
+	{
+		isHotReloadEnabled = value;
+	}
+
+	bool ShaderCache::IsTraceRecordingEnabled() const
+	{
+		return isTraceRecordingEnabled;
+	}
+
+	void ShaderCache::SetTraceRecordingEnabled(bool value)
+	{
+		isTraceRecordingEnabled = value;
+	}
+
+	void ShaderCache::PrewarmFromTrace()
+	{
+		// Manifest is produced offline by ShaderPermutationTool in the trace format.
+		auto records = ReadShaderTrace(traceWriter.GetPath());
+		const auto manifestRecords = ReadShaderTrace(SShaderCache::ManifestPath);
+		records.insert(records.end(), manifestRecords.begin(), manifestRecords.end());
+
+		std::lock_guard lockGuard(traceMutex);
+		size_t recordsCount = 0;
+		for (const auto& record : records)
+		{
+			if (record.shaderType >= static_cast<uint8_t>(RE::BSShader::Type::Total) ||
+				record.shaderClass >= static_cast<uint8_t>(ShaderClass::Total) ||
+				!tracedShaders.insert(record.GetKey()).second)
 			{
-				if (def.Name != nullptr)
-				{
-					result += def.Name;
-					result += ' ';
-				}
-				else
-				{
-					break;
-				}
+				continue;
 			}
-			return result;
+			pendingTraceRecords[record.shaderType].push_back(record);
+			++recordsCount;
+		}
+		for (size_t typeIndex = 0; typeIndex < pendingTraceRecords.size(); ++typeIndex)
+		{
+			hasPendingTraceRecords[typeIndex] = !pendingTraceRecords[typeIndex].empty();
 		}
 
-		static void AddAttribute(uint64_t& desc, RE::BSGraphics::Vertex::Attribute attribute) 
-		{ 
-			desc |= ((1ull << (44 + attribute)) | (1ull << (54 + attribute)) |
-					 (0b1111ull << (4 * attribute + 4)));
+		logger::info("Loaded {} shader permutations from trace", recordsCount);
+	}
+
+	void ShaderCache::ClearTrace()
+	{
+		std::lock_guard writerLockGuard(traceWriterMutex);
+		std::lock_guard lockGuard(traceMutex);
+		traceWriter.Remove();
+		tracedShaders.clear();
+		unwrittenTraceRecords.clear();
+	}
+
+	void ShaderCache::RecordTrace(ShaderClass shaderClass, const RE::BSShader& shader,
+		uint32_t descriptor)
+	{
+		if (!IsTraceRecordingEnabled())
+		{
+			return;
 		}
 
-		template<size_t MaxOffsetsSize>
-		static void ReflectConstantBuffers(ID3D11ShaderReflection& reflector,
-			std::array<size_t, 3>& bufferSizes,
-			std::array<int8_t, MaxOffsetsSize>& constantOffsets,
-			uint64_t& vertexDesc,
-			ShaderClass shaderClass, uint32_t descriptor, const RE::BSShader& shader)
+		ShaderTraceRecord record;
+		record.descriptor = descriptor;
+		record.shaderType = static_cast<uint8_t>(shader.shaderType.underlying());
+		record.shaderClass = static_cast<uint8_t>(shaderClass);
+
+		std::lock_guard lockGuard(traceMutex);
+		if (tracedShaders.insert(record.GetKey()).second)
 		{
-			D3D11_SHADER_DESC desc;
-			if (FAILED(reflector.GetDesc(&desc)))
-			{
-				logger::error("Failed to get shader descriptor for {} shader {}::{}",
-					magic_enum::enum_name(shaderClass), magic_enum::enum_name(shader.shaderType.get()),
-					descriptor);
-				return;
-			}
+			unwrittenTraceRecords.push_back(record);
+		}
+	}
 
-			if (shaderClass == ShaderClass::Vertex)
+	void ShaderCache::FlushTrace()
+	{
+		std::lock_guard writerLockGuard(traceWriterMutex);
+		std::vector<ShaderTraceRecord> records;
+		{
+			std::lock_guard lockGuard(traceMutex);
+			records.swap(unwrittenTraceRecords);
+		}
+		if (records.empty())
+		{
+			return;
+		}
+
+		bool isWritten = true;
+		for (const auto& record : records)
+		{
+			isWritten = traceWriter.Append(record) && isWritten;
+		}
+		if (!traceWriter.Flush() || !isWritten)
+		{
+			logger::warn("Failed to write {} shader trace records", records.size());
+		}
+	}
+
+	void ShaderCache::EnqueueTraceRecords(const RE::BSShader& shader, uint32_t descriptor)
+	{
+		const auto typeIndex = static_cast<size_t>(shader.shaderType.underlying());
+		// Imagespace shaders are separate instances per effect, so only records for the
+		// effect of this instance can be queued.
+		const bool isImagespace = shader.shaderType == RE::BSShader::Type::ImageSpace;
+
+		std::lock_guard lockGuard(traceMutex);
+		auto& records = pendingTraceRecords[typeIndex];
+		std::erase_if(records, [&](const ShaderTraceRecord& record) {
+			if (isImagespace && record.descriptor != descriptor)
 			{
-				vertexDesc = 0b1111;
-				bool hasTexcoord2 = false;
-				bool hasTexcoord3 = false;
-				for (uint32_t inputIndex = 0; inputIndex < desc.InputParameters; ++inputIndex)
-				{
-					D3D11_SIGNATURE_PARAMETER_DESC inputDesc;
-					if (FAILED(reflector.GetInputParameterDesc(inputIndex, &inputDesc)))
-					{
-						logger::error(
-							"Failed to get input parameter {} descriptor for {} shader {}::{}",
-							inputIndex, magic_enum::enum_name(shaderClass),
-							magic_enum::enum_name(shader.shaderType.get()),
-							descriptor);
-					}
-					else
-					{
-						std::string_view semanticName = inputDesc.SemanticName;
-						if (semanticName == "POSITION" && inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_POSITION);
-						}
-						else if (semanticName == "TEXCOORD" &&
-								 inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_TEXCOORD0);
-						}
-						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex == 1)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_TEXCOORD1);
-						}
-						else if (semanticName == "NORMAL" &&
-								 inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_NORMAL);
-						}
-						else if (semanticName == "BINORMAL" && inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_BINORMAL);
-						}
-						else if (semanticName == "COLOR" &&
-								 inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_COLOR);
-						}
-						else if (semanticName == "BLENDWEIGHT" && inputDesc.SemanticIndex == 0)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_SKINNING);
-						}
-						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex >= 4 &&
-								 inputDesc.SemanticIndex <= 7)
-						{
-							AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_INSTANCEDATA);
-						}
-						else if (semanticName == "TEXCOORD" &&
-								 inputDesc.SemanticIndex == 2)
-						{
-							hasTexcoord2 = true;
-						}
-						else if (semanticName == "TEXCOORD" && inputDesc.SemanticIndex == 3)
-						{
-							hasTexcoord3 = true;
-						}
-					}
-				}
-				if (hasTexcoord2)
-				{
-					if (hasTexcoord3)
-					{
-						AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_LANDDATA);
-					}
-					else
-					{
-						AddAttribute(vertexDesc, RE::BSGraphics::Vertex::VA_EYEDATA);
-					}
-				}
+				return false;
 			}
+			compilationSet.Add({ static_cast<ShaderClass>(record.shaderClass), shader,
+								   record.descriptor },
+				0);
+			return true;
+		});
+		hasPendingTraceRecords[typeIndex] = !records.empty();
+	}
+
+	void ShaderCache::OnFrame(std::chrono::microseconds frameTime)
+	{
+		++frameIndex;
+		UpdateThrottle(frameTime);
+		UpdateTimestampRate();
+		ReleaseRetiredShaders(false);
+		EvictShaders();
+	}
+
+	uint64_t ShaderCache::GetFrameIndex() const
+	{
+		return frameIndex;
+	}
+
+	double ShaderCache::GetTimestampsPerNanosecond() const
+	{
+		return timestampsPerNanosecond;
+	}
+
+	void ShaderCache::RecordTechnique(TechniquePath path, uint64_t startTimestamp)
+	{
+		auto& pathCounters = techniqueCounters[static_cast<size_t>(path)];
+		pathCounters.count.fetch_add(1, std::memory_order_relaxed);
+		pathCounters.timestamps.fetch_add(GetTimestamp() - startTimestamp,
+			std::memory_order_relaxed);
+	}
+
+	void ShaderCache::UpdateTimestampRate()
+	{
+		constexpr auto MeasurementPeriod = std::chrono::milliseconds(500);
+
+		const auto time = std::chrono::steady_clock::now();
+		const uint64_t timestamp = GetTimestamp();
+		if (rateMeasurementTimestamp == 0)
+		{
+			rateMeasurementTime = time;
+			rateMeasurementTimestamp = timestamp;
+			return;
+		}
+
+		const auto elapsed = time - rateMeasurementTime;
+		if (elapsed >= MeasurementPeriod)
+		{
+			timestampsPerNanosecond = (timestamp - rateMeasurementTimestamp) /
+				static_cast<double>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			rateMeasurementTime = time;
+			rateMeasurementTimestamp = timestamp;
+		}
+	}
+
+	size_t ShaderCache::GetCompilationThreadCount() const
+	{
+		return compilationThreads.size();
+	}
+
+	void ShaderCache::SetCompilationThreadCount(size_t value)
+	{
+		ResizeCompilationThreads(std::clamp<size_t>(value, 1,
+			std::max(1u, std::thread::hardware_concurrency())));
+	}
+
+	bool ShaderCache::IsCompilationPaused() const
+	{
+		return compilationSet.IsPaused();
+	}
+
+	void ShaderCache::SetCompilationPaused(bool value)
+	{
+		compilationSet.SetPaused(value);
+	}
 
-			if (desc.ConstantBuffers <= 0)
-			{
-				return;
-			}
+	bool ShaderCache::IsThrottlingEnabled() const
+	{
+		return isThrottlingEnabled;
+	}
 
-			auto mapBufferConsts =
-				[&](const char* bufferName, size_t& bufferSize)
-			{
-				auto bufferReflector = reflector.GetConstantBufferByName(bufferName);
-				if (bufferReflector == nullptr)
-				{
-					logger::warn("Buffer {} not found for {} shader {}::{}",
-						bufferName, magic_enum::enum_name(shaderClass),
-						magic_enum::enum_name(shader.shaderType.get()),
-						descriptor);
-					return;
-				}
+	void ShaderCache::SetThrottlingEnabled(bool value)
+	{
+		isThrottlingEnabled = value;
+		if (!isThrottlingEnabled)
+		{
+			activeCompilationLimit = compilationThreads.size();
+			compilationSet.SetActiveTasksLimit(activeCompilationLimit);
+		}
+	}
 
-				D3D11_SHADER_BUFFER_DESC bufferDesc;
-				if (FAILED(bufferReflector->GetDesc(&bufferDesc)))
-				{
-					logger::warn("Failed to get buffer {} descriptor for {} shader {}::{}",
-						bufferName, magic_enum::enum_name(shaderClass),
-						magic_enum::enum_name(shader.shaderType.get()),
-						descriptor);
-					return;
-				}
+	float ShaderCache::GetThrottleFrameTime() const
+	{
+		return throttleFrameTime;
+	}
 
-				for (uint32_t i = 0; i < bufferDesc.Variables; i++)
-				{
-					ID3D11ShaderReflectionVariable* var = bufferReflector->GetVariableByIndex(i);
+	void ShaderCache::SetThrottleFrameTime(float milliseconds)
+	{
+		throttleFrameTime = std::max(milliseconds, 1.f);
+	}
 
-					D3D11_SHADER_VARIABLE_DESC varDesc;
-					if (FAILED(var->GetDesc(&varDesc)))
-					{
-						logger::error("Failed to get variable descriptor for {} shader {}::{}",
-							magic_enum::enum_name(shaderClass),
-							magic_enum::enum_name(shader.shaderType.get()),
-							descriptor);
-						continue;
-					}
+	size_t ShaderCache::GetActiveCompilationLimit() const
+	{
+		return activeCompilationLimit;
+	}
 
-					const auto variableIndex = GetVariableIndex(shaderClass, shader, varDesc.Name);
-					bool variableFound = variableIndex != -1;
-					if (variableFound)
-					{
-						constantOffsets[variableIndex] = varDesc.StartOffset / 4;
-					}
-					else
-					{
-						logger::error("Unknown variable name {} in {} shader {}::{}", varDesc.Name,
-							magic_enum::enum_name(shaderClass),
-							magic_enum::enum_name(shader.shaderType.get()), descriptor);
-					}
+	ShaderCache::ShaderCache() :
+		diskCache(SShaderCache::DiskCachePath), sourceHasher(sourceStore),
+		traceWriter(SShaderCache::TracePath)
+	{
+		ResizeCompilationThreads(std::max(1,
+			(static_cast<int32_t>(std::thread::hardware_concurrency()) - 4)));
+		sourceWatcherThread =
+			std::jthread([this](std::stop_token stopToken) { WatchShaderSources(stopToken); });
+	}
 
-					if (shader.shaderType == RE::BSShader::Type::ImageSpace)
-					{
-						D3D11_SHADER_TYPE_DESC varTypeDesc;
-						var->GetType()->GetDesc(&varTypeDesc);
-						if (varTypeDesc.Elements > 0)
-						{
-							if (!variableFound)
-							{
-								const std::string arrayName =
-									std::format("{}[{}]", varDesc.Name, varTypeDesc.Elements);
-								const auto variableArrayIndex =
-									GetVariableIndex(shaderClass, shader, arrayName.c_str());
-								if (variableArrayIndex != -1)
-								{
-									constantOffsets[variableArrayIndex] = varDesc.StartOffset / 4;
-								}
-								else
-								{
-									logger::error("Unknown variable name {} in {} shader {}::{}",
-										arrayName, magic_enum::enum_name(shaderClass),
-										magic_enum::enum_name(shader.shaderType.get()), descriptor);
-								}
-							}
-							else
-							{
-								const auto elementSize = varDesc.Size / varTypeDesc.Elements;
-								for (uint32_t arrayIndex = 1; arrayIndex < varTypeDesc.Elements;
-									 ++arrayIndex)
-								{
-									const std::string varName =
-										std::format("{}[{}]", varDesc.Name, arrayIndex);
-									const auto variableIndex =
-										GetVariableIndex(shaderClass, shader, varName.c_str());
-									if (variableIndex != -1)
-									{
-										constantOffsets[variableIndex] =
-											(varDesc.StartOffset + elementSize * arrayIndex) / 4;
-									}
-									else
-									{
-										logger::error(
-											"Unknown variable name {} in {} shader {}::{}", varName,
-											magic_enum::enum_name(shaderClass),
-											magic_enum::enum_name(shader.shaderType.get()),
-											descriptor);
-									}
-								}
-							}
-						}
-					}
-				}
+	void ShaderCache::ResizeCompilationThreads(size_t count)
+	{
+		for (size_t threadIndex = count; threadIndex < compilationThreads.size(); ++threadIndex)
+		{
+			compilationThreads[threadIndex].request_stop();
+		}
+		// Stopped workers finish the shader they are compiling before they are joined.
+		while (compilationThreads.size() > count)
+		{
+			compilationThreads.pop_back();
+		}
+		while (compilationThreads.size() < count)
+		{
+			compilationThreads.emplace_back(
+				[this](std::stop_token stopToken) { ProcessCompilationSet(stopToken); });
+		}
 
-				bufferSize = ((bufferDesc.Size + 15) & ~15) / 16;
-			};
+		activeCompilationLimit = isThrottlingEnabled && activeCompilationLimit != 0 ?
+		                             std::min(activeCompilationLimit, count) :
+		                             count;
+		compilationSet.SetActiveTasksLimit(activeCompilationLimit);
+	}
 
-			mapBufferConsts("PerTechnique", bufferSizes[0]);
-			mapBufferConsts("PerMaterial", bufferSizes[1]);
-			mapBufferConsts("PerGeometry", bufferSizes[2]);
+	void ShaderCache::UpdateThrottle(std::chrono::microseconds frameTime)
+	{
+		constexpr uint32_t ThrottleUpdateInterval = 30;
+		constexpr float FrameTimeSmoothing = 0.05f;
+
+		const float frameTimeMs = frameTime.count() / 1000.f;
+		averageFrameTime = averageFrameTime == 0.f ?
+		                       frameTimeMs :
+		                       std::lerp(averageFrameTime, frameTimeMs, FrameTimeSmoothing);
+
+		if (!isThrottlingEnabled || ++framesSinceThrottleUpdate < ThrottleUpdateInterval)
+		{
+			return;
 		}
+		framesSinceThrottleUpdate = 0;
 
-		static ID3DBlob* CompileShader(ShaderClass shaderClass, const RE::BSShader& shader,
-			uint32_t descriptor)
+		size_t newLimit = activeCompilationLimit;
+		if (averageFrameTime > throttleFrameTime * 1.05f && newLimit > 1)
 		{
-			const auto type = shader.shaderType.get();
-			const std::wstring path = GetShaderPath(
-				shader.shaderType == RE::BSShader::Type::ImageSpace ?
-					std::string_view(static_cast<const RE::BSImagespaceShader&>(shader).originalShaderName) :
-					shader.fxpFilename);
+			--newLimit;
+		}
+		else if (averageFrameTime < throttleFrameTime * 0.9f &&
+				 newLimit < compilationThreads.size())
+		{
+			++newLimit;
+		}
 
-			std::array<D3D_SHADER_MACRO, 64> defines;
-			if (shaderClass == ShaderClass::Vertex)
-			{
-				defines[0] = { "VSHADER", nullptr };
-			}
-			else if (shaderClass == ShaderClass::Pixel)
+		if (newLimit != activeCompilationLimit)
+		{
+			activeCompilationLimit = newLimit;
+			compilationSet.SetActiveTasksLimit(activeCompilationLimit);
+		}
+	}
+
+	ShaderCacheStatistics ShaderCache::GetStatistics() const
+	{
+		ShaderCacheStatistics result;
+
+		for (size_t classIndex = 0; classIndex < counters.size(); ++classIndex)
+		{
+			for (size_t typeIndex = 0; typeIndex < counters[classIndex].size(); ++typeIndex)
 			{
-				defines[0] = { "PSHADER", nullptr };
+				const auto& typeCounters = counters[classIndex][typeIndex];
+				auto& statistics = result.perType[classIndex][typeIndex];
+				statistics.compiled = typeCounters.compiled;
+				statistics.loadedFromDisk = typeCounters.loadedFromDisk;
+				statistics.shared = typeCounters.shared;
+				statistics.failed = typeCounters.failed;
+				statistics.hits = typeCounters.hits;
+				statistics.misses = typeCounters.misses;
+				statistics.evicted = typeCounters.evicted;
+				statistics.byteCodeSize = typeCounters.byteCodeSize;
 			}
-			else if (shaderClass == ShaderClass::Geometry)
+		}
+
+		compilationSet.ForEachTask([&result](const ShaderCompilationTask& task, bool isInProgress) {
+			const auto countTask = [&](ShaderClass shaderClass) {
+				auto& statistics = result.perType[static_cast<size_t>(shaderClass)]
+				                                 [static_cast<size_t>(task.GetShaderType())];
+				++(isInProgress ? statistics.inProgress : statistics.queued);
+			};
+			countTask(task.GetShaderClass());
+			if (task.IsTechnique())
 			{
-				defines[0] = { "GSHADER", nullptr };
+				countTask(ShaderClass::Pixel);
 			}
-			else if (shaderClass == ShaderClass::Hull)
+		});
+
+		std::lock_guard lock(compilationRecordsMutex);
+		for (size_t classIndex = 0; classIndex < result.perClass.size(); ++classIndex)
+		{
+			auto& classStatistics = result.perClass[classIndex];
+			CompileTimeHistogram classCompileTimes;
+			for (size_t typeIndex = 0; typeIndex < result.perType[classIndex].size(); ++typeIndex)
 			{
-				defines[0] = { "HSHADER", nullptr };
+				auto& statistics = result.perType[classIndex][typeIndex];
+				const auto& typeCompileTimes = compileTimeHistograms[classIndex][typeIndex];
+				classCompileTimes.Merge(typeCompileTimes);
+				statistics.compileTimeP50 = typeCompileTimes.GetPercentile(50);
+				statistics.compileTimeP95 = typeCompileTimes.GetPercentile(95);
+				statistics.compileTimeP99 = typeCompileTimes.GetPercentile(99);
+
+				classStatistics.queued += statistics.queued;
+				classStatistics.inProgress += statistics.inProgress;
+				classStatistics.compiled += statistics.compiled;
+				classStatistics.loadedFromDisk += statistics.loadedFromDisk;
+				classStatistics.shared += statistics.shared;
+				classStatistics.failed += statistics.failed;
+				classStatistics.hits += statistics.hits;
+				classStatistics.misses += statistics.misses;
+				classStatistics.evicted += statistics.evicted;
+				classStatistics.byteCodeSize += statistics.byteCodeSize;
 			}
-			else if (shaderClass == ShaderClass::Domain)
+			classStatistics.compileTimeP50 = classCompileTimes.GetPercentile(50);
+			classStatistics.compileTimeP95 = classCompileTimes.GetPercentile(95);
+			classStatistics.compileTimeP99 = classCompileTimes.GetPercentile(99);
+		}
+
+		const double rate = GetTimestampsPerNanosecond();
+		for (size_t pathIndex = 0; pathIndex < techniqueCounters.size(); ++pathIndex)
+		{
+			const auto& pathCounters = techniqueCounters[pathIndex];
+			auto& statistics = result.perTechniquePath[pathIndex];
+			statistics.count = pathCounters.count;
+			if (rate > 0.)
 			{
-				defines[0] = { "DSHADER", nullptr };
+				statistics.totalTime = std::chrono::nanoseconds(
+					static_cast<int64_t>(pathCounters.timestamps / rate));
 			}
-			defines[1] = { nullptr, nullptr };
-			GetShaderDefines(type, descriptor, &defines[1]);
-
-			//logger::info("{}, {}", descriptor, MergeDefinesString(defines));
+		}
 
-			ID3DBlob* shaderBlob = nullptr;
-			ID3DBlob* errorBlob = nullptr;
-			const uint32_t flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
-			const HRESULT compileResult = D3DCompileFromFile(path.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, "main",
-					GetShaderProfile(shaderClass), flags, 0, &shaderBlob, &errorBlob);
+		return result;
+	}
 
-			if (FAILED(compileResult))
-			{
-				if (errorBlob != nullptr)
-				{
-					logger::error("Failed to compile {} shader {}::{}: {}",
-						magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor,
-						static_cast<char*>(errorBlob->GetBufferPointer()));
-					errorBlob->Release();
-				}
-				if (shaderBlob != nullptr)
-				{
-					shaderBlob->Release();
-				}
+	std::vector<ShaderCompilationRecord> ShaderCache::GetCompilationRecords() const
+	{
+		std::lock_guard lock(compilationRecordsMutex);
+		return { compilationRecords.cbegin(), compilationRecords.cend() };
+	}
 
-				return nullptr;
-			}
-			logger::info("Compiled {} shader {}::{}", magic_enum::enum_name(shaderClass),
-				magic_enum::enum_name(type), descriptor);
+	void ShaderCache::CompileTimeHistogram::Add(std::chrono::microseconds duration)
+	{
+		const double microseconds = std::max<double>(static_cast<double>(duration.count()), 1.);
+		const auto bucketIndex = static_cast<size_t>(std::log2(microseconds) * BucketsPerOctave);
+		++counts[std::min(bucketIndex, BucketCount - 1)];
+		++totalCount;
+	}
 
-			return shaderBlob;
+	void ShaderCache::CompileTimeHistogram::Merge(const CompileTimeHistogram& other)
+	{
+		for (size_t bucketIndex = 0; bucketIndex < BucketCount; ++bucketIndex)
+		{
+			counts[bucketIndex] += other.counts[bucketIndex];
 		}
+		totalCount += other.totalCount;
+	}
 
-		std::unique_ptr<RE::BSGraphics::VertexShader> CreateVertexShader(ID3DBlob& shaderData,
-			const RE::BSShader& shader, uint32_t descriptor) 
+	std::chrono::microseconds ShaderCache::CompileTimeHistogram::GetPercentile(
+		uint32_t value) const
+	{
+		if (totalCount == 0)
 		{
-			static const auto perTechniqueBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524755, 411371));
-			static const auto perMaterialBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524757, 411373));
-			static const auto perGeometryBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524759, 411375));
-			static const auto bufferData = REL::Relocation<void*>(RELOCATION_ID(524965, 411446));
-
-			auto rawPtr =
-				new uint8_t[sizeof(RE::BSGraphics::VertexShader) + shaderData.GetBufferSize()];
-			auto shaderPtr = new (rawPtr) RE::BSGraphics::VertexShader;
-			memcpy(rawPtr + sizeof(RE::BSGraphics::VertexShader), shaderData.GetBufferPointer(),
-				shaderData.GetBufferSize());
-			auto newShader = std::unique_ptr<RE::BSGraphics::VertexShader>(shaderPtr);
-			newShader->byteCodeSize = shaderData.GetBufferSize();
-			newShader->id = descriptor;
-			newShader->shaderDesc = 0;
-
-			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
-			const auto reflectionResult = D3DReflect(shaderData.GetBufferPointer(), shaderData.GetBufferSize(),
-				IID_PPV_ARGS(&reflector));
-			if (FAILED(reflectionResult))
+			return std::chrono::microseconds(0);
+		}
+		const uint64_t rank = std::max<uint64_t>((totalCount * value + 99) / 100, 1);
+		uint64_t count = 0;
+		size_t bucketIndex = 0;
+		for (; bucketIndex < BucketCount - 1; ++bucketIndex)
+		{
+			count += counts[bucketIndex];
+			if (count >= rank)
 			{
-				logger::error("Failed to reflect vertex shader {}::{}", magic_enum::enum_name(shader.shaderType.get()),
-					descriptor);
+				break;
 			}
-			else
+		}
+		return std::chrono::microseconds(static_cast<int64_t>(
+			std::exp2(static_cast<double>(bucketIndex + 1) / BucketsPerOctave)));
+	}
+
+	void ShaderCache::ResetStatistics()
+	{
+		for (auto& classCounters : counters)
+		{
+			for (auto& typeCounters : classCounters)
 			{
-				std::array<size_t, 3> bufferSizes = { 0, 0, 0 };
-				std::fill(newShader->constantTable.begin(), newShader->constantTable.end(), 0);
-				ReflectConstantBuffers(*reflector.Get(), bufferSizes, newShader->constantTable, newShader->shaderDesc, ShaderClass::Vertex, descriptor, shader);
-				if (bufferSizes[0] != 0)
-				{
-					newShader->constantBuffers[0].buffer =
-						perTechniqueBuffersArray.get()[bufferSizes[0]];
-				}
-				else
-				{
-					newShader->constantBuffers[0].buffer = nullptr;
-					newShader->constantBuffers[0].data = bufferData.get();
-				}
-				if (bufferSizes[1] != 0)
-				{
-					newShader->constantBuffers[1].buffer =
-						perMaterialBuffersArray.get()[bufferSizes[1]];
-				}
-				else
-				{
-					newShader->constantBuffers[1].buffer = nullptr;
-					newShader->constantBuffers[1].data = bufferData.get();
-				}
-				if (bufferSizes[2] != 0)
-				{
-					newShader->constantBuffers[2].buffer =
-						perGeometryBuffersArray.get()[bufferSizes[2]];
-				}
-				else
-				{
-					newShader->constantBuffers[2].buffer = nullptr;
-					newShader->constantBuffers[2].data = bufferData.get();
-				}
+				typeCounters.compiled = 0;
+				typeCounters.loadedFromDisk = 0;
+				typeCounters.shared = 0;
+				typeCounters.failed = 0;
+				typeCounters.hits = 0;
+				typeCounters.misses = 0;
+				typeCounters.evicted = 0;
 			}
+		}
+		for (auto& pathCounters : techniqueCounters)
+		{
+			pathCounters.count = 0;
+			pathCounters.timestamps = 0;
+		}
 
-			return newShader;
+		std::lock_guard lock(compilationRecordsMutex);
+		compilationRecords.clear();
+		compileTimeHistograms = {};
+	}
+
+	void ShaderCache::RecordCompilation(ShaderCompilationRecord&& record)
+	{
+		auto& typeCounters = counters[static_cast<size_t>(record.shaderClass)]
+		                             [static_cast<size_t>(record.shaderType)];
+		if (record.isFailed)
+		{
+			++typeCounters.failed;
+		}
+		else if (record.isLoadedFromDisk)
+		{
+			++typeCounters.loadedFromDisk;
+		}
+		else
+		{
+			++typeCounters.compiled;
 		}
 
-		std::unique_ptr<RE::BSGraphics::PixelShader> CreatePixelShader(ID3DBlob& shaderData,
-			const RE::BSShader& shader, uint32_t descriptor)
+		std::lock_guard lock(compilationRecordsMutex);
+		if (!record.isLoadedFromDisk && !record.isFailed)
 		{
-			static const auto perTechniqueBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524761, 411377));
-			static const auto perMaterialBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524763, 411379));
-			static const auto perGeometryBuffersArray =
-				REL::Relocation<REX::W32::ID3D11Buffer**>(RELOCATION_ID(524765, 411381));
-			static const auto bufferData = REL::Relocation<void*>(RELOCATION_ID(524967, 411448));
+			compileTimeHistograms[static_cast<size_t>(record.shaderClass)]
+								 [static_cast<size_t>(record.shaderType)]
+									 .Add(record.duration);
+		}
+		if (compilationRecords.size() == MaxCompilationRecords)
+		{
+			compilationRecords.pop_front();
+		}
+		compilationRecords.push_back(std::move(record));
+	}
 
-			auto newShader = std::make_unique<RE::BSGraphics::PixelShader>();
-			newShader->id = descriptor;
-			
-			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
-			const auto reflectionResult = D3DReflect(shaderData.GetBufferPointer(),
-				shaderData.GetBufferSize(), IID_PPV_ARGS(&reflector));
-			if (FAILED(reflectionResult))
-			{
-				logger::error("Failed to reflect pixel shader {}::{}", magic_enum::enum_name(shader.shaderType.get()),
-					descriptor);
-			}
-			else
-			{
-				std::array<size_t, 3> bufferSizes = { 0, 0, 0 };
-				std::fill(newShader->constantTable.begin(), newShader->constantTable.end(), 0);
-				uint64_t dummy;
-				ReflectConstantBuffers(*reflector.Get(), bufferSizes, newShader->constantTable,
-					dummy,
-					ShaderClass::Pixel, descriptor, shader);
-				if (bufferSizes[0] != 0)
-				{
-					newShader->constantBuffers[0].buffer =
-						perTechniqueBuffersArray.get()[bufferSizes[0]];
-				}
-				else
-				{
-					newShader->constantBuffers[0].buffer = nullptr;
-					newShader->constantBuffers[0].data = bufferData.get();
-				}
-				if (bufferSizes[1] != 0)
-				{
-					newShader->constantBuffers[1].buffer =
-						perMaterialBuffersArray.get()[bufferSizes[1]];
-				}
-				else
-				{
-					newShader->constantBuffers[1].buffer = nullptr;
-					newShader->constantBuffers[1].data = bufferData.get();
-				}
-				if (bufferSizes[2] != 0)
-				{
-					newShader->constantBuffers[2].buffer =
-						perGeometryBuffersArray.get()[bufferSizes[2]];
-				}
-				else
-				{
-					newShader->constantBuffers[2].buffer = nullptr;
-					newShader->constantBuffers[2].data = bufferData.get();
-				}
-			}
+	void ShaderCache::RecordAccess(ShaderClass shaderClass, const RE::BSShader& shader,
+		bool isHit)
+	{
+		auto& typeCounters = counters[static_cast<size_t>(shaderClass)]
+		                             [static_cast<size_t>(shader.shaderType.underlying())];
+		(isHit ? typeCounters.hits : typeCounters.misses).fetch_add(1, std::memory_order_relaxed);
+	}
 
-			return newShader;
-		}
+	void ShaderCache::RecordInsertion(ShaderClass shaderClass, const RE::BSShader& shader,
+		size_t byteCodeSize)
+	{
+		counters[static_cast<size_t>(shaderClass)][static_cast<size_t>(shader.shaderType.underlying())]
+			.byteCodeSize += byteCodeSize;
+		cachedByteCodeSize += byteCodeSize;
+	}
 
-		template<size_t Count>
-		std::array<Microsoft::WRL::ComPtr<REX::W32::ID3D11Buffer>, Count>
-			CreateDynamicConstantBuffers(REX::W32::ID3D11Device& device)
+	void ShaderCache::RecordRemoval(ShaderClass shaderClass, size_t typeIndex, size_t byteCodeSize,
+		bool isEvicted)
+	{
+		auto& typeCounters = counters[static_cast<size_t>(shaderClass)][typeIndex];
+		typeCounters.byteCodeSize -= byteCodeSize;
+		cachedByteCodeSize -= byteCodeSize;
+		if (isEvicted)
 		{
-			std::array<Microsoft::WRL::ComPtr<REX::W32::ID3D11Buffer>, Count> result;
+			++typeCounters.evicted;
+		}
+	}
 
-			REX::W32::D3D11_BUFFER_DESC descriptor;
-			descriptor.usage = REX::W32::D3D11_USAGE_DYNAMIC;
-			descriptor.bindFlags = REX::W32::D3D11_BIND_CONSTANT_BUFFER;
-			descriptor.cpuAccessFlags = REX::W32::D3D11_CPU_ACCESS_WRITE;
-			descriptor.miscFlags = 0; 
-			descriptor.structureByteStride = 0;
-			for (UINT bufferIndex = 0; bufferIndex < Count; ++bufferIndex)
+	void ShaderCache::RecordDeduplication(ShaderClass shaderClass, const RE::BSShader& shader)
+	{
+		++counters[static_cast<size_t>(shaderClass)][static_cast<size_t>(shader.shaderType.underlying())]
+			  .shared;
+	}
+
+	void ShaderCache::RecordFailure(ShaderClass shaderClass, const RE::BSShader& shader)
+	{
+		++counters[static_cast<size_t>(shaderClass)][static_cast<size_t>(shader.shaderType.underlying())]
+			  .failed;
+	}
+
+	bool ShaderCache::IsCancelled(uint64_t generation) const
+	{
+		return generation != compilationGeneration;
+	}
+
+	std::optional<ShaderCacheEntry> ShaderCache::LoadOrCompileShader(
+		const SShaderCache::ShaderPermutation& permutation, ShaderClass shaderClass,
+		const RE::BSShader& shader, uint32_t descriptor, size_t constantTableSize,
+		uint64_t generation)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		const auto& defines = permutation.defines;
+		const auto& definesString = permutation.definesString;
+		auto key = permutation.key;
+
+		ShaderCompilationRecord record;
+		record.shaderType = shader.shaderType.get();
+		record.shaderClass = shaderClass;
+		record.descriptor = descriptor;
+		record.defines = definesString;
+		const auto finishRecord = [&](bool isLoadedFromDisk, bool isFailed, size_t byteCodeSize) {
+			record.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::high_resolution_clock::now() - startTime);
+			record.byteCodeSize = byteCodeSize;
+			record.isLoadedFromDisk = isLoadedFromDisk;
+			record.isFailed = isFailed;
+			RecordCompilation(std::move(record));
+		};
+
+		// Hashing also registers the include closure that hot reload watches.
+		key.sourceHash = sourceHasher.GetHash(SShaderCache::GetSourcePath(shader));
+
+		const bool useDiskCache = IsDiskCacheEnabled();
+		if (useDiskCache)
+		{
+			if (auto shaderEntry = diskCache.Load(key, definesString);
+				shaderEntry.has_value() &&
+				shaderEntry->reflection.constantTable.size() == constantTableSize)
 			{
-				descriptor.byteWidth = 4 * sizeof(float) * (bufferIndex + 1);
-				REX::W32::ID3D11Buffer* buffer;
-				device.CreateBuffer(&descriptor, nullptr, &buffer);
-				result[bufferIndex] = buffer;
+				logger::info("Loaded {} shader {}::{} from disk cache",
+					magic_enum::enum_name(shaderClass),
+					magic_enum::enum_name(shader.shaderType.get()), descriptor);
+				finishRecord(true, false, shaderEntry->byteCode.size());
+				return shaderEntry;
 			}
+		}
 
-			return result;
+		if (IsCancelled(generation))
+		{
+			return std::nullopt;
 		}
 
-		std::unique_ptr<HullShader> CreateHullShader(ID3DBlob& shaderData,
-			const RE::BSShader& shader, uint32_t descriptor)
+		Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+		shaderBlob.Attach(SShaderCache::CompileShader(shaderClass, shader, descriptor, defines,
+			sourceStore));
+		if (shaderBlob == nullptr)
 		{
-			static const auto device =
-				REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
-			static const auto perTechniqueBuffersArray =
-				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
-			static const auto perMaterialBuffersArray =
-				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
-			static const auto perGeometryBuffersArray =
-				CreateDynamicConstantBuffers<HullShader::MaxConstants>(**device);
-			static std::array<float, HullShader::MaxConstants * 4> bufferData;
+			finishRecord(false, true, 0);
+			return std::nullopt;
+		}
 
-			auto newShader = std::make_unique<HullShader>();
-			newShader->id = descriptor;
+		auto reflection = SShaderCache::ReflectShader(shaderClass, shader, descriptor,
+			*shaderBlob.Get(), constantTableSize);
+		if (!reflection.has_value())
+		{
+			finishRecord(false, true, shaderBlob->GetBufferSize());
+			return std::nullopt;
+		}
 
-			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
-			const auto reflectionResult = D3DReflect(shaderData.GetBufferPointer(),
-				shaderData.GetBufferSize(), IID_PPV_ARGS(&reflector));
-			if (FAILED(reflectionResult))
-			{
-				logger::error("Failed to reflect hull shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
-			}
-			else
-			{
-				std::array<size_t, 3> bufferSizes = { 0, 0, 0 };
-				std::fill(newShader->constantTable.begin(), newShader->constantTable.end(), 0);
-				uint64_t dummy;
-				ReflectConstantBuffers(*reflector.Get(), bufferSizes, newShader->constantTable,
-					dummy, ShaderClass::Hull, descriptor, shader);
-				if (bufferSizes[0] != 0 && bufferSizes[0] < perTechniqueBuffersArray.size())
-				{
-					newShader->constantBuffers[0].buffer =
-						perTechniqueBuffersArray[bufferSizes[0]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[0].buffer = nullptr;
-					newShader->constantBuffers[0].data = bufferData.data();
-				}
-				if (bufferSizes[1] != 0 && bufferSizes[1] < perMaterialBuffersArray.size())
-				{
-					newShader->constantBuffers[1].buffer =
-						perMaterialBuffersArray[bufferSizes[1]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[1].buffer = nullptr;
-					newShader->constantBuffers[1].data = bufferData.data();
-				}
-				if (bufferSizes[2] != 0 && bufferSizes[2] < perGeometryBuffersArray.size())
-				{
-					newShader->constantBuffers[2].buffer =
-						perGeometryBuffersArray[bufferSizes[2]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[2].buffer = nullptr;
-					newShader->constantBuffers[2].data = bufferData.data();
-				}
-			}
+		ShaderCacheEntry shaderEntry;
+		shaderEntry.reflection = std::move(*reflection);
+		const auto byteCode = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+		shaderEntry.byteCode.assign(byteCode, byteCode + shaderBlob->GetBufferSize());
+		finishRecord(false, false, shaderEntry.byteCode.size());
 
-			return newShader;
+		if (useDiskCache && !diskCache.Store(key, definesString, shaderEntry))
+		{
+			logger::warn("Failed to store {} shader {}::{} in disk cache",
+				magic_enum::enum_name(shaderClass),
+				magic_enum::enum_name(shader.shaderType.get()), descriptor);
 		}
 
-		std::unique_ptr<DomainShader> CreateDomainShader(ID3DBlob& shaderData,
-			const RE::BSShader& shader, uint32_t descriptor)
+		return shaderEntry;
+	}
+
+	template <typename T>
+	T* ShaderCache::PublishShader(ShaderClass shaderClass, const RE::BSShader& shader,
+		uint32_t descriptor, ConcurrentShaderMap<T>& shaders, std::unique_ptr<T>&& newShader,
+		SharedShader<T>& sharedShader, uint64_t generation, bool replaceExisting)
+	{
+		std::shared_lock lock(clearMutex);
+		if (IsCancelled(generation))
 		{
-			static const auto device =
-				REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
-			static const auto perTechniqueBuffersArray =
-				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
-			static const auto perMaterialBuffersArray =
-				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
-			static const auto perGeometryBuffersArray =
-				CreateDynamicConstantBuffers<DomainShader::MaxConstants>(**device);
-			static std::array<float, DomainShader::MaxConstants * 4> bufferData;
+			newShader->shader->Release();
+			return nullptr;
+		}
 
-			auto newShader = std::make_unique<DomainShader>();
-			newShader->id = descriptor;
+		// Vertex shader objects carry their own copy of the bytecode. Other classes only reference
+		// the shared entry, which is charged once while it has users.
+		const size_t byteCodeSize =
+			shaderClass == ShaderClass::Vertex ? sharedShader.entry->byteCode.size() : 0;
+		const typename ConcurrentShaderMap<T>::EntryInfo entryInfo{ byteCodeSize, sharedShader.key,
+			GetFrameIndex() };
+		const auto addSharedShaderUse = [this, shaderClass, &shader, &sharedShader]() {
+			std::lock_guard sharedShadersLock(sharedShadersMutex);
+			if (sharedShader.useCount++ == 0)
+			{
+				sharedShader.chargedSize = sharedShader.entry->byteCode.size();
+				RecordInsertion(shaderClass, shader, sharedShader.chargedSize);
+			}
+		};
 
-			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
-			const auto reflectionResult = D3DReflect(shaderData.GetBufferPointer(),
-				shaderData.GetBufferSize(), IID_PPV_ARGS(&reflector));
-			if (FAILED(reflectionResult))
+		if (replaceExisting)
+		{
+			typename ConcurrentShaderMap<T>::EntryInfo replacedInfo;
+			auto [cachedShader, oldShader] =
+				shaders.Replace(descriptor, std::move(newShader), entryInfo, &replacedInfo);
+			if (oldShader != nullptr)
 			{
-				logger::error("Failed to reflect domain shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
+				RetireShader(std::move(oldShader));
+				RecordRemoval(shaderClass, static_cast<size_t>(shader.shaderType.underlying()),
+					replacedInfo.cost, false);
 			}
 			else
 			{
-				std::array<size_t, 3> bufferSizes = { 0, 0, 0 };
-				std::fill(newShader->constantTable.begin(), newShader->constantTable.end(), 0);
-				uint64_t dummy;
-				ReflectConstantBuffers(*reflector.Get(), bufferSizes, newShader->constantTable,
-					dummy, ShaderClass::Domain, descriptor, shader);
-				if (bufferSizes[0] != 0 && bufferSizes[0] < perTechniqueBuffersArray.size())
-				{
-					newShader->constantBuffers[0].buffer =
-						perTechniqueBuffersArray[bufferSizes[0]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[0].buffer = nullptr;
-					newShader->constantBuffers[0].data = bufferData.data();
-				}
-				if (bufferSizes[1] != 0 && bufferSizes[1] < perMaterialBuffersArray.size())
-				{
-					newShader->constantBuffers[1].buffer =
-						perMaterialBuffersArray[bufferSizes[1]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[1].buffer = nullptr;
-					newShader->constantBuffers[1].data = bufferData.data();
-				}
-				if (bufferSizes[2] != 0 && bufferSizes[2] < perGeometryBuffersArray.size())
-				{
-					newShader->constantBuffers[2].buffer =
-						perGeometryBuffersArray[bufferSizes[2]].Get();
-				}
-				else
-				{
-					newShader->constantBuffers[2].buffer = nullptr;
-					newShader->constantBuffers[2].data = bufferData.data();
-				}
+				RegisterReloadTarget(shaderClass, shader, descriptor);
 			}
-
-			return newShader;
+			RecordInsertion(shaderClass, shader, byteCodeSize);
+			addSharedShaderUse();
+			return cachedShader;
 		}
 
-		static bool IsSupportedShader(const RE::BSShader& shader, uint32_t descriptor)
+		auto [cachedShader, wasInserted] = shaders.Insert(descriptor, std::move(newShader), entryInfo);
+		if (wasInserted)
 		{
-			if (shader.shaderType == RE::BSShader::Type::ImageSpace)
-			{
-				return descriptor != std::numeric_limits<uint32_t>::max();
-			}
-			return true;
+			RecordInsertion(shaderClass, shader, byteCodeSize);
+			RegisterReloadTarget(shaderClass, shader, descriptor);
+			addSharedShaderUse();
 		}
-
-		static uint32_t GetImagespaceShaderDescriptor(const RE::BSImagespaceShader& imagespaceShader)
+		else
 		{
-			using enum RE::ImageSpaceManager::ImageSpaceEffectEnum;
+			newShader->shader->Release();
+		}
+		return cachedShader;
+	}
 
-			static const std::unordered_map<std::string_view, uint32_t> descriptors{
-				{ "BSImagespaceShaderISBlur", static_cast<uint32_t>(ISBlur) },
-				{ "BSImagespaceShaderBlur3", static_cast<uint32_t>(ISBlur3) },
-				{ "BSImagespaceShaderBlur5", static_cast<uint32_t>(ISBlur5) },
-				{ "BSImagespaceShaderBlur7", static_cast<uint32_t>(ISBlur7) },
-				{ "BSImagespaceShaderBlur9", static_cast<uint32_t>(ISBlur9) },
-				{ "BSImagespaceShaderBlur11", static_cast<uint32_t>(ISBlur11) },
-				{ "BSImagespaceShaderBlur13", static_cast<uint32_t>(ISBlur13) },
-				{ "BSImagespaceShaderBlur15", static_cast<uint32_t>(ISBlur15) },
-				{ "BSImagespaceShaderBrightPassBlur3", static_cast<uint32_t>(ISBrightPassBlur3) },
-				{ "BSImagespaceShaderBrightPassBlur5", static_cast<uint32_t>(ISBrightPassBlur5) },
-				{ "BSImagespaceShaderBrightPassBlur7", static_cast<uint32_t>(ISBrightPassBlur7) },
-				{ "BSImagespaceShaderBrightPassBlur9", static_cast<uint32_t>(ISBrightPassBlur9) },
-				{ "BSImagespaceShaderBrightPassBlur11", static_cast<uint32_t>(ISBrightPassBlur11) },
-				{ "BSImagespaceShaderBrightPassBlur13", static_cast<uint32_t>(ISBrightPassBlur13) },
-				{ "BSImagespaceShaderBrightPassBlur15", static_cast<uint32_t>(ISBrightPassBlur15) },
-				{ "BSImagespaceShaderNonHDRBlur3", static_cast<uint32_t>(ISNonHDRBlur3) },
-				{ "BSImagespaceShaderNonHDRBlur5", static_cast<uint32_t>(ISNonHDRBlur5) },
-				{ "BSImagespaceShaderNonHDRBlur7", static_cast<uint32_t>(ISNonHDRBlur7) },
-				{ "BSImagespaceShaderNonHDRBlur9", static_cast<uint32_t>(ISNonHDRBlur9) },
-				{ "BSImagespaceShaderNonHDRBlur11", static_cast<uint32_t>(ISNonHDRBlur11) },
-				{ "BSImagespaceShaderNonHDRBlur13", static_cast<uint32_t>(ISNonHDRBlur13) },
-				{ "BSImagespaceShaderNonHDRBlur15", static_cast<uint32_t>(ISNonHDRBlur15) },
-				{ "BSImagespaceShaderISBasicCopy", static_cast<uint32_t>(ISBasicCopy) },
-				{ "BSImagespaceShaderISSimpleColor", static_cast<uint32_t>(ISSimpleColor) },
-				{ "BSImagespaceShaderApplyReflections", static_cast<uint32_t>(ISApplyReflections) },
-				{ "BSImagespaceShaderISExp", static_cast<uint32_t>(ISExp) },
-				{ "BSImagespaceShaderISDisplayDepth", static_cast<uint32_t>(ISDisplayDepth) },
-				{ "BSImagespaceShaderAlphaBlend", static_cast<uint32_t>(ISAlphaBlend) },
-				{ "BSImagespaceShaderWaterFlow", static_cast<uint32_t>(ISWaterFlow) },
-				{ "BSImagespaceShaderISWaterBlend", static_cast<uint32_t>(ISWaterBlend) },
-				{ "BSImagespaceShaderGreyScale", static_cast<uint32_t>(ISCopyGrayScale) },
-				{ "BSImagespaceShaderCopy", static_cast<uint32_t>(ISCopy) },
-				{ "BSImagespaceShaderCopyScaleBias", static_cast<uint32_t>(ISCopyScaleBias) },
-				{ "BSImagespaceShaderCopyCustomViewport",
-					static_cast<uint32_t>(ISCopyCustomViewport) },
-				{ "BSImagespaceShaderCopyTextureMask", static_cast<uint32_t>(ISCopyTextureMask) },
-				{ "BSImagespaceShaderCopyDynamicFetchDisabled",
-					static_cast<uint32_t>(ISCopyDynamicFetchDisabled) },
-				{ "BSImagespaceShaderISCompositeVolumetricLighting",
-					static_cast<uint32_t>(ISCompositeVolumetricLighting) },
-				{ "BSImagespaceShaderISCompositeLensFlare",
-					static_cast<uint32_t>(ISCompositeLensFlare) },
-				{ "BSImagespaceShaderISCompositeLensFlareVolumetricLighting",
-					static_cast<uint32_t>(ISCompositeLensFlareVolumetricLighting) },
-				{ "BSImagespaceShaderISDebugSnow", static_cast<uint32_t>(ISDebugSnow) },
-				{ "BSImagespaceShaderDepthOfField", static_cast<uint32_t>(ISDepthOfField) },
-				{ "BSImagespaceShaderDepthOfFieldFogged",
-					static_cast<uint32_t>(ISDepthOfFieldFogged) },
-				{ "BSImagespaceShaderDepthOfFieldMaskedFogged",
-					static_cast<uint32_t>(ISDepthOfFieldMaskedFogged) },
-				{ "BSImagespaceShaderDistantBlur", static_cast<uint32_t>(ISDistantBlur) },
-				{ "BSImagespaceShaderDistantBlurFogged",
-					static_cast<uint32_t>(ISDistantBlurFogged) },
-				{ "BSImagespaceShaderDistantBlurMaskedFogged",
-					static_cast<uint32_t>(ISDistantBlurMaskedFogged) },
-				{ "BSImagespaceShaderDoubleVision", static_cast<uint32_t>(ISDoubleVision) },
-				{ "BSImagespaceShaderISDownsample", static_cast<uint32_t>(ISDownsample) },
-				{ "BSImagespaceShaderISDownsampleIgnoreBrightest",
-					static_cast<uint32_t>(ISDownsampleIgnoreBrightest) },
-				{ "BSImagespaceShaderISUpsampleDynamicResolution",
-					static_cast<uint32_t>(ISUpsampleDynamicResolution) },
-				{ "BSImageSpaceShaderVolumetricLighting",
-					static_cast<uint32_t>(ISVolumetricLighting) },
-				{ "BSImagespaceShaderHDRDownSample4", static_cast<uint32_t>(ISHDRDownSample4) },
-				{ "BSImagespaceShaderHDRDownSample4LightAdapt",
-					static_cast<uint32_t>(ISHDRDownSample4LightAdapt) },
-				{ "BSImagespaceShaderHDRDownSample4LumClamp",
-					static_cast<uint32_t>(ISHDRDownSample4LumClamp) },
-				{ "BSImagespaceShaderHDRDownSample4RGB2Lum",
-					static_cast<uint32_t>(ISHDRDownSample4RGB2Lum) },
-				{ "BSImagespaceShaderHDRDownSample16", static_cast<uint32_t>(ISHDRDownSample16) },
-				{ "BSImagespaceShaderHDRDownSample16LightAdapt",
-					static_cast<uint32_t>(ISHDRDownSample16LightAdapt) },
-				{ "BSImagespaceShaderHDRDownSample16Lum",
-					static_cast<uint32_t>(ISHDRDownSample16Lum) },
-				{ "BSImagespaceShaderHDRDownSample16LumClamp",
-					static_cast<uint32_t>(ISHDRDownSample16LumClamp) },
-				{ "BSImagespaceShaderHDRTonemapBlendCinematic",
-					static_cast<uint32_t>(ISHDRTonemapBlendCinematic) },
-				{ "BSImagespaceShaderHDRTonemapBlendCinematicFade",
-					static_cast<uint32_t>(ISHDRTonemapBlendCinematicFade) },
-				{ "BSImagespaceShaderISIBLensFlares", static_cast<uint32_t>(ISIBLensFlares) },
-				{ "BSImagespaceShaderISLightingComposite",
-					static_cast<uint32_t>(ISLightingComposite) },
-				{ "BSImagespaceShaderISLightingCompositeMenu",
-					static_cast<uint32_t>(ISLightingCompositeMenu) },
-				{ "BSImagespaceShaderISLightingCompositeNoDirectionalLight",
-					static_cast<uint32_t>(ISLightingCompositeNoDirectionalLight) },
-				{ "BSImagespaceShaderLocalMap", static_cast<uint32_t>(ISLocalMap) },
-				{ "BSISWaterBlendHeightmaps", static_cast<uint32_t>(ISWaterBlendHeightmaps) },
-				{ "BSISWaterDisplacementClearSimulation",
-					static_cast<uint32_t>(ISWaterDisplacementClearSimulation) },
-				{ "BSISWaterDisplacementNormals",
-					static_cast<uint32_t>(ISWaterDisplacementNormals) },
-				{ "BSISWaterDisplacementRainRipple",
-					static_cast<uint32_t>(ISWaterDisplacementRainRipple) },
-				{ "BSISWaterDisplacementTexOffset",
-					static_cast<uint32_t>(ISWaterDisplacementTexOffset) },
-				{ "BSISWaterWadingHeightmap", static_cast<uint32_t>(ISWaterWadingHeightmap) },
-				{ "BSISWaterRainHeightmap", static_cast<uint32_t>(ISWaterRainHeightmap) },
-				{ "BSISWaterSmoothHeightmap", static_cast<uint32_t>(ISWaterSmoothHeightmap) },
-				{ "BSISWaterWadingHeightmap", static_cast<uint32_t>(ISWaterWadingHeightmap) },
-				{ "BSImagespaceShaderMap", static_cast<uint32_t>(ISMap) },
-				{ "BSImagespaceShaderMap", static_cast<uint32_t>(ISMap) },
-				{ "BSImagespaceShaderWorldMap", static_cast<uint32_t>(ISWorldMap) },
-				{ "BSImagespaceShaderWorldMapNoSkyBlur",
-					static_cast<uint32_t>(ISWorldMapNoSkyBlur) },
-				{ "BSImagespaceShaderISMinify", static_cast<uint32_t>(ISMinify) },
-				{ "BSImagespaceShaderISMinifyContrast", static_cast<uint32_t>(ISMinifyContrast) },
-				{ "BSImagespaceShaderNoiseNormalmap", static_cast<uint32_t>(ISNoiseNormalmap) },
-				{ "BSImagespaceShaderNoiseScrollAndBlend",
-					static_cast<uint32_t>(ISNoiseScrollAndBlend) },
-				{ "BSImagespaceShaderRadialBlur",
-					static_cast<uint32_t>(ISRadialBlur) },
-				{ "BSImagespaceShaderRadialBlurHigh", static_cast<uint32_t>(ISRadialBlurHigh) },
-				{ "BSImagespaceShaderRadialBlurMedium", static_cast<uint32_t>(ISRadialBlurMedium) },
-				{ "BSImagespaceShaderRefraction", static_cast<uint32_t>(ISRefraction) },
-			};
+	template <typename T>
+	void ShaderCache::RetireShader(std::unique_ptr<T>&& shader)
+	{
+		std::lock_guard lock(retiredShadersMutex);
+		retiredShaders.push_back({ GetFrameIndex(), [retiredShader = shader.release()]() {
+									  retiredShader->shader->Release();
+									  delete retiredShader;
+								  } });
+	}
 
-			auto it = descriptors.find(imagespaceShader.name);
-			if (it == descriptors.cend())
+	void ShaderCache::ReleaseRetiredShaders(bool releaseAll)
+	{
+		// The renderer may still reference a replaced shader from the frame it was swapped in.
+		constexpr uint64_t RetireFrameDelay = 3;
+
+		std::lock_guard lock(retiredShadersMutex);
+		const auto currentFrame = GetFrameIndex();
+		std::erase_if(retiredShaders, [&](const RetiredShader& retiredShader) {
+			if (releaseAll || retiredShader.frameIndex + RetireFrameDelay < currentFrame)
 			{
-				return std::numeric_limits<uint32_t>::max();
+				retiredShader.release();
+				return true;
 			}
-			return it->second;
-		}
+			return false;
+		});
+
+		const auto releaseRetiredTables = [currentFrame](auto& shaderMaps) {
+			for (auto& shaders : shaderMaps)
+			{
+				shaders.ReleaseRetiredTables(currentFrame);
+			}
+		};
+		releaseRetiredTables(vertexShaders);
+		releaseRetiredTables(pixelShaders);
+		releaseRetiredTables(hullShaders);
+		releaseRetiredTables(domainShaders);
 	}
 
-	RE::BSGraphics::VertexShader* ShaderCache::GetVertexShader(const RE::BSShader& shader,
-		uint32_t rawDescriptor)
+	void ShaderCache::EvictShaders()
 	{
-		uint32_t descriptor = rawDescriptor;
-		if (shader.shaderType == RE::BSShader::Type::ImageSpace)
+		// Shaders used in the frame that was just rendered may still be bound by the renderer.
+		constexpr uint64_t MinIdleFrames = 2;
+
+		const size_t budget = GetMemoryBudget();
+		const uint64_t cachedSize = cachedByteCodeSize;
+		if (budget == 0 || cachedSize <= budget)
 		{
-			descriptor = SShaderCache::GetImagespaceShaderDescriptor(
-				static_cast<const RE::BSImagespaceShader&>(shader));
+			evictionRetryFrame = 0;
+			return;
 		}
 
-		if (!SShaderCache::IsSupportedShader(shader, descriptor))
+		// A scan that could not get under the budget is only repeated once the bytecode above the
+		// budget grows or some shader has been idle long enough to be evicted.
+		const auto currentFrame = GetFrameIndex();
+		if (evictionRetryFrame != 0 && currentFrame < evictionRetryFrame &&
+			cachedSize - budget <= evictionRetryExcess)
 		{
-			return nullptr;
+			return;
 		}
 
+		std::shared_lock lock(clearMutex);
+
+		std::vector<SShaderCache::EvictionCandidate> candidates;
+		uint64_t nextCandidateFrame = std::numeric_limits<uint64_t>::max();
+		SShaderCache::CollectEvictionCandidates(ShaderClass::Vertex, vertexShaders, currentFrame,
+			MinIdleFrames, candidates, nextCandidateFrame);
+		SShaderCache::CollectEvictionCandidates(ShaderClass::Pixel, pixelShaders, currentFrame,
+			MinIdleFrames, candidates, nextCandidateFrame);
+		SShaderCache::CollectEvictionCandidates(ShaderClass::Hull, hullShaders, currentFrame,
+			MinIdleFrames, candidates, nextCandidateFrame);
+		SShaderCache::CollectEvictionCandidates(ShaderClass::Domain, domainShaders, currentFrame,
+			MinIdleFrames, candidates, nextCandidateFrame);
+		std::sort(candidates.begin(), candidates.end(),
+			[](const SShaderCache::EvictionCandidate& first,
+				const SShaderCache::EvictionCandidate& second) {
+				return first.lastUseFrame < second.lastUseFrame;
+			});
+
+		// Evicting below the budget keeps the next few insertions from triggering another scan.
+		const uint64_t targetSize = budget - budget / 8;
+		std::unordered_set<size_t> evictedTasks;
+		for (const auto& candidate : candidates)
 		{
-			std::lock_guard lockGuard(vertexShadersMutex);
-			auto& typeCache = vertexShaders[static_cast<size_t>(shader.shaderType.underlying())];
-			auto it = typeCache.find(descriptor);
-			if (it != typeCache.end())
+			if (cachedByteCodeSize <= targetSize)
+			{
+				break;
+			}
+
+			bool isEvicted = false;
+			switch (candidate.shaderClass)
+			{
+			case ShaderClass::Vertex:
+				isEvicted = EvictShader(candidate.shaderClass, candidate.typeIndex,
+					candidate.descriptor, vertexShaders[candidate.typeIndex], sharedVertexShaders);
+				break;
+			case ShaderClass::Pixel:
+				isEvicted = EvictShader(candidate.shaderClass, candidate.typeIndex,
+					candidate.descriptor, pixelShaders[candidate.typeIndex], sharedPixelShaders);
+				break;
+			case ShaderClass::Hull:
+				isEvicted = EvictShader(candidate.shaderClass, candidate.typeIndex,
+					candidate.descriptor, hullShaders[candidate.typeIndex], sharedHullShaders);
+				break;
+			case ShaderClass::Domain:
+				isEvicted = EvictShader(candidate.shaderClass, candidate.typeIndex,
+					candidate.descriptor, domainShaders[candidate.typeIndex], sharedDomainShaders);
+				break;
+			}
+			if (isEvicted)
 			{
-				return it->second.get();
+				evictedTasks.insert(ShaderCompilationTask::GetId(candidate.shaderClass,
+					static_cast<RE::BSShader::Type>(candidate.typeIndex), candidate.descriptor));
 			}
 		}
 
-		if (IsAsync())
+		if (const uint64_t remainingSize = cachedByteCodeSize; remainingSize > budget)
 		{
-			compilationSet.Add({ ShaderClass::Vertex, shader, descriptor });
+			evictionRetryFrame = nextCandidateFrame;
+			evictionRetryExcess = remainingSize - budget;
 		}
 		else
 		{
-			return MakeAndAddVertexShader(shader, descriptor);
-		}
-
-		return nullptr;
-	}
-
-	RE::BSGraphics::PixelShader* ShaderCache::GetPixelShader(const RE::BSShader& shader,
-		uint32_t rawDescriptor)
-	{
-		uint32_t descriptor = rawDescriptor;
-		if (shader.shaderType == RE::BSShader::Type::ImageSpace)
-		{
-			descriptor = SShaderCache::GetImagespaceShaderDescriptor(
-				static_cast<const RE::BSImagespaceShader&>(shader));
+			evictionRetryFrame = 0;
 		}
 
-		if (!SShaderCache::IsSupportedShader(shader, descriptor))
+		if (evictedTasks.empty())
 		{
-			return nullptr;
+			return;
 		}
 
 		{
-			std::lock_guard lockGuard(pixelShadersMutex);
-			auto& typeCache = pixelShaders[static_cast<size_t>(shader.shaderType.underlying())];
-			auto it = typeCache.find(descriptor);
-			if (it != typeCache.end())
+			std::lock_guard reloadTargetsLock(reloadTargetsMutex);
+			for (auto& [path, tasks] : reloadTargets)
 			{
-				return it->second.get();
+				std::erase_if(tasks, [&evictedTasks](const ShaderCompilationTask& task) {
+					return evictedTasks.contains(task.GetId());
+				});
 			}
 		}
 
-		if (IsAsync())
-		{
-			compilationSet.Add({ ShaderClass::Pixel, shader, descriptor });
-		}
-		else
-		{
-			return MakeAndAddPixelShader(shader, descriptor);
-		}
-
-		return nullptr;
+		logger::info("Evicted {} shaders, {} KB of bytecode cached", evictedTasks.size(),
+			cachedByteCodeSize / 1024);
 	}
 
-	HullShader* ShaderCache::GetHullShader(const RE::BSShader& shader,
-		uint32_t rawDescriptor)
+	template <typename T>
+	bool ShaderCache::EvictShader(ShaderClass shaderClass, size_t typeIndex, uint32_t descriptor,
+		ConcurrentShaderMap<T>& shaders, SharedShaderMap<T>& sharedShaders)
 	{
-		uint32_t descriptor = rawDescriptor;
-		if (shader.shaderType == RE::BSShader::Type::ImageSpace)
+		typename ConcurrentShaderMap<T>::EntryInfo entryInfo;
+		auto evictedShader = shaders.Remove(descriptor, &entryInfo);
+		if (evictedShader == nullptr)
 		{
-			descriptor = SShaderCache::GetImagespaceShaderDescriptor(
-				static_cast<const RE::BSImagespaceShader&>(shader));
+			return false;
 		}
 
-		if (!SShaderCache::IsSupportedShader(shader, descriptor))
-		{
-			return nullptr;
-		}
+		RetireShader(std::move(evictedShader));
+		RecordRemoval(shaderClass, typeIndex, entryInfo.cost, true);
+		ReleaseSharedShader(shaderClass, sharedShaders, entryInfo.group);
+		return true;
+	}
 
+	template <typename T>
+	void ShaderCache::ReleaseSharedShader(ShaderClass shaderClass,
+		SharedShaderMap<T>& sharedShaders, uint64_t sharedKey)
+	{
+		// Dropping the last reference frees the shared bytecode, the D3D object itself lives on
+		// in retired shaders until they are released.
+		std::lock_guard lock(sharedShadersMutex);
+		if (auto it = sharedShaders.find(sharedKey);
+			it != sharedShaders.end() && it->second->useCount > 0 && --it->second->useCount == 0)
 		{
-			std::lock_guard lockGuard(hullShadersMutex);
-			auto& typeCache = hullShaders[static_cast<size_t>(shader.shaderType.underlying())];
-			auto it = typeCache.find(descriptor);
-			if (it != typeCache.end())
-			{
-				return it->second.get();
-			}
+			RecordRemoval(shaderClass, it->second->typeIndex, it->second->chargedSize, false);
+			sharedShaders.erase(it);
 		}
+	}
 
-		if (IsAsync())
-		{
-			compilationSet.Add({ ShaderClass::Hull, shader, descriptor });
-		}
-		else
-		{
-			return MakeAndAddHullShader(shader, descriptor);
-		}
+	size_t ShaderCache::GetMemoryBudget() const
+	{
+		return memoryBudget;
+	}
 
-		return nullptr;
+	void ShaderCache::SetMemoryBudget(size_t value)
+	{
+		memoryBudget = value;
 	}
 
-	DomainShader* ShaderCache::GetDomainShader(const RE::BSShader& shader,
-		uint32_t rawDescriptor)
+	void ShaderCache::RegisterReloadTarget(ShaderClass shaderClass, const RE::BSShader& shader,
+		uint32_t descriptor)
 	{
-		uint32_t descriptor = rawDescriptor;
-		if (shader.shaderType == RE::BSShader::Type::ImageSpace)
-		{
-			descriptor = SShaderCache::GetImagespaceShaderDescriptor(
-				static_cast<const RE::BSImagespaceShader&>(shader));
-		}
+		const auto sourcePath = SShaderCache::GetSourcePath(shader);
+
+		std::lock_guard lock(reloadTargetsMutex);
+		reloadTargets[sourcePath].emplace_back(shaderClass, shader, descriptor, true);
+	}
 
-		if (!SShaderCache::IsSupportedShader(shader, descriptor))
+	void ShaderCache::ReloadShaders(const std::vector<std::filesystem::path>& changedPaths)
+	{
 		{
-			return nullptr;
+			std::lock_guard lock(sharedShadersMutex);
+			// Descriptors still using an erased entry are replaced by the reload, so its charge is
+			// dropped with it.
+			const auto eraseChanged = [&](ShaderClass shaderClass, auto& sharedShaders) {
+				std::erase_if(sharedShaders, [&](const auto& item) {
+					if (std::find(changedPaths.cbegin(), changedPaths.cend(),
+							item.second->sourcePath) == changedPaths.cend())
+					{
+						return false;
+					}
+					RecordRemoval(shaderClass, item.second->typeIndex, item.second->chargedSize,
+						false);
+					return true;
+				});
+			};
+			eraseChanged(ShaderClass::Vertex, sharedVertexShaders);
+			eraseChanged(ShaderClass::Pixel, sharedPixelShaders);
+			eraseChanged(ShaderClass::Hull, sharedHullShaders);
+			eraseChanged(ShaderClass::Domain, sharedDomainShaders);
 		}
 
+		std::vector<ShaderCompilationTask> tasks;
 		{
-			std::lock_guard lockGuard(domainShadersMutex);
-			auto& typeCache = domainShaders[static_cast<size_t>(shader.shaderType.underlying())];
-			auto it = typeCache.find(descriptor);
-			if (it != typeCache.end())
+			std::lock_guard lock(reloadTargetsMutex);
+			for (const auto& path : changedPaths)
 			{
-				return it->second.get();
+				if (auto it = reloadTargets.find(path.native()); it != reloadTargets.end())
+				{
+					for (const auto& task : it->second)
+					{
+						tasks.push_back(task);
+					}
+				}
 			}
 		}
 
-		if (IsAsync())
-		{
-			compilationSet.Add({ ShaderClass::Domain, shader, descriptor });
-		}
-		else
+		logger::info("Reloading {} shaders after source changes", tasks.size());
+		const auto currentFrame = GetFrameIndex();
+		for (const auto& task : tasks)
 		{
-			return MakeAndAddDomainShader(shader, descriptor);
+			compilationSet.Add(task, currentFrame);
 		}
-
-		return nullptr;
-	}
-
-	ShaderCache::~ShaderCache() 
-	{ 
-		Clear();
 	}
 
-	bool ShaderCache::IsEnabledForClass(ShaderClass shaderClass) const 
+	void ShaderCache::WatchShaderSources(std::stop_token stopToken)
 	{
-		return isEnabled && !(disabledClasses & (1 << static_cast<uint32_t>(shaderClass)));
-	}
+		constexpr auto PollInterval = std::chrono::milliseconds(500);
 
-	void ShaderCache::SetEnabledForClass(ShaderClass shaderClass, bool value)
-	{
-		if (value)
-		{
-			disabledClasses &= ~(1 << static_cast<uint32_t>(shaderClass));
-		}
-		else
+		std::mutex watchMutex;
+		std::condition_variable_any watchCondition;
+		std::unique_lock lock(watchMutex);
+		while (!stopToken.stop_requested())
 		{
-			disabledClasses |= (1 << static_cast<uint32_t>(shaderClass));
+			watchCondition.wait_for(lock, stopToken, PollInterval, []() { return false; });
+			if (stopToken.stop_requested())
+			{
+				break;
+			}
+
+			FlushTrace();
+
+			if (IsEnabled() && IsHotReloadEnabled())
+			{
+				if (const auto changedPaths = sourceHasher.PollChanges(); !changedPaths.empty())
+				{
+					ReloadShaders(changedPaths);
+				}
+			}
 		}
 	}
 
-	void ShaderCache::Clear()
+	template <typename T, typename CreateFunc>
+	std::shared_ptr<SharedShader<T>> ShaderCache::AcquireSharedShader(ShaderClass shaderClass,
+		const RE::BSShader& shader, uint32_t descriptor, size_t constantTableSize,
+		uint64_t generation, SharedShaderMap<T>& sharedShaders, CreateFunc&& createFunc)
 	{
-		for (auto& shaders : vertexShaders)
+		const auto permutation = SShaderCache::MakePermutation(shaderClass, shader, descriptor);
+		const uint64_t sharedKey = HashBytes(&permutation.key.shaderType,
+			sizeof(permutation.key.shaderType), permutation.key.definesHash);
+
+		std::shared_ptr<SharedShader<T>> sharedShader;
 		{
-			for (auto& [id, shader] : shaders)
+			std::lock_guard lock(sharedShadersMutex);
+			auto& sharedShaderSlot = sharedShaders[sharedKey];
+			if (sharedShaderSlot == nullptr)
 			{
-				shader->shader->Release();
+				sharedShaderSlot = std::make_shared<SharedShader<T>>();
+				sharedShaderSlot->sourcePath = SShaderCache::GetSourcePath(shader);
+				sharedShaderSlot->key = sharedKey;
+				sharedShaderSlot->typeIndex = static_cast<size_t>(shader.shaderType.underlying());
 			}
-			shaders.clear();
+			sharedShader = sharedShaderSlot;
 		}
-		for (auto& shaders : pixelShaders)
+
+		std::lock_guard lock(sharedShader->mutex);
+		if (sharedShader->isInitialized)
 		{
-			for (auto& [id, shader] : shaders)
+			if (sharedShader->shader != nullptr)
 			{
-				shader->shader->Release();
+				RecordDeduplication(shaderClass, shader);
 			}
-			shaders.clear();
+			return sharedShader;
 		}
-		for (auto& shaders : hullShaders)
+
+		sharedShader->entry = LoadOrCompileShader(permutation, shaderClass, shader, descriptor,
+			constantTableSize, generation);
+		// The slot may already belong to the maps of a later generation, so a cancelled
+		// compilation leaves it uninitialized for the next request instead of failing it.
+		if (IsCancelled(generation))
 		{
-			for (auto& [id, shader] : shaders)
-			{
-				shader->shader->Release();
-			}
-			shaders.clear();
+			sharedShader->entry.reset();
+			return sharedShader;
 		}
-		for (auto& shaders : domainShaders)
+		if (sharedShader->entry.has_value() &&
+			FAILED(createFunc(*sharedShader->entry, sharedShader->shader)))
 		{
-			for (auto& [id, shader] : shaders)
-			{
-				shader->shader->Release();
-			}
-			shaders.clear();
+			logger::error("Failed to create {} shader {}::{}", magic_enum::enum_name(shaderClass),
+				magic_enum::enum_name(shader.shaderType.get()), descriptor);
+			RecordFailure(shaderClass, shader);
+			sharedShader->shader.Reset();
+			sharedShader->entry.reset();
 		}
+		sharedShader->isInitialized = true;
 
-		compilationSet.Clear();
+		return sharedShader;
 	}
 
-	bool ShaderCache::IsEnabled() const
-	{ 
-		return isEnabled;
-	}
+	std::unique_ptr<RE::BSGraphics::VertexShader> ShaderCache::BuildVertexShader(
+		const RE::BSShader& shader, uint32_t descriptor, uint64_t generation,
+		std::shared_ptr<SharedShader<RE::BSGraphics::VertexShader>>& sharedShader)
+	{
+		static const auto device = REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
 
-	void ShaderCache::SetEnabled(bool value)
-	{ 
-		isEnabled = value;
-	}
+		sharedShader = AcquireSharedShader(ShaderClass::Vertex, shader, descriptor,
+			std::tuple_size_v<decltype(RE::BSGraphics::VertexShader::constantTable)>, generation, sharedVertexShaders,
+			[](const ShaderCacheEntry& shaderEntry, auto& shaderObject) {
+				return (*device)->CreateVertexShader(shaderEntry.byteCode.data(),
+					shaderEntry.byteCode.size(), nullptr, shaderObject.GetAddressOf());
+			});
+		if (sharedShader->shader == nullptr)
+		{
+			return nullptr;
+		}
 
-	bool ShaderCache::IsAsync() const
-	{ 
-		return isAsync;
+		auto newShader = SShaderCache::CreateVertexShader(*sharedShader->entry, descriptor);
+		newShader->shader = sharedShader->shader.Get();
+		newShader->shader->AddRef();
+		return newShader;
 	}
 
-	void ShaderCache::SetAsync(bool value)
-	{ 
-		isAsync = value;
+	std::unique_ptr<RE::BSGraphics::PixelShader> ShaderCache::BuildPixelShader(
+		const RE::BSShader& shader, uint32_t descriptor, uint64_t generation,
+		std::shared_ptr<SharedShader<RE::BSGraphics::PixelShader>>& sharedShader)
+	{
+		static const auto device = REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
+
+		sharedShader = AcquireSharedShader(ShaderClass::Pixel, shader, descriptor,
+			std::tuple_size_v<decltype(RE::BSGraphics::PixelShader::constantTable)>, generation, sharedPixelShaders,
+			[](const ShaderCacheEntry& shaderEntry, auto& shaderObject) {
+				return (*device)->CreatePixelShader(shaderEntry.byteCode.data(),
+					shaderEntry.byteCode.size(), nullptr, shaderObject.GetAddressOf());
+			});
+		if (sharedShader->shader == nullptr)
+		{
+			return nullptr;
+		}
+
+		auto newShader = SShaderCache::CreatePixelShader(*sharedShader->entry, descriptor);
+		newShader->shader = sharedShader->shader.Get();
+		newShader->shader->AddRef();
+		return newShader;
 	}
 
-	ShaderCache::ShaderCache() 
+	RE::BSGraphics::VertexShader* ShaderCache::MakeAndAddVertexShader(const RE::BSShader& shader,
+		uint32_t descriptor, bool replaceExisting)
 	{
-		static const auto compilationThreadCount = std::max(1, (static_cast<int32_t>(std::thread::hardware_concurrency()) - 4));
-		for (size_t threadIndex = 0; threadIndex < compilationThreadCount; ++threadIndex)
+		const auto generation = compilationGeneration.load();
+		std::shared_ptr<SharedShader<RE::BSGraphics::VertexShader>> sharedShader;
+		auto newShader = BuildVertexShader(shader, descriptor, generation, sharedShader);
+		if (newShader == nullptr)
 		{
-			compilationThreads.push_back(std::jthread(&ShaderCache::ProcessCompilationSet, this));
+			return nullptr;
 		}
+
+		return PublishShader(ShaderClass::Vertex, shader, descriptor,
+			vertexShaders[static_cast<size_t>(shader.shaderType.get())], std::move(newShader),
+			*sharedShader, generation, replaceExisting);
 	}
 
-	RE::BSGraphics::VertexShader* ShaderCache::MakeAndAddVertexShader(const RE::BSShader& shader,
-		uint32_t descriptor)
+	RE::BSGraphics::PixelShader* ShaderCache::MakeAndAddPixelShader(const RE::BSShader& shader,
+		uint32_t descriptor, bool replaceExisting)
 	{
-		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Vertex, shader, descriptor))
+		const auto generation = compilationGeneration.load();
+		std::shared_ptr<SharedShader<RE::BSGraphics::PixelShader>> sharedShader;
+		auto newShader = BuildPixelShader(shader, descriptor, generation, sharedShader);
+		if (newShader == nullptr)
 		{
-			static const auto device = REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
+			return nullptr;
+		}
 
-			auto newShader = SShaderCache::CreateVertexShader(*shaderBlob, shader,
-				descriptor);
+		return PublishShader(ShaderClass::Pixel, shader, descriptor,
+			pixelShaders[static_cast<size_t>(shader.shaderType.get())], std::move(newShader),
+			*sharedShader, generation, replaceExisting);
+	}
 
-			std::lock_guard lockGuard(vertexShadersMutex);
+	std::pair<RE::BSGraphics::VertexShader*, RE::BSGraphics::PixelShader*>
+		ShaderCache::MakeAndAddTechnique(const RE::BSShader& shader, uint32_t vertexDescriptor,
+			uint32_t pixelDescriptor)
+	{
+		const auto generation = compilationGeneration.load();
+		const auto typeIndex = static_cast<size_t>(shader.shaderType.get());
 
-			const auto result = (*device)->CreateVertexShader(shaderBlob->GetBufferPointer(),
-				newShader->byteCodeSize, nullptr, &newShader->shader);
-			if (FAILED(result))
-			{
-				logger::error("Failed to create vertex shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
-				if (newShader->shader != nullptr)
-				{
-					newShader->shader->Release();
-				}
-			}
-			else
+		// Halves already published, for example by another technique sharing them, are kept.
+		auto vertexShader = vertexShaders[typeIndex].Find(vertexDescriptor);
+		auto pixelShader = pixelShaders[typeIndex].Find(pixelDescriptor);
+
+		std::shared_ptr<SharedShader<RE::BSGraphics::VertexShader>> sharedVertexShader;
+		std::unique_ptr<RE::BSGraphics::VertexShader> newVertexShader;
+		if (vertexShader == nullptr)
+		{
+			newVertexShader = BuildVertexShader(shader, vertexDescriptor, generation, sharedVertexShader);
+			if (newVertexShader == nullptr)
 			{
-				return vertexShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
+				return { nullptr, nullptr };
 			}
 		}
-		return nullptr;
-	}
 
-	RE::BSGraphics::PixelShader* ShaderCache::MakeAndAddPixelShader(const RE::BSShader& shader,
-		uint32_t descriptor)
-	{
-		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Pixel, shader, descriptor))
+		std::shared_ptr<SharedShader<RE::BSGraphics::PixelShader>> sharedPixelShader;
+		std::unique_ptr<RE::BSGraphics::PixelShader> newPixelShader;
+		if (pixelShader == nullptr)
 		{
-			static const auto device =
-				REL::Relocation<REX::W32::ID3D11Device**>(RE::Offset::D3D11Device);
-
-			auto newShader = SShaderCache::CreatePixelShader(*shaderBlob, shader,
-				descriptor);
-
-			std::lock_guard lockGuard(pixelShadersMutex);
-			const auto result = (*device)->CreatePixelShader(shaderBlob->GetBufferPointer(),
-				shaderBlob->GetBufferSize(), nullptr, &newShader->shader);
-			if (FAILED(result))
+			newPixelShader = BuildPixelShader(shader, pixelDescriptor, generation, sharedPixelShader);
+			if (newPixelShader == nullptr)
 			{
-				logger::error("Failed to create pixel shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()),
-					descriptor);
-				if (newShader->shader != nullptr)
+				if (newVertexShader != nullptr)
 				{
-					newShader->shader->Release();
+					newVertexShader->shader->Release();
 				}
-			}
-			else
-			{
-				return pixelShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
+				return { nullptr, nullptr };
 			}
 		}
-		return nullptr;
+
+		if (newVertexShader != nullptr)
+		{
+			vertexShader = PublishShader(ShaderClass::Vertex, shader, vertexDescriptor,
+				vertexShaders[typeIndex], std::move(newVertexShader), *sharedVertexShader,
+				generation, false);
+		}
+		if (newPixelShader != nullptr)
+		{
+			pixelShader = PublishShader(ShaderClass::Pixel, shader, pixelDescriptor,
+				pixelShaders[typeIndex], std::move(newPixelShader), *sharedPixelShader, generation,
+				false);
+		}
+		if (vertexShader == nullptr || pixelShader == nullptr)
+		{
+			return { nullptr, nullptr };
+		}
+		return { vertexShader, pixelShader };
 	}
 
 	HullShader* ShaderCache::MakeAndAddHullShader(const RE::BSShader& shader,
-		uint32_t descriptor)
+		uint32_t descriptor, bool replaceExisting)
 	{
-		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Hull, shader, descriptor))
+		static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
+
+		const auto generation = compilationGeneration.load();
+		const auto sharedShader = AcquireSharedShader(ShaderClass::Hull, shader, descriptor,
+			HullShader::MaxConstants, generation, sharedHullShaders,
+			[](const ShaderCacheEntry& shaderEntry, auto& shaderObject) {
+				return (*device)->CreateHullShader(shaderEntry.byteCode.data(),
+					shaderEntry.byteCode.size(), nullptr, shaderObject.GetAddressOf());
+			});
+		if (sharedShader->shader == nullptr)
 		{
-			static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
+			return nullptr;
+		}
 
-			auto newShader = SShaderCache::CreateHullShader(*shaderBlob, shader, descriptor);
+		auto newShader = SShaderCache::CreateHullShader(*sharedShader->entry, descriptor);
+		newShader->shader = sharedShader->shader.Get();
+		newShader->shader->AddRef();
 
-			std::lock_guard lockGuard(hullShadersMutex);
-			const auto result = (*device)->CreateHullShader(shaderBlob->GetBufferPointer(),
-				shaderBlob->GetBufferSize(), nullptr, &newShader->shader);
-			if (FAILED(result))
-			{
-				logger::error("Failed to create hull shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
-				if (newShader->shader != nullptr)
-				{
-					newShader->shader->Release();
-				}
-			}
-			else
-			{
-				return hullShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
-			}
-		}
-		return nullptr;
+		return PublishShader(ShaderClass::Hull, shader, descriptor,
+			hullShaders[static_cast<size_t>(shader.shaderType.get())], std::move(newShader),
+			*sharedShader, generation, replaceExisting);
 	}
 
 	DomainShader* ShaderCache::MakeAndAddDomainShader(const RE::BSShader& shader,
-		uint32_t descriptor)
+		uint32_t descriptor, bool replaceExisting)
 	{
-		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Domain, shader, descriptor))
+		static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
+
+		const auto generation = compilationGeneration.load();
+		const auto sharedShader = AcquireSharedShader(ShaderClass::Domain, shader, descriptor,
+			DomainShader::MaxConstants, generation, sharedDomainShaders,
+			[](const ShaderCacheEntry& shaderEntry, auto& shaderObject) {
+				return (*device)->CreateDomainShader(shaderEntry.byteCode.data(),
+					shaderEntry.byteCode.size(), nullptr, shaderObject.GetAddressOf());
+			});
+		if (sharedShader->shader == nullptr)
 		{
-			static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
+			return nullptr;
+		}
 
-			auto newShader = SShaderCache::CreateDomainShader(*shaderBlob, shader, descriptor);
+		auto newShader = SShaderCache::CreateDomainShader(*sharedShader->entry, descriptor);
+		newShader->shader = sharedShader->shader.Get();
+		newShader->shader->AddRef();
 
-			std::lock_guard lockGuard(domainShadersMutex);
-			const auto result = (*device)->CreateDomainShader(shaderBlob->GetBufferPointer(),
-				shaderBlob->GetBufferSize(), nullptr, &newShader->shader);
-			if (FAILED(result))
-			{
-				logger::error("Failed to create domain shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
-				if (newShader->shader != nullptr)
-				{
-					newShader->shader->Release();
-				}
-			}
-			else
-			{
-				return domainShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
-			}
-		}
-		return nullptr;
+		return PublishShader(ShaderClass::Domain, shader, descriptor,
+			domainShaders[static_cast<size_t>(shader.shaderType.get())], std::move(newShader),
+			*sharedShader, generation, replaceExisting);
 	}
 
-	void ShaderCache::ProcessCompilationSet() 
+	void ShaderCache::ProcessCompilationSet(std::stop_token stopToken) 
 	{ 
-		while (true)
+		while (const auto task = compilationSet.WaitTake(stopToken))
 		{
-			const auto& task = compilationSet.WaitTake();
-			task.Perform();
-			compilationSet.Complete(task);
+			task->Perform();
+			compilationSet.Complete(*task);
 		}
 	}
 
 	ShaderCompilationTask::ShaderCompilationTask(ShaderClass aShaderClass,
 		const RE::BSShader& aShader,
-		uint32_t aDescriptor) 
+		uint32_t aDescriptor,
+		bool aIsReload) 
 		: shaderClass(aShaderClass)
 		, shader(aShader)
 		, descriptor(aDescriptor)
+		, isReload(aIsReload)
+	{}
+
+	ShaderCompilationTask::ShaderCompilationTask(const RE::BSShader& aShader,
+		uint32_t aVertexDescriptor,
+		uint32_t aPixelDescriptor)
+		: shaderClass(ShaderClass::Vertex)
+		, shader(aShader)
+		, descriptor(aVertexDescriptor)
+		, pixelDescriptor(aPixelDescriptor)
+		, isReload(false)
 	{}
 
 	void ShaderCompilationTask::Perform() const
 	{ 
-		if (shaderClass == ShaderClass::Vertex)
+		if (pixelDescriptor.has_value())
+		{
+			ShaderCache::Instance().MakeAndAddTechnique(shader, descriptor, *pixelDescriptor);
+		}
+		else if (shaderClass == ShaderClass::Vertex)
 		{
-			ShaderCache::Instance().MakeAndAddVertexShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddVertexShader(shader, descriptor, isReload);
 		}
 		else if (shaderClass == ShaderClass::Pixel)
 		{
-			ShaderCache::Instance().MakeAndAddPixelShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddPixelShader(shader, descriptor, isReload);
 		}
 		else if (shaderClass == ShaderClass::Hull)
 		{
-			ShaderCache::Instance().MakeAndAddHullShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddHullShader(shader, descriptor, isReload);
 		}
 		else if (shaderClass == ShaderClass::Domain)
 		{
-			ShaderCache::Instance().MakeAndAddDomainShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddDomainShader(shader, descriptor, isReload);
 		}
 	}
 
 	size_t ShaderCompilationTask::GetId() const
 	{ 
-		return descriptor + (static_cast<size_t>(shader.shaderType.underlying()) << 32) +
+		if (pixelDescriptor.has_value())
+		{
+			// Technique ids hash both descriptors and use a class value no single shader has.
+			const uint64_t descriptors = (static_cast<uint64_t>(*pixelDescriptor) << 32) | descriptor;
+			const uint64_t hash = HashBytes(&descriptors, sizeof(descriptors),
+				HashSeed + static_cast<uint64_t>(shader.shaderType.underlying()));
+			return (hash >> 4) | (0xFull << 60);
+		}
+		return GetId(shaderClass, shader.shaderType.get(), descriptor);
+	}
+
+	size_t ShaderCompilationTask::GetId(ShaderClass shaderClass, RE::BSShader::Type shaderType,
+		uint32_t descriptor)
+	{
+		return descriptor + (static_cast<size_t>(shaderType) << 32) +
 		       (static_cast<size_t>(shaderClass) << 60);
 	}
 
+	ShaderClass ShaderCompilationTask::GetShaderClass() const
+	{
+		return shaderClass;
+	}
+
+	RE::BSShader::Type ShaderCompilationTask::GetShaderType() const
+	{
+		return shader.shaderType.get();
+	}
+
+	bool ShaderCompilationTask::IsTechnique() const
+	{
+		return pixelDescriptor.has_value();
+	}
+
+	bool ShaderCompilationTask::IsReload() const
+	{
+		return isReload;
+	}
+
 	bool ShaderCompilationTask::operator==(const ShaderCompilationTask& other) const
 	{ 
 		return GetId() == other.GetId();
 	}
 
-	ShaderCompilationTask CompilationSet::WaitTake() 
+	bool CompilationSet::TaskPriority::operator<(const TaskPriority& other) const
+	{
+		if (lastRequestFrame != other.lastRequestFrame)
+		{
+			return lastRequestFrame > other.lastRequestFrame;
+		}
+		if (classRank != other.classRank)
+		{
+			return classRank < other.classRank;
+		}
+		if (requestCount != other.requestCount)
+		{
+			return requestCount > other.requestCount;
+		}
+		return sequence < other.sequence;
+	}
+
+	uint32_t CompilationSet::GetClassRank(ShaderClass shaderClass)
+	{
+		// Vertex and pixel shaders share a rank so that both halves of a technique requested
+		// in the same frame are compiled next to each other.
+		return shaderClass == ShaderClass::Vertex || shaderClass == ShaderClass::Pixel ? 0 : 1;
+	}
+
+	std::optional<ShaderCompilationTask> CompilationSet::WaitTake(std::stop_token stopToken) 
 	{
 		std::unique_lock lock(mutex);
-		conditionVariable.wait(lock, [this]() { return !availableTasks.empty(); });
+		if (!conditionVariable.wait(lock, stopToken, [this]() {
+				return !isPaused && !taskQueue.empty() &&
+			           tasksInProgress.size() < activeTasksLimit;
+			}))
+		{
+			return std::nullopt;
+		}
 
-		auto node = availableTasks.extract(availableTasks.begin());
-		auto task = node.value();
-		tasksInProgress.insert(std::move(node));
+		const auto taskId = taskQueue.begin()->second;
+		taskQueue.erase(taskQueue.begin());
+		auto node = availableTasks.extract(taskId);
+		auto task = node.mapped().task;
+		tasksInProgress.insert(task);
 		return task;
 	}
 
-	void CompilationSet::Add(const ShaderCompilationTask& task)
+	void CompilationSet::Add(const ShaderCompilationTask& task, uint64_t frameIndex)
 	{
 		std::unique_lock lock(mutex);
-		auto inProgressIt = tasksInProgress.find(task);
-		if (inProgressIt == tasksInProgress.end())
+		const auto taskId = task.GetId();
+		if (tasksInProgress.contains(task))
+		{
+			// Compilation in progress may have read the source before it was edited.
+			if (task.IsReload() && !deferredReloads.contains(taskId))
+			{
+				TaskPriority priority;
+				priority.lastRequestFrame = frameIndex;
+				priority.classRank = GetClassRank(task.GetShaderClass());
+				priority.requestCount = 1;
+				deferredReloads.emplace(taskId, QueuedTask{ task, priority });
+			}
+			return;
+		}
+
+		if (auto availableIt = availableTasks.find(taskId); availableIt != availableTasks.end())
 		{
-			auto [availableIt, wasAdded] = availableTasks.insert(task);
-			lock.unlock();
-			if (wasAdded)
+			auto priority = availableIt->second.priority;
+			taskQueue.erase({ priority, taskId });
+			priority.lastRequestFrame = std::max(priority.lastRequestFrame, frameIndex);
+			++priority.requestCount;
+			if (task.IsReload() && !availableIt->second.task.IsReload())
 			{
-				conditionVariable.notify_one();
+				// Queued task would only compile a shader that is not cached yet, the reload
+				// also replaces one that is.
+				availableTasks.erase(availableIt);
+				availableIt = availableTasks.emplace(taskId, QueuedTask{ task, priority }).first;
 			}
+			availableIt->second.priority = priority;
+			taskQueue.insert({ priority, taskId });
+			return;
 		}
+
+		TaskPriority priority;
+		priority.lastRequestFrame = frameIndex;
+		priority.classRank = GetClassRank(task.GetShaderClass());
+		priority.requestCount = 1;
+		priority.sequence = nextSequence++;
+		availableTasks.emplace(taskId, QueuedTask{ task, priority });
+		taskQueue.insert({ priority, taskId });
+		lock.unlock();
+
+		conditionVariable.notify_one();
 	}
 
 	void CompilationSet::Complete(const ShaderCompilationTask& task)
 	{
 		std::unique_lock lock(mutex);
 		tasksInProgress.erase(task);
+		if (auto node = deferredReloads.extract(task.GetId()); !node.empty())
+		{
+			auto& queuedTask = node.mapped();
+			queuedTask.priority.sequence = nextSequence++;
+			taskQueue.insert({ queuedTask.priority, node.key() });
+			availableTasks.insert(std::move(node));
+		}
+		lock.unlock();
+
+		conditionVariable.notify_one();
 	}
 
 	void CompilationSet::Clear()
 	{
 		std::lock_guard lock(mutex);
 		availableTasks.clear();
+		taskQueue.clear();
 		tasksInProgress.clear();
+		deferredReloads.clear();
+	}
+
+	bool CompilationSet::IsPaused() const
+	{
+		std::lock_guard lock(mutex);
+		return isPaused;
+	}
+
+	void CompilationSet::SetPaused(bool value)
+	{
+		{
+			std::lock_guard lock(mutex);
+			isPaused = value;
+		}
+		conditionVariable.notify_all();
+	}
+
+	size_t CompilationSet::GetActiveTasksLimit() const
+	{
+		std::lock_guard lock(mutex);
+		return activeTasksLimit;
+	}
+
+	void CompilationSet::SetActiveTasksLimit(size_t value)
+	{
+		{
+			std::lock_guard lock(mutex);
+			activeTasksLimit = value;
+		}
+		conditionVariable.notify_all();
 	}
 
 	bool ShaderCache::NeedsTessellationStages(const RE::BSShader& shader, int vertexDescriptor)
@@ -1,8 +1,17 @@
 #pragma once
 
+#include "Core/ConcurrentShaderMap.h"
+#include "Core/ShaderDiskCache.h"
+#include "Core/ShaderTrace.h"
+
 #include <RE/B/BSShader.h>
 
 #include <condition_variable>
+#include <deque>
+#include <intrin.h>
+#include <set>
+#include <shared_mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 struct ID3D11DomainShader;
@@ -21,6 +30,15 @@ namespace SIE
 		Total,
 	};
 
+	// How BSShader::BeginTechnique resolved the shaders of a draw.
+	enum class TechniquePath
+	{
+		Hit,
+		Miss,
+		Vanilla,
+		Total,
+	};
+
 	struct HullShader
 	{
 		constexpr static std::uint32_t MaxConstants = 4;
@@ -45,10 +63,20 @@ namespace SIE
 	{
 	public:
 		ShaderCompilationTask(ShaderClass shaderClass, const RE::BSShader& shader,
-			uint32_t descriptor);
+			uint32_t descriptor, bool isReload = false);
+		// Compiles vertex and pixel shaders of a technique back to back and publishes them
+		// together.
+		ShaderCompilationTask(const RE::BSShader& shader, uint32_t vertexDescriptor,
+			uint32_t pixelDescriptor);
 		void Perform() const;
 
 		size_t GetId() const;
+		static size_t GetId(ShaderClass shaderClass, RE::BSShader::Type shaderType,
+			uint32_t descriptor);
+		ShaderClass GetShaderClass() const;
+		RE::BSShader::Type GetShaderType() const;
+		bool IsTechnique() const;
+		bool IsReload() const;
 
 		bool operator==(const ShaderCompilationTask& other) const;
 
@@ -56,6 +84,8 @@ namespace SIE
 		ShaderClass shaderClass;
 		const RE::BSShader& shader;
 		uint32_t descriptor;
+		std::optional<uint32_t> pixelDescriptor;
+		bool isReload;
 	};
 }
 
@@ -73,16 +103,120 @@ namespace SIE
 	class CompilationSet
 	{
 	public:
-		ShaderCompilationTask WaitTake();
-		void Add(const ShaderCompilationTask& task);
+		std::optional<ShaderCompilationTask> WaitTake(std::stop_token stopToken);
+		void Add(const ShaderCompilationTask& task, uint64_t frameIndex);
 		void Complete(const ShaderCompilationTask& task);
 		void Clear();
 
+		bool IsPaused() const;
+		void SetPaused(bool value);
+		size_t GetActiveTasksLimit() const;
+		void SetActiveTasksLimit(size_t value);
+
+		template <typename Func>
+		void ForEachTask(Func&& func) const
+		{
+			std::lock_guard lock(mutex);
+			for (const auto& [id, queuedTask] : availableTasks)
+			{
+				func(queuedTask.task, false);
+			}
+			for (const auto& [id, queuedTask] : deferredReloads)
+			{
+				func(queuedTask.task, false);
+			}
+			for (const auto& task : tasksInProgress)
+			{
+				func(task, true);
+			}
+		}
+
 	private:
-		std::unordered_set<ShaderCompilationTask> availableTasks;
+		struct TaskPriority
+		{
+			uint64_t lastRequestFrame = 0;
+			uint32_t classRank = 0;
+			uint32_t requestCount = 0;
+			uint64_t sequence = 0;
+
+			bool operator<(const TaskPriority& other) const;
+		};
+
+		struct QueuedTask
+		{
+			ShaderCompilationTask task;
+			TaskPriority priority;
+		};
+
+		static uint32_t GetClassRank(ShaderClass shaderClass);
+
+		std::unordered_map<size_t, QueuedTask> availableTasks;
+		std::set<std::pair<TaskPriority, size_t>> taskQueue;
 		std::unordered_set<ShaderCompilationTask> tasksInProgress;
-		std::condition_variable conditionVariable;
-		std::mutex mutex;
+		// Reloads of shaders that were being compiled when requested, queued once they complete so
+		// that the edited source replaces the result.
+		std::unordered_map<size_t, QueuedTask> deferredReloads;
+		uint64_t nextSequence = 0;
+		bool isPaused = false;
+		size_t activeTasksLimit = std::numeric_limits<size_t>::max();
+		std::condition_variable_any conditionVariable;
+		mutable std::mutex mutex;
+	};
+
+	namespace SShaderCache
+	{
+		struct ShaderPermutation;
+	}
+
+	template <typename T>
+	struct SharedShader;
+
+	template <typename T>
+	using SharedShaderMap = std::unordered_map<uint64_t, std::shared_ptr<SharedShader<T>>>;
+
+	struct ShaderCompilationRecord
+	{
+		RE::BSShader::Type shaderType{};
+		ShaderClass shaderClass = ShaderClass::Vertex;
+		uint32_t descriptor = 0;
+		std::string defines;
+		std::chrono::microseconds duration{ 0 };
+		size_t byteCodeSize = 0;
+		bool isLoadedFromDisk = false;
+		bool isFailed = false;
+	};
+
+	struct ShaderStatistics
+	{
+		uint64_t queued = 0;
+		uint64_t inProgress = 0;
+		uint64_t compiled = 0;
+		uint64_t loadedFromDisk = 0;
+		uint64_t shared = 0;
+		uint64_t failed = 0;
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evicted = 0;
+		uint64_t byteCodeSize = 0;
+		std::chrono::microseconds compileTimeP50{ 0 };
+		std::chrono::microseconds compileTimeP95{ 0 };
+		std::chrono::microseconds compileTimeP99{ 0 };
+	};
+
+	struct TechniquePathStatistics
+	{
+		uint64_t count = 0;
+		std::chrono::nanoseconds totalTime{ 0 };
+	};
+
+	struct ShaderCacheStatistics
+	{
+		std::array<std::array<ShaderStatistics, static_cast<size_t>(RE::BSShader::Type::Total)>,
+			static_cast<size_t>(ShaderClass::Total)>
+			perType;
+		std::array<ShaderStatistics, static_cast<size_t>(ShaderClass::Total)> perClass;
+		std::array<TechniquePathStatistics, static_cast<size_t>(TechniquePath::Total)>
+			perTechniquePath;
 	};
 
 	class ShaderCache
@@ -102,6 +236,44 @@ namespace SIE
 		void SetEnabledForClass(ShaderClass shaderClass, bool value);
 		bool IsAsync() const;
 		void SetAsync(bool value);
+		bool IsDiskCacheEnabled() const;
+		void SetDiskCacheEnabled(bool value);
+
+		bool IsHotReloadEnabled() const;
+		void SetHotReloadEnabled(bool value);
+		bool IsTraceRecordingEnabled() const;
+		void SetTraceRecordingEnabled(bool value);
+
+		void ClearDiskCache();
+		void PrewarmFromTrace();
+		void ClearTrace();
+
+		size_t GetCompilationThreadCount() const;
+		void SetCompilationThreadCount(size_t value);
+		bool IsCompilationPaused() const;
+		void SetCompilationPaused(bool value);
+		bool IsThrottlingEnabled() const;
+		void SetThrottlingEnabled(bool value);
+		float GetThrottleFrameTime() const;
+		void SetThrottleFrameTime(float milliseconds);
+		size_t GetActiveCompilationLimit() const;
+		// Bytecode size above which least recently used shaders are evicted, 0 disables eviction.
+		size_t GetMemoryBudget() const;
+		void SetMemoryBudget(size_t value);
+
+		ShaderCacheStatistics GetStatistics() const;
+		// Most recent compilations, at most MaxCompilationRecords of them.
+		std::vector<ShaderCompilationRecord> GetCompilationRecords() const;
+		void ResetStatistics();
+
+		void OnFrame(std::chrono::microseconds frameTime);
+		uint64_t GetFrameIndex() const;
+
+		// Cheap enough to be taken on every draw, converted to time with a rate measured in
+		// OnFrame.
+		static uint64_t GetTimestamp() { return __rdtsc(); }
+		double GetTimestampsPerNanosecond() const;
+		void RecordTechnique(TechniquePath path, uint64_t startTimestamp);
 
 		void Clear();
 
@@ -110,42 +282,194 @@ namespace SIE
 			uint32_t descriptor);
 		HullShader* GetHullShader(const RE::BSShader& shader, uint32_t descriptor);
 		DomainShader* GetDomainShader(const RE::BSShader& shader, uint32_t descriptor);
+		// Returns both shaders of a technique or neither, a missing half is compiled together
+		// with the other one.
+		std::pair<RE::BSGraphics::VertexShader*, RE::BSGraphics::PixelShader*> GetTechnique(
+			const RE::BSShader& shader, uint32_t vertexDescriptor, uint32_t pixelDescriptor);
 
 		RE::BSGraphics::VertexShader* MakeAndAddVertexShader(const RE::BSShader& shader,
-			uint32_t descriptor);
+			uint32_t descriptor, bool replaceExisting = false);
 		RE::BSGraphics::PixelShader* MakeAndAddPixelShader(const RE::BSShader& shader,
-			uint32_t descriptor);
-		HullShader* MakeAndAddHullShader(const RE::BSShader& shader, uint32_t descriptor);
-		DomainShader* MakeAndAddDomainShader(const RE::BSShader& shader, uint32_t descriptor);
+			uint32_t descriptor, bool replaceExisting = false);
+		HullShader* MakeAndAddHullShader(const RE::BSShader& shader, uint32_t descriptor,
+			bool replaceExisting = false);
+		DomainShader* MakeAndAddDomainShader(const RE::BSShader& shader, uint32_t descriptor,
+			bool replaceExisting = false);
+		std::pair<RE::BSGraphics::VertexShader*, RE::BSGraphics::PixelShader*>
+			MakeAndAddTechnique(const RE::BSShader& shader, uint32_t vertexDescriptor,
+				uint32_t pixelDescriptor);
 
 	private:
 		ShaderCache();
-		void ProcessCompilationSet();
+		void ProcessCompilationSet(std::stop_token stopToken);
+		void ResizeCompilationThreads(size_t count);
+		void UpdateThrottle(std::chrono::microseconds frameTime);
+		void UpdateTimestampRate();
+		bool IsCancelled(uint64_t generation) const;
+		void RecordCompilation(ShaderCompilationRecord&& record);
+		void RecordAccess(ShaderClass shaderClass, const RE::BSShader& shader, bool isHit);
+		void RecordInsertion(ShaderClass shaderClass, const RE::BSShader& shader,
+			size_t byteCodeSize);
+		void RecordRemoval(ShaderClass shaderClass, size_t typeIndex, size_t byteCodeSize,
+			bool isEvicted);
+		void RecordDeduplication(ShaderClass shaderClass, const RE::BSShader& shader);
+		void RecordFailure(ShaderClass shaderClass, const RE::BSShader& shader);
+		void RecordTrace(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor);
+		void FlushTrace();
+		void EnqueueTraceRecords(const RE::BSShader& shader, uint32_t descriptor);
+		template <typename T>
+		T* FindShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor,
+			std::array<ConcurrentShaderMap<T>, static_cast<size_t>(RE::BSShader::Type::Total)>&
+				shaders);
+		std::unique_ptr<RE::BSGraphics::VertexShader> BuildVertexShader(const RE::BSShader& shader,
+			uint32_t descriptor, uint64_t generation,
+			std::shared_ptr<SharedShader<RE::BSGraphics::VertexShader>>& sharedShader);
+		std::unique_ptr<RE::BSGraphics::PixelShader> BuildPixelShader(const RE::BSShader& shader,
+			uint32_t descriptor, uint64_t generation,
+			std::shared_ptr<SharedShader<RE::BSGraphics::PixelShader>>& sharedShader);
+		std::optional<ShaderCacheEntry> LoadOrCompileShader(
+			const SShaderCache::ShaderPermutation& permutation, ShaderClass shaderClass,
+			const RE::BSShader& shader, uint32_t descriptor, size_t constantTableSize,
+			uint64_t generation);
+		template <typename T>
+		T* PublishShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor,
+			ConcurrentShaderMap<T>& shaders, std::unique_ptr<T>&& newShader,
+			SharedShader<T>& sharedShader, uint64_t generation, bool replaceExisting);
+		template <typename T>
+		void RetireShader(std::unique_ptr<T>&& shader);
+		void ReleaseRetiredShaders(bool releaseAll);
+		void EvictShaders();
+		template <typename T>
+		bool EvictShader(ShaderClass shaderClass, size_t typeIndex, uint32_t descriptor,
+			ConcurrentShaderMap<T>& shaders, SharedShaderMap<T>& sharedShaders);
+		template <typename T>
+		void ReleaseSharedShader(ShaderClass shaderClass, SharedShaderMap<T>& sharedShaders,
+			uint64_t sharedKey);
+		void RegisterReloadTarget(ShaderClass shaderClass, const RE::BSShader& shader,
+			uint32_t descriptor);
+		void ReloadShaders(const std::vector<std::filesystem::path>& changedPaths);
+		void WatchShaderSources(std::stop_token stopToken);
+		template <typename T, typename CreateFunc>
+		std::shared_ptr<SharedShader<T>> AcquireSharedShader(ShaderClass shaderClass,
+			const RE::BSShader& shader, uint32_t descriptor, size_t constantTableSize,
+			uint64_t generation, SharedShaderMap<T>& sharedShaders, CreateFunc&& createFunc);
 
 		~ShaderCache();
 
-		std::array<std::unordered_map<uint32_t, std::unique_ptr<RE::BSGraphics::VertexShader>>,
-			static_cast<size_t>(RE::BSShader::Type::Total)>
+		std::array<ConcurrentShaderMap<RE::BSGraphics::VertexShader>, static_cast<size_t>(RE::BSShader::Type::Total)>
 			vertexShaders;
-		std::array<std::unordered_map<uint32_t, std::unique_ptr<RE::BSGraphics::PixelShader>>,
-			static_cast<size_t>(RE::BSShader::Type::Total)>
+		std::array<ConcurrentShaderMap<RE::BSGraphics::PixelShader>, static_cast<size_t>(RE::BSShader::Type::Total)>
 			pixelShaders;
-		std::array<std::unordered_map<uint32_t, std::unique_ptr<HullShader>>,
-			static_cast<size_t>(RE::BSShader::Type::Total)>
+		std::array<ConcurrentShaderMap<HullShader>, static_cast<size_t>(RE::BSShader::Type::Total)>
 			hullShaders;
-		std::array<std::unordered_map<uint32_t, std::unique_ptr<DomainShader>>,
-			static_cast<size_t>(RE::BSShader::Type::Total)>
+		std::array<ConcurrentShaderMap<DomainShader>, static_cast<size_t>(RE::BSShader::Type::Total)>
 			domainShaders;
 
+		SharedShaderMap<RE::BSGraphics::VertexShader> sharedVertexShaders;
+		SharedShaderMap<RE::BSGraphics::PixelShader> sharedPixelShaders;
+		SharedShaderMap<HullShader> sharedHullShaders;
+		SharedShaderMap<DomainShader> sharedDomainShaders;
+		std::mutex sharedShadersMutex;
+
+		struct RetiredShader
+		{
+			uint64_t frameIndex = 0;
+			std::function<void()> release;
+		};
+		bool isHotReloadEnabled = true;
+		std::unordered_map<std::filesystem::path::string_type, std::vector<ShaderCompilationTask>>
+			reloadTargets;
+		std::mutex reloadTargetsMutex;
+		std::vector<RetiredShader> retiredShaders;
+		std::mutex retiredShadersMutex;
+
 		bool isEnabled = false;
 		uint32_t disabledClasses = 0;
 
 		bool isAsync = true;
+		bool isDiskCacheEnabled = true;
+		ShaderDiskCache diskCache;
+		ShaderSourceStore sourceStore;
+		ShaderSourceHasher sourceHasher;
+		bool isTraceRecordingEnabled = true;
+		ShaderTraceWriter traceWriter;
+		std::unordered_set<uint64_t> tracedShaders;
+		std::array<std::vector<ShaderTraceRecord>, static_cast<size_t>(RE::BSShader::Type::Total)>
+			pendingTraceRecords;
+		std::array<std::atomic<bool>, static_cast<size_t>(RE::BSShader::Type::Total)>
+			hasPendingTraceRecords{};
+		// Written by the source watcher thread so that the render thread never waits for the
+		// trace file.
+		std::vector<ShaderTraceRecord> unwrittenTraceRecords;
+		std::mutex traceMutex;
+		// Guards traceWriter, taken before traceMutex.
+		std::mutex traceWriterMutex;
+
 		CompilationSet compilationSet; 
+		std::atomic<uint64_t> frameIndex = 0;
+		std::atomic<size_t> memoryBudget = 128 << 20;
+		std::atomic<uint64_t> cachedByteCodeSize = 0;
+		// Frame and bytecode size above the budget until which EvictShaders skips scanning,
+		// frame is 0 if it does not.
+		uint64_t evictionRetryFrame = 0;
+		uint64_t evictionRetryExcess = 0;
+		std::atomic<uint64_t> compilationGeneration = 0;
+		std::shared_mutex clearMutex;
+
+		bool isThrottlingEnabled = true;
+		float throttleFrameTime = 1000.f / 60.f;
+		float averageFrameTime = 0.f;
+		uint32_t framesSinceThrottleUpdate = 0;
+		size_t activeCompilationLimit = 0;
+
+		struct ShaderCounters
+		{
+			std::atomic<uint64_t> compiled = 0;
+			std::atomic<uint64_t> loadedFromDisk = 0;
+			std::atomic<uint64_t> shared = 0;
+			std::atomic<uint64_t> failed = 0;
+			std::atomic<uint64_t> hits = 0;
+			std::atomic<uint64_t> misses = 0;
+			std::atomic<uint64_t> evicted = 0;
+			std::atomic<uint64_t> byteCodeSize = 0;
+		};
+		std::array<std::array<ShaderCounters, static_cast<size_t>(RE::BSShader::Type::Total)>,
+			static_cast<size_t>(ShaderClass::Total)>
+			counters;
+		// Compile times of the whole session, bucketed logarithmically so that percentiles are
+		// within an eighth of an octave.
+		struct CompileTimeHistogram
+		{
+			static constexpr size_t BucketsPerOctave = 8;
+			static constexpr size_t BucketCount = 32 * BucketsPerOctave;
+
+			std::array<uint64_t, BucketCount> counts{};
+			uint64_t totalCount = 0;
+
+			void Add(std::chrono::microseconds duration);
+			void Merge(const CompileTimeHistogram& other);
+			// Upper bound of the bucket holding the percentile, 0 if empty.
+			std::chrono::microseconds GetPercentile(uint32_t value) const;
+		};
+		std::array<std::array<CompileTimeHistogram, static_cast<size_t>(RE::BSShader::Type::Total)>,
+			static_cast<size_t>(ShaderClass::Total)>
+			compileTimeHistograms;
+
+		static constexpr size_t MaxCompilationRecords = 1024;
+		std::deque<ShaderCompilationRecord> compilationRecords;
+		mutable std::mutex compilationRecordsMutex;
+
+		struct TechniqueCounters
+		{
+			std::atomic<uint64_t> count = 0;
+			std::atomic<uint64_t> timestamps = 0;
+		};
+		std::array<TechniqueCounters, static_cast<size_t>(TechniquePath::Total)> techniqueCounters;
+		std::chrono::steady_clock::time_point rateMeasurementTime;
+		uint64_t rateMeasurementTimestamp = 0;
+		std::atomic<double> timestampsPerNanosecond = 0.;
+
 		std::vector<std::jthread> compilationThreads;
-		std::mutex vertexShadersMutex;
-		std::mutex pixelShadersMutex;
-		std::mutex hullShadersMutex;
-		std::mutex domainShadersMutex;
+		std::jthread sourceWatcherThread;
 	};
 }
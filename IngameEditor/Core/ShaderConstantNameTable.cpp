@@ -0,0 +1,225 @@
+#include "Core/ShaderConstantNameTable.h"
+
+#include "Core/ShaderDiskCache.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <map>
+
+namespace SIE
+{
+	namespace SShaderConstantNameTable
+	{
+		constexpr uint64_t SlotMultiplier = 0x9e3779b97f4a7c15ull;
+		constexpr uint32_t MaxSeedAttempts = 1 << 16;
+
+		struct ParsedName
+		{
+			std::string_view baseName;
+			bool isElement = false;
+			uint32_t arrayIndex = 0;
+		};
+
+		static ParsedName ParseName(std::string_view name)
+		{
+			const auto bracketPosition = name.rfind('[');
+			if (bracketPosition == std::string_view::npos || bracketPosition == 0 ||
+				name.back() != ']')
+			{
+				return { name };
+			}
+
+			const auto subscript = name.substr(bracketPosition + 1, name.size() - bracketPosition - 2);
+			uint32_t arrayIndex = 0;
+			const auto [end, error] =
+				std::from_chars(subscript.data(), subscript.data() + subscript.size(), arrayIndex);
+			if (subscript.empty() || error != std::errc() || end != subscript.data() + subscript.size())
+			{
+				return { name };
+			}
+			return { name.substr(0, bracketPosition), true, arrayIndex };
+		}
+	}
+
+	ShaderConstantNameTable::ShaderConstantNameTable(std::initializer_list<Name> names) :
+		ShaderConstantNameTable(std::span<const Name>(names.begin(), names.end()))
+	{}
+
+	ShaderConstantNameTable::ShaderConstantNameTable(std::span<const Name> names)
+	{
+		using namespace SShaderConstantNameTable;
+
+		struct Group
+		{
+			int32_t index = -1;
+			std::vector<Element> elements;
+		};
+
+		std::map<std::string_view, Group> groups;
+		size_t nameStorageSize = 0;
+		for (const auto& name : names)
+		{
+			const auto parsedName = ParseName(name.name);
+			auto [groupIt, isInserted] = groups.try_emplace(parsedName.baseName);
+			if (isInserted)
+			{
+				nameStorageSize += parsedName.baseName.size();
+			}
+			if (parsedName.isElement)
+			{
+				groupIt->second.elements.push_back({ parsedName.arrayIndex, name.index });
+			}
+			else
+			{
+				groupIt->second.index = name.index;
+			}
+		}
+
+		nameStorage.reserve(nameStorageSize);
+		entries.reserve(groups.size());
+		for (auto& [name, group] : groups)
+		{
+			std::sort(group.elements.begin(), group.elements.end(),
+				[](const Element& first, const Element& second) {
+					return first.arrayIndex < second.arrayIndex;
+				});
+
+			Entry entry;
+			entry.nameOffset = static_cast<uint32_t>(nameStorage.size());
+			entry.nameSize = static_cast<uint32_t>(name.size());
+			entry.index = group.index;
+			entry.elementsOffset = static_cast<uint32_t>(elements.size());
+			entry.elementsCount = static_cast<uint32_t>(group.elements.size());
+			nameStorage += name;
+			elements.insert(elements.end(), group.elements.begin(), group.elements.end());
+			entries.push_back(entry);
+		}
+
+		if (entries.empty())
+		{
+			return;
+		}
+
+		std::vector<uint64_t> hashes;
+		hashes.reserve(entries.size());
+		for (const auto& entry : entries)
+		{
+			hashes.push_back(HashString(GetName(entry)));
+		}
+
+		// Hash and displace: entries are split into buckets by hash, then buckets starting from
+		// the largest one search for a seed placing all their entries into free slots.
+		for (size_t slotCount = std::bit_ceil(2 * entries.size());; slotCount *= 2)
+		{
+			const size_t bucketCount = std::max<size_t>(1, slotCount / 4);
+			slotShift = 64 - static_cast<uint32_t>(std::countr_zero(slotCount));
+			bucketSeeds.assign(bucketCount, 0);
+			slots.assign(slotCount, -1);
+
+			std::vector<std::vector<int32_t>> buckets(bucketCount);
+			for (size_t entryIndex = 0; entryIndex < entries.size(); ++entryIndex)
+			{
+				buckets[hashes[entryIndex] & (bucketCount - 1)].push_back(
+					static_cast<int32_t>(entryIndex));
+			}
+			std::vector<size_t> bucketOrder(bucketCount);
+			for (size_t bucketIndex = 0; bucketIndex < bucketCount; ++bucketIndex)
+			{
+				bucketOrder[bucketIndex] = bucketIndex;
+			}
+			std::stable_sort(bucketOrder.begin(), bucketOrder.end(),
+				[&buckets](size_t first, size_t second) {
+					return buckets[first].size() > buckets[second].size();
+				});
+
+			bool isBuilt = true;
+			std::vector<uint32_t> bucketSlots;
+			for (const size_t bucketIndex : bucketOrder)
+			{
+				const auto& bucket = buckets[bucketIndex];
+				bool isPlaced = bucket.empty();
+				for (uint32_t seed = 0; !isPlaced && seed < MaxSeedAttempts; ++seed)
+				{
+					bucketSlots.clear();
+					isPlaced = std::all_of(bucket.begin(), bucket.end(), [&](int32_t entryIndex) {
+						const uint32_t slot = GetSlot(hashes[entryIndex] ^ seed);
+						if (slots[slot] != -1 ||
+							std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end())
+						{
+							return false;
+						}
+						bucketSlots.push_back(slot);
+						return true;
+					});
+					if (isPlaced)
+					{
+						bucketSeeds[bucketIndex] = seed;
+						for (size_t index = 0; index < bucket.size(); ++index)
+						{
+							slots[bucketSlots[index]] = bucket[index];
+						}
+					}
+				}
+				if (!isPlaced)
+				{
+					isBuilt = false;
+					break;
+				}
+			}
+			if (isBuilt)
+			{
+				break;
+			}
+		}
+	}
+
+	const ShaderConstantNameTable::Entry* ShaderConstantNameTable::Find(std::string_view name) const
+	{
+		if (slots.empty())
+		{
+			return nullptr;
+		}
+
+		const uint64_t hash = HashString(name);
+		const int32_t entryIndex = slots[GetSlot(hash ^ bucketSeeds[hash & (bucketSeeds.size() - 1)])];
+		if (entryIndex == -1 || GetName(entries[entryIndex]) != name)
+		{
+			return nullptr;
+		}
+		return &entries[entryIndex];
+	}
+
+	std::span<const ShaderConstantNameTable::Element> ShaderConstantNameTable::GetElements(
+		const Entry& entry) const
+	{
+		return std::span(elements).subspan(entry.elementsOffset, entry.elementsCount);
+	}
+
+	int32_t ShaderConstantNameTable::GetElementIndex(const Entry& entry, uint32_t arrayIndex) const
+	{
+		const auto entryElements = GetElements(entry);
+		const auto elementIt = std::lower_bound(entryElements.begin(), entryElements.end(), arrayIndex,
+			[](const Element& element, uint32_t value) { return element.arrayIndex < value; });
+		if (elementIt == entryElements.end() || elementIt->arrayIndex != arrayIndex)
+		{
+			return -1;
+		}
+		return elementIt->index;
+	}
+
+	size_t ShaderConstantNameTable::GetSize() const
+	{
+		return entries.size();
+	}
+
+	std::string_view ShaderConstantNameTable::GetName(const Entry& entry) const
+	{
+		return std::string_view(nameStorage).substr(entry.nameOffset, entry.nameSize);
+	}
+
+	uint32_t ShaderConstantNameTable::GetSlot(uint64_t hash) const
+	{
+		return static_cast<uint32_t>((hash * SShaderConstantNameTable::SlotMultiplier) >> slotShift);
+	}
+}
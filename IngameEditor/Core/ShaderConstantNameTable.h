@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SIE
+{
+	// Immutable name to constant index map with a perfect hash, built once per shader type and
+	// class. Array element names ("Name[3]") are grouped under their base name so reflection
+	// resolves a whole array with a single lookup.
+	class ShaderConstantNameTable
+	{
+	public:
+		struct Name
+		{
+			std::string_view name;
+			int32_t index = -1;
+		};
+
+		struct Element
+		{
+			uint32_t arrayIndex = 0;
+			int32_t index = -1;
+		};
+
+		struct Entry
+		{
+			uint32_t nameOffset = 0;
+			uint32_t nameSize = 0;
+			int32_t index = -1;
+			uint32_t elementsOffset = 0;
+			uint32_t elementsCount = 0;
+		};
+
+		ShaderConstantNameTable() = default;
+		ShaderConstantNameTable(std::initializer_list<Name> names);
+		explicit ShaderConstantNameTable(std::span<const Name> names);
+
+		const Entry* Find(std::string_view name) const;
+		std::span<const Element> GetElements(const Entry& entry) const;
+		int32_t GetElementIndex(const Entry& entry, uint32_t arrayIndex) const;
+		size_t GetSize() const;
+
+	private:
+		std::string_view GetName(const Entry& entry) const;
+		uint32_t GetSlot(uint64_t hash) const;
+
+		std::string nameStorage;
+		std::vector<Element> elements;
+		std::vector<Entry> entries;
+		std::vector<uint32_t> bucketSeeds;
+		std::vector<int32_t> slots;
+		uint32_t slotShift = 63;
+	};
+}
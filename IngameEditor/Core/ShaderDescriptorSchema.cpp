@@ -0,0 +1,293 @@
+#include "Core/ShaderDescriptorSchema.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace SIE
+{
+	namespace SShaderDescriptorSchema
+	{
+		struct EncodeState
+		{
+			uint32_t bits = 0;
+			uint32_t assignedMask = 0;
+
+			bool Assign(uint32_t mask, uint32_t value)
+			{
+				if (((bits ^ value) & mask & assignedMask) != 0)
+				{
+					return false;
+				}
+				bits = (bits & ~mask) | (value & mask);
+				assignedMask |= mask;
+				return true;
+			}
+		};
+
+		static bool IsSameDefine(const ShaderDefine& first, const ShaderDefine& second)
+		{
+			const auto firstDefinition =
+				first.definition != nullptr ? std::string_view(first.definition) : std::string_view();
+			const auto secondDefinition =
+				second.definition != nullptr ? std::string_view(second.definition) : std::string_view();
+			return std::string_view(first.name) == second.name &&
+			       (first.definition == nullptr) == (second.definition == nullptr) &&
+			       firstDefinition == secondDefinition;
+		}
+
+		static bool IsTechniqueValid(const ShaderDescriptorSchema& schema, uint32_t descriptor)
+		{
+			return schema.techniques.empty() ||
+			       std::find(schema.techniques.begin(), schema.techniques.end(),
+					   descriptor & schema.techniqueMask) != schema.techniques.end();
+		}
+
+		static bool DecodesTo(const ShaderDescriptorSchema& schema, uint32_t descriptor,
+			std::span<const ShaderDefine> defines)
+		{
+			std::array<ShaderDefine, 64> decoded;
+			const size_t count = DecodeDescriptor(schema, descriptor, decoded);
+			if (count != defines.size())
+			{
+				return false;
+			}
+			return std::all_of(defines.begin(), defines.end(), [&](const ShaderDefine& define) {
+				return std::any_of(decoded.begin(), decoded.begin() + count,
+					[&define](const ShaderDefine& other) { return IsSameDefine(define, other); });
+			});
+		}
+
+		// Unassigned bits are zero, which may still select rules emitting defines outside the set,
+		// so bits those rules require to be clear are set one at a time until the set matches.
+		static std::optional<uint32_t> Complete(const ShaderDescriptorSchema& schema,
+			std::span<const ShaderDefine> defines, const EncodeState& state)
+		{
+			if (IsTechniqueValid(schema, state.bits) && DecodesTo(schema, state.bits, defines))
+			{
+				return state.bits;
+			}
+
+			std::array<ShaderDefine, 64> decoded;
+			const size_t count = DecodeDescriptor(schema, state.bits, decoded);
+			const auto extraIt = std::find_if(decoded.begin(), decoded.begin() + count,
+				[&defines](const ShaderDefine& define) {
+					return std::none_of(defines.begin(), defines.end(),
+						[&define](const ShaderDefine& other) {
+							return std::string_view(other.name) == define.name;
+						});
+				});
+			if (extraIt != decoded.begin() + count)
+			{
+				for (const auto& rule : schema.rules)
+				{
+					if (std::string_view(rule.name) != extraIt->name || !rule.Matches(state.bits))
+					{
+						continue;
+					}
+					for (uint32_t freeBits = rule.mask & ~rule.value & ~state.assignedMask;
+						 freeBits != 0; freeBits &= freeBits - 1)
+					{
+						const uint32_t bit = freeBits & (~freeBits + 1);
+						EncodeState bitState = state;
+						bitState.Assign(bit, bit);
+						if (auto result = Complete(schema, defines, bitState))
+						{
+							return result;
+						}
+					}
+				}
+				return std::nullopt;
+			}
+
+			// Techniques without own defines are not selected by any rule.
+			for (const uint32_t technique : schema.techniques)
+			{
+				EncodeState techniqueState = state;
+				if (techniqueState.Assign(schema.techniqueMask, technique) &&
+					DecodesTo(schema, techniqueState.bits, defines))
+				{
+					return techniqueState.bits;
+				}
+			}
+			return std::nullopt;
+		}
+
+		// Depth first search over the rules able to produce each define, every candidate is
+		// completed and verified by decoding it.
+		static std::optional<uint32_t> Encode(const ShaderDescriptorSchema& schema,
+			std::span<const ShaderDefine> defines, size_t defineIndex, const EncodeState& state)
+		{
+			if (defineIndex == defines.size())
+			{
+				return Complete(schema, defines, state);
+			}
+
+			const auto& define = defines[defineIndex];
+			for (const auto& rule : schema.rules)
+			{
+				if (std::string_view(rule.name) != define.name)
+				{
+					continue;
+				}
+
+				EncodeState ruleState = state;
+				if (!ruleState.Assign(rule.mask, rule.value))
+				{
+					continue;
+				}
+
+				if (rule.fieldWidth != 0)
+				{
+					if (define.definition == nullptr)
+					{
+						continue;
+					}
+					const auto valueIt = std::find_if(DescriptorFieldValues.begin(),
+						DescriptorFieldValues.begin() + rule.fieldMax + 1,
+						[&define](const char* value) { return std::string_view(value) == define.definition; });
+					const auto fieldValue =
+						static_cast<uint32_t>(valueIt - DescriptorFieldValues.begin());
+					if (fieldValue > rule.fieldMax ||
+						!ruleState.Assign(rule.GetFieldMask(), fieldValue << rule.fieldShift))
+					{
+						continue;
+					}
+				}
+				else if ((rule.definition == nullptr) != (define.definition == nullptr) ||
+						 (rule.definition != nullptr &&
+							 std::string_view(rule.definition) != define.definition))
+				{
+					continue;
+				}
+
+				if (rule.anyMask == 0 || (ruleState.bits & rule.anyMask) != 0)
+				{
+					if (auto result = Encode(schema, defines, defineIndex + 1, ruleState))
+					{
+						return result;
+					}
+					continue;
+				}
+
+				for (uint32_t anyBits = rule.anyMask; anyBits != 0; anyBits &= anyBits - 1)
+				{
+					const uint32_t bit = anyBits & (~anyBits + 1);
+					EncodeState bitState = ruleState;
+					if (!bitState.Assign(bit, bit))
+					{
+						continue;
+					}
+					if (auto result = Encode(schema, defines, defineIndex + 1, bitState))
+					{
+						return result;
+					}
+				}
+			}
+			return std::nullopt;
+		}
+
+		// Expected defines are written as NAME or NAME=VALUE in decoding order.
+		template <size_t Size>
+		constexpr bool HasDefines(const ShaderDescriptorSchema& schema, uint32_t descriptor,
+			const std::array<std::string_view, Size>& expected)
+		{
+			std::array<ShaderDefine, 64> defines;
+			if (DecodeDescriptor(schema, descriptor, defines) != Size)
+			{
+				return false;
+			}
+			for (size_t index = 0; index < Size; ++index)
+			{
+				const auto separator = expected[index].find('=');
+				const auto name = expected[index].substr(0, separator);
+				if (name != defines[index].name)
+				{
+					return false;
+				}
+				if (separator == std::string_view::npos ?
+						defines[index].definition != nullptr :
+						defines[index].definition == nullptr ||
+							expected[index].substr(separator + 1) != defines[index].definition)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static_assert(HasDefines<2>(SkyShaderSchema, Bits(SunGlare), { "TEX", "DITHER" }));
+		static_assert(HasDefines<4>(GrassShaderSchema, 0x10007,
+			{ "VERTLIT", "SLOPE", "BILLBOARD", "DO_ALPHA_TEST" }));
+		static_assert(HasDefines<5>(WaterShaderSchema, (3 << WaterTechniqueShift) | 1,
+			{ "WATER", "FOG", "VC", "SPECULAR", "NUM_SPECULAR_LIGHTS=3" }));
+		static_assert(HasDefines<3>(WaterShaderSchema, 11 << WaterTechniqueShift,
+			{ "WATER", "FOG", "SIMPLE" }));
+		static_assert(HasDefines<3>(LightingShaderSchema, Bits(MTLandLODBlend) << LightingTechniqueShift,
+			{ "MULTI_TEXTURE", "LANDSCAPE", "LOD_LAND_BLEND" }));
+		static_assert(HasDefines<3>(UtilityShaderSchema, (1 << 21) | (6 << 17),
+			{ "RENDER_SHADOWMASK", "SHADOWFILTER=4", "SHADOWSPLITCOUNT=3" }));
+		static_assert(HasDefines<3>(UtilityShaderSchema, 1 << 14,
+			{ "RENDER_SHADOWMAP", "SHADOWSPLITCOUNT=3", "NO_PIXEL_SHADER" }));
+	}
+
+	bool IsValidDescriptor(const ShaderDescriptorSchema& schema, uint32_t descriptor)
+	{
+		return (descriptor & ~GetUsedBits(schema)) == 0 &&
+		       SShaderDescriptorSchema::IsTechniqueValid(schema, descriptor);
+	}
+
+	size_t CanonicalizeDefines(std::span<ShaderDefine> defines)
+	{
+		std::stable_sort(defines.begin(), defines.end(),
+			[](const ShaderDefine& first, const ShaderDefine& second) {
+				return std::strcmp(first.name, second.name) < 0;
+			});
+		const auto uniqueEnd = std::unique(defines.begin(), defines.end(),
+			[](const ShaderDefine& first, const ShaderDefine& second) {
+				return std::strcmp(first.name, second.name) == 0;
+			});
+		return static_cast<size_t>(uniqueEnd - defines.begin());
+	}
+
+	std::string MergeDefinesString(std::span<const ShaderDefine> defines)
+	{
+		std::string result;
+		for (const auto& define : defines)
+		{
+			if (define.name == nullptr)
+			{
+				break;
+			}
+			result += define.name;
+			if (define.definition != nullptr)
+			{
+				result += '=';
+				result += define.definition;
+			}
+			result += ' ';
+		}
+		return result;
+	}
+
+	std::optional<uint32_t> EncodeDescriptor(const ShaderDescriptorSchema& schema,
+		std::span<const ShaderDefine> defines)
+	{
+		std::vector<ShaderDefine> uniqueDefines;
+		for (const auto& define : defines)
+		{
+			if (define.name == nullptr)
+			{
+				break;
+			}
+			if (std::none_of(uniqueDefines.cbegin(), uniqueDefines.cend(),
+					[&define](const ShaderDefine& other) {
+						return std::string_view(other.name) == define.name;
+					}))
+			{
+				uniqueDefines.push_back(define);
+			}
+		}
+		return SShaderDescriptorSchema::Encode(schema, uniqueDefines, 0, {});
+	}
+}
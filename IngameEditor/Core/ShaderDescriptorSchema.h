@@ -0,0 +1,693 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace SIE
+{
+	// Layout compatible with D3D_SHADER_MACRO, decoded arrays are passed to the compiler as is.
+	struct ShaderDefine
+	{
+		const char* name = nullptr;
+		const char* definition = nullptr;
+	};
+
+	inline constexpr std::array<const char*, 16> DescriptorFieldValues = { { "0", "1", "2", "3",
+		"4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15" } };
+
+	// Emits a define when (descriptor & mask) == value and, if anyMask is not zero, at least one
+	// of its bits is set. Definition is either fixed or read from a descriptor bit field clamped
+	// to fieldMax.
+	struct DescriptorRule
+	{
+		uint32_t mask = 0;
+		uint32_t value = 0;
+		uint32_t anyMask = 0;
+		const char* name = nullptr;
+		const char* definition = nullptr;
+		uint8_t fieldShift = 0;
+		uint8_t fieldWidth = 0;
+		uint8_t fieldMax = 0;
+
+		static constexpr DescriptorRule Always(const char* name,
+			const char* definition = nullptr)
+		{
+			return { .name = name, .definition = definition };
+		}
+
+		static constexpr DescriptorRule Masked(uint32_t mask, uint32_t value, const char* name,
+			const char* definition = nullptr)
+		{
+			return { .mask = mask, .value = value, .name = name, .definition = definition };
+		}
+
+		static constexpr DescriptorRule Equal(uint32_t value, const char* name,
+			const char* definition = nullptr)
+		{
+			return Masked(0xFFFFFFFF, value, name, definition);
+		}
+
+		template <typename Enum>
+		static constexpr DescriptorRule Flag(Enum flag, const char* name)
+		{
+			const auto mask = static_cast<uint32_t>(flag);
+			return Masked(mask, mask, name);
+		}
+
+		constexpr uint32_t GetFieldMask() const
+		{
+			return ((1u << fieldWidth) - 1) << fieldShift;
+		}
+
+		constexpr bool Matches(uint32_t descriptor) const
+		{
+			return (descriptor & mask) == value && (anyMask == 0 || (descriptor & anyMask) != 0);
+		}
+
+		constexpr const char* GetDefinition(uint32_t descriptor) const
+		{
+			if (fieldWidth == 0)
+			{
+				return definition;
+			}
+			const uint32_t fieldValue = (descriptor & GetFieldMask()) >> fieldShift;
+			return DescriptorFieldValues[fieldValue < fieldMax ? fieldValue : fieldMax];
+		}
+	};
+
+	template <size_t Capacity>
+	struct DescriptorRuleTable
+	{
+		std::array<DescriptorRule, Capacity> rules{};
+		size_t size = 0;
+
+		constexpr void Add(const DescriptorRule& rule) { rules[size++] = rule; }
+		constexpr std::span<const DescriptorRule> GetRules() const { return { rules.data(), size }; }
+	};
+
+	struct ShaderDescriptorSchema
+	{
+		std::span<const DescriptorRule> rules;
+		// Descriptors are only valid if their technique bits hold one of the listed values, an
+		// empty list accepts any technique.
+		uint32_t techniqueMask = 0;
+		std::span<const uint32_t> techniques;
+	};
+
+	// Writes defines of the descriptor to output, skipping repeated names, and returns their count.
+	constexpr size_t DecodeDescriptor(const ShaderDescriptorSchema& schema, uint32_t descriptor,
+		std::span<ShaderDefine> output)
+	{
+		size_t count = 0;
+		for (const auto& rule : schema.rules)
+		{
+			if (count == output.size())
+			{
+				break;
+			}
+			if (!rule.Matches(descriptor))
+			{
+				continue;
+			}
+			bool isRepeated = false;
+			for (size_t index = 0; index < count && !isRepeated; ++index)
+			{
+				isRepeated = std::string_view(output[index].name) == rule.name;
+			}
+			if (!isRepeated)
+			{
+				output[count++] = { rule.name, rule.GetDefinition(descriptor) };
+			}
+		}
+		return count;
+	}
+
+	constexpr uint32_t GetUsedBits(const ShaderDescriptorSchema& schema)
+	{
+		uint32_t result = schema.techniqueMask;
+		for (const auto& rule : schema.rules)
+		{
+			result |= rule.mask | rule.anyMask | rule.GetFieldMask();
+		}
+		return result;
+	}
+
+	bool IsValidDescriptor(const ShaderDescriptorSchema& schema, uint32_t descriptor);
+
+	// Sorts defines by name and drops repeated names, returns the number of defines kept.
+	size_t CanonicalizeDefines(std::span<ShaderDefine> defines);
+	std::string MergeDefinesString(std::span<const ShaderDefine> defines);
+
+	// Finds a descriptor decoding to exactly the given set of defines. Many descriptors may share
+	// one set, bits not required by any define are left zero.
+	std::optional<uint32_t> EncodeDescriptor(const ShaderDescriptorSchema& schema,
+		std::span<const ShaderDefine> defines);
+
+	enum class LightingShaderTechniques
+	{
+		None = 0,
+		Envmap = 1,
+		Glowmap = 2,
+		Parallax = 3,
+		Facegen = 4,
+		FacegenRGBTint = 5,
+		Hair = 6,
+		ParallaxOcc = 7,
+		MTLand = 8,
+		LODLand = 9,
+		Snow = 10,  // unused
+		MultilayerParallax = 11,
+		TreeAnim = 12,
+		LODObjects = 13,
+		MultiIndexSparkle = 14,
+		LODObjectHD = 15,
+		Eye = 16,
+		Cloud = 17,  // unused
+		LODLandNoise = 18,
+		MTLandLODBlend = 19,
+		Outline = 20,
+	};
+
+	enum class LightingShaderFlags : uint32_t
+	{
+		VC = 1 << 0,
+		Skinned = 1 << 1,
+		ModelSpaceNormals = 1 << 2,
+		// flags 3 to 8 are unused
+		Specular = 1 << 9,
+		SoftLighting = 1 << 10,
+		RimLighting = 1 << 11,
+		BackLighting = 1 << 12,
+		ShadowDir = 1 << 13,
+		DefShadow = 1 << 14,
+		ProjectedUV = 1 << 15,
+		AnisoLighting = 1 << 16,
+		AmbientSpecular = 1 << 17,
+		WorldMap = 1 << 18,
+		BaseObjectIsSnow = 1 << 19,
+		DoAlphaTest = 1 << 20,
+		Snow = 1 << 21,
+		CharacterLight = 1 << 22,
+		AdditionalAlphaMask = 1 << 23,
+	};
+
+	enum class BloodSplatterShaderTechniques
+	{
+		Splatter = 0,
+		Flare = 1,
+	};
+
+	enum class DistantTreeShaderTechniques
+	{
+		DistantTreeBlock = 0,
+		Depth = 1,
+	};
+
+	enum class DistantTreeShaderFlags : uint32_t
+	{
+		AlphaTest = 0x10000,
+	};
+
+	enum class SkyShaderTechniques
+	{
+		SunOcclude = 0,
+		SunGlare = 1,
+		MoonAndStarsMask = 2,
+		Stars = 3,
+		Clouds = 4,
+		CloudsLerp = 5,
+		CloudsFade = 6,
+		Texture = 7,
+		Sky = 8,
+	};
+
+	enum class GrassShaderTechniques
+	{
+		VertLit = 0,
+		FlatLit = 1,
+		FlatLitSlope = 2,
+		VertLitSlope = 3,
+		VertLitBillboard = 4,
+		FlatLitBillboard = 5,
+		FlatLitSlopeBillboard = 6,
+		VertLitSlopeBillboard = 7,
+		RenderDepth = 8,
+	};
+
+	enum class GrassShaderFlags : uint32_t
+	{
+		AlphaTest = 0x10000,
+	};
+
+	enum class ParticleShaderTechniques
+	{
+		Particles = 0,
+		ParticlesGryColor = 1,
+		ParticlesGryAlpha = 2,
+		ParticlesGryColorAlpha = 3,
+		EnvCubeSnow = 4,
+		EnvCubeRain = 5,
+	};
+
+	enum class EffectShaderFlags : uint32_t
+	{
+		Vc = 1 << 0,
+		TexCoord = 1 << 1,
+		TexCoordIndex = 1 << 2,
+		Skinned = 1 << 3,
+		Normals = 1 << 4,
+		BinormalTangent = 1 << 5,
+		Texture = 1 << 6,
+		IndexedTexture = 1 << 7,
+		Falloff = 1 << 8,
+		AddBlend = 1 << 10,
+		MultBlend = 1 << 11,
+		Particles = 1 << 12,
+		StripParticles = 1 << 13,
+		Blood = 1 << 14,
+		Membrane = 1 << 15,
+		Lighting = 1 << 16,
+		ProjectedUv = 1 << 17,
+		Soft = 1 << 18,
+		GrayscaleToColor = 1 << 19,
+		GrayscaleToAlpha = 1 << 20,
+		IgnoreTexAlpha = 1 << 21,
+		MultBlendDecal = 1 << 22,
+		AlphaTest = 1 << 23,
+		SkyObject = 1 << 24,
+		MsnSpuSkinned = 1 << 25,
+		MotionVectorsNormals = 1 << 26,
+	};
+
+	enum class WaterShaderTechniques
+	{
+		Underwater = 8,
+		Lod = 9,
+		Stencil = 10,
+		Simple = 11,
+	};
+
+	enum class WaterShaderFlags : uint32_t
+	{
+		Vc = 1 << 0,
+		NormalTexCoord = 1 << 1,
+		Reflections = 1 << 2,
+		Refractions = 1 << 3,
+		Depth = 1 << 4,
+		Interior = 1 << 5,
+		Wading = 1 << 6,
+		VertexAlphaDepth = 1 << 7,
+		Cubemap = 1 << 8,
+		Flowmap = 1 << 9,
+		BlendNormals = 1 << 10,
+	};
+
+	enum class UtilityShaderFlags : uint32_t
+	{
+		Vc = 1 << 0,
+		Texture = 1 << 1,
+		Skinned = 1 << 2,
+		Normals = 1 << 3,
+		BinormalTangent = 1 << 4,
+		AlphaTest = 1 << 7,
+		LodLandscape = 1 << 8,
+		RenderNormal = 1 << 9,
+		RenderNormalFalloff = 1 << 10,
+		RenderNormalClamp = 1 << 11,
+		RenderNormalClear = 1 << 12,
+		RenderDepth = 1 << 13,
+		RenderShadowmap = 1 << 14,
+		RenderShadowmapClamped = 1 << 15,
+		GrayscaleToAlpha = 1 << 15,
+		RenderShadowmapPb = 1 << 16,
+		AdditionalAlphaMask = 1 << 16,
+		DepthWriteDecals = 1 << 17,
+		DebugShadowSplit = 1 << 18,
+		DebugColor = 1 << 19,
+		GrayscaleMask = 1 << 20,
+		RenderShadowmask = 1 << 21,
+		RenderShadowmaskSpot = 1 << 22,
+		RenderShadowmaskPb = 1 << 23,
+		RenderShadowmaskDpb = 1 << 24,
+		RenderBaseTexture = 1 << 25,
+		TreeAnim = 1 << 26,
+		LodObject = 1 << 27,
+		LocalMapFogOfWar = 1 << 28,
+		OpaqueEffect = 1 << 29,
+	};
+
+	namespace SShaderDescriptorSchema
+	{
+		template <typename Enum>
+		constexpr uint32_t Bits(Enum value)
+		{
+			return static_cast<uint32_t>(value);
+		}
+
+		template <typename Enum, typename... Enums>
+		constexpr uint32_t Bits(Enum value, Enums... values)
+		{
+			return static_cast<uint32_t>(value) | Bits(values...);
+		}
+
+		constexpr uint32_t LightingTechniqueShift = 24;
+		constexpr uint32_t LightingTechniqueMask = 0x3F << LightingTechniqueShift;
+
+		constexpr DescriptorRule LightingTechnique(LightingShaderTechniques technique,
+			const char* name)
+		{
+			return DescriptorRule::Masked(LightingTechniqueMask,
+				static_cast<uint32_t>(technique) << LightingTechniqueShift, name);
+		}
+
+		constexpr uint32_t GrassTechniqueMask = 0b1111;
+
+		constexpr DescriptorRule GrassTechnique(GrassShaderTechniques technique, const char* name)
+		{
+			return DescriptorRule::Masked(GrassTechniqueMask, static_cast<uint32_t>(technique),
+				name);
+		}
+
+		constexpr uint32_t WaterTechniqueShift = 11;
+		constexpr uint32_t WaterTechniqueMask = 0xF << WaterTechniqueShift;
+
+		constexpr DescriptorRule WaterTechnique(WaterShaderTechniques technique, const char* name)
+		{
+			return DescriptorRule::Masked(WaterTechniqueMask,
+				static_cast<uint32_t>(technique) << WaterTechniqueShift, name);
+		}
+
+		using enum LightingShaderTechniques;
+		using enum SkyShaderTechniques;
+		using enum ParticleShaderTechniques;
+
+		inline constexpr std::array LightingRules = {
+			LightingTechnique(Envmap, "ENVMAP"),
+			LightingTechnique(Glowmap, "GLOWMAP"),
+			LightingTechnique(Parallax, "PARALLAX"),
+			LightingTechnique(Facegen, "FACEGEN"),
+			LightingTechnique(FacegenRGBTint, "FACEGEN_RGB_TINT"),
+			LightingTechnique(Hair, "HAIR"),
+			LightingTechnique(ParallaxOcc, "PARALLAX_OCC"),
+			LightingTechnique(MTLand, "MULTI_TEXTURE"),
+			LightingTechnique(MTLand, "LANDSCAPE"),
+			LightingTechnique(LODLand, "LODLANDSCAPE"),
+			LightingTechnique(MultilayerParallax, "MULTI_LAYER_PARALLAX"),
+			LightingTechnique(TreeAnim, "TREE_ANIM"),
+			LightingTechnique(LODObjects, "LODOBJECTS"),
+			LightingTechnique(MultiIndexSparkle, "MULTI_INDEX"),
+			LightingTechnique(MultiIndexSparkle, "SPARKLE"),
+			LightingTechnique(LODObjectHD, "LODOBJECTSHD"),
+			LightingTechnique(Eye, "EYE"),
+			LightingTechnique(LODLandNoise, "LODLANDSCAPE"),
+			LightingTechnique(LODLandNoise, "LODLANDNOISE"),
+			LightingTechnique(MTLandLODBlend, "MULTI_TEXTURE"),
+			LightingTechnique(MTLandLODBlend, "LANDSCAPE"),
+			LightingTechnique(MTLandLODBlend, "LOD_LAND_BLEND"),
+			LightingTechnique(Outline, "OUTLINE"),
+			DescriptorRule::Flag(LightingShaderFlags::VC, "VC"),
+			DescriptorRule::Flag(LightingShaderFlags::Skinned, "SKINNED"),
+			DescriptorRule::Flag(LightingShaderFlags::ModelSpaceNormals, "MODELSPACENORMALS"),
+			DescriptorRule::Flag(LightingShaderFlags::Specular, "SPECULAR"),
+			DescriptorRule::Flag(LightingShaderFlags::SoftLighting, "SOFT_LIGHTING"),
+			DescriptorRule::Flag(LightingShaderFlags::RimLighting, "RIM_LIGHTING"),
+			DescriptorRule::Flag(LightingShaderFlags::BackLighting, "BACK_LIGHTING"),
+			DescriptorRule::Flag(LightingShaderFlags::ShadowDir, "SHADOW_DIR"),
+			DescriptorRule::Flag(LightingShaderFlags::DefShadow, "DEFSHADOW"),
+			DescriptorRule::Flag(LightingShaderFlags::ProjectedUV, "PROJECTED_UV"),
+			DescriptorRule::Flag(LightingShaderFlags::AnisoLighting, "ANISO_LIGHTING"),
+			DescriptorRule::Flag(LightingShaderFlags::AmbientSpecular, "AMBIENT_SPECULAR"),
+			DescriptorRule::Flag(LightingShaderFlags::WorldMap, "WORLD_MAP"),
+			DescriptorRule::Flag(LightingShaderFlags::BaseObjectIsSnow, "BASE_OBJECT_IS_SNOW"),
+			DescriptorRule::Flag(LightingShaderFlags::DoAlphaTest, "DO_ALPHA_TEST"),
+			DescriptorRule::Flag(LightingShaderFlags::Snow, "SNOW"),
+			DescriptorRule::Flag(LightingShaderFlags::CharacterLight, "CHARACTER_LIGHT"),
+			DescriptorRule::Flag(LightingShaderFlags::AdditionalAlphaMask, "ADDITIONAL_ALPHA_MASK"),
+		};
+
+		inline constexpr std::array<uint32_t, 19> LightingTechniques = { { 0 << 24, 1 << 24,
+			2 << 24, 3 << 24, 4 << 24, 5 << 24, 6 << 24, 7 << 24, 8 << 24, 9 << 24, 11 << 24,
+			12 << 24, 13 << 24, 14 << 24, 15 << 24, 16 << 24, 18 << 24, 19 << 24, 20 << 24 } };
+
+		inline constexpr std::array BloodSplatterRules = {
+			DescriptorRule::Equal(static_cast<uint32_t>(BloodSplatterShaderTechniques::Splatter),
+				"SPLATTER"),
+			DescriptorRule::Equal(static_cast<uint32_t>(BloodSplatterShaderTechniques::Flare),
+				"FLARE"),
+		};
+
+		inline constexpr std::array<uint32_t, 2> BloodSplatterTechniques = { { 0, 1 } };
+
+		inline constexpr std::array DistantTreeRules = {
+			DescriptorRule::Masked(1, static_cast<uint32_t>(DistantTreeShaderTechniques::Depth),
+				"RENDER_DEPTH"),
+			DescriptorRule::Flag(DistantTreeShaderFlags::AlphaTest, "DO_ALPHA_TEST"),
+		};
+
+		inline constexpr std::array SkyRules = {
+			DescriptorRule::Equal(Bits(SunOcclude), "OCCLUSION"),
+			DescriptorRule::Equal(Bits(SunGlare), "TEX"),
+			DescriptorRule::Equal(Bits(SunGlare), "DITHER"),
+			DescriptorRule::Equal(Bits(MoonAndStarsMask), "TEX"),
+			DescriptorRule::Equal(Bits(MoonAndStarsMask), "MOONMASK"),
+			DescriptorRule::Equal(Bits(Stars), "HORIZFADE"),
+			DescriptorRule::Equal(Bits(Clouds), "TEX"),
+			DescriptorRule::Equal(Bits(Clouds), "CLOUDS"),
+			DescriptorRule::Equal(Bits(CloudsLerp), "TEX"),
+			DescriptorRule::Equal(Bits(CloudsLerp), "CLOUDS"),
+			DescriptorRule::Equal(Bits(CloudsLerp), "TEXLERP"),
+			DescriptorRule::Equal(Bits(CloudsFade), "TEX"),
+			DescriptorRule::Equal(Bits(CloudsFade), "CLOUDS"),
+			DescriptorRule::Equal(Bits(CloudsFade), "TEXFADE"),
+			DescriptorRule::Equal(Bits(Texture), "TEX"),
+			DescriptorRule::Equal(Bits(Sky), "DITHER"),
+		};
+
+		inline constexpr std::array<uint32_t, 9> SkyTechniques = { { 0, 1, 2, 3, 4, 5, 6, 7,
+			8 } };
+
+		inline constexpr std::array GrassRules = {
+			GrassTechnique(GrassShaderTechniques::VertLit, "VERTLIT"),
+			GrassTechnique(GrassShaderTechniques::FlatLitSlope, "SLOPE"),
+			GrassTechnique(GrassShaderTechniques::VertLitSlope, "VERTLIT"),
+			GrassTechnique(GrassShaderTechniques::VertLitBillboard, "VERTLIT"),
+			GrassTechnique(GrassShaderTechniques::VertLitBillboard, "BILLBOARD"),
+			GrassTechnique(GrassShaderTechniques::FlatLitBillboard, "BILLBOARD"),
+			GrassTechnique(GrassShaderTechniques::FlatLitSlopeBillboard, "SLOPE"),
+			GrassTechnique(GrassShaderTechniques::FlatLitSlopeBillboard, "BILLBOARD"),
+			GrassTechnique(GrassShaderTechniques::VertLitSlopeBillboard, "VERTLIT"),
+			GrassTechnique(GrassShaderTechniques::VertLitSlopeBillboard, "SLOPE"),
+			GrassTechnique(GrassShaderTechniques::VertLitSlopeBillboard, "BILLBOARD"),
+			GrassTechnique(GrassShaderTechniques::RenderDepth, "RENDER_DEPTH"),
+			DescriptorRule::Flag(GrassShaderFlags::AlphaTest, "DO_ALPHA_TEST"),
+		};
+
+		inline constexpr std::array<uint32_t, 9> GrassTechniques = { { 0, 1, 2, 3, 4, 5, 6, 7,
+			8 } };
+
+		inline constexpr std::array ParticleRules = {
+			DescriptorRule::Equal(Bits(ParticlesGryColor), "GRAYSCALE_TO_COLOR"),
+			DescriptorRule::Equal(Bits(ParticlesGryAlpha), "GRAYSCALE_TO_ALPHA"),
+			DescriptorRule::Equal(Bits(ParticlesGryColorAlpha), "GRAYSCALE_TO_COLOR"),
+			DescriptorRule::Equal(Bits(ParticlesGryColorAlpha), "GRAYSCALE_TO_ALPHA"),
+			DescriptorRule::Equal(Bits(EnvCubeSnow), "ENVCUBE"),
+			DescriptorRule::Equal(Bits(EnvCubeSnow), "SNOW"),
+			DescriptorRule::Equal(Bits(EnvCubeRain), "ENVCUBE"),
+			DescriptorRule::Equal(Bits(EnvCubeRain), "RAIN"),
+		};
+
+		inline constexpr std::array<uint32_t, 6> ParticleTechniques = { { 0, 1, 2, 3, 4, 5 } };
+
+		inline constexpr std::array EffectRules = {
+			DescriptorRule::Flag(EffectShaderFlags::Vc, "VC"),
+			DescriptorRule::Flag(EffectShaderFlags::TexCoord, "TEXCOORD"),
+			DescriptorRule::Flag(EffectShaderFlags::TexCoordIndex, "TEXCOORD_INDEX"),
+			DescriptorRule::Flag(EffectShaderFlags::Skinned, "SKINNED"),
+			DescriptorRule::Flag(EffectShaderFlags::Normals, "NORMALS"),
+			DescriptorRule::Flag(EffectShaderFlags::BinormalTangent, "BINORMAL_TANGENT"),
+			DescriptorRule::Flag(EffectShaderFlags::Texture, "TEXTURE"),
+			DescriptorRule::Flag(EffectShaderFlags::IndexedTexture, "INDEXED_TEXTURE"),
+			DescriptorRule::Flag(EffectShaderFlags::Falloff, "FALLOFF"),
+			DescriptorRule::Flag(EffectShaderFlags::AddBlend, "ADDBLEND"),
+			DescriptorRule::Flag(EffectShaderFlags::MultBlend, "MULTBLEND"),
+			DescriptorRule::Flag(EffectShaderFlags::Particles, "PARTICLES"),
+			DescriptorRule::Flag(EffectShaderFlags::StripParticles, "STRIP_PARTICLES"),
+			DescriptorRule::Flag(EffectShaderFlags::Blood, "BLOOD"),
+			DescriptorRule::Flag(EffectShaderFlags::Membrane, "MEMBRANE"),
+			DescriptorRule::Flag(EffectShaderFlags::Lighting, "LIGHTING"),
+			DescriptorRule::Flag(EffectShaderFlags::ProjectedUv, "PROJECTED_UV"),
+			DescriptorRule::Flag(EffectShaderFlags::Soft, "SOFT"),
+			DescriptorRule::Flag(EffectShaderFlags::GrayscaleToColor, "GRAYSCALE_TO_COLOR"),
+			DescriptorRule::Flag(EffectShaderFlags::GrayscaleToAlpha, "GRAYSCALE_TO_ALPHA"),
+			DescriptorRule::Flag(EffectShaderFlags::IgnoreTexAlpha, "IGNORE_TEX_ALPHA"),
+			DescriptorRule::Flag(EffectShaderFlags::MultBlendDecal, "MULTBLEND_DECAL"),
+			DescriptorRule::Flag(EffectShaderFlags::AlphaTest, "ALPHA_TEST"),
+			DescriptorRule::Flag(EffectShaderFlags::SkyObject, "SKY_OBJECT"),
+			DescriptorRule::Flag(EffectShaderFlags::MsnSpuSkinned, "MSN_SPU_SKINNED"),
+			DescriptorRule::Flag(EffectShaderFlags::MotionVectorsNormals, "MOTIONVECTORS_NORMALS"),
+		};
+
+		// Techniques 0 to 7 render specular water with the technique index as light count.
+		constexpr uint32_t WaterSpecularMask = 0x8 << WaterTechniqueShift;
+
+		inline constexpr std::array WaterRules = {
+			DescriptorRule::Always("WATER"),
+			DescriptorRule::Always("FOG"),
+			DescriptorRule::Flag(WaterShaderFlags::Vc, "VC"),
+			DescriptorRule::Flag(WaterShaderFlags::NormalTexCoord, "NORMAL_TEXCOORD"),
+			DescriptorRule::Flag(WaterShaderFlags::Reflections, "REFLECTIONS"),
+			DescriptorRule::Flag(WaterShaderFlags::Refractions, "REFRACTIONS"),
+			DescriptorRule::Flag(WaterShaderFlags::Depth, "DEPTH"),
+			DescriptorRule::Flag(WaterShaderFlags::Interior, "INTERIOR"),
+			DescriptorRule::Flag(WaterShaderFlags::Wading, "WADING"),
+			DescriptorRule::Flag(WaterShaderFlags::VertexAlphaDepth, "VERTEX_ALPHA_DEPTH"),
+			DescriptorRule::Flag(WaterShaderFlags::Cubemap, "CUBEMAP"),
+			DescriptorRule::Flag(WaterShaderFlags::Flowmap, "FLOWMAP"),
+			DescriptorRule::Flag(WaterShaderFlags::BlendNormals, "BLEND_NORMALS"),
+			WaterTechnique(WaterShaderTechniques::Underwater, "UNDERWATER"),
+			WaterTechnique(WaterShaderTechniques::Lod, "LOD"),
+			WaterTechnique(WaterShaderTechniques::Stencil, "STENCIL"),
+			WaterTechnique(WaterShaderTechniques::Simple, "SIMPLE"),
+			DescriptorRule::Masked(WaterSpecularMask, 0, "SPECULAR"),
+			DescriptorRule{ .mask = WaterSpecularMask,
+				.name = "NUM_SPECULAR_LIGHTS",
+				.fieldShift = WaterTechniqueShift,
+				.fieldWidth = 3,
+				.fieldMax = 7 },
+		};
+
+		inline constexpr std::array<uint32_t, 12> WaterTechniques = { { 0 << 11, 1 << 11,
+			2 << 11, 3 << 11, 4 << 11, 5 << 11, 6 << 11, 7 << 11, 8 << 11, 9 << 11, 10 << 11,
+			11 << 11 } };
+
+		namespace UtilityBits
+		{
+			using enum UtilityShaderFlags;
+
+			constexpr uint32_t Shadowmask =
+				Bits(RenderShadowmask, RenderShadowmaskSpot, RenderShadowmaskPb, RenderShadowmaskDpb);
+			constexpr uint32_t Opaque = Bits(OpaqueEffect);
+			constexpr uint32_t Shadowmap = Bits(RenderShadowmap);
+			constexpr uint32_t Depth = Bits(RenderDepth);
+			constexpr uint32_t Bit15 = Bits(RenderShadowmapClamped);
+			constexpr uint32_t Bit16 = Bits(RenderShadowmapPb);
+			constexpr uint32_t Bit17 = Bits(DepthWriteDecals);
+			constexpr uint32_t Normal = Bits(RenderNormal);
+			constexpr uint32_t NormalClear = Bits(RenderNormalClear);
+			constexpr uint32_t LodLand = Bits(LodLandscape);
+			constexpr uint32_t Focus = Bits(RenderShadowmask, RenderShadowmaskSpot);
+		}
+
+		// Conditions joined by "or" in the vanilla decoder are split into several rules emitting
+		// the same define.
+		inline constexpr std::array UtilityRules = {
+			DescriptorRule::Flag(UtilityShaderFlags::Vc, "VC"),
+			DescriptorRule::Flag(UtilityShaderFlags::Texture, "TEXTURE"),
+			DescriptorRule::Flag(UtilityShaderFlags::Skinned, "SKINNED"),
+			DescriptorRule::Flag(UtilityShaderFlags::Normals, "NORMALS"),
+			DescriptorRule::Flag(UtilityShaderFlags::AlphaTest, "ALPHA_TEST"),
+			DescriptorRule{ .mask = UtilityBits::LodLand,
+				.value = UtilityBits::LodLand,
+				.anyMask = UtilityBits::Focus,
+				.name = "FOCUS_SHADOW" },
+			DescriptorRule::Masked(UtilityBits::LodLand | UtilityBits::Focus, UtilityBits::LodLand,
+				"LOD_LANDSCAPE"),
+			DescriptorRule::Masked(UtilityBits::Normal | UtilityBits::NormalClear,
+				UtilityBits::Normal, "RENDER_NORMAL"),
+			DescriptorRule::Masked(UtilityBits::Normal | UtilityBits::NormalClear,
+				UtilityBits::NormalClear, "RENDER_NORMAL_CLEAR"),
+			DescriptorRule::Masked(UtilityBits::Normal | UtilityBits::NormalClear,
+				UtilityBits::Normal | UtilityBits::NormalClear, "STENCIL_ABOVE_WATER"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderNormalFalloff, "RENDER_NORMAL_FALLOFF"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderNormalClamp, "RENDER_NORMAL_CLAMP"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderDepth, "RENDER_DEPTH"),
+			DescriptorRule::Flag(UtilityShaderFlags::OpaqueEffect, "OPAQUE_EFFECT"),
+			DescriptorRule::Masked(UtilityBits::Shadowmap | UtilityBits::Bit16, UtilityBits::Bit16,
+				"ADDITIONAL_ALPHA_MASK"),
+			DescriptorRule::Masked(UtilityBits::Opaque | UtilityBits::Bit15,
+				UtilityBits::Opaque | UtilityBits::Bit15, "GRAYSCALE_TO_ALPHA"),
+			DescriptorRule::Masked(UtilityBits::Opaque | UtilityBits::Shadowmap,
+				UtilityBits::Shadowmap, "RENDER_SHADOWMAP"),
+			DescriptorRule::Masked(UtilityBits::Opaque | UtilityBits::Shadowmap | UtilityBits::Bit16,
+				UtilityBits::Shadowmap | UtilityBits::Bit16, "RENDER_SHADOWMAP_PB"),
+			DescriptorRule::Masked(UtilityBits::Opaque | UtilityBits::Bit15, UtilityBits::Bit15,
+				"RENDER_SHADOWMAP_CLAMPED"),
+			DescriptorRule::Flag(UtilityShaderFlags::GrayscaleMask, "GRAYSCALE_MASK"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderShadowmask, "RENDER_SHADOWMASK"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderShadowmaskSpot, "RENDER_SHADOWMASKSPOT"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderShadowmaskPb, "RENDER_SHADOWMASKPB"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderShadowmaskDpb, "RENDER_SHADOWMASKDPB"),
+			DescriptorRule::Flag(UtilityShaderFlags::RenderBaseTexture, "RENDER_BASE_TEXTURE"),
+			DescriptorRule::Flag(UtilityShaderFlags::TreeAnim, "TREE_ANIM"),
+			DescriptorRule::Flag(UtilityShaderFlags::LodObject, "LOD_OBJECT"),
+			DescriptorRule::Flag(UtilityShaderFlags::LocalMapFogOfWar, "LOCALMAP_FOGOFWAR"),
+			DescriptorRule{ .anyMask = UtilityBits::Shadowmask,
+				.name = "SHADOWFILTER",
+				.fieldShift = 17,
+				.fieldWidth = 3,
+				.fieldMax = 4 },
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Opaque |
+									   UtilityBits::Shadowmap | UtilityBits::Bit17,
+				UtilityBits::Shadowmap | UtilityBits::Bit17, "DEPTH_WRITE_DECALS"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth | UtilityBits::Bit17,
+				UtilityBits::Depth | UtilityBits::Bit17, "DEPTH_WRITE_DECALS"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Opaque | UtilityBits::Bit17,
+				UtilityBits::Opaque | UtilityBits::Bit17, "DEBUG_COLOR"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Shadowmap | UtilityBits::Bit17,
+				UtilityBits::Bit17, "DEBUG_COLOR"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Opaque | Bits(UtilityShaderFlags::DebugColor),
+				UtilityBits::Opaque | Bits(UtilityShaderFlags::DebugColor), "DEBUG_COLOR"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Shadowmap | Bits(UtilityShaderFlags::DebugColor),
+				Bits(UtilityShaderFlags::DebugColor), "DEBUG_COLOR"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Opaque |
+									   Bits(UtilityShaderFlags::DebugShadowSplit),
+				UtilityBits::Opaque | Bits(UtilityShaderFlags::DebugShadowSplit),
+				"DEBUG_SHADOWSPLIT"),
+			DescriptorRule::Masked(UtilityBits::Shadowmask | UtilityBits::Depth |
+									   UtilityBits::Shadowmap |
+									   Bits(UtilityShaderFlags::DebugShadowSplit),
+				Bits(UtilityShaderFlags::DebugShadowSplit), "DEBUG_SHADOWSPLIT"),
+			DescriptorRule::Always("SHADOWSPLITCOUNT", "3"),
+			DescriptorRule::Masked(UtilityBits::Bit16 | Bits(UtilityShaderFlags::AlphaTest) |
+									   UtilityBits::Opaque | UtilityBits::Shadowmap,
+				UtilityBits::Shadowmap, "NO_PIXEL_SHADER"),
+			DescriptorRule::Masked(UtilityBits::Bit16 | Bits(UtilityShaderFlags::AlphaTest) |
+									   UtilityBits::Shadowmask | UtilityBits::Depth,
+				UtilityBits::Depth, "NO_PIXEL_SHADER"),
+		};
+	}
+
+	inline constexpr ShaderDescriptorSchema LightingShaderSchema = { SShaderDescriptorSchema::LightingRules,
+		SShaderDescriptorSchema::LightingTechniqueMask, SShaderDescriptorSchema::LightingTechniques };
+	inline constexpr ShaderDescriptorSchema BloodSplatterShaderSchema = {
+		SShaderDescriptorSchema::BloodSplatterRules, 0xFFFFFFFF,
+		SShaderDescriptorSchema::BloodSplatterTechniques
+	};
+	inline constexpr ShaderDescriptorSchema DistantTreeShaderSchema = {
+		SShaderDescriptorSchema::DistantTreeRules, 1, {}
+	};
+	inline constexpr ShaderDescriptorSchema SkyShaderSchema = { SShaderDescriptorSchema::SkyRules,
+		0xFFFFFFFF, SShaderDescriptorSchema::SkyTechniques };
+	inline constexpr ShaderDescriptorSchema GrassShaderSchema = { SShaderDescriptorSchema::GrassRules,
+		SShaderDescriptorSchema::GrassTechniqueMask, SShaderDescriptorSchema::GrassTechniques };
+	inline constexpr ShaderDescriptorSchema ParticleShaderSchema = {
+		SShaderDescriptorSchema::ParticleRules, 0xFFFFFFFF,
+		SShaderDescriptorSchema::ParticleTechniques
+	};
+	inline constexpr ShaderDescriptorSchema EffectShaderSchema = { SShaderDescriptorSchema::EffectRules,
+		0, {} };
+	inline constexpr ShaderDescriptorSchema WaterShaderSchema = { SShaderDescriptorSchema::WaterRules,
+		SShaderDescriptorSchema::WaterTechniqueMask, SShaderDescriptorSchema::WaterTechniques };
+	inline constexpr ShaderDescriptorSchema UtilityShaderSchema = { SShaderDescriptorSchema::UtilityRules,
+		0, {} };
+}
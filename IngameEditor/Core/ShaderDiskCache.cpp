@@ -0,0 +1,400 @@
+#include "Core/ShaderDiskCache.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+namespace SIE
+{
+	namespace SShaderDiskCache
+	{
+		constexpr uint64_t HashPrime = 0x100000001b3ull;
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t shaderType;
+			uint32_t shaderClass;
+			uint32_t definesSize;
+			uint32_t reserved;
+			uint64_t sourceHash;
+			uint64_t definesHash;
+			uint32_t bufferSizes[3];
+			uint32_t constantTableSize;
+			uint64_t vertexDesc;
+			uint64_t byteCodeSize;
+			uint64_t payloadHash;
+		};
+		static_assert(std::is_trivially_copyable_v<FileHeader>);
+
+		static std::optional<std::string> ReadFile(const std::filesystem::path& path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open())
+			{
+				return std::nullopt;
+			}
+			std::ostringstream stream;
+			stream << file.rdbuf();
+			return std::move(stream).str();
+		}
+
+		static std::optional<std::string_view> ParseInclude(std::string_view line)
+		{
+			const auto directiveStart = line.find_first_not_of(" \t");
+			if (directiveStart == std::string_view::npos || line[directiveStart] != '#')
+			{
+				return std::nullopt;
+			}
+			line.remove_prefix(directiveStart + 1);
+			const auto nameStart = line.find_first_not_of(" \t");
+			if (nameStart == std::string_view::npos || !line.substr(nameStart).starts_with("include"))
+			{
+				return std::nullopt;
+			}
+			line.remove_prefix(nameStart + std::string_view("include").size());
+			const auto openQuote = line.find('"');
+			if (openQuote == std::string_view::npos)
+			{
+				return std::nullopt;
+			}
+			const auto closeQuote = line.find('"', openQuote + 1);
+			if (closeQuote == std::string_view::npos)
+			{
+				return std::nullopt;
+			}
+			return line.substr(openQuote + 1, closeQuote - openQuote - 1);
+		}
+
+		static uint64_t GetPayloadHash(std::string_view defines, const ShaderCacheEntry& entry)
+		{
+			uint64_t hash = HashString(defines);
+			hash = HashBytes(entry.reflection.constantTable.data(),
+				entry.reflection.constantTable.size(), hash);
+			return HashBytes(entry.byteCode.data(), entry.byteCode.size(), hash);
+		}
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		uint64_t hash = seed;
+		const auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t index = 0; index < size; ++index)
+		{
+			hash ^= bytes[index];
+			hash *= SShaderDiskCache::HashPrime;
+		}
+		return hash;
+	}
+
+	uint64_t HashString(std::string_view string, uint64_t seed)
+	{
+		return HashBytes(string.data(), string.size(), seed);
+	}
+
+	std::shared_ptr<const ShaderSourceFile> ShaderSourceStore::Get(const std::filesystem::path& path)
+	{
+		const auto normalizedPath = path.lexically_normal();
+		{
+			std::shared_lock lock(mutex);
+			if (auto it = files.find(normalizedPath.native()); it != files.end())
+			{
+				return it->second;
+			}
+		}
+
+		auto text = SShaderDiskCache::ReadFile(normalizedPath);
+		if (!text.has_value())
+		{
+			return nullptr;
+		}
+
+		auto file = std::make_shared<ShaderSourceFile>();
+		file->path = normalizedPath;
+		file->text = std::move(*text);
+		file->hash = HashString(file->text);
+		std::string_view remaining = file->text;
+		while (!remaining.empty())
+		{
+			const auto lineEnd = remaining.find('\n');
+			const auto line = remaining.substr(0, lineEnd);
+			remaining.remove_prefix(lineEnd == std::string_view::npos ? remaining.size() : lineEnd + 1);
+
+			if (const auto includeName = SShaderDiskCache::ParseInclude(line))
+			{
+				file->includes.emplace_back(*includeName);
+			}
+		}
+
+		// Another thread may have loaded the same file meanwhile, its copy wins.
+		std::unique_lock lock(mutex);
+		return files.try_emplace(normalizedPath.native(), std::move(file)).first->second;
+	}
+
+	void ShaderSourceStore::Invalidate(std::span<const std::filesystem::path::string_type> paths)
+	{
+		std::unique_lock lock(mutex);
+		for (const auto& path : paths)
+		{
+			files.erase(path);
+		}
+	}
+
+	void ShaderSourceStore::Clear()
+	{
+		std::unique_lock lock(mutex);
+		files.clear();
+	}
+
+	ShaderSourceHasher::ShaderSourceHasher(ShaderSourceStore& aSourceStore) :
+		sourceStore(aSourceStore)
+	{}
+
+	uint64_t ShaderSourceHasher::GetHash(const std::filesystem::path& path)
+	{
+		const auto normalizedPath = path.lexically_normal();
+
+		std::lock_guard lock(mutex);
+		if (auto it = hashes.find(normalizedPath.native()); it != hashes.end())
+		{
+			return it->second;
+		}
+
+		std::vector<std::filesystem::path> stack;
+		std::vector<std::filesystem::path> closure;
+		const auto hash = ComputeHash(normalizedPath, stack, closure);
+		hashes.insert_or_assign(normalizedPath.native(), hash);
+		closures.insert_or_assign(normalizedPath.native(), std::move(closure));
+		return hash;
+	}
+
+	void ShaderSourceHasher::Reset()
+	{
+		std::lock_guard lock(mutex);
+		hashes.clear();
+		closures.clear();
+		writeTimes.clear();
+	}
+
+	std::vector<std::filesystem::path> ShaderSourceHasher::PollChanges()
+	{
+		std::lock_guard lock(mutex);
+
+		std::vector<std::filesystem::path::string_type> changedFiles;
+		for (auto& [path, writeTime] : writeTimes)
+		{
+			std::error_code errorCode;
+			const auto currentWriteTime = std::filesystem::last_write_time(path, errorCode);
+			if (currentWriteTime != writeTime)
+			{
+				writeTime = currentWriteTime;
+				changedFiles.push_back(path);
+			}
+		}
+
+		std::vector<std::filesystem::path> result;
+		if (changedFiles.empty())
+		{
+			return result;
+		}
+		sourceStore.Invalidate(changedFiles);
+
+		for (auto it = closures.begin(); it != closures.end();)
+		{
+			const bool isChanged = std::any_of(it->second.cbegin(), it->second.cend(),
+				[&changedFiles](const std::filesystem::path& path) {
+					return std::find(changedFiles.cbegin(), changedFiles.cend(), path.native()) !=
+				           changedFiles.cend();
+				});
+			if (isChanged)
+			{
+				result.emplace_back(it->first);
+				hashes.erase(it->first);
+				it = closures.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		return result;
+	}
+
+	uint64_t ShaderSourceHasher::ComputeHash(const std::filesystem::path& path,
+		std::vector<std::filesystem::path>& stack, std::vector<std::filesystem::path>& closure)
+	{
+		if (std::find(stack.cbegin(), stack.cend(), path) != stack.cend())
+		{
+			return HashString(path.generic_string());
+		}
+
+		if (std::find(closure.cbegin(), closure.cend(), path) == closure.cend())
+		{
+			closure.push_back(path);
+		}
+		std::error_code errorCode;
+		writeTimes.insert_or_assign(path.native(),
+			std::filesystem::last_write_time(path, errorCode));
+
+		const auto source = sourceStore.Get(path);
+		if (source == nullptr)
+		{
+			return HashString(path.generic_string(), 0);
+		}
+
+		stack.push_back(path);
+
+		uint64_t hash = source->hash;
+		for (const auto& includeName : source->includes)
+		{
+			const auto includePath = (path.parent_path() / includeName).lexically_normal();
+			const auto includeHash = ComputeHash(includePath, stack, closure);
+			hash = HashBytes(&includeHash, sizeof(includeHash), hash);
+		}
+
+		stack.pop_back();
+
+		return hash;
+	}
+
+	ShaderDiskCache::ShaderDiskCache(std::filesystem::path aRootPath) :
+		rootPath(std::move(aRootPath))
+	{}
+
+	std::optional<ShaderCacheEntry> ShaderDiskCache::Load(const ShaderCacheKey& key,
+		std::string_view defines) const
+	{
+		std::ifstream file(GetEntryPath(key), std::ios::binary);
+		if (!file.is_open())
+		{
+			return std::nullopt;
+		}
+
+		SShaderDiskCache::FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			return std::nullopt;
+		}
+
+		if (header.magic != Magic || header.version != Version ||
+			header.shaderType != key.shaderType || header.shaderClass != key.shaderClass ||
+			header.sourceHash != key.sourceHash || header.definesHash != key.definesHash ||
+			header.definesSize != defines.size())
+		{
+			return std::nullopt;
+		}
+
+		constexpr uint64_t MaxByteCodeSize = 16 * 1024 * 1024;
+		if (header.byteCodeSize == 0 || header.byteCodeSize > MaxByteCodeSize ||
+			header.constantTableSize > std::numeric_limits<uint8_t>::max())
+		{
+			return std::nullopt;
+		}
+
+		std::string storedDefines(header.definesSize, '\0');
+		ShaderCacheEntry entry;
+		entry.reflection.bufferSizes = { header.bufferSizes[0], header.bufferSizes[1],
+			header.bufferSizes[2] };
+		entry.reflection.vertexDesc = header.vertexDesc;
+		entry.reflection.constantTable.resize(header.constantTableSize);
+		entry.byteCode.resize(header.byteCodeSize);
+
+		if (!file.read(storedDefines.data(), storedDefines.size()) ||
+			!file.read(reinterpret_cast<char*>(entry.reflection.constantTable.data()),
+				entry.reflection.constantTable.size()) ||
+			!file.read(reinterpret_cast<char*>(entry.byteCode.data()), entry.byteCode.size()))
+		{
+			return std::nullopt;
+		}
+
+		if (storedDefines != defines ||
+			SShaderDiskCache::GetPayloadHash(storedDefines, entry) != header.payloadHash)
+		{
+			return std::nullopt;
+		}
+
+		return entry;
+	}
+
+	bool ShaderDiskCache::Store(const ShaderCacheKey& key, std::string_view defines,
+		const ShaderCacheEntry& entry) const
+	{
+		const auto entryPath = GetEntryPath(key);
+
+		std::error_code errorCode;
+		std::filesystem::create_directories(entryPath.parent_path(), errorCode);
+		if (errorCode)
+		{
+			return false;
+		}
+
+		SShaderDiskCache::FileHeader header;
+		header.magic = Magic;
+		header.version = Version;
+		header.shaderType = key.shaderType;
+		header.shaderClass = key.shaderClass;
+		header.reserved = 0;
+		header.definesSize = static_cast<uint32_t>(defines.size());
+		header.sourceHash = key.sourceHash;
+		header.definesHash = key.definesHash;
+		std::copy(entry.reflection.bufferSizes.cbegin(), entry.reflection.bufferSizes.cend(),
+			header.bufferSizes);
+		header.constantTableSize = static_cast<uint32_t>(entry.reflection.constantTable.size());
+		header.vertexDesc = entry.reflection.vertexDesc;
+		header.byteCodeSize = entry.byteCode.size();
+		header.payloadHash = SShaderDiskCache::GetPayloadHash(defines, entry);
+
+		// Entries are written next to their final location and renamed over it, so that
+		// concurrent readers never observe a partially written file.
+		auto temporaryPath = entryPath;
+		temporaryPath += std::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(defines.data(), defines.size());
+			file.write(reinterpret_cast<const char*>(entry.reflection.constantTable.data()),
+				entry.reflection.constantTable.size());
+			file.write(reinterpret_cast<const char*>(entry.byteCode.data()), entry.byteCode.size());
+			if (!file.good())
+			{
+				file.close();
+				std::filesystem::remove(temporaryPath, errorCode);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, entryPath, errorCode);
+		if (errorCode)
+		{
+			std::filesystem::remove(temporaryPath, errorCode);
+			return false;
+		}
+		return true;
+	}
+
+	void ShaderDiskCache::Clear() const
+	{
+		std::error_code errorCode;
+		std::filesystem::remove_all(rootPath, errorCode);
+	}
+
+	const std::filesystem::path& ShaderDiskCache::GetRootPath() const
+	{
+		return rootPath;
+	}
+
+	std::filesystem::path ShaderDiskCache::GetEntryPath(const ShaderCacheKey& key) const
+	{
+		return rootPath / std::format("{}", key.shaderType) / std::format("{}", key.shaderClass) /
+		       std::format("{:016X}.bin", key.definesHash);
+	}
+}
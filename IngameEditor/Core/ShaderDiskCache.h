@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace SIE
+{
+	constexpr uint64_t HashSeed = 0xcbf29ce484222325ull;
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HashSeed);
+	uint64_t HashString(std::string_view string, uint64_t seed = HashSeed);
+
+	struct ShaderCacheKey
+	{
+		uint32_t shaderType = 0;
+		uint32_t shaderClass = 0;
+		uint64_t sourceHash = 0;
+		uint64_t definesHash = 0;
+	};
+
+	struct ShaderReflectionData
+	{
+		std::array<uint32_t, 3> bufferSizes = { 0, 0, 0 };
+		uint64_t vertexDesc = 0;
+		std::vector<int8_t> constantTable;
+	};
+
+	struct ShaderCacheEntry
+	{
+		ShaderReflectionData reflection;
+		std::vector<uint8_t> byteCode;
+	};
+
+	struct ShaderSourceFile
+	{
+		std::filesystem::path path;
+		std::string text;
+		uint64_t hash = 0;
+		std::vector<std::string> includes;
+	};
+
+	// Keeps every source file read once in memory for all compilation threads. Files are
+	// loaded into owned buffers instead of being mapped, so they stay writable for hot reload.
+	class ShaderSourceStore
+	{
+	public:
+		// Returns nullptr if the file can not be read.
+		std::shared_ptr<const ShaderSourceFile> Get(const std::filesystem::path& path);
+		void Invalidate(std::span<const std::filesystem::path::string_type> paths);
+		void Clear();
+
+	private:
+		std::unordered_map<std::filesystem::path::string_type,
+			std::shared_ptr<const ShaderSourceFile>>
+			files;
+		std::shared_mutex mutex;
+	};
+
+	class ShaderSourceHasher
+	{
+	public:
+		explicit ShaderSourceHasher(ShaderSourceStore& sourceStore);
+
+		uint64_t GetHash(const std::filesystem::path& path);
+		void Reset();
+
+		// Returns hashed root files whose include closure was modified since it was hashed
+		// and forgets their hashes.
+		std::vector<std::filesystem::path> PollChanges();
+
+	private:
+		uint64_t ComputeHash(const std::filesystem::path& path,
+			std::vector<std::filesystem::path>& stack, std::vector<std::filesystem::path>& closure);
+
+		std::unordered_map<std::filesystem::path::string_type, uint64_t> hashes;
+		std::unordered_map<std::filesystem::path::string_type, std::vector<std::filesystem::path>>
+			closures;
+		std::unordered_map<std::filesystem::path::string_type, std::filesystem::file_time_type>
+			writeTimes;
+		ShaderSourceStore& sourceStore;
+		std::mutex mutex;
+	};
+
+	class ShaderDiskCache
+	{
+	public:
+		static constexpr uint32_t Magic = 0x42454953;  // SIEB
+		static constexpr uint32_t Version = 3;
+
+		explicit ShaderDiskCache(std::filesystem::path rootPath);
+
+		std::optional<ShaderCacheEntry> Load(const ShaderCacheKey& key,
+			std::string_view defines) const;
+		bool Store(const ShaderCacheKey& key, std::string_view defines,
+			const ShaderCacheEntry& entry) const;
+		void Clear() const;
+
+		const std::filesystem::path& GetRootPath() const;
+
+	private:
+		std::filesystem::path GetEntryPath(const ShaderCacheKey& key) const;
+
+		std::filesystem::path rootPath;
+	};
+}
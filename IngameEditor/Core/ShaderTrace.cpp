@@ -0,0 +1,123 @@
+#include "Core/ShaderTrace.h"
+
+namespace SIE
+{
+	namespace SShaderTrace
+	{
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+		};
+
+		static bool HasValidHeader(const std::filesystem::path& path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			FileHeader header;
+			return file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+			       header.magic == ShaderTraceWriter::Magic &&
+			       header.version == ShaderTraceWriter::Version;
+		}
+	}
+
+	uint64_t ShaderTraceRecord::GetKey() const
+	{
+		return descriptor | (static_cast<uint64_t>(shaderClass) << 32) |
+		       (static_cast<uint64_t>(shaderType) << 40);
+	}
+
+	std::vector<ShaderTraceRecord> ReadShaderTrace(const std::filesystem::path& path)
+	{
+		std::vector<ShaderTraceRecord> result;
+
+		std::ifstream file(path, std::ios::binary);
+		SShaderTrace::FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			header.magic != ShaderTraceWriter::Magic || header.version != ShaderTraceWriter::Version)
+		{
+			return result;
+		}
+
+		ShaderTraceRecord record;
+		while (file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+		{
+			result.push_back(record);
+		}
+		return result;
+	}
+
+	ShaderTraceWriter::ShaderTraceWriter(std::filesystem::path aPath) :
+		path(std::move(aPath))
+	{}
+
+	bool ShaderTraceWriter::Append(const ShaderTraceRecord& record)
+	{
+		if (!file.is_open() && !Open())
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+		return file.good();
+	}
+
+	bool ShaderTraceWriter::Flush()
+	{
+		if (!file.is_open())
+		{
+			return true;
+		}
+		file.flush();
+		return file.good();
+	}
+
+	void ShaderTraceWriter::Close()
+	{
+		file.close();
+	}
+
+	void ShaderTraceWriter::Remove()
+	{
+		Close();
+		std::error_code errorCode;
+		std::filesystem::remove(path, errorCode);
+	}
+
+	const std::filesystem::path& ShaderTraceWriter::GetPath() const
+	{
+		return path;
+	}
+
+	bool ShaderTraceWriter::Open()
+	{
+		std::error_code errorCode;
+		if (path.has_parent_path())
+		{
+			std::filesystem::create_directories(path.parent_path(), errorCode);
+		}
+
+		if (SShaderTrace::HasValidHeader(path))
+		{
+			// A trailing partial record left by an interrupted write would shift every record
+			// appended after it, so the file is cut back to a whole number of records.
+			const auto fileSize = std::filesystem::file_size(path, errorCode);
+			if (!errorCode)
+			{
+				const auto recordsSize = (fileSize - sizeof(SShaderTrace::FileHeader)) /
+				                         sizeof(ShaderTraceRecord) * sizeof(ShaderTraceRecord);
+				std::filesystem::resize_file(path, sizeof(SShaderTrace::FileHeader) + recordsSize,
+					errorCode);
+			}
+			file.open(path, std::ios::binary | std::ios::app);
+			return file.is_open();
+		}
+
+		file.open(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		const SShaderTrace::FileHeader header{ Magic, Version };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		return file.good();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace SIE
+{
+	struct ShaderTraceRecord
+	{
+		uint32_t descriptor = 0;
+		uint8_t shaderType = 0;
+		uint8_t shaderClass = 0;
+		uint16_t reserved = 0;
+
+		uint64_t GetKey() const;
+	};
+	static_assert(sizeof(ShaderTraceRecord) == 8);
+
+	std::vector<ShaderTraceRecord> ReadShaderTrace(const std::filesystem::path& path);
+
+	class ShaderTraceWriter
+	{
+	public:
+		static constexpr uint32_t Magic = 0x54454953;  // SIET
+		static constexpr uint32_t Version = 1;
+
+		explicit ShaderTraceWriter(std::filesystem::path path);
+
+		// Records are buffered until Flush or Close.
+		bool Append(const ShaderTraceRecord& record);
+		bool Flush();
+		void Close();
+		void Remove();
+
+		const std::filesystem::path& GetPath() const;
+
+	private:
+		bool Open();
+
+		std::filesystem::path path;
+		std::ofstream file;
+	};
+}
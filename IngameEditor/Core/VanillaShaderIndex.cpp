@@ -0,0 +1,75 @@
+#include "Core/VanillaShaderIndex.h"
+
+#include <mutex>
+
+namespace SIE
+{
+	namespace SVanillaShaderIndex
+	{
+		template <typename T>
+		static bool IsCurrent(const T& index, size_t sourceSize, const void* sourceFirst)
+		{
+			return index.sourceSize == sourceSize && index.sourceFirst == sourceFirst;
+		}
+	}
+
+	RE::BSGraphics::VertexShader* VanillaShaderIndex::GetVertexShader(const RE::BSShader& shader,
+		uint32_t descriptor)
+	{
+		return Find(vertexShaders, shader, shader.vertexShaders, descriptor);
+	}
+
+	RE::BSGraphics::PixelShader* VanillaShaderIndex::GetPixelShader(const RE::BSShader& shader,
+		uint32_t descriptor)
+	{
+		return Find(pixelShaders, shader, shader.pixelShaders, descriptor);
+	}
+
+	void VanillaShaderIndex::Clear()
+	{
+		std::unique_lock lock(mutex);
+		vertexShaders.clear();
+		pixelShaders.clear();
+	}
+
+	template <typename T, typename MapType>
+	T* VanillaShaderIndex::Find(IndexMap<T>& indices, const RE::BSShader& shader,
+		const MapType& source, uint32_t descriptor)
+	{
+		using namespace SVanillaShaderIndex;
+
+		// Only the live technique map is inspected, indexed objects may already have been freed
+		// by a reload.
+		const size_t sourceSize = source.size();
+		const T* sourceFirst = sourceSize != 0 ? *source.begin() : nullptr;
+
+		const auto findShader = [descriptor](const Index<T>& index) -> T* {
+			const auto it = index.shaders.find(descriptor);
+			return it != index.shaders.end() ? it->second : nullptr;
+		};
+
+		{
+			std::shared_lock lock(mutex);
+			const auto it = indices.find(&shader);
+			if (it != indices.end() && IsCurrent(it->second, sourceSize, sourceFirst))
+			{
+				return findShader(it->second);
+			}
+		}
+
+		std::unique_lock lock(mutex);
+		auto& index = indices[&shader];
+		if (!IsCurrent(index, sourceSize, sourceFirst))
+		{
+			index.shaders.clear();
+			index.shaders.reserve(sourceSize);
+			for (auto item : source)
+			{
+				index.shaders.try_emplace(item->id, item);
+			}
+			index.sourceSize = sourceSize;
+			index.sourceFirst = sourceFirst;
+		}
+		return findShader(index);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <RE/B/BSShader.h>
+
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace SIE
+{
+	// Descriptor to vanilla shader lookup over the technique maps of each BSShader. An index is
+	// built on first use and rebuilt when the size or the first object of the map it was built
+	// from changes. Shader loading allocates new objects, so a reload is only missed if it keeps
+	// the size and reuses the address of the first shader; no shader load hook exists to call
+	// Clear() from.
+	class VanillaShaderIndex
+	{
+	public:
+		static VanillaShaderIndex& Instance()
+		{
+			static VanillaShaderIndex instance;
+			return instance;
+		}
+
+		RE::BSGraphics::VertexShader* GetVertexShader(const RE::BSShader& shader,
+			uint32_t descriptor);
+		RE::BSGraphics::PixelShader* GetPixelShader(const RE::BSShader& shader, uint32_t descriptor);
+
+		void Clear();
+
+	private:
+		template <typename T>
+		struct Index
+		{
+			size_t sourceSize = 0;
+			const T* sourceFirst = nullptr;
+			std::unordered_map<uint32_t, T*> shaders;
+		};
+
+		template <typename T>
+		using IndexMap = std::unordered_map<const RE::BSShader*, Index<T>>;
+
+		VanillaShaderIndex() = default;
+
+		template <typename T, typename MapType>
+		T* Find(IndexMap<T>& indices, const RE::BSShader& shader, const MapType& source,
+			uint32_t descriptor);
+
+		IndexMap<RE::BSGraphics::VertexShader> vertexShaders;
+		IndexMap<RE::BSGraphics::PixelShader> pixelShaders;
+		std::shared_mutex mutex;
+	};
+}
@@ -1,5 +1,9 @@
 #include "Gui/Gui.h"
 
+#include "Core/CpuProfiler.h"
+#include "Core/FrameRecorder.h"
+#include "Core/RenderPassTracker.h"
+#include "Core/ShaderCache.h"
 #include "Gui/MainWindow.h"
 #include "Utils/Hooking.h"
 #include "Utils/OverheadBuilder.h"
@@ -148,6 +152,10 @@ namespace SIE
 #endif
 
 		Core::GetInstance().Process(delta);
+		ShaderCache::Instance().OnFrame(delta);
+		FrameRecorder::Instance().OnFrame();
+		CpuProfiler::Instance().OnFrame();
+		RenderPassTracker::Instance().OnFrame();
 
         const auto result = IDXGISwapChainPresentFunc(This, SyncInterval, Flags);
 
@@ -1,5 +1,8 @@
 #include "Gui/MainWindow.h"
 
+#include "Core/CpuProfiler.h"
+#include "Core/FrameRecorder.h"
+#include "Core/RenderPassTracker.h"
 #include "Core/Renderer.h"
 #include "Core/ShaderCache.h"
 #include "Gui/CellEditor.h"
@@ -38,65 +41,364 @@ namespace SIE
 {
 	namespace SMainWindow
 	{
-		struct RenderPassCache
+		void RenderPassStatistics()
 		{
-			struct Pool
+			auto& tracker = RenderPassTracker::Instance();
+			bool isEnabled = tracker.IsEnabled();
+			if (ImGui::Checkbox("Track render passes", &isEnabled))
 			{
-				RE::BSRenderPass* passes;
-				RE::BSLight** lights;
-				RE::BSRenderPass* firstAvailable;
-				RE::BSRenderPass* lastAvailable;
-				RE::BSSpinLock lock;
-			};
+				tracker.SetEnabled(isEnabled);
+			}
+			int passesPerFrame = static_cast<int>(tracker.GetPassesPerFrame());
+			if (ImGui::DragInt("Passes scanned per frame", &passesPerFrame, 64.f, 256,
+					static_cast<int>(RenderPassTracker::PoolCount * RenderPassTracker::PassCount)))
+			{
+				tracker.SetPassesPerFrame(static_cast<size_t>(std::max(passesPerFrame, 0)));
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Reset high water"))
+			{
+				tracker.ResetHighWater();
+			}
+			if (!isEnabled)
+			{
+				return;
+			}
+
+			ImGui::Text("Counts lag by up to %d frames, high water marks are approximate",
+				static_cast<int>(tracker.GetSweepFrameCount()));
+			for (size_t poolIndex = 0; poolIndex < RenderPassTracker::PoolCount; ++poolIndex)
+			{
+				const auto& pool = tracker.GetPoolStatistics(poolIndex);
+				ImGui::Text("%d/%d passes used in pool %d (high water %d) including:",
+					pool.totalUsed, RenderPassTracker::PassCount, poolIndex, pool.totalHighWater);
+				for (size_t typeIndex = 0; typeIndex < RenderPassTracker::TypeCount; ++typeIndex)
+				{
+					if (pool.highWater[typeIndex] > 0)
+					{
+						const char* typeName =
+							typeIndex < static_cast<size_t>(RE::BSShader::Type::Total) ?
+								magic_enum::enum_name(static_cast<RE::BSShader::Type>(typeIndex))
+									.data() :
+								"Untyped";
+						ImGui::Text("%d %s passes (high water %d)", pool.used[typeIndex], typeName,
+							pool.highWater[typeIndex]);
+					}
+				}
+			}
+
+			std::array<float, RenderPassTracker::HistorySize> slotChanges;
+			tracker.GetHistory(slotChanges);
+			ImGui::PlotHistogram("Slot changes per sweep", slotChanges.data(),
+				static_cast<int>(slotChanges.size()), 0, nullptr, 0.f, FLT_MAX, ImVec2(0.f, 60.f));
+		}
 
-			static constexpr size_t PoolCount = 2;
+		static bool HasActivity(const ShaderStatistics& statistics)
+		{
+			return statistics.queued != 0 || statistics.inProgress != 0 ||
+			       statistics.compiled != 0 || statistics.loadedFromDisk != 0 ||
+			       statistics.shared != 0 || statistics.failed != 0 || statistics.hits != 0 ||
+			       statistics.misses != 0;
+		}
 
-			std::array<Pool, PoolCount> pools;
-		};
+		static void ShaderStatisticsRow(const char* className, const char* typeName,
+			const ShaderStatistics& statistics)
+		{
+			const auto requests = statistics.hits + statistics.misses;
+			const float hitRate =
+				requests != 0 ? 100.f * statistics.hits / static_cast<float>(requests) : 0.f;
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(className);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(typeName);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.queued);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.inProgress);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.compiled);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.loadedFromDisk);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.shared);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.failed);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f%%", hitRate);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", statistics.compileTimeP50.count() / 1000.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", statistics.compileTimeP95.count() / 1000.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", statistics.compileTimeP99.count() / 1000.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", statistics.evicted);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", statistics.byteCodeSize / 1024.f);
+		}
 
-		void RenderPassStatistics() 
+		void ShaderCacheStatistics()
 		{
-			static const REL::Relocation<RenderPassCache*> renderPassCache(
-				RELOCATION_ID(528206, 415150));
+			auto& shaderCache = ShaderCache::Instance();
+			if (ImGui::Button("Reset statistics"))
+			{
+				shaderCache.ResetStatistics();
+			}
+
+			const auto statistics = shaderCache.GetStatistics();
+			constexpr ImGuiTableFlags tableFlags =
+				ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+			if (ImGui::BeginTable("ShaderStatistics", 14, tableFlags))
+			{
+				ImGui::TableSetupColumn("Class");
+				ImGui::TableSetupColumn("Type");
+				ImGui::TableSetupColumn("Queued");
+				ImGui::TableSetupColumn("In progress");
+				ImGui::TableSetupColumn("Compiled");
+				ImGui::TableSetupColumn("From disk");
+				ImGui::TableSetupColumn("Shared");
+				ImGui::TableSetupColumn("Failed");
+				ImGui::TableSetupColumn("Hit rate");
+				ImGui::TableSetupColumn("p50 ms");
+				ImGui::TableSetupColumn("p95 ms");
+				ImGui::TableSetupColumn("p99 ms");
+				ImGui::TableSetupColumn("Evicted");
+				ImGui::TableSetupColumn("Bytecode KB");
+				ImGui::TableHeadersRow();
+
+				for (size_t classIndex = 0; classIndex < statistics.perClass.size(); ++classIndex)
+				{
+					if (!HasActivity(statistics.perClass[classIndex]))
+					{
+						continue;
+					}
+					const auto className =
+						magic_enum::enum_name(static_cast<ShaderClass>(classIndex));
+					ShaderStatisticsRow(className.data(), "All", statistics.perClass[classIndex]);
+					for (size_t typeIndex = 0; typeIndex < statistics.perType[classIndex].size();
+						 ++typeIndex)
+					{
+						const auto& typeStatistics = statistics.perType[classIndex][typeIndex];
+						if (HasActivity(typeStatistics))
+						{
+							ShaderStatisticsRow("",
+								magic_enum::enum_name(static_cast<RE::BSShader::Type>(typeIndex))
+									.data(),
+								typeStatistics);
+						}
+					}
+				}
+				ImGui::EndTable();
+			}
 
-			for (size_t poolIndex = 0; poolIndex < RenderPassCache::PoolCount; ++poolIndex)
+			if (ImGui::BeginTable("TechniqueStatistics", 4, tableFlags))
 			{
-				const auto& pool = (*renderPassCache).pools[poolIndex];
+				ImGui::TableSetupColumn("Technique lookup");
+				ImGui::TableSetupColumn("Draws");
+				ImGui::TableSetupColumn("Average ns");
+				ImGui::TableSetupColumn("Total ms");
+				ImGui::TableHeadersRow();
+
+				for (size_t pathIndex = 0; pathIndex < statistics.perTechniquePath.size();
+					 ++pathIndex)
+				{
+					const auto& pathStatistics = statistics.perTechniquePath[pathIndex];
+					const float averageTime =
+						pathStatistics.count != 0 ?
+							pathStatistics.totalTime.count() /
+								static_cast<float>(pathStatistics.count) :
+							0.f;
+
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(
+						magic_enum::enum_name(static_cast<TechniquePath>(pathIndex)).data());
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", pathStatistics.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", averageTime);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", pathStatistics.totalTime.count() / 1000000.f);
+				}
+				ImGui::EndTable();
+			}
 
-				std::array<size_t, static_cast<size_t>(RE::BSShader::Type::Total) + 1> usedPasses;
-				std::fill(usedPasses.begin(), usedPasses.end(), 0);
+			if (PushingCollapsingHeader("Permutations"))
+			{
+				auto records = shaderCache.GetCompilationRecords();
+				std::sort(records.begin(), records.end(),
+					[](const auto& first, const auto& second) {
+						return first.duration > second.duration;
+					});
+				ImGui::Text("%zu most recent compilations", records.size());
 
-				constexpr size_t passCount = 65535;
-				for (size_t passIndex = 0; passIndex < passCount; ++passIndex)
+				if (ImGui::BeginTable("ShaderPermutations", 7,
+						tableFlags | ImGuiTableFlags_ScrollY, ImVec2(0.f, 400.f)))
 				{
-					const RE::BSRenderPass& pass = pool.passes[passIndex];
-					if (pass.passEnum != 0)
+					ImGui::TableSetupScrollFreeze(0, 1);
+					ImGui::TableSetupColumn("Class");
+					ImGui::TableSetupColumn("Type");
+					ImGui::TableSetupColumn("Descriptor");
+					ImGui::TableSetupColumn("Duration ms");
+					ImGui::TableSetupColumn("Bytecode KB");
+					ImGui::TableSetupColumn("Source");
+					ImGui::TableSetupColumn("Defines");
+					ImGui::TableHeadersRow();
+
+					ImGuiListClipper clipper;
+					clipper.Begin(static_cast<int>(records.size()));
+					while (clipper.Step())
 					{
-						/*logger::info("{} {} {}", pass.passEnum,
-							reinterpret_cast<void*>(pass.shaderProperty),
-							reinterpret_cast<void*>(pass.shader));*/
-						++usedPasses[static_cast<size_t>(RE::BSShader::Type::Total)];
-						if (pass.shaderProperty != nullptr)
+						for (int recordIndex = clipper.DisplayStart;
+							 recordIndex < clipper.DisplayEnd; ++recordIndex)
 						{
-							++usedPasses[static_cast<size_t>(pass.shader->shaderType.get())];
+							const auto& record = records[recordIndex];
+							ImGui::TableNextRow();
+							ImGui::TableNextColumn();
+							ImGui::TextUnformatted(magic_enum::enum_name(record.shaderClass).data());
+							ImGui::TableNextColumn();
+							ImGui::TextUnformatted(magic_enum::enum_name(record.shaderType).data());
+							ImGui::TableNextColumn();
+							ImGui::Text("%08X", record.descriptor);
+							ImGui::TableNextColumn();
+							ImGui::Text("%.1f", record.duration.count() / 1000.f);
+							ImGui::TableNextColumn();
+							ImGui::Text("%.1f", record.byteCodeSize / 1024.f);
+							ImGui::TableNextColumn();
+							ImGui::TextUnformatted(record.isFailed ?
+							                           "Failed" :
+							                           (record.isLoadedFromDisk ? "Disk" : "Compiled"));
+							ImGui::TableNextColumn();
+							ImGui::TextUnformatted(record.defines.c_str());
 						}
 					}
+					ImGui::EndTable();
+				}
+				ImGui::TreePop();
+			}
+		}
+
+		void CpuProfilerTimeline()
+		{
+			constexpr float RowHeight = 18.f;
+			constexpr float MinLabelWidth = 30.f;
+
+			auto& profiler = CpuProfiler::Instance();
+			bool isEnabled = profiler.IsEnabled();
+			if (ImGui::Checkbox("Enable CPU Profiler", &isEnabled))
+			{
+				profiler.SetEnabled(isEnabled);
+			}
+			static bool isPaused = false;
+			static CpuProfiler::Frame frame;
+			ImGui::SameLine();
+			ImGui::Checkbox("Pause", &isPaused);
+			if (!isPaused)
+			{
+				frame = profiler.GetLastFrame();
+			}
+			if (frame.threads.empty() || frame.end <= frame.start)
+			{
+				return;
+			}
+
+			const double timestampsPerMillisecond =
+				ShaderCache::Instance().GetTimestampsPerNanosecond() * 1000000.;
+			const auto toMilliseconds = [timestampsPerMillisecond](uint64_t timestamps) {
+				return timestampsPerMillisecond > 0. ? timestamps / timestampsPerMillisecond : 0.;
+			};
+			const double frameDuration = static_cast<double>(frame.end - frame.start);
+			ImGui::Text("Frame %llu, %.2f ms", frame.index, toMilliseconds(frame.end - frame.start));
+
+			std::map<CpuProfiler::NameId, std::pair<uint64_t, uint64_t>> totals;
+			auto* drawList = ImGui::GetWindowDrawList();
+			const float width = ImGui::GetContentRegionAvail().x;
+			for (size_t threadIndex = 0; threadIndex < frame.threads.size(); ++threadIndex)
+			{
+				const auto& thread = frame.threads[threadIndex];
+				uint16_t maxDepth = 0;
+				for (const auto& event : thread.events)
+				{
+					maxDepth = std::max(maxDepth, event.depth);
 				}
 
-				ImGui::Text("%d/%d passes used in pool %d including:",
-					usedPasses[static_cast<size_t>(RE::BSShader::Type::Total)], passCount,
-					poolIndex);
-				for (size_t typeIndex = 0;
-					 typeIndex < static_cast<size_t>(RE::BSShader::Type::Total); ++typeIndex)
+				ImGui::Text("Thread %zu, %zu scopes, %u dropped", threadIndex, thread.events.size(),
+					thread.droppedEvents);
+				const ImVec2 origin = ImGui::GetCursorScreenPos();
+				ImGui::InvisibleButton(std::format("Timeline{}", threadIndex).c_str(),
+					ImVec2(width, (maxDepth + 1) * RowHeight));
+				const bool isHovered = ImGui::IsItemHovered();
+				const ImVec2 mousePosition = ImGui::GetMousePos();
+
+				for (const auto& event : thread.events)
 				{
-					if (usedPasses[typeIndex] > 0)
+					const uint64_t start = std::clamp(event.start, frame.start, frame.end);
+					const uint64_t end =
+						std::clamp(event.end != 0 ? event.end : frame.end, start, frame.end);
+					auto& total = totals[event.name];
+					++total.first;
+					total.second += end - start;
+
+					const ImVec2 min(origin.x + static_cast<float>(width * (start - frame.start) /
+																	frameDuration),
+						origin.y + event.depth * RowHeight);
+					const ImVec2 max(std::max(min.x + 1.f,
+										 origin.x + static_cast<float>(
+														width * (end - frame.start) / frameDuration)),
+						min.y + RowHeight - 1.f);
+					drawList->AddRectFilled(min, max,
+						ImColor::HSV(std::fmod(event.name * 0.618034f, 1.f), 0.5f, 0.7f));
+
+					const bool isEventHovered = isHovered && mousePosition.x >= min.x &&
+					                            mousePosition.x < max.x && mousePosition.y >= min.y &&
+					                            mousePosition.y < max.y;
+					if (max.x - min.x >= MinLabelWidth || isEventHovered)
 					{
-						ImGui::Text("%d %s passes", usedPasses[typeIndex],
-							magic_enum::enum_name(static_cast<RE::BSShader::Type>(typeIndex))
-								.data());
+						const auto name = profiler.GetName(event.name);
+						if (max.x - min.x >= MinLabelWidth)
+						{
+							drawList->PushClipRect(min, max, true);
+							drawList->AddText(ImVec2(min.x + 2.f, min.y + 2.f),
+								IM_COL32(255, 255, 255, 255), name.c_str());
+							drawList->PopClipRect();
+						}
+						if (isEventHovered)
+						{
+							ImGui::SetTooltip("%s\n%.3f ms", name.c_str(), toMilliseconds(end - start));
+						}
 					}
 				}
 			}
+
+			constexpr ImGuiTableFlags tableFlags =
+				ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+			if (ImGui::BeginTable("CpuProfilerTotals", 3, tableFlags))
+			{
+				ImGui::TableSetupColumn("Scope");
+				ImGui::TableSetupColumn("Count");
+				ImGui::TableSetupColumn("Total ms");
+				ImGui::TableHeadersRow();
+
+				std::vector<std::pair<CpuProfiler::NameId, std::pair<uint64_t, uint64_t>>>
+					sortedTotals(totals.begin(), totals.end());
+				std::sort(sortedTotals.begin(), sortedTotals.end(),
+					[](const auto& first, const auto& second) {
+						return first.second.second > second.second.second;
+					});
+				for (const auto& [name, total] : sortedTotals)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(profiler.GetName(name).c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", total.first);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", toMilliseconds(total.second));
+				}
+				ImGui::EndTable();
+			}
 		}
 
 		bool VisibilityFlagEdit(const char* label, RE::VISIBILITY flagMask) 
@@ -257,9 +559,40 @@ namespace SIE
 			static RE::BSFixedString savePath = "WeatherEditorOutput.esp";
 			EspPathEdit("SavePath", "", savePath);
 			ImGui::SameLine();
+			static std::shared_ptr<ExportJob> exportJob;
+			const bool isExporting = exportJob != nullptr && !exportJob->IsDone();
+			ImGui::BeginDisabled(isExporting);
 			if (ImGui::Button("Save"))
 			{
-				Serializer::Instance().Export(std::string("Data\\") + savePath.c_str());
+				exportJob = Serializer::Instance().Export(std::string("Data\\") + savePath.c_str());
+			}
+			ImGui::EndDisabled();
+			ImGui::SameLine();
+			bool isDebugDumpEnabled = Serializer::Instance().IsDebugDumpEnabled();
+			if (ImGui::Checkbox("Dump Records", &isDebugDumpEnabled))
+			{
+				Serializer::Instance().SetDebugDumpEnabled(isDebugDumpEnabled);
+			}
+
+			if (exportJob != nullptr)
+			{
+				const auto progress = exportJob->GetProgress();
+				const float fraction = progress.formCount != 0 ?
+				                           static_cast<float>(progress.formsWritten) / progress.formCount :
+				                           1.f;
+				ImGui::ProgressBar(fraction, ImVec2(-1.f, 0.f),
+					std::format("{} {}/{} forms, {} KB", magic_enum::enum_name(progress.phase),
+						progress.formsWritten, progress.formCount, progress.bytesWritten / 1024)
+						.c_str());
+				if (isExporting)
+				{
+					ImGui::BeginDisabled(exportJob->IsCancelRequested());
+					if (ImGui::Button("Cancel Export"))
+					{
+						exportJob->Cancel();
+					}
+					ImGui::EndDisabled();
+				}
 			}
 		}
 
@@ -328,6 +661,55 @@ namespace SIE
 				{
 					shaderCache.SetAsync(isAsync);
 				}
+				bool useDiskCache = shaderCache.IsDiskCacheEnabled();
+				if (ImGui::Checkbox("Use Shader Disk Cache", &useDiskCache))
+				{
+					shaderCache.SetDiskCacheEnabled(useDiskCache);
+				}
+				bool hotReload = shaderCache.IsHotReloadEnabled();
+				if (ImGui::Checkbox("Hot Reload Shaders", &hotReload))
+				{
+					shaderCache.SetHotReloadEnabled(hotReload);
+				}
+				bool recordTrace = shaderCache.IsTraceRecordingEnabled();
+				if (ImGui::Checkbox("Record Shader Trace", &recordTrace))
+				{
+					shaderCache.SetTraceRecordingEnabled(recordTrace);
+				}
+				bool pauseCompilation = shaderCache.IsCompilationPaused();
+				if (ImGui::Checkbox("Pause Shader Compilation", &pauseCompilation))
+				{
+					shaderCache.SetCompilationPaused(pauseCompilation);
+				}
+				int compilationThreadCount =
+					static_cast<int>(shaderCache.GetCompilationThreadCount());
+				if (ImGui::SliderInt("Compilation Threads", &compilationThreadCount, 1,
+						static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))))
+				{
+					shaderCache.SetCompilationThreadCount(compilationThreadCount);
+				}
+				int memoryBudget = static_cast<int>(shaderCache.GetMemoryBudget() >> 20);
+				if (ImGui::DragInt("Shader Memory Budget (MB, 0 - unlimited)", &memoryBudget, 1.f, 0,
+						4096))
+				{
+					shaderCache.SetMemoryBudget(static_cast<size_t>(std::max(memoryBudget, 0)) << 20);
+				}
+				bool throttleCompilation = shaderCache.IsThrottlingEnabled();
+				if (ImGui::Checkbox("Throttle Compilation By Frame Time", &throttleCompilation))
+				{
+					shaderCache.SetThrottlingEnabled(throttleCompilation);
+				}
+				if (throttleCompilation)
+				{
+					float throttleFrameTime = shaderCache.GetThrottleFrameTime();
+					if (ImGui::DragFloat("Target Frame Time (ms)", &throttleFrameTime, 0.1f, 1.f,
+							100.f))
+					{
+						shaderCache.SetThrottleFrameTime(throttleFrameTime);
+					}
+					ImGui::Text("%d compilation threads active",
+						static_cast<int>(shaderCache.GetActiveCompilationLimit()));
+				}
 				bool useCustomShaders = shaderCache.IsEnabled();
 				if (ImGui::Checkbox("Use Custom Shaders", &useCustomShaders))
 				{
@@ -349,6 +731,32 @@ namespace SIE
 						}
 					}
 				}
+				if (PushingCollapsingHeader("Shader Cache Statistics"))
+				{
+					SMainWindow::ShaderCacheStatistics();
+					ImGui::TreePop();
+				}
+
+				auto& frameRecorder = FrameRecorder::Instance();
+				bool recordFrames = frameRecorder.IsEnabled();
+				if (ImGui::Checkbox("Record Frame Capture", &recordFrames))
+				{
+					frameRecorder.SetEnabled(recordFrames);
+				}
+				if (!recordFrames)
+				{
+					int captureCapacity = static_cast<int>(frameRecorder.GetCapacity() >> 10);
+					if (ImGui::DragInt("Frame Capture Size (K records)", &captureCapacity, 1.f, 1,
+							65536))
+					{
+						frameRecorder.SetCapacity(static_cast<size_t>(std::max(captureCapacity, 1))
+												  << 10);
+					}
+				}
+				else if (frameRecorder.IsRecording())
+				{
+					ImGui::Text("Recording to %s", frameRecorder.GetPath().string().c_str());
+				}
 
 				auto& targetManager = TargetManager::Instance();
 				bool enableHighlight = targetManager.GetEnableTargetHighlight();
@@ -496,6 +904,11 @@ namespace SIE
 				SMainWindow::RenderPassStatistics();
 				ImGui::TreePop();
 			}
+			if (PushingCollapsingHeader("CPU Profiler"))
+			{
+				SMainWindow::CpuProfilerTimeline();
+				ImGui::TreePop();
+			}
 			ImGui::TreePop();
 		}
 
@@ -506,6 +919,16 @@ namespace SIE
 				auto& shaderCache = ShaderCache::Instance();
 				shaderCache.Clear();
 			}
+			if (ImGui::Button("Clear shader disk cache"))
+			{
+				auto& shaderCache = ShaderCache::Instance();
+				shaderCache.ClearDiskCache();
+			}
+			if (ImGui::Button("Clear shader trace"))
+			{
+				auto& shaderCache = ShaderCache::Instance();
+				shaderCache.ClearTrace();
+			}
 			if (ImGui::Button("Enable all"))
 			{
 				const auto tes = RE::TES::GetSingleton();
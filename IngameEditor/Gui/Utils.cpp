@@ -34,9 +34,16 @@ namespace SIE
 
 	bool FormEditor(RE::TESForm* form, bool isChanged)
 	{
-		if (isChanged && !(form->formFlags & RE::TESForm::RecordFlags::kTemporary))
+		if (!(form->formFlags & RE::TESForm::RecordFlags::kTemporary))
 		{
-			Serializer::Instance().EnqueueForm(*form);
+			// Editor of the form was drawn on earlier frames before any of its widgets could
+			// change it, so the first call captures the unedited form.
+			auto& serializer = Serializer::Instance();
+			serializer.CaptureBaseline(*form);
+			if (isChanged)
+			{
+				serializer.EnqueueForm(*form);
+			}
 		}
 		return isChanged;
 	}
@@ -1,6 +1,9 @@
 #include "Hooks.h"
 
+#include "Core/CpuProfiler.h"
+#include "Core/FrameRecorder.h"
 #include "Core/ShaderCache.h"
+#include "Core/VanillaShaderIndex.h"
 #include "Serialization/Serializer.h"
 #include "Utils/Hooking.h"
 #include "Utils/TargetManager.h"
@@ -80,16 +83,35 @@
 
 namespace FrameAnnotations
 {
+	// Queried once per device context instead of on every marker.
+	static ID3DUserDefinedAnnotation* GetAnnotation()
+	{
+		static decltype(RE::BSGraphics::Renderer::GetDeviceContext()) annotatedContext = nullptr;
+		static Microsoft::WRL::ComPtr<ID3DUserDefinedAnnotation> annotation;
+
+		const auto context = RE::BSGraphics::Renderer::GetDeviceContext();
+		if (context != annotatedContext)
+		{
+			annotation.Reset();
+			annotatedContext = context;
+			if (context != nullptr)
+			{
+				context->QueryInterface(
+					reinterpret_cast<const REX::W32::GUID&>(__uuidof(ID3DUserDefinedAnnotation)),
+					reinterpret_cast<void**>(annotation.ReleaseAndGetAddressOf()));
+			}
+		}
+		return annotation.Get();
+	}
+
 	struct ScopedFrameEvent
 	{
-		ScopedFrameEvent(const std::string& eventName)
+		ScopedFrameEvent(const wchar_t* eventName) :
+			annotation(GetAnnotation())
 		{
-			HRESULT hr = RE::BSGraphics::Renderer::GetDeviceContext()->QueryInterface(
-				reinterpret_cast<const REX::W32::GUID&>(__uuidof(annotation)),
-				reinterpret_cast<void**>(&annotation));
-			if (!FAILED(hr))
+			if (annotation != nullptr)
 			{
-				annotation->BeginEvent(std::wstring(eventName.begin(), eventName.end()).c_str());
+				annotation->BeginEvent(eventName);
 			}
 		}
 
@@ -105,28 +127,140 @@ namespace FrameAnnotations
 		ID3DUserDefinedAnnotation* annotation = nullptr;
 	};
 
-	void BeginFrameEvent(const std::string& eventName)
+	// ASCII event name with a wide copy for annotations, built at compile time.
+	struct FrameEventName
 	{
-		ID3DUserDefinedAnnotation* annotation = nullptr;
-		HRESULT hr = RE::BSGraphics::Renderer::GetDeviceContext()->QueryInterface(
-			reinterpret_cast<const REX::W32::GUID&>(__uuidof(annotation)),
-			reinterpret_cast<void**>(&annotation));
-		if (!FAILED(hr))
+		static constexpr size_t MaxSize = 64;
+
+		template <size_t Size>
+		constexpr FrameEventName(const char (&value)[Size]) :
+			FrameEventName({ std::string_view(value, Size - 1) })
+		{}
+
+		constexpr FrameEventName(std::initializer_list<std::string_view> parts)
+		{
+			for (const auto part : parts)
+			{
+				for (const char character : part)
+				{
+					if (size + 1 < MaxSize)
+					{
+						name[size] = character;
+						wideName[size] = static_cast<wchar_t>(character);
+						++size;
+					}
+				}
+			}
+		}
+
+		constexpr std::string_view GetView() const { return std::string_view(name, size); }
+
+		char name[MaxSize]{};
+		wchar_t wideName[MaxSize]{};
+		size_t size = 0;
+	};
+
+	constexpr size_t GetDigitCount(size_t value)
+	{
+		size_t count = 1;
+		for (; value >= 10; value /= 10)
+		{
+			++count;
+		}
+		return count;
+	}
+
+	template <size_t Value>
+	constexpr auto IndexDigits = [] {
+		std::array<char, GetDigitCount(Value)> result{};
+		size_t value = Value;
+		for (size_t index = result.size(); index-- > 0; value /= 10)
+		{
+			result[index] = static_cast<char>('0' + value % 10);
+		}
+		return result;
+	}();
+
+	template <size_t Value>
+	constexpr std::string_view IndexName(IndexDigits<Value>.data(), IndexDigits<Value>.size());
+
+	// Annotated events of the current thread, one bit per nesting level, so that a capture
+	// starting or stopping inside an event keeps markers balanced.
+	static thread_local uint64_t annotatedEvents = 0;
+	static thread_local uint32_t eventDepth = 0;
+
+	static SIE::CpuProfiler::NameId InternEventName(std::string_view name)
+	{
+		return SIE::CpuProfiler::Instance().InternName(name);
+	}
+
+	template <FrameEventName Name>
+	SIE::CpuProfiler::NameId GetEventNameId()
+	{
+		static const auto nameId = InternEventName(Name.GetView());
+		return nameId;
+	}
+
+	// Marker name is either a wide constant or a callable formatting it, which is only called
+	// while a graphics debugger captures.
+	template <typename MarkerName>
+	void BeginFrameEvent(SIE::CpuProfiler::NameId eventName, MarkerName&& markerName)
+	{
+		SIE::CpuProfiler::Instance().BeginScope(eventName);
+
+		bool isAnnotated = false;
+		auto annotation = GetAnnotation();
+		if (annotation != nullptr && annotation->GetStatus() != 0)
+		{
+			if constexpr (std::is_invocable_v<MarkerName>)
+			{
+				const std::string name = markerName();
+				annotation->BeginEvent(std::wstring(name.begin(), name.end()).c_str());
+			}
+			else
+			{
+				annotation->BeginEvent(markerName);
+			}
+			isAnnotated = true;
+		}
+
+		if (eventDepth < 64)
 		{
-			annotation->BeginEvent(std::wstring(eventName.begin(), eventName.end()).c_str());
+			annotatedEvents = (annotatedEvents & ~(1ull << eventDepth)) |
+			                  (static_cast<uint64_t>(isAnnotated) << eventDepth);
 		}
+		++eventDepth;
+	}
+
+	template <FrameEventName Name>
+	void BeginFrameEvent()
+	{
+		BeginFrameEvent(GetEventNameId<Name>(), Name.wideName);
+	}
+
+	template <FrameEventName Name, typename MarkerNameFunc>
+	void BeginFrameEvent(MarkerNameFunc&& markerNameFunc)
+	{
+		BeginFrameEvent(GetEventNameId<Name>(), std::forward<MarkerNameFunc>(markerNameFunc));
 	}
 
 	void EndFrameEvent()
 	{
-		ID3DUserDefinedAnnotation* annotation = nullptr;
-		HRESULT hr = RE::BSGraphics::Renderer::GetDeviceContext()->QueryInterface(
-			reinterpret_cast<const REX::W32::GUID&>(__uuidof(annotation)),
-			reinterpret_cast<void**>(&annotation));
-		if (!FAILED(hr))
+		if (eventDepth == 0)
+		{
+			return;
+		}
+		--eventDepth;
+
+		if (eventDepth < 64 && (annotatedEvents & (1ull << eventDepth)) != 0)
 		{
-			annotation->EndEvent();
+			if (auto annotation = GetAnnotation())
+			{
+				annotation->EndEvent();
+			}
 		}
+
+		SIE::CpuProfiler::Instance().EndScope();
 	}
 
 	template<RE::BSShader::Type ShaderType>
@@ -134,9 +268,13 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShader* shader, RE::BSRenderPass* pass, uint32_t renderFlags)
 		{
-			const std::string passName = std::format("[{}:{:x}] <{}> {}", magic_enum::enum_name(ShaderType), pass->passEnum,
-					pass->accumulationHint.underlying(), pass->geometry->name.c_str());
-			BeginFrameEvent(passName);
+			static constexpr FrameEventName EventName = { magic_enum::enum_name<ShaderType>(),
+				" Geometry" };
+			BeginFrameEvent<EventName>([pass] {
+				return std::format("[{}:{:x}] <{}> {}", magic_enum::enum_name(ShaderType),
+					pass->passEnum, pass->accumulationHint.underlying(), pass->geometry->name.c_str());
+			});
+			SIE::FrameRecorder::Instance().BeginDraw();
 
 			func(shader, pass, renderFlags);
 		}
@@ -152,6 +290,7 @@ namespace FrameAnnotations
 		{
 			func(shader, pass, renderFlags);
 
+			SIE::FrameRecorder::Instance().EndDraw(ShaderType, pass->passEnum, renderFlags);
 			EndFrameEvent();
 		}
 
@@ -185,10 +324,17 @@ namespace FrameAnnotations
 		{
 			if (OriginalRenderer != nullptr)
 			{
-				BeginFrameEvent(std::format("Render Pass {} <{}>", RendererIndex, renderFlags));
+				static constexpr FrameEventName EventName = { "Render Pass ",
+					IndexName<RendererIndex> };
+				BeginFrameEvent<EventName>([renderFlags] {
+					return std::format("Render Pass {} <{}>", RendererIndex, renderFlags);
+				});
+				SIE::FrameRecorder::Instance().BeginScope();
 
 				OriginalRenderer(shaderAccumulator, renderFlags);
 
+				SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::Renderer,
+					RendererIndex, renderFlags);
 				EndFrameEvent();
 			}
 		}
@@ -198,8 +344,10 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* renderer, uint32_t firstPass, uint32_t lastPass, uint32_t renderFlags)
 		{
-			BeginFrameEvent(
-				std::format("BSBatchRenderer::Unk03 ({},{}) <{}>", firstPass, lastPass, renderFlags));
+			BeginFrameEvent<"BSBatchRenderer::Unk03">([=] {
+				return std::format("BSBatchRenderer::Unk03 ({},{}) <{}>", firstPass, lastPass,
+					renderFlags);
+			});
 
 			func(renderer, firstPass, lastPass, renderFlags);
 
@@ -216,12 +364,20 @@ namespace FrameAnnotations
 			void* passIndexList,
 			uint32_t renderFlags)
 		{
-			BeginFrameEvent(std::format("BSBatchRenderer::RenderBatches ({})[{}] <{}>", *currentPass, *bucketIndex,
-				renderFlags));
+			BeginFrameEvent<"BSBatchRenderer::RenderBatches">([=] {
+				return std::format("BSBatchRenderer::RenderBatches ({})[{}] <{}>", *currentPass,
+					*bucketIndex, renderFlags);
+			});
+			auto& frameRecorder = SIE::FrameRecorder::Instance();
+			const uint32_t startBucketIndex = *bucketIndex;
+			frameRecorder.SetBucket(startBucketIndex);
+			frameRecorder.BeginScope();
 
 			const bool result =
 				func(renderer, currentPass, bucketIndex, passIndexList, renderFlags);
 
+			frameRecorder.EndScope(SIE::FrameCaptureScope::RenderBatches, startBucketIndex,
+				renderFlags);
 			EndFrameEvent();
 
 			return result;
@@ -234,11 +390,16 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShaderAccumulator* shaderAccumulator, uint32_t renderFlags)
 		{
-			BeginFrameEvent(std::format("BSShaderAccumulator::FinishAccumulatingDispatch [{}] <{}>",
-				static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags));
+			BeginFrameEvent<"BSShaderAccumulator::FinishAccumulatingDispatch">([=] {
+				return std::format("BSShaderAccumulator::FinishAccumulatingDispatch [{}] <{}>",
+					static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags);
+			});
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(shaderAccumulator, renderFlags);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::FinishAccumulatingDispatch,
+				static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags);
 			EndFrameEvent();
 		}
 
@@ -250,11 +411,16 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShaderAccumulator* shaderAccumulator, uint32_t renderFlags)
 		{
-			BeginFrameEvent(std::format("BSShaderAccumulator::Unk2B [{}] <{}>",
-				static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags));
+			BeginFrameEvent<"BSShaderAccumulator::Unk2B">([=] {
+				return std::format("BSShaderAccumulator::Unk2B [{}] <{}>",
+					static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags);
+			});
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(shaderAccumulator, renderFlags);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::AccumulatorUnk2B,
+				static_cast<uint32_t>(shaderAccumulator->renderMode), renderFlags);
 			EndFrameEvent();
 		}
 
@@ -266,7 +432,7 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::NiAVObject* camera, int a2, bool a3, bool a4, bool a5)
 		{
-			BeginFrameEvent("Cubemap");
+			BeginFrameEvent<"Cubemap">();
 
 			func(camera, a2, a3, a4, a5);
 
@@ -282,7 +448,8 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* imageSpaceShader, RE::BSTriShape* shape, RE::ImageSpaceEffectParam* param)
 		{
-			BeginFrameEvent(std::format("{}", magic_enum::enum_name(EffectType)));
+			static constexpr FrameEventName EventName = { magic_enum::enum_name<EffectType>() };
+			BeginFrameEvent<EventName>();
 
 			func(imageSpaceShader, shape, param);
 
@@ -297,7 +464,7 @@ namespace FrameAnnotations
 	{
 		static bool thunk(void* waterReflections)
 		{
-			BeginFrameEvent("Water Reflections");
+			BeginFrameEvent<"Water Reflections">();
 
 			const bool result = func(waterReflections);
 
@@ -313,7 +480,7 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShadowLight* light, void* a2)
 		{
-			BeginFrameEvent("Directional Light Shadowmaps");
+			BeginFrameEvent<"Directional Light Shadowmaps">();
 
 			func(light, a2);
 
@@ -328,7 +495,7 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShadowLight* light, void* a2)
 		{
-			BeginFrameEvent("Spot Light Shadowmaps");
+			BeginFrameEvent<"Spot Light Shadowmaps">();
 
 			func(light, a2);
 
@@ -343,7 +510,7 @@ namespace FrameAnnotations
 	{
 		static void thunk(RE::BSShadowLight* light, void* a2)
 		{
-			BeginFrameEvent("Omnidirectional Light Shadowmaps");
+			BeginFrameEvent<"Omnidirectional Light Shadowmaps">();
 
 			func(light, a2);
 
@@ -358,10 +525,12 @@ namespace FrameAnnotations
 	{
 		static void thunk(bool a1, bool a2)
 		{
-			BeginFrameEvent("Depth");
+			BeginFrameEvent<"Depth">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(a1, a2);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::Depth);
 			EndFrameEvent();
 		}
 
@@ -372,10 +541,12 @@ namespace FrameAnnotations
 	{
 		static void thunk(bool a1)
 		{
-			BeginFrameEvent("Shadowmasks");
+			BeginFrameEvent<"Shadowmasks">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(a1);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::Shadowmasks);
 			EndFrameEvent();
 		}
 
@@ -386,10 +557,12 @@ namespace FrameAnnotations
 	{
 		static void thunk(bool a1)
 		{
-			BeginFrameEvent("World");
+			BeginFrameEvent<"World">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(a1);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::World);
 			EndFrameEvent();
 		}
 
@@ -400,10 +573,12 @@ namespace FrameAnnotations
 	{
 		static void thunk(bool a1, bool a2)
 		{
-			BeginFrameEvent("First Person View");
+			BeginFrameEvent<"First Person View">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(a1, a2);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::FirstPersonView);
 			EndFrameEvent();
 		}
 
@@ -414,10 +589,12 @@ namespace FrameAnnotations
 	{
 		static void thunk()
 		{
-			BeginFrameEvent("Water Effects");
+			BeginFrameEvent<"Water Effects">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func();
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::WaterEffects);
 			EndFrameEvent();
 		}
 
@@ -428,10 +605,12 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* a1, bool a2, bool a3)
 		{
-			BeginFrameEvent("Player View");
+			BeginFrameEvent<"Player View">();
+			SIE::FrameRecorder::Instance().BeginScope();
 
 			func(a1, a2, a3);
 
+			SIE::FrameRecorder::Instance().EndScope(SIE::FrameCaptureScope::PlayerView);
 			EndFrameEvent();
 		}
 
@@ -453,7 +632,8 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* shaderAccumulator, uint32_t firstPass, uint32_t lastPass, uint32_t renderFlags, int groupIndex)
 		{
-			BeginFrameEvent(magic_enum::enum_name(Pass).data());
+			static constexpr FrameEventName EventName = { magic_enum::enum_name<Pass>() };
+			BeginFrameEvent<EventName>();
 
 			func(shaderAccumulator, firstPass, lastPass, renderFlags, groupIndex);
 
@@ -468,7 +648,9 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* group, uint32_t renderFlags)
 		{
-			BeginFrameEvent(std::format("Geometry Group {}", GroupIndex));
+			static constexpr FrameEventName EventName = { "Geometry Group ",
+				IndexName<GroupIndex> };
+			BeginFrameEvent<EventName>();
 
 			func(group, renderFlags);
 
@@ -484,7 +666,9 @@ namespace FrameAnnotations
 		static void thunk(void* shaderAccumulator, uint32_t firstPass, uint32_t lastPass,
 			uint32_t renderFlags, int groupIndex)
 		{
-			BeginFrameEvent(std::format("Geometry Group {}", GroupIndex));
+			static constexpr FrameEventName EventName = { "Geometry Group ",
+				IndexName<GroupIndex> };
+			BeginFrameEvent<EventName>();
 
 			func(shaderAccumulator, firstPass, lastPass, renderFlags, groupIndex);
 
@@ -499,7 +683,7 @@ namespace FrameAnnotations
 	{
 		static void thunk(void* shaderAccumulator, uint32_t renderFlags)
 		{
-			BeginFrameEvent("Effects");
+			BeginFrameEvent<"Effects">();
 
 			func(shaderAccumulator, renderFlags);
 
@@ -1053,53 +1237,51 @@ struct BSShader_BeginTechnique
 		static REL::Relocation<void(void*, RE::BSGraphics::PixelShader*)> SetPixelShader(
 			RELOCATION_ID(75555, 77356));
 
+		const uint64_t startTimestamp = SIE::ShaderCache::GetTimestamp();
+		SIE::FrameRecorder::Instance().SetTechnique(vertexDescriptor, pixelDescriptor);
 		auto& shaderCache = SIE::ShaderCache::Instance();
 		RE::BSGraphics::VertexShader* vertexShader = nullptr;
-		if (shaderCache.IsEnabledForClass(SIE::ShaderClass::Vertex))
+		RE::BSGraphics::PixelShader* pixelShader = nullptr;
+		const bool useCustomVertexShader = shaderCache.IsEnabledForClass(SIE::ShaderClass::Vertex);
+		const bool useCustomPixelShader = shaderCache.IsEnabledForClass(SIE::ShaderClass::Pixel);
+		if (useCustomVertexShader && useCustomPixelShader)
+		{
+			std::tie(vertexShader, pixelShader) =
+				shaderCache.GetTechnique(*shader, vertexDescriptor, pixelDescriptor);
+		}
+		else if (useCustomVertexShader)
 		{
 			vertexShader = shaderCache.GetVertexShader(*shader, vertexDescriptor);
 		}
-		if (vertexShader == nullptr)
+		else if (useCustomPixelShader)
 		{
-			for (auto item : shader->vertexShaders)
-			{
-				if (item->id == vertexDescriptor)
-				{
-					vertexShader = item;
-					break;
-				}
-			}
+			pixelShader = shaderCache.GetPixelShader(*shader, pixelDescriptor);
 		}
-		else
+		auto path = SIE::TechniquePath::Vanilla;
+		if (useCustomVertexShader || useCustomPixelShader)
 		{
-			for (auto item : shader->vertexShaders)
-			{
-				if (item->id == vertexDescriptor)
-				{
-					if (vertexShader->shaderDesc != item->shaderDesc)
-					{
-						logger::info("{} {}", vertexShader->shaderDesc, item->shaderDesc);
-					}
-					break;
-				}
-			}
+			const bool isHit = (!useCustomVertexShader || vertexShader != nullptr) &&
+			                   (!useCustomPixelShader || pixelShader != nullptr);
+			path = isHit ? SIE::TechniquePath::Hit : SIE::TechniquePath::Miss;
 		}
-		RE::BSGraphics::PixelShader* pixelShader = nullptr;
-		if (shaderCache.IsEnabledForClass(SIE::ShaderClass::Pixel))
+		auto& vanillaShaders = SIE::VanillaShaderIndex::Instance();
+		if (vertexShader == nullptr)
 		{
-			pixelShader = shaderCache.GetPixelShader(*shader, pixelDescriptor);
+			vertexShader = vanillaShaders.GetVertexShader(*shader, vertexDescriptor);
 		}
-		if (pixelShader == nullptr)
+		else if (const auto vanillaVertexShader =
+					 vanillaShaders.GetVertexShader(*shader, vertexDescriptor))
 		{
-			for (auto item : shader->pixelShaders)
+			if (vertexShader->shaderDesc != vanillaVertexShader->shaderDesc)
 			{
-				if (item->id == pixelDescriptor)
-				{
-					pixelShader = item;
-					break;
-				}
+				logger::info("{} {}", vertexShader->shaderDesc, vanillaVertexShader->shaderDesc);
 			}
 		}
+		if (pixelShader == nullptr)
+		{
+			pixelShader = vanillaShaders.GetPixelShader(*shader, pixelDescriptor);
+		}
+		shaderCache.RecordTechnique(path, startTimestamp);
 		if (vertexShader == nullptr || pixelShader == nullptr)
 		{
 			return false;
@@ -1385,7 +1567,12 @@ struct WinMain_OnQuitGame
 {
 	static void thunk()
 	{
-		SIE::Serializer::Instance().OnQuitGame();
+		// The game may terminate the process before returning, so the autosave has to be written
+		// first.
+		if (const auto exportJob = SIE::Serializer::Instance().OnQuitGame())
+		{
+			exportJob->Wait();
+		}
 
 		func();
 	}
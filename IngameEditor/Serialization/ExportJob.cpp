@@ -0,0 +1,153 @@
+#include "Serialization/ExportJob.h"
+
+#include <array>
+#include <string_view>
+
+namespace SIE
+{
+	namespace SExportJob
+	{
+		bool IsFinalPhase(ExportPhase phase)
+		{
+			return phase == ExportPhase::Completed || phase == ExportPhase::Failed ||
+			       phase == ExportPhase::Cancelled;
+		}
+
+		// Generator finds the cell of a placed reference by this member.
+		constexpr std::array<std::string_view, 1> AlwaysExportedMembers = { "Cell" };
+
+		// Objects are compared member by member, generator populates the record it overrides
+		// with the result so that the other members keep their values. Anything else is
+		// exported whole when it changed.
+		std::optional<nlohmann::json> Diff(const nlohmann::json& baseline,
+			const nlohmann::json& value)
+		{
+			if (!baseline.is_object() || !value.is_object())
+			{
+				if (baseline == value)
+				{
+					return std::nullopt;
+				}
+				return value;
+			}
+
+			nlohmann::json result = nlohmann::json::object();
+			for (const auto& [key, member] : value.items())
+			{
+				const auto baselineMember = baseline.find(key);
+				if (baselineMember == baseline.end())
+				{
+					result[key] = member;
+				}
+				else if (auto memberDiff = Diff(*baselineMember, member))
+				{
+					result[key] = std::move(*memberDiff);
+				}
+			}
+			if (result.empty())
+			{
+				return std::nullopt;
+			}
+			return result;
+		}
+	}
+
+	std::optional<nlohmann::json> ExportRecord::ToJson() const
+	{
+		nlohmann::json form = nlohmann::json::object();
+		if (sections.size() == 1)
+		{
+			form = *sections.front();
+		}
+		else
+		{
+			for (const auto& section : sections)
+			{
+				form.update(*section);
+			}
+		}
+
+		if (baseline != nullptr)
+		{
+			auto formDiff = SExportJob::Diff(*baseline, form);
+			if (!formDiff.has_value())
+			{
+				return std::nullopt;
+			}
+			if (formDiff->is_object())
+			{
+				for (const auto member : SExportJob::AlwaysExportedMembers)
+				{
+					if (const auto it = form.find(member); it != form.end())
+					{
+						(*formDiff)[member] = *it;
+					}
+				}
+			}
+			form = std::move(*formDiff);
+		}
+
+		return nlohmann::json{ { "Master", masterFile }, { "Override", overrideFile },
+			{ "FormKey", formKey }, { "Form", std::move(form) }, { "References", *references } };
+	}
+
+	ExportJob::ExportJob(std::string aPath,
+		std::vector<std::shared_ptr<const ExportRecord>>&& aForms, bool aIsDebugDumpEnabled,
+		ProgressCallback&& aCallback)
+		: path(std::move(aPath))
+		, forms(std::move(aForms))
+		, isDebugDumpEnabled(aIsDebugDumpEnabled)
+		, callback(std::move(aCallback))
+	{
+		progress.formCount = forms.size();
+	}
+
+	const std::string& ExportJob::GetPath() const
+	{
+		return path;
+	}
+
+	ExportProgress ExportJob::GetProgress() const
+	{
+		std::lock_guard lock(mutex);
+		return progress;
+	}
+
+	bool ExportJob::IsDone() const
+	{
+		std::lock_guard lock(mutex);
+		return SExportJob::IsFinalPhase(progress.phase);
+	}
+
+	void ExportJob::Wait() const
+	{
+		std::unique_lock lock(mutex);
+		doneCondition.wait(lock, [this] { return SExportJob::IsFinalPhase(progress.phase); });
+	}
+
+	void ExportJob::Cancel()
+	{
+		isCancelRequested = true;
+	}
+
+	bool ExportJob::IsCancelRequested() const
+	{
+		return isCancelRequested;
+	}
+
+	void ExportJob::SetProgress(const ExportProgress& value)
+	{
+		{
+			std::lock_guard lock(mutex);
+			progress = value;
+		}
+		if (callback)
+		{
+			callback(value);
+		}
+		if (SExportJob::IsFinalPhase(value.phase))
+		{
+			doneCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace SIE
+{
+	enum class ExportPhase : uint8_t
+	{
+		Queued,
+		WritingRecords,
+		Generating,
+		Completed,
+		Failed,
+		Cancelled,
+	};
+
+	struct ExportProgress
+	{
+		ExportPhase phase = ExportPhase::Queued;
+		size_t formCount = 0;
+		size_t formsWritten = 0;
+		uint64_t bytesWritten = 0;
+	};
+
+	// Enqueued state of a form, parts that did not change between edits are shared with the
+	// previous state of the form.
+	struct ExportRecord
+	{
+		std::string masterFile;
+		std::string overrideFile;
+		std::string formKey;
+		// Members of the form json, merged in order.
+		std::vector<std::shared_ptr<const nlohmann::json>> sections;
+		std::shared_ptr<const std::unordered_set<std::string>> references;
+		// Form json before its first edit, only members that differ from it are exported.
+		std::shared_ptr<const nlohmann::json> baseline;
+
+		// Empty if the form does not differ from its baseline.
+		std::optional<nlohmann::json> ToJson() const;
+	};
+
+	// Handle of an export run by the serializer worker over a snapshot of the enqueued forms.
+	class ExportJob
+	{
+	public:
+		using ProgressCallback = std::function<void(const ExportProgress&)>;
+
+		const std::string& GetPath() const;
+		ExportProgress GetProgress() const;
+		bool IsDone() const;
+		void Wait() const;
+
+		// Takes effect between forms, a generator that has already started still writes its plugin.
+		void Cancel();
+		bool IsCancelRequested() const;
+
+	private:
+		friend class Serializer;
+
+		ExportJob(std::string aPath, std::vector<std::shared_ptr<const ExportRecord>>&& aForms,
+			bool aIsDebugDumpEnabled, ProgressCallback&& aCallback);
+
+		// Callback is invoked on the worker thread, outside of the lock.
+		void SetProgress(const ExportProgress& value);
+
+		std::string path;
+		std::vector<std::shared_ptr<const ExportRecord>> forms;
+		bool isDebugDumpEnabled = false;
+		ProgressCallback callback;
+
+		std::atomic<bool> isCancelRequested = false;
+		ExportProgress progress;
+		mutable std::condition_variable doneCondition;
+		mutable std::mutex mutex;
+	};
+}
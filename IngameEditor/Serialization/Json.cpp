@@ -21,6 +21,7 @@
 #include <RE/T/TESWaterForm.h>
 #include <RE/T/TESWeather.h>
 
+#include <array>
 #include <format>
 
 namespace RE
@@ -122,150 +123,298 @@ namespace RE
 		j = json{ { "Hdr", imageSpace.data.hdr }, { "Cinematic", imageSpace.data.cinematic },
 			{ "Tint", imageSpace.data.tint }, { "DepthOfField", imageSpace.data.depthOfField } };
 	}
+}
 
-	void to_json(json& j, const TESWeather& weather)
+namespace SIE
+{
+	namespace SJson
 	{
-		using enum TESWeather::ColorTime;
+		using json = nlohmann::json;
+
+		constexpr uint64_t HashSeed = 0xCBF29CE484222325ull;
+
+		uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+		{
+			const auto bytes = static_cast<const uint8_t*>(data);
+			for (size_t index = 0; index < size; ++index)
+			{
+				hash = (hash ^ bytes[index]) * 0x100000001B3ull;
+			}
+			return hash;
+		}
+
+		template <typename... Args>
+		uint64_t HashValues(uint64_t hash, const Args&... values)
+		{
+			((hash = HashBytes(hash, &values, sizeof(values))), ...);
+			return hash;
+		}
+
+		uint64_t HashString(uint64_t hash, const char* text)
+		{
+			const std::string_view view = text != nullptr ? text : "";
+			return HashBytes(HashValues(hash, view.size()), view.data(), view.size());
+		}
 
-		constexpr auto saveColorData = [](const auto& colors)
+		const RE::TESWeather& AsWeather(const RE::TESForm& form)
 		{
-		    using enum TESWeather::ColorTime; 
+			return static_cast<const RE::TESWeather&>(form);
+		}
+
+		template <typename Colors>
+		json SaveWeatherColorData(const Colors& colors)
+		{
+			using enum RE::TESWeather::ColorTime;
 			return json{ { "Sunrise", colors[kSunrise] }, { "Day", colors[kDay] },
 				{ "Sunset", colors[kSunset] }, { "Night", colors[kNight] } };
-		};
+		}
 
-		constexpr auto saveImageSpaces = [](const auto& imageSpaces)
+		uint64_t FingerprintWeatherFog(const RE::TESForm& form)
 		{
-		    using enum TESWeather::ColorTime;
-			return json{ { "Sunrise", SIE::ToFormKey(imageSpaces[kSunrise]) },
-				{ "Day", SIE::ToFormKey(imageSpaces[kDay]) },
-				{ "Sunset", SIE::ToFormKey(imageSpaces[kSunset]) },
-				{ "Night", SIE::ToFormKey(imageSpaces[kNight]) } };
-		};
+			return HashValues(HashSeed, AsWeather(form).fogData);
+		}
+
+		void WriteWeatherFog(json& j, const RE::TESForm& form)
+		{
+			const auto& weather = AsWeather(form);
+			j.update(json{ { "FogDistanceDayNear", weather.fogData.dayNear },
+				{ "FogDistanceDayFar", weather.fogData.dayFar },
+				{ "FogDistanceDayMax", weather.fogData.dayMax },
+				{ "FogDistanceDayPower", weather.fogData.dayPower },
+				{ "FogDistanceNightNear", weather.fogData.nightNear },
+				{ "FogDistanceNightFar", weather.fogData.nightFar },
+				{ "FogDistanceNightMax", weather.fogData.nightMax },
+				{ "FogDistanceNightPower", weather.fogData.nightPower } });
+		}
+
+		uint64_t FingerprintWeatherAmbientColors(const RE::TESForm& form)
+		{
+			return HashValues(HashSeed, AsWeather(form).directionalAmbientLightingColors);
+		}
+
+		void WriteWeatherAmbientColors(json& j, const RE::TESForm& form)
+		{
+			using enum RE::TESWeather::ColorTime;
+
+			const auto& weather = AsWeather(form);
+			j["DirectionalAmbientLightingColors"] = {
+				{ "Sunrise", weather.directionalAmbientLightingColors[kSunrise] },
+				{ "Day", weather.directionalAmbientLightingColors[kDay] },
+				{ "Sunset", weather.directionalAmbientLightingColors[kSunset] },
+				{ "Night", weather.directionalAmbientLightingColors[kNight] }
+			};
+		}
+
+		uint64_t FingerprintWeatherColors(const RE::TESForm& form)
+		{
+			return HashValues(HashSeed, AsWeather(form).colorData);
+		}
+
+		void WriteWeatherColors(json& j, const RE::TESForm& form)
+		{
+			using RE::TESWeather;
+
+			const auto& weather = AsWeather(form);
+			j.update(json{ { "SkyUpperColor",
+							   SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSkyUpper]) },
+				{ "FogNearColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kFogNear]) },
+				{ "CloudLayerColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kUnknown]) },
+				{ "AmbientColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kAmbient]) },
+				{ "SunlightColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSunlight]) },
+				{ "SunColor", SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSun]) },
+				{ "StarsColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kStars]) },
+				{ "SkyLowerColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSkyLower]) },
+				{ "HorizonColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kHorizon]) },
+				{ "EffectLightingColor",
+					SaveWeatherColorData(
+						weather.colorData[TESWeather::ColorTypes::kEffectLighting]) },
+				{ "CloudLodDiffuseColor",
+					SaveWeatherColorData(
+						weather.colorData[TESWeather::ColorTypes::kCloudLODDiffuse]) },
+				{ "CloudLodAmbientColor",
+					SaveWeatherColorData(
+						weather.colorData[TESWeather::ColorTypes::kCloudLODAmbient]) },
+				{ "FogFarColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kFogFar]) },
+				{ "SkyStaticsColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSkyStatics]) },
+				{ "WaterMultiplierColor",
+					SaveWeatherColorData(
+						weather.colorData[TESWeather::ColorTypes::kWaterMultiplier]) },
+				{ "SunGlareColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kSunGlare]) },
+				{ "MoonGlareColor",
+					SaveWeatherColorData(weather.colorData[TESWeather::ColorTypes::kMoonGlare]) } });
+		}
+
+		uint64_t FingerprintWeatherData(const RE::TESForm& form)
+		{
+			return HashValues(HashSeed, AsWeather(form).data);
+		}
+
+		void WriteWeatherData(json& j, const RE::TESForm& form)
+		{
+			const auto& weather = AsWeather(form);
+			j.update(json{ { "WindSpeed", weather.data.windSpeed / 255.f },
+				{ "TransDelta", weather.data.transDelta * 4.f },
+				{ "SunGlare", weather.data.sunGlare / 255.f },
+				{ "SunDamage", weather.data.sunDamage / 255.f },
+				{ "WindDirection", weather.data.windDirection / 360.f },
+				{ "WindDirectionRange", weather.data.windDirectionRange / 180.f },
+				{ "PrecipitationBeginFadeIn", weather.data.precipitationBeginFadeIn / 255.f },
+				{ "PrecipitationEndFadeOut", weather.data.precipitationEndFadeOut / 255.f },
+				{ "ThunderLightningBeginFadeIn", weather.data.thunderLightningBeginFadeIn / 255.f },
+				{ "ThunderLightningEndFadeOut", weather.data.thunderLightningEndFadeOut / 255.f },
+				{ "ThunderLightningFrequency", weather.data.thunderLightningFrequency / 255.f },
+				{ "LightningColor",
+					std::format("255, {}, {}, {}", weather.data.lightningColor.red,
+						weather.data.lightningColor.green, weather.data.lightningColor.blue) },
+				{ "Flags", weather.data.flags.underlying() },
+				{ "VisualEffectBegin", weather.data.visualEffectBegin },
+				{ "VisualEffectEnd", weather.data.visualEffectEnd } });
+		}
 
-		constexpr auto saveCloudTextures = [](const auto& cloudTextures)
+		uint64_t FingerprintWeatherClouds(const RE::TESForm& form)
 		{
-			json j;
-			for (const auto& texture : cloudTextures)
+			const auto& weather = AsWeather(form);
+			uint64_t hash = HashValues(HashSeed, weather.cloudLayerDisabledBits,
+				weather.cloudLayerSpeedX, weather.cloudLayerSpeedY, weather.cloudColorData,
+				weather.cloudAlpha);
+			for (const auto& texture : weather.cloudTextures)
+			{
+				hash = HashString(hash, texture.textureName.c_str());
+			}
+			return hash;
+		}
+
+		void WriteWeatherClouds(json& j, const RE::TESForm& form)
+		{
+			using enum RE::TESWeather::ColorTime;
+
+			const auto& weather = AsWeather(form);
+
+			json cloudTextures;
+			for (const auto& texture : weather.cloudTextures)
 			{
 				if (texture.textureName.empty())
 				{
-					j.push_back(nullptr);
+					cloudTextures.push_back(nullptr);
 				}
 				else
 				{
-					j.push_back(texture.textureName.c_str());
+					cloudTextures.push_back(texture.textureName.c_str());
 				}
 			}
-			return j;
-		};
 
-		auto saveClouds = [&weather, &saveColorData]()
-		{
-			json j;
+			json clouds;
 			for (size_t layerIndex = 0; layerIndex < RE::TESWeather::kTotalLayers; ++layerIndex)
 			{
-				j.push_back({ { "Enabled", !((weather.cloudLayerDisabledBits >> layerIndex) & 1) },
+				clouds.push_back({ { "Enabled", !((weather.cloudLayerDisabledBits >> layerIndex) & 1) },
 					{ "XSpeed", weather.cloudLayerSpeedX[layerIndex] / 1270.f - 0.1f },
 					{ "YSpeed", weather.cloudLayerSpeedY[layerIndex] / 1270.f - 0.1f },
-					{ "Colors", saveColorData(weather.cloudColorData[layerIndex]) },
+					{ "Colors", SaveWeatherColorData(weather.cloudColorData[layerIndex]) },
 					{ "Alphas", { { "Sunrise", weather.cloudAlpha[layerIndex][kSunrise] },
 									{ "Day", weather.cloudAlpha[layerIndex][kDay] },
 									{ "Sunset", weather.cloudAlpha[layerIndex][kSunset] },
 									{ "Night", weather.cloudAlpha[layerIndex][kNight] } } } });
-			};
-			return j;
-		};
+			}
+
+			j["CloudTextures"] = std::move(cloudTextures);
+			j["Clouds"] = std::move(clouds);
+		}
 
-		auto saveSkyStatics = [&weather]()
+		uint64_t FingerprintWeatherLinks(const RE::TESForm& form)
 		{
-			json j = json::array();
-			for (const auto& item : weather.skyStatics) { j.push_back(SIE::ToFormKey(item)); }
-			return j;
-		};
+			const auto& weather = AsWeather(form);
+			uint64_t hash = HashValues(HashSeed, weather.precipitationData, weather.imageSpaces,
+				weather.referenceEffect, weather.volumetricLighting);
+			hash = HashString(hash, weather.aurora.model.c_str());
+			for (const auto item : weather.skyStatics)
+			{
+				hash = HashValues(hash, item);
+			}
+			for (const auto item : weather.sounds)
+			{
+				hash = HashValues(hash, item->soundFormID, item->type);
+			}
+			return hash;
+		}
 
-		auto saveSounds = [&weather]()
+		void WriteWeatherLinks(json& j, const RE::TESForm& form)
 		{
-			json j = json::array();
+			using enum RE::TESWeather::ColorTime;
+
+			const auto& weather = AsWeather(form);
+
+			json skyStatics = json::array();
+			for (const auto& item : weather.skyStatics)
+			{
+				skyStatics.push_back(ToFormKey(item));
+			}
+
+			json sounds = json::array();
 			for (const auto& item : weather.sounds)
 			{
-				j.push_back({ { "Sound", SIE::ToFormKey(TESForm::LookupByID<BGSSoundDescriptorForm>(
+				sounds.push_back(
+					{ { "Sound", ToFormKey(RE::TESForm::LookupByID<RE::BGSSoundDescriptorForm>(
 									 item->soundFormID)) },
 						{ "Type", item->type.underlying() } });
 			}
-			return j;
-		};
 
-		j = json{ { "FogDistanceDayNear", weather.fogData.dayNear },
-			{ "FogDistanceDayFar", weather.fogData.dayFar },
-			{ "FogDistanceDayMax", weather.fogData.dayMax },
-			{ "FogDistanceDayPower", weather.fogData.dayPower },
-			{ "FogDistanceNightNear", weather.fogData.nightNear },
-			{ "FogDistanceNightFar", weather.fogData.nightFar },
-			{ "FogDistanceNightMax", weather.fogData.nightMax },
-			{ "FogDistanceNightPower", weather.fogData.nightPower },
-			{ "DirectionalAmbientLightingColors",
-				{ { "Sunrise", weather.directionalAmbientLightingColors[kSunrise] },
-					{ "Day", weather.directionalAmbientLightingColors[kDay] },
-					{ "Sunset", weather.directionalAmbientLightingColors[kSunset] },
-					{ "Night", weather.directionalAmbientLightingColors[kNight] } } },
-			{ "SkyUpperColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kSkyUpper]) },
-			{ "FogNearColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kFogNear]) },
-			{ "CloudLayerColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kUnknown]) },
-			{ "AmbientColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kAmbient]) },
-			{ "SunlightColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kSunlight]) },
-			{ "SunColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kSun]) },
-			{ "StarsColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kStars]) },
-			{ "SkyLowerColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kSkyLower]) },
-			{ "HorizonColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kHorizon]) },
-			{ "EffectLightingColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kEffectLighting]) },
-			{ "CloudLodDiffuseColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kCloudLODDiffuse]) },
-			{ "CloudLodAmbientColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kCloudLODAmbient]) },
-			{ "FogFarColor", saveColorData(weather.colorData[TESWeather::ColorTypes::kFogFar]) },
-			{ "SkyStaticsColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kSkyStatics]) },
-			{ "WaterMultiplierColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kWaterMultiplier]) },
-			{ "SunGlareColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kSunGlare]) },
-			{ "MoonGlareColor",
-				saveColorData(weather.colorData[TESWeather::ColorTypes::kMoonGlare]) },
-			{ "WindSpeed", weather.data.windSpeed / 255.f },
-			{ "TransDelta", weather.data.transDelta * 4.f },
-			{ "SunGlare", weather.data.sunGlare / 255.f },
-			{ "SunDamage", weather.data.sunDamage / 255.f },
-			{ "WindDirection", weather.data.windDirection / 360.f },
-			{ "WindDirectionRange", weather.data.windDirectionRange / 180.f },
-			{ "PrecipitationBeginFadeIn", weather.data.precipitationBeginFadeIn / 255.f },
-			{ "PrecipitationEndFadeOut", weather.data.precipitationEndFadeOut / 255.f },
-			{ "ThunderLightningBeginFadeIn", weather.data.thunderLightningBeginFadeIn / 255.f },
-			{ "ThunderLightningEndFadeOut", weather.data.thunderLightningEndFadeOut / 255.f },
-			{ "ThunderLightningFrequency", weather.data.thunderLightningFrequency / 255.f },
-			{ "LightningColor",
-				std::format("255, {}, {}, {}", weather.data.lightningColor.red,
-					weather.data.lightningColor.green,
-					weather.data.lightningColor.blue) },
-			{ "Flags", weather.data.flags.underlying() },
-			{ "VisualEffectBegin", weather.data.visualEffectBegin },
-			{ "VisualEffectEnd", weather.data.visualEffectEnd },
-			{ "Precipitation", SIE::ToFormKey(weather.precipitationData) },
-		    { "ImageSpaces", saveImageSpaces(weather.imageSpaces) },
-			{ "CloudTextures", saveCloudTextures(weather.cloudTextures) },
-			{ "Clouds", saveClouds() }, { "VisualEffect", SIE::ToFormKey(weather.referenceEffect) },
-			{ "Aurora", { { "File", weather.aurora.model.c_str() } } },
-			{ "SkyStatics", saveSkyStatics() }, { "Sounds", saveSounds() },
-			{ "VolumetricLighting",
-				{ { "Sunrise", SIE::ToFormKey(weather.volumetricLighting[kSunrise]) },
-					{ "Day", SIE::ToFormKey(weather.volumetricLighting[kDay]) },
-					{ "Sunset", SIE::ToFormKey(weather.volumetricLighting[kSunset]) },
-					{ "Night", SIE::ToFormKey(weather.volumetricLighting[kNight]) } } } };
+			j.update(json{ { "Precipitation", ToFormKey(weather.precipitationData) },
+				{ "ImageSpaces",
+					{ { "Sunrise", ToFormKey(weather.imageSpaces[kSunrise]) },
+						{ "Day", ToFormKey(weather.imageSpaces[kDay]) },
+						{ "Sunset", ToFormKey(weather.imageSpaces[kSunset]) },
+						{ "Night", ToFormKey(weather.imageSpaces[kNight]) } } },
+				{ "VisualEffect", ToFormKey(weather.referenceEffect) },
+				{ "Aurora", { { "File", weather.aurora.model.c_str() } } },
+				{ "SkyStatics", std::move(skyStatics) }, { "Sounds", std::move(sounds) },
+				{ "VolumetricLighting",
+					{ { "Sunrise", ToFormKey(weather.volumetricLighting[kSunrise]) },
+						{ "Day", ToFormKey(weather.volumetricLighting[kDay]) },
+						{ "Sunset", ToFormKey(weather.volumetricLighting[kSunset]) },
+						{ "Night", ToFormKey(weather.volumetricLighting[kNight]) } } } });
+		}
+
+		constexpr std::array<FormJsonSection, 6> WeatherSections = { {
+			{ FingerprintWeatherFog, WriteWeatherFog, false },
+			{ FingerprintWeatherAmbientColors, WriteWeatherAmbientColors, false },
+			{ FingerprintWeatherColors, WriteWeatherColors, false },
+			{ FingerprintWeatherData, WriteWeatherData, false },
+			{ FingerprintWeatherClouds, WriteWeatherClouds, false },
+			{ FingerprintWeatherLinks, WriteWeatherLinks, true },
+		} };
+	}
+
+	std::span<const FormJsonSection> GetFormJsonSections(RE::FormType formType)
+	{
+		if (formType == RE::FormType::Weather)
+		{
+			return SJson::WeatherSections;
+		}
+		return {};
+	}
+}
+
+namespace RE
+{
+	using namespace nlohmann;
+
+	void to_json(json& j, const TESWeather& weather)
+	{
+		j = json::object();
+		for (const auto& section : SIE::SJson::WeatherSections)
+		{
+			section.write(j, weather);
+		}
 	}
 
 	void to_json(json& j, const BGSVolumetricLighting& lighting)
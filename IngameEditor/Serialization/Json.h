@@ -1,10 +1,31 @@
 #pragma once
 
+#include <RE/F/FormTypes.h>
+
 #include <nlohmann/json.hpp>
 
+#include <span>
+
 namespace RE
 {
 	class TESForm;
 
 	void to_json(nlohmann::json& j, const TESForm& form);
 }
+
+namespace SIE
+{
+	// Part of the json of a form that only depends on the data its fingerprint is computed from,
+	// so that it is written again only when that data changes.
+	struct FormJsonSection
+	{
+		uint64_t (*fingerprint)(const RE::TESForm& form);
+		// Adds the members of the section to j.
+		void (*write)(nlohmann::json& j, const RE::TESForm& form);
+		// Form references need to be collected again when the section changes.
+		bool hasReferences;
+	};
+
+	// Empty for forms that are always written whole.
+	std::span<const FormJsonSection> GetFormJsonSections(RE::FormType formType);
+}
@@ -0,0 +1,587 @@
+#include "Serialization/RecordFormat.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace SIE
+{
+	namespace SRecordFormat
+	{
+		template <typename T>
+		T ReadUnaligned(const std::byte* data)
+		{
+			T value;
+			std::memcpy(&value, data, sizeof(T));
+			return value;
+		}
+
+		// Colors are written by to_json as "alpha, red, green, blue". Only strings that format
+		// back to themselves are stored as colors so that reading them back is lossless.
+		bool ParseColor(std::string_view text, RecordColor& color)
+		{
+			uint8_t components[4];
+			const char* current = text.data();
+			const char* end = text.data() + text.size();
+			for (size_t index = 0; index < 4; ++index)
+			{
+				if (index != 0)
+				{
+					if (end - current < 2 || current[0] != ',' || current[1] != ' ')
+					{
+						return false;
+					}
+					current += 2;
+				}
+				if (current == end || (current[0] == '0' && current + 1 != end && current[1] != ','))
+				{
+					return false;
+				}
+				const auto [next, errorCode] = std::from_chars(current, end, components[index]);
+				if (errorCode != std::errc())
+				{
+					return false;
+				}
+				current = next;
+			}
+			if (current != end)
+			{
+				return false;
+			}
+
+			color = { components[0], components[1], components[2], components[3] };
+			return true;
+		}
+
+		uint64_t GetFixedSize(RecordValueType type)
+		{
+			switch (type)
+			{
+			case RecordValueType::Null:
+			case RecordValueType::False:
+			case RecordValueType::True:
+				return 1;
+			case RecordValueType::Int32:
+			case RecordValueType::UInt32:
+			case RecordValueType::Float32:
+			case RecordValueType::Color:
+				return 1 + 4;
+			case RecordValueType::Int64:
+			case RecordValueType::UInt64:
+			case RecordValueType::Float64:
+				return 1 + 8;
+			default:
+				return 0;
+			}
+		}
+	}
+
+	RecordWriter::RecordWriter(std::ostream& aStream) :
+		stream(aStream)
+	{
+		const RecordFileHeader header;
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		bytesWritten = sizeof(header);
+	}
+
+	void RecordWriter::Write(const nlohmann::json& record)
+	{
+		buffer.clear();
+		WriteValue(record);
+
+		recordOffsets.push_back(bytesWritten);
+		stream.write(reinterpret_cast<const char*>(buffer.data()),
+			static_cast<std::streamsize>(buffer.size()));
+		bytesWritten += buffer.size();
+	}
+
+	bool RecordWriter::Finish()
+	{
+		RecordFileHeader header;
+		header.recordCount = static_cast<uint32_t>(recordOffsets.size());
+		header.keyCount = static_cast<uint32_t>(keys.size());
+
+		buffer.clear();
+		for (const auto& key : keys)
+		{
+			Append(static_cast<uint32_t>(key.size()));
+			const auto keyBytes = std::as_bytes(std::span(key));
+			buffer.insert(buffer.end(), keyBytes.begin(), keyBytes.end());
+		}
+		header.keyTableOffset = bytesWritten;
+		header.recordTableOffset = bytesWritten + buffer.size();
+		for (const uint64_t offset : recordOffsets)
+		{
+			Append(offset);
+		}
+		stream.write(reinterpret_cast<const char*>(buffer.data()),
+			static_cast<std::streamsize>(buffer.size()));
+		bytesWritten += buffer.size();
+
+		stream.seekp(0);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.seekp(0, std::ios::end);
+		stream.flush();
+		return stream.good();
+	}
+
+	size_t RecordWriter::GetRecordCount() const
+	{
+		return recordOffsets.size();
+	}
+
+	uint64_t RecordWriter::GetBytesWritten() const
+	{
+		return bytesWritten;
+	}
+
+	template <typename T>
+	void RecordWriter::Append(T value)
+	{
+		const size_t offset = buffer.size();
+		buffer.resize(offset + sizeof(T));
+		std::memcpy(buffer.data() + offset, &value, sizeof(T));
+	}
+
+	void RecordWriter::WriteValue(const nlohmann::json& value)
+	{
+		using value_t = nlohmann::json::value_t;
+
+		switch (value.type())
+		{
+		case value_t::boolean:
+			{
+				Append(value.get<bool>() ? RecordValueType::True : RecordValueType::False);
+				break;
+			}
+		case value_t::number_integer:
+			{
+				const auto number = value.get<int64_t>();
+				if (number >= INT32_MIN && number <= INT32_MAX)
+				{
+					Append(RecordValueType::Int32);
+					Append(static_cast<int32_t>(number));
+				}
+				else
+				{
+					Append(RecordValueType::Int64);
+					Append(number);
+				}
+				break;
+			}
+		case value_t::number_unsigned:
+			{
+				const auto number = value.get<uint64_t>();
+				if (number <= UINT32_MAX)
+				{
+					Append(RecordValueType::UInt32);
+					Append(static_cast<uint32_t>(number));
+				}
+				else
+				{
+					Append(RecordValueType::UInt64);
+					Append(number);
+				}
+				break;
+			}
+		case value_t::number_float:
+			{
+				// Most values come from floats, those are stored without widening.
+				const auto number = value.get<double>();
+				const auto narrowNumber = static_cast<float>(number);
+				if (static_cast<double>(narrowNumber) == number)
+				{
+					Append(RecordValueType::Float32);
+					Append(narrowNumber);
+				}
+				else
+				{
+					Append(RecordValueType::Float64);
+					Append(number);
+				}
+				break;
+			}
+		case value_t::string:
+			{
+				const auto& text = value.get_ref<const std::string&>();
+				RecordColor color;
+				if (SRecordFormat::ParseColor(text, color))
+				{
+					Append(RecordValueType::Color);
+					Append(color);
+				}
+				else
+				{
+					Append(RecordValueType::String);
+					Append(static_cast<uint32_t>(text.size()));
+					const auto textBytes = std::as_bytes(std::span(text));
+					buffer.insert(buffer.end(), textBytes.begin(), textBytes.end());
+				}
+				break;
+			}
+		case value_t::array:
+		case value_t::object:
+			{
+				const bool isObject = value.is_object();
+				Append(isObject ? RecordValueType::Object : RecordValueType::Array);
+				Append(static_cast<uint32_t>(value.size()));
+				const size_t payloadSizeOffset = buffer.size();
+				Append(uint32_t(0));
+
+				if (isObject)
+				{
+					for (const auto& [key, member] : value.items())
+					{
+						Append(GetKeyIndex(key));
+						WriteValue(member);
+					}
+				}
+				else
+				{
+					for (const auto& element : value)
+					{
+						WriteValue(element);
+					}
+				}
+
+				const auto payloadSize =
+					static_cast<uint32_t>(buffer.size() - payloadSizeOffset - sizeof(uint32_t));
+				std::memcpy(buffer.data() + payloadSizeOffset, &payloadSize, sizeof(payloadSize));
+				break;
+			}
+		default:
+			{
+				Append(RecordValueType::Null);
+				break;
+			}
+		}
+	}
+
+	uint32_t RecordWriter::GetKeyIndex(const std::string& key)
+	{
+		const auto [it, isInserted] =
+			keyIndices.try_emplace(key, static_cast<uint32_t>(keys.size()));
+		if (isInserted)
+		{
+			keys.push_back(key);
+		}
+		return it->second;
+	}
+
+	RecordValue::RecordValue(const RecordFile* aFile, const std::byte* aData,
+		const std::byte* aEnd) :
+		file(aFile),
+		data(aData != nullptr && aData < aEnd ? aData : nullptr), end(aEnd)
+	{}
+
+	template <typename T>
+	T RecordValue::Read(size_t offset) const
+	{
+		if (data == nullptr || static_cast<size_t>(end - data) < 1 + offset + sizeof(T))
+		{
+			return T{};
+		}
+		return SRecordFormat::ReadUnaligned<T>(data + 1 + offset);
+	}
+
+	RecordValueType RecordValue::GetType() const
+	{
+		if (data == nullptr)
+		{
+			return RecordValueType::Invalid;
+		}
+		const auto type = static_cast<RecordValueType>(*data);
+		return type < RecordValueType::Invalid ? type : RecordValueType::Invalid;
+	}
+
+	bool RecordValue::IsValid() const
+	{
+		return GetType() != RecordValueType::Invalid;
+	}
+
+	bool RecordValue::GetBool() const
+	{
+		return GetType() == RecordValueType::True;
+	}
+
+	int64_t RecordValue::GetInt() const
+	{
+		switch (GetType())
+		{
+		case RecordValueType::Int32:
+			return Read<int32_t>(0);
+		case RecordValueType::Int64:
+			return Read<int64_t>(0);
+		case RecordValueType::UInt32:
+			return Read<uint32_t>(0);
+		case RecordValueType::UInt64:
+			return static_cast<int64_t>(Read<uint64_t>(0));
+		default:
+			return 0;
+		}
+	}
+
+	uint64_t RecordValue::GetUInt() const
+	{
+		switch (GetType())
+		{
+		case RecordValueType::Int32:
+		case RecordValueType::Int64:
+			return static_cast<uint64_t>(GetInt());
+		case RecordValueType::UInt32:
+			return Read<uint32_t>(0);
+		case RecordValueType::UInt64:
+			return Read<uint64_t>(0);
+		default:
+			return 0;
+		}
+	}
+
+	double RecordValue::GetFloat() const
+	{
+		switch (GetType())
+		{
+		case RecordValueType::Float32:
+			return Read<float>(0);
+		case RecordValueType::Float64:
+			return Read<double>(0);
+		case RecordValueType::Int32:
+		case RecordValueType::Int64:
+			return static_cast<double>(GetInt());
+		case RecordValueType::UInt32:
+		case RecordValueType::UInt64:
+			return static_cast<double>(GetUInt());
+		default:
+			return 0.;
+		}
+	}
+
+	std::string_view RecordValue::GetString() const
+	{
+		if (GetType() != RecordValueType::String)
+		{
+			return {};
+		}
+		const uint32_t length = Read<uint32_t>(0);
+		if (static_cast<size_t>(end - data) < 1 + sizeof(uint32_t) + length)
+		{
+			return {};
+		}
+		return { reinterpret_cast<const char*>(data + 1 + sizeof(uint32_t)), length };
+	}
+
+	RecordColor RecordValue::GetColor() const
+	{
+		return GetType() == RecordValueType::Color ? Read<RecordColor>(0) : RecordColor{};
+	}
+
+	uint32_t RecordValue::GetSize() const
+	{
+		const auto type = GetType();
+		return type == RecordValueType::Array || type == RecordValueType::Object ?
+		           Read<uint32_t>(0) :
+		           0;
+	}
+
+	RecordValue RecordValue::GetElement(uint32_t index) const
+	{
+		if (GetType() != RecordValueType::Array)
+		{
+			return {};
+		}
+
+		RecordValue result;
+		uint32_t currentIndex = 0;
+		ForEachElement([&](const RecordValue& element) {
+			if (currentIndex++ == index)
+			{
+				result = element;
+			}
+		});
+		return result;
+	}
+
+	RecordValue RecordValue::GetMember(std::string_view key) const
+	{
+		if (GetType() != RecordValueType::Object)
+		{
+			return {};
+		}
+
+		RecordValue result;
+		ForEachMember([&](std::string_view memberKey, const RecordValue& member) {
+			if (!result.IsValid() && memberKey == key)
+			{
+				result = member;
+			}
+		});
+		return result;
+	}
+
+	const std::byte* RecordValue::GetPayload() const
+	{
+		const auto type = GetType();
+		if (type != RecordValueType::Array && type != RecordValueType::Object)
+		{
+			return nullptr;
+		}
+		const uint32_t payloadSize = Read<uint32_t>(sizeof(uint32_t));
+		const std::byte* payload = data + 1 + 2 * sizeof(uint32_t);
+		if (payload > end || static_cast<size_t>(end - payload) < payloadSize)
+		{
+			return nullptr;
+		}
+		return payload;
+	}
+
+	const std::byte* RecordValue::GetNext() const
+	{
+		const auto type = GetType();
+		uint64_t size = SRecordFormat::GetFixedSize(type);
+		if (type == RecordValueType::String)
+		{
+			size = 1 + sizeof(uint32_t) + static_cast<uint64_t>(Read<uint32_t>(0));
+		}
+		else if (type == RecordValueType::Array || type == RecordValueType::Object)
+		{
+			size = 1 + 2 * sizeof(uint32_t) + static_cast<uint64_t>(Read<uint32_t>(sizeof(uint32_t)));
+		}
+		if (size == 0 || static_cast<uint64_t>(end - data) < size)
+		{
+			return nullptr;
+		}
+		return data + size;
+	}
+
+	std::string_view RecordValue::GetKey(const std::byte* member) const
+	{
+		if (file == nullptr || end - member < static_cast<ptrdiff_t>(sizeof(uint32_t)))
+		{
+			return {};
+		}
+		return file->GetKey(SRecordFormat::ReadUnaligned<uint32_t>(member));
+	}
+
+	bool RecordFile::Open(std::span<const std::byte> aData)
+	{
+		data = {};
+		keys.clear();
+		recordTable = {};
+
+		RecordFileHeader header;
+		if (aData.size() < sizeof(header))
+		{
+			return false;
+		}
+		std::memcpy(&header, aData.data(), sizeof(header));
+		if (header.magic != RecordFileHeader::Magic || header.version != RecordFileHeader::Version ||
+			header.headerSize < sizeof(header) || header.keyTableOffset > header.recordTableOffset ||
+			header.recordTableOffset > aData.size() ||
+			(aData.size() - header.recordTableOffset) / sizeof(uint64_t) < header.recordCount)
+		{
+			return false;
+		}
+
+		const auto keyTable = aData.subspan(header.keyTableOffset,
+			header.recordTableOffset - header.keyTableOffset);
+		keys.reserve(header.keyCount);
+		size_t offset = 0;
+		for (uint32_t index = 0; index < header.keyCount; ++index)
+		{
+			if (keyTable.size() - offset < sizeof(uint32_t))
+			{
+				return false;
+			}
+			const auto length = SRecordFormat::ReadUnaligned<uint32_t>(keyTable.data() + offset);
+			offset += sizeof(uint32_t);
+			if (keyTable.size() - offset < length)
+			{
+				return false;
+			}
+			keys.emplace_back(reinterpret_cast<const char*>(keyTable.data() + offset), length);
+			offset += length;
+		}
+
+		data = aData;
+		recordTable = aData.subspan(header.recordTableOffset, header.recordCount * sizeof(uint64_t));
+		return true;
+	}
+
+	uint32_t RecordFile::GetRecordCount() const
+	{
+		return static_cast<uint32_t>(recordTable.size() / sizeof(uint64_t));
+	}
+
+	RecordValue RecordFile::GetRecord(uint32_t index) const
+	{
+		if (index >= GetRecordCount())
+		{
+			return {};
+		}
+		const auto offset =
+			SRecordFormat::ReadUnaligned<uint64_t>(recordTable.data() + index * sizeof(uint64_t));
+		if (offset >= data.size())
+		{
+			return {};
+		}
+		return RecordValue(this, data.data() + offset, data.data() + data.size());
+	}
+
+	std::string_view RecordFile::GetKey(uint32_t index) const
+	{
+		return index < keys.size() ? keys[index] : std::string_view();
+	}
+
+	nlohmann::json ToJson(const RecordValue& value)
+	{
+		switch (value.GetType())
+		{
+		case RecordValueType::False:
+		case RecordValueType::True:
+			return value.GetBool();
+		case RecordValueType::Int32:
+		case RecordValueType::Int64:
+			return value.GetInt();
+		case RecordValueType::UInt32:
+		case RecordValueType::UInt64:
+			return value.GetUInt();
+		case RecordValueType::Float32:
+		case RecordValueType::Float64:
+			return value.GetFloat();
+		case RecordValueType::String:
+			return std::string(value.GetString());
+		case RecordValueType::Color:
+			{
+				const auto color = value.GetColor();
+				char buffer[32];
+				char* current = buffer;
+				for (const uint8_t component : { color.alpha, color.red, color.green, color.blue })
+				{
+					if (current != buffer)
+					{
+						*current++ = ',';
+						*current++ = ' ';
+					}
+					current = std::to_chars(current, std::end(buffer), component).ptr;
+				}
+				return std::string(buffer, current);
+			}
+		case RecordValueType::Array:
+			{
+				auto result = nlohmann::json::array();
+				value.ForEachElement(
+					[&result](const RecordValue& element) { result.push_back(ToJson(element)); });
+				return result;
+			}
+		case RecordValueType::Object:
+			{
+				auto result = nlohmann::json::object();
+				value.ForEachMember([&result](std::string_view key, const RecordValue& member) {
+					result[std::string(key)] = ToJson(member);
+				});
+				return result;
+			}
+		default:
+			return nullptr;
+		}
+	}
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace SIE
+{
+	// Binary records passed from the serializer to EspGenerator, EspGenerator/RecordFileReader.cs
+	// must be kept in sync. All values are little endian and unaligned.
+	//
+	// File is a header, the records, a key table of object member names and a table of record
+	// offsets. Every value starts with a RecordValueType byte:
+	//   Null, False, True                      no payload
+	//   Int32, UInt32, Float32                 4 bytes
+	//   Int64, UInt64, Float64                 8 bytes
+	//   String                                 uint32 length, bytes
+	//   Color                                  alpha, red, green, blue bytes
+	//   Array                                  uint32 count, uint32 payload size, values
+	//   Object                                 uint32 count, uint32 payload size,
+	//                                          (uint32 key index, value) members
+	// Payload sizes let readers skip over containers without decoding them.
+	enum class RecordValueType : uint8_t
+	{
+		Null,
+		False,
+		True,
+		Int32,
+		Int64,
+		UInt32,
+		UInt64,
+		Float32,
+		Float64,
+		String,
+		Color,
+		Array,
+		Object,
+		Invalid,
+	};
+
+	struct RecordFileHeader
+	{
+		static constexpr uint32_t Magic = 0x52454953;  // SIER
+		static constexpr uint16_t Version = 1;
+
+		uint32_t magic = Magic;
+		uint16_t version = Version;
+		uint16_t headerSize = sizeof(RecordFileHeader);
+		uint32_t recordCount = 0;
+		uint32_t keyCount = 0;
+		uint64_t keyTableOffset = 0;
+		uint64_t recordTableOffset = 0;
+	};
+	static_assert(sizeof(RecordFileHeader) == 32);
+
+	struct RecordColor
+	{
+		uint8_t alpha = 0;
+		uint8_t red = 0;
+		uint8_t green = 0;
+		uint8_t blue = 0;
+	};
+
+	// Encodes each record into memory and appends it to the stream, only keys and record offsets
+	// are kept until Finish.
+	class RecordWriter
+	{
+	public:
+		explicit RecordWriter(std::ostream& aStream);
+
+		void Write(const nlohmann::json& record);
+		bool Finish();
+
+		size_t GetRecordCount() const;
+		uint64_t GetBytesWritten() const;
+
+	private:
+		void WriteValue(const nlohmann::json& value);
+		uint32_t GetKeyIndex(const std::string& key);
+
+		template <typename T>
+		void Append(T value);
+
+		std::ostream& stream;
+		std::vector<std::byte> buffer;
+		std::vector<std::string> keys;
+		std::unordered_map<std::string, uint32_t> keyIndices;
+		std::vector<uint64_t> recordOffsets;
+		uint64_t bytesWritten = 0;
+	};
+
+	class RecordFile;
+
+	// View of a value inside the data of a RecordFile, nothing is decoded until asked for.
+	// Accessors of a value of another type return empty results.
+	class RecordValue
+	{
+	public:
+		RecordValue() = default;
+
+		RecordValueType GetType() const;
+		bool IsValid() const;
+
+		bool GetBool() const;
+		int64_t GetInt() const;
+		uint64_t GetUInt() const;
+		double GetFloat() const;
+		std::string_view GetString() const;
+		RecordColor GetColor() const;
+
+		// Number of elements or members.
+		uint32_t GetSize() const;
+		RecordValue GetElement(uint32_t index) const;
+		RecordValue GetMember(std::string_view key) const;
+
+		template <typename Func>
+		void ForEachElement(Func&& func) const
+		{
+			const std::byte* current = GetPayload();
+			const uint32_t size = GetSize();
+			for (uint32_t index = 0; current != nullptr && index < size; ++index)
+			{
+				const RecordValue element(file, current, end);
+				func(element);
+				current = element.GetNext();
+			}
+		}
+
+		template <typename Func>
+		void ForEachMember(Func&& func) const
+		{
+			const std::byte* current = GetPayload();
+			const uint32_t size = GetSize();
+			for (uint32_t index = 0; current != nullptr && index < size; ++index)
+			{
+				const RecordValue member(file, current + sizeof(uint32_t), end);
+				func(GetKey(current), member);
+				current = member.GetNext();
+			}
+		}
+
+	private:
+		friend class RecordFile;
+
+		RecordValue(const RecordFile* aFile, const std::byte* aData, const std::byte* aEnd);
+
+		template <typename T>
+		T Read(size_t offset) const;
+
+		// First element or member of a container whose payload fits into the data.
+		const std::byte* GetPayload() const;
+		// Value following this one, null if it does not fit into the data.
+		const std::byte* GetNext() const;
+		std::string_view GetKey(const std::byte* member) const;
+
+		const RecordFile* file = nullptr;
+		const std::byte* data = nullptr;
+		const std::byte* end = nullptr;
+	};
+
+	// Does not own data, which must outlive the file and every value taken from it.
+	class RecordFile
+	{
+	public:
+		bool Open(std::span<const std::byte> aData);
+
+		uint32_t GetRecordCount() const;
+		RecordValue GetRecord(uint32_t index) const;
+		std::string_view GetKey(uint32_t index) const;
+
+	private:
+		std::span<const std::byte> data;
+		std::vector<std::string_view> keys;
+		std::span<const std::byte> recordTable;
+	};
+
+	// Debugging fallback, the result is the json the record was written from.
+	nlohmann::json ToJson(const RecordValue& value);
+}
@@ -2,6 +2,7 @@
 
 #include "Serialization/SerializationUtils.h"
 #include "Serialization/Json.h"
+#include "Serialization/RecordFormat.h"
 #include "Utils/Engine.h"
 
 #include <RE/B/BGSLightingTemplate.h>
@@ -23,6 +24,10 @@
 
 #include <nlohmann/json.hpp>
 
+#include <fstream>
+#include <optional>
+#include <set>
+
 namespace SIE
 {
 	namespace SSerializer
@@ -172,27 +177,43 @@ namespace SIE
 
 		if ((Dll = LoadLibraryA("EspGeneratorWrapper.dll")))
 		{
-			if (const auto address = GetProcAddress(Dll, "Export"))
+			if (const auto address = GetProcAddress(Dll, "ExportStream"))
 			{
-				ExportImpl = reinterpret_cast<decltype(ExportImpl)>(address);
-				logger::error("Successfully loaded Export method from EspGeneratorWrapper.dll");
+				ExportStreamImpl = reinterpret_cast<decltype(ExportStreamImpl)>(address);
+				logger::info("Successfully loaded ExportStream method from EspGeneratorWrapper.dll");
 			}
 			else
 			{
-				logger::error("Export method wasn't found in EspGeneratorWrapper.dll!");
+				logger::error("ExportStream method wasn't found in EspGeneratorWrapper.dll!");
 			}
 		}
 		else
 		{
 			logger::error("Failed to load EspGeneratorWrapper.dll!");
 		}
+
+		exportThread = std::jthread([this](std::stop_token stopToken) { RunJobs(stopToken); });
 	}
 
     Serializer::~Serializer()
     {
+		// Worker drains the jobs that are still queued before it stops.
+		exportThread.request_stop();
+		if (exportThread.joinable())
+		{
+			exportThread.join();
+		}
 	    FreeLibrary(Dll);
 	}
 
+	void Serializer::CaptureBaseline(const RE::TESForm& form)
+	{
+		if (!baselines.contains(&form))
+		{
+			baselines.emplace(&form, std::make_shared<const nlohmann::json>(form));
+		}
+	}
+
     void Serializer::EnqueueForm(const RE::TESForm& form)
 	{
 		constexpr uint32_t indexMask = 0xFF000000;
@@ -200,50 +221,260 @@ namespace SIE
 		const auto srcFile = form.GetFile(0);
 		const auto overrideFile = form.GetDescriptionOwnerFile();
 
-		forms[&form] = { { "Master", srcFile ? srcFile->fileName : "null" },
-			{ "Override", overrideFile ? overrideFile->fileName : "null" },
-			{ "FormKey", ToFormKey(&form) }, { "Form", form },
-			{ "References", SSerializer::CollectReferences(form) } };
+		auto& formRecord = forms[&form];
+		const auto previousRecord = formRecord.record;
+
+		auto record = std::make_shared<ExportRecord>();
+		record->masterFile = srcFile ? srcFile->fileName : "null";
+		record->overrideFile = overrideFile ? overrideFile->fileName : "null";
+		record->formKey = ToFormKey(&form);
+		if (const auto it = baselines.find(&form); it != baselines.end())
+		{
+			record->baseline = it->second;
+		}
+
+		// Editors only report that something changed, sections whose fingerprint is the same as
+		// when the form was last enqueued are reused instead of being serialized again.
+		const auto sections = GetFormJsonSections(form.formType.get());
+		bool areReferencesChanged = previousRecord == nullptr || sections.empty();
+		if (sections.empty())
+		{
+			record->sections.push_back(std::make_shared<const nlohmann::json>(form));
+		}
+		else
+		{
+			formRecord.fingerprints.resize(sections.size());
+			for (size_t sectionIndex = 0; sectionIndex < sections.size(); ++sectionIndex)
+			{
+				const auto& section = sections[sectionIndex];
+				const uint64_t fingerprint = section.fingerprint(form);
+				if (previousRecord != nullptr &&
+					formRecord.fingerprints[sectionIndex] == fingerprint)
+				{
+					record->sections.push_back(previousRecord->sections[sectionIndex]);
+					continue;
+				}
+
+				auto json = std::make_shared<nlohmann::json>(nlohmann::json::object());
+				section.write(*json, form);
+				record->sections.push_back(std::move(json));
+				formRecord.fingerprints[sectionIndex] = fingerprint;
+				areReferencesChanged = areReferencesChanged || section.hasReferences;
+			}
+		}
+
+		record->references = areReferencesChanged ?
+		                         std::make_shared<const std::unordered_set<std::string>>(
+									 SSerializer::CollectReferences(form)) :
+		                         previousRecord->references;
+		formRecord.record = std::move(record);
 	}
 
-    void Serializer::Export(const std::string& path) const
+	bool Serializer::WriteRecords(ExportJob& job, const std::string& path,
+		ExportProgress& progress)
 	{
-		nlohmann::json j;
+		constexpr size_t ProgressInterval = 64;
 
-		for (auto& [form, json] : forms)
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
 		{
-			j.push_back(json);
+			return false;
 		}
 
-		const auto pathToAddW = std::filesystem::current_path().append(path).native();
-		const auto pathToAdd = std::string(pathToAddW.cbegin(), pathToAddW.cend());
-
-		logger::info("Calling EspGenerator for {} to {}", j.dump(4), pathToAdd);
-		try
+		// Records are written in the binary format, or as JSON lines while debugging. First record
+		// lists every plugin the others need so that the generator can build its load order before
+		// reading them.
+		std::set<std::string> modKeys;
+		for (const auto& record : job.forms)
 		{
-			const auto resultCode = ExportImpl(pathToAdd.c_str(), j.dump().c_str());
-			if (resultCode == 0)
+			modKeys.insert(record->masterFile);
+			modKeys.insert(record->overrideFile);
+			modKeys.insert(record->references->cbegin(), record->references->cend());
+		}
+		std::optional<RecordWriter> writer;
+		if (!job.isDebugDumpEnabled)
+		{
+			writer.emplace(file);
+		}
+		const auto write = [&file, &writer](const nlohmann::json& record) {
+			if (writer.has_value())
 			{
-				logger::info("Successfully exported");
+				writer->Write(record);
 			}
 			else
 			{
-				logger::info("Export failed! Result code {}", resultCode);
+				file << record << '\n';
+			}
+		};
+
+		write(nlohmann::json{ { "ModKeys", modKeys } });
+
+		for (const auto& record : job.forms)
+		{
+			if (job.IsCancelRequested())
+			{
+				return false;
+			}
+			// Forms edited back to their baseline are not exported.
+			if (const auto json = record->ToJson())
+			{
+				if (job.isDebugDumpEnabled)
+				{
+					logger::info("Exporting {}", json->dump(4));
+				}
+				write(*json);
+			}
+
+			if (++progress.formsWritten % ProgressInterval == 0 ||
+				progress.formsWritten == progress.formCount)
+			{
+				progress.bytesWritten = static_cast<uint64_t>(file.tellp());
+				job.SetProgress(progress);
 			}
 		}
-		catch (std::exception e)
+
+		if (writer.has_value())
 		{
-			logger::info("Export failed with exception {}", e.what());
+			return writer->Finish();
 		}
+		file.flush();
+		return file.good();
 	}
 
-	void Serializer::OnQuitGame() const 
-	{ 
-		if (!forms.empty())
+	void Serializer::RunJob(ExportJob& job)
+	{
+		const auto recordsPath = job.GetPath() + (job.isDebugDumpEnabled ? ".ndjson" : ".records");
+
+		ExportProgress progress = job.GetProgress();
+		const auto finish = [&job, &progress](ExportPhase phase) {
+			progress.phase = phase;
+			job.forms.clear();
+			job.SetProgress(progress);
+		};
+
+		if (job.IsCancelRequested())
+		{
+			finish(ExportPhase::Cancelled);
+			return;
+		}
+		if (ExportStreamImpl == nullptr)
+		{
+			logger::error("Export failed! EspGeneratorWrapper.dll is not loaded");
+			finish(ExportPhase::Failed);
+			return;
+		}
+
+		progress.phase = ExportPhase::WritingRecords;
+		job.SetProgress(progress);
+		const bool areRecordsWritten = WriteRecords(job, recordsPath, progress);
+
+		auto phase = ExportPhase::Failed;
+		if (job.IsCancelRequested())
 		{
-			Export(std::format(
-				"Data/SKSE/plugins/EspGenerator/OnQuitAutoSave_{:%d-%m-%Y_%H-%M-%OS}.esp",
-				std::chrono::system_clock::now()));
+			logger::info("Export to {} cancelled", job.GetPath());
+			phase = ExportPhase::Cancelled;
 		}
+		else if (!areRecordsWritten)
+		{
+			logger::error("Export failed! Can't write records to {}", recordsPath);
+		}
+		else
+		{
+			progress.phase = ExportPhase::Generating;
+			job.SetProgress(progress);
+
+			logger::info("Calling EspGenerator for {} forms to {}", progress.formCount,
+				job.GetPath());
+			try
+			{
+				const auto resultCode = ExportStreamImpl(job.GetPath().c_str(), recordsPath.c_str());
+				if (resultCode == 0)
+				{
+					logger::info("Successfully exported");
+					phase = ExportPhase::Completed;
+				}
+				else
+				{
+					logger::info("Export failed! Result code {}", resultCode);
+				}
+			}
+			catch (std::exception e)
+			{
+				logger::info("Export failed with exception {}", e.what());
+			}
+		}
+
+		if (job.isDebugDumpEnabled)
+		{
+			logger::info("Records are kept in {}", recordsPath);
+		}
+		else
+		{
+			std::error_code errorCode;
+			std::filesystem::remove(recordsPath, errorCode);
+		}
+		finish(phase);
+	}
+
+	void Serializer::RunJobs(std::stop_token stopToken)
+	{
+		while (true)
+		{
+			std::unique_lock lock(jobMutex);
+			jobCondition.wait(lock, stopToken, [this] { return !pendingJobs.empty(); });
+			if (pendingJobs.empty())
+			{
+				return;
+			}
+			const auto job = std::move(pendingJobs.front());
+			pendingJobs.pop_front();
+			lock.unlock();
+
+			RunJob(*job);
+		}
+	}
+
+	std::shared_ptr<ExportJob> Serializer::Export(const std::string& path,
+		ExportJob::ProgressCallback callback)
+	{
+		const auto pathToAddW = std::filesystem::current_path().append(path).native();
+		auto pathToAdd = std::string(pathToAddW.cbegin(), pathToAddW.cend());
+
+		std::vector<std::shared_ptr<const ExportRecord>> snapshot;
+		snapshot.reserve(forms.size());
+		for (const auto& [form, formRecord] : forms)
+		{
+			snapshot.push_back(formRecord.record);
+		}
+
+		const auto job = std::shared_ptr<ExportJob>(new ExportJob(std::move(pathToAdd),
+			std::move(snapshot), isDebugDumpEnabled, std::move(callback)));
+		{
+			std::lock_guard lock(jobMutex);
+			pendingJobs.push_back(job);
+		}
+		jobCondition.notify_one();
+		return job;
+	}
+
+	std::shared_ptr<ExportJob> Serializer::OnQuitGame()
+	{
+		if (forms.empty())
+		{
+			return nullptr;
+		}
+		return Export(std::format(
+			"Data/SKSE/plugins/EspGenerator/OnQuitAutoSave_{:%d-%m-%Y_%H-%M-%OS}.esp",
+			std::chrono::system_clock::now()));
+	}
+
+	bool Serializer::IsDebugDumpEnabled() const
+	{
+		return isDebugDumpEnabled;
+	}
+
+	void Serializer::SetDebugDumpEnabled(bool value)
+	{
+		isDebugDumpEnabled = value;
 	}
 }
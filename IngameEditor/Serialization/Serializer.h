@@ -1,10 +1,19 @@
 #pragma once
 
+#include "Serialization/ExportJob.h"
+
 #include <nlohmann/json.hpp>
 
 #include <Windows.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace RE
 {
@@ -20,16 +29,45 @@ namespace SIE
 
 		~Serializer();
 
+		// Keeps the current json of the form, if it has none yet, to export only the members edited
+		// since. Must be called before the first edit of the form.
+		void CaptureBaseline(const RE::TESForm& form);
 		void EnqueueForm(const RE::TESForm& form);
-		void Export(const std::string& path) const;
-		void OnQuitGame() const;
+		// Snapshots the enqueued forms and queues their export on the worker thread.
+		std::shared_ptr<ExportJob> Export(const std::string& path,
+			ExportJob::ProgressCallback callback = nullptr);
+		std::shared_ptr<ExportJob> OnQuitGame();
+
+		// Passes records to the generator as JSON lines instead of the binary format, keeps their
+		// file and logs every exported form.
+		bool IsDebugDumpEnabled() const;
+		void SetDebugDumpEnabled(bool value);
 
 	private:
 		Serializer();
 
 		inline static HMODULE Dll = nullptr;
-		static inline int (*ExportImpl)(const char*, const char*) = nullptr;
+		static inline int (*ExportStreamImpl)(const char*, const char*) = nullptr;
+
+		static bool WriteRecords(ExportJob& job, const std::string& path, ExportProgress& progress);
+		static void RunJob(ExportJob& job);
+
+		void RunJobs(std::stop_token stopToken);
+
+		struct FormRecord
+		{
+			// Fingerprints of the json sections of the form, see GetFormJsonSections.
+			std::vector<uint64_t> fingerprints;
+			std::shared_ptr<const ExportRecord> record;
+		};
+
+		std::unordered_map<const RE::TESForm*, FormRecord> forms;
+		std::unordered_map<const RE::TESForm*, std::shared_ptr<const nlohmann::json>> baselines;
+		bool isDebugDumpEnabled = false;
 
-		std::unordered_map<const RE::TESForm*, nlohmann::json> forms;
+		std::deque<std::shared_ptr<ExportJob>> pendingJobs;
+		std::condition_variable_any jobCondition;
+		std::mutex jobMutex;
+		std::jthread exportThread;
     };
 }
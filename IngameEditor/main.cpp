@@ -1,4 +1,5 @@
 #include "Hooks.h"
+#include "Core/ShaderCache.h"
 #include "Gui/Gui.h"
 #include "Gui/NiObjectEditor.h"
 #include "Utils/RTTICache.h"
@@ -20,6 +21,7 @@ void MessageHandler(SKSE::MessagingInterface::Message* a_message)
 	else if (a_message->type == SKSE::MessagingInterface::kDataLoaded)
 	{
 		Hooks::OnDataLoaded();
+		SIE::ShaderCache::Instance().PrewarmFromTrace();
 		RE::BSInputDeviceManager::GetSingleton()->AddEventSink(&SIE::Gui::Instance());
 		SIE::RegisterNiConstructors();
 		SIE::RegisterNiEditors();
@@ -0,0 +1,366 @@
+#include "Core/ConcurrentShaderMap.h"
+#include "ToolSupport.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace SIE
+{
+	namespace SBeginTechniqueBenchmark
+	{
+		struct Options
+		{
+			size_t techniqueCount = 4000;
+			size_t drawCount = 100000;
+			size_t iterationCount = 5;
+			uint32_t seed = 1;
+		};
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("BeginTechniqueBenchmark");
+			parser.Add("--techniques", "n",
+				"vertex and pixel shaders in the synthetic technique maps (default: 4000)",
+				options.techniqueCount, 1);
+			parser.Add("--draws", "n", "BeginTechnique calls per timed run (default: 100000)",
+				options.drawCount, 1);
+			parser.Add("--iterations", "n",
+				"timed runs of every path, the fastest is reported (default: 5)",
+				options.iterationCount, 1);
+			parser.Add("--seed", "n", "seed of the synthetic data (default: 1)", options.seed);
+			return parser.Parse(argc, argv);
+		}
+
+		struct VertexShader
+		{
+			uint32_t id = 0;
+			uint32_t shaderDesc = 0;
+		};
+
+		struct PixelShader
+		{
+			uint32_t id = 0;
+		};
+
+		// Stands in for BSShader, technique maps are walked in their unordered storage order.
+		struct Shader
+		{
+			std::vector<VertexShader*> vertexShaders;
+			std::vector<PixelShader*> pixelShaders;
+			std::vector<std::unique_ptr<VertexShader>> vertexStorage;
+			std::vector<std::unique_ptr<PixelShader>> pixelStorage;
+		};
+
+		struct Draw
+		{
+			uint32_t vertexDescriptor = 0;
+			uint32_t pixelDescriptor = 0;
+		};
+
+		// Vanilla lookup BeginTechnique used before VanillaShaderIndex.
+		template <typename T>
+		static T* FindLinear(const std::vector<T*>& source, uint32_t descriptor)
+		{
+			for (auto item : source)
+			{
+				if (item->id == descriptor)
+				{
+					return item;
+				}
+			}
+			return nullptr;
+		}
+
+		// Mirrors Core/VanillaShaderIndex.cpp, which depends on CommonLibSSE types, including its
+		// locking and the staleness check done on every lookup.
+		class VanillaShaderIndex
+		{
+		public:
+			VertexShader* GetVertexShader(const Shader& shader, uint32_t descriptor)
+			{
+				return Find(vertexShaders, shader, shader.vertexShaders, descriptor);
+			}
+
+			PixelShader* GetPixelShader(const Shader& shader, uint32_t descriptor)
+			{
+				return Find(pixelShaders, shader, shader.pixelShaders, descriptor);
+			}
+
+		private:
+			template <typename T>
+			struct Index
+			{
+				size_t sourceSize = 0;
+				const T* sourceFirst = nullptr;
+				std::unordered_map<uint32_t, T*> shaders;
+			};
+
+			template <typename T>
+			using IndexMap = std::unordered_map<const Shader*, Index<T>>;
+
+			template <typename T>
+			static bool IsCurrent(const Index<T>& index, size_t sourceSize, const T* sourceFirst)
+			{
+				return index.sourceSize == sourceSize && index.sourceFirst == sourceFirst;
+			}
+
+			template <typename T>
+			T* Find(IndexMap<T>& indices, const Shader& shader, const std::vector<T*>& source,
+				uint32_t descriptor)
+			{
+				const size_t sourceSize = source.size();
+				const T* sourceFirst = sourceSize != 0 ? source.front() : nullptr;
+
+				const auto findShader = [descriptor](const Index<T>& index) -> T* {
+					const auto it = index.shaders.find(descriptor);
+					return it != index.shaders.end() ? it->second : nullptr;
+				};
+
+				{
+					std::shared_lock lock(mutex);
+					const auto it = indices.find(&shader);
+					if (it != indices.end() && IsCurrent(it->second, sourceSize, sourceFirst))
+					{
+						return findShader(it->second);
+					}
+				}
+
+				std::unique_lock lock(mutex);
+				auto& index = indices[&shader];
+				if (!IsCurrent(index, sourceSize, sourceFirst))
+				{
+					index.shaders.clear();
+					index.shaders.reserve(sourceSize);
+					for (auto item : source)
+					{
+						index.shaders.try_emplace(item->id, item);
+					}
+					index.sourceSize = sourceSize;
+					index.sourceFirst = sourceFirst;
+				}
+				return findShader(index);
+			}
+
+			IndexMap<VertexShader> vertexShaders;
+			IndexMap<PixelShader> pixelShaders;
+			std::shared_mutex mutex;
+		};
+
+		enum class Fallback
+		{
+			Linear,
+			Indexed,
+		};
+
+		enum class TechniquePath
+		{
+			Hit,
+			Miss,
+			Vanilla,
+		};
+
+		struct Caches
+		{
+			ConcurrentShaderMap<VertexShader> vertexShaders;
+			ConcurrentShaderMap<PixelShader> pixelShaders;
+		};
+
+		// Follows the lookups of the BSShader_BeginTechnique hook in Hooks.cpp, returns 0 where the
+		// hook fails the technique or logs mismatching vertex shader descriptions.
+		static uint64_t BeginTechnique(const Shader& shader, const Caches* caches,
+			VanillaShaderIndex& index, Fallback fallback, const Draw& draw, uint64_t frame)
+		{
+			VertexShader* vertexShader = nullptr;
+			PixelShader* pixelShader = nullptr;
+			if (caches != nullptr)
+			{
+				vertexShader = caches->vertexShaders.Find(draw.vertexDescriptor, frame);
+				pixelShader = caches->pixelShaders.Find(draw.pixelDescriptor, frame);
+			}
+
+			const auto findVertexShader = [&]() {
+				return fallback == Fallback::Linear ?
+				           FindLinear(shader.vertexShaders, draw.vertexDescriptor) :
+				           index.GetVertexShader(shader, draw.vertexDescriptor);
+			};
+			if (vertexShader == nullptr)
+			{
+				vertexShader = findVertexShader();
+			}
+			else if (const auto vanillaVertexShader = findVertexShader())
+			{
+				if (vertexShader->shaderDesc != vanillaVertexShader->shaderDesc)
+				{
+					return 0;
+				}
+			}
+			if (pixelShader == nullptr)
+			{
+				pixelShader = fallback == Fallback::Linear ?
+				                  FindLinear(shader.pixelShaders, draw.pixelDescriptor) :
+				                  index.GetPixelShader(shader, draw.pixelDescriptor);
+			}
+			if (vertexShader == nullptr || pixelShader == nullptr)
+			{
+				return 0;
+			}
+			return (static_cast<uint64_t>(vertexShader->id) << 32) | pixelShader->id;
+		}
+
+		static Shader MakeShader(size_t techniqueCount, std::mt19937& random)
+		{
+			// Lighting descriptors spread over the whole 32 bit range, so the keys are drawn the
+			// same way instead of being dense.
+			std::unordered_set<uint32_t> descriptors;
+			while (descriptors.size() < techniqueCount)
+			{
+				descriptors.insert(static_cast<uint32_t>(random()));
+			}
+
+			Shader shader;
+			for (const uint32_t descriptor : descriptors)
+			{
+				shader.vertexStorage.push_back(
+					std::make_unique<VertexShader>(descriptor, descriptor >> 3));
+				shader.pixelStorage.push_back(std::make_unique<PixelShader>(descriptor));
+			}
+			std::ranges::shuffle(shader.vertexStorage, random);
+			std::ranges::shuffle(shader.pixelStorage, random);
+			for (const auto& item : shader.vertexStorage)
+			{
+				shader.vertexShaders.push_back(item.get());
+			}
+			for (const auto& item : shader.pixelStorage)
+			{
+				shader.pixelShaders.push_back(item.get());
+			}
+			return shader;
+		}
+
+		static double Measure(size_t iterationCount, const std::function<void()>& func)
+		{
+			double bestTime = 0.;
+			for (size_t iteration = 0; iteration < iterationCount; ++iteration)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				func();
+				const double time =
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+						.count();
+				bestTime = iteration == 0 ? time : std::min(bestTime, time);
+			}
+			return bestTime;
+		}
+
+		static int Run(const Options& options)
+		{
+			std::mt19937 random(options.seed);
+			const Shader shader = MakeShader(options.techniqueCount, random);
+
+			Caches filledCaches;
+			for (const auto item : shader.vertexShaders)
+			{
+				filledCaches.vertexShaders.Insert(item->id, std::make_unique<VertexShader>(*item));
+			}
+			for (const auto item : shader.pixelShaders)
+			{
+				filledCaches.pixelShaders.Insert(item->id, std::make_unique<PixelShader>(*item));
+			}
+			const Caches emptyCaches;
+
+			std::vector<Draw> draws;
+			draws.reserve(options.drawCount);
+			std::uniform_int_distribution<size_t> techniqueDistribution(0,
+				options.techniqueCount - 1);
+			for (size_t drawIndex = 0; drawIndex < options.drawCount; ++drawIndex)
+			{
+				const uint32_t vertexDescriptor =
+					shader.vertexShaders[techniqueDistribution(random)]->id;
+				const uint32_t pixelDescriptor =
+					shader.pixelShaders[techniqueDistribution(random)]->id;
+				draws.push_back({ vertexDescriptor, pixelDescriptor });
+			}
+
+			std::cout << std::format("{} techniques, {} draws per run, fastest of {} runs\n\n",
+				options.techniqueCount, options.drawCount, options.iterationCount);
+			std::cout << std::format("{:<10}{:>14}{:>14}{:>12}\n", "Path", "Linear ns",
+				"Indexed ns", "Speedup");
+
+			size_t mismatchCount = 0;
+			for (const auto path :
+				{ TechniquePath::Hit, TechniquePath::Miss, TechniquePath::Vanilla })
+			{
+				const Caches* caches = path == TechniquePath::Hit ? &filledCaches :
+				                       path == TechniquePath::Miss ? &emptyCaches :
+				                                                     nullptr;
+
+				std::array<double, 2> times = {};
+				std::array<uint64_t, 2> checksums = {};
+				for (const auto fallback : { Fallback::Linear, Fallback::Indexed })
+				{
+					VanillaShaderIndex index;
+					const auto fallbackIndex = static_cast<size_t>(fallback);
+					times[fallbackIndex] = Measure(options.iterationCount, [&] {
+						uint64_t checksum = 0;
+						uint64_t frame = 0;
+						for (const auto& draw : draws)
+						{
+							checksum += BeginTechnique(shader, caches, index, fallback, draw,
+								++frame);
+						}
+						checksums[fallbackIndex] = checksum;
+					});
+				}
+
+				const double linearTime = times[0] * 1e6 / options.drawCount;
+				const double indexedTime = times[1] * 1e6 / options.drawCount;
+				const std::string_view name = path == TechniquePath::Hit ? "Hit" :
+				                              path == TechniquePath::Miss ? "Miss" :
+				                                                            "Vanilla";
+				std::cout << std::format("{:<10}{:>14.1f}{:>14.1f}{:>11.1f}x\n", name, linearTime,
+					indexedTime, linearTime / indexedTime);
+
+				if (checksums[0] != checksums[1])
+				{
+					std::cerr << std::format("{} path resolves different shaders: {} and {}\n",
+						name, checksums[0], checksums[1]);
+					++mismatchCount;
+				}
+			}
+
+			std::cout << "\nHit finds both shaders in the cache and still resolves the vanilla "
+						 "vertex shader to compare descriptions, Miss falls back for both after "
+						 "two cache lookups, Vanilla only falls back\n";
+
+			if (mismatchCount != 0)
+			{
+				return 1;
+			}
+			std::cout << "Linear and indexed fallbacks resolve the same shaders\n";
+			return 0;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SBeginTechniqueBenchmark::Options options;
+	if (!SIE::SBeginTechniqueBenchmark::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SBeginTechniqueBenchmark::Run(options);
+}
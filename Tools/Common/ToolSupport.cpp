@@ -0,0 +1,164 @@
+#include "ToolSupport.h"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <iostream>
+
+namespace SIE
+{
+	namespace SToolSupport
+	{
+		constexpr size_t DescriptionColumn = 29;
+		constexpr size_t LineWidth = 88;
+
+		static void AppendDescription(std::string& usage, std::string_view description)
+		{
+			size_t column = usage.size() - usage.rfind('\n') - 1;
+			while (!description.empty())
+			{
+				// Defaults are kept on one line with their value.
+				const size_t wordStart = description.starts_with("(default: ") ? 10 : 0;
+				const auto wordEnd = std::min(description.find(' ', wordStart), description.size());
+				const auto word = description.substr(0, wordEnd);
+				if (column > DescriptionColumn && column + 1 + word.size() > LineWidth)
+				{
+					usage += '\n';
+					column = 0;
+				}
+				if (column < DescriptionColumn)
+				{
+					usage.append(DescriptionColumn - column, ' ');
+					column = DescriptionColumn;
+				}
+				else if (column > DescriptionColumn)
+				{
+					usage += ' ';
+					++column;
+				}
+				usage += word;
+				column += word.size();
+				description.remove_prefix(std::min(wordEnd + 1, description.size()));
+			}
+			usage += '\n';
+		}
+	}
+
+	ToolOptionParser::ToolOptionParser(std::string_view aToolName) :
+		toolName(aToolName)
+	{}
+
+	void ToolOptionParser::Add(std::string_view name, std::string_view valueName,
+		std::string description, ParseFunc parse)
+	{
+		options.push_back({ name, valueName, std::move(description), std::move(parse) });
+	}
+
+	void ToolOptionParser::Add(std::string_view name, std::string_view valueName,
+		std::string description, size_t& value, size_t minValue)
+	{
+		Add(name, valueName, std::move(description), [&value, minValue](const std::string& text) {
+			value = std::max<size_t>(std::stoull(text), minValue);
+		});
+	}
+
+	void ToolOptionParser::Add(std::string_view name, std::string_view valueName,
+		std::string description, uint32_t& value)
+	{
+		Add(name, valueName, std::move(description), [&value](const std::string& text) {
+			value = static_cast<uint32_t>(std::stoul(text));
+		});
+	}
+
+	void ToolOptionParser::Add(std::string_view name, std::string_view valueName,
+		std::string description, std::string& value)
+	{
+		Add(name, valueName, std::move(description),
+			[&value](const std::string& text) { value = text; });
+	}
+
+	void ToolOptionParser::Add(std::string_view name, std::string_view valueName,
+		std::string description, std::filesystem::path& value)
+	{
+		Add(name, valueName, std::move(description),
+			[&value](const std::string& text) { value = text; });
+	}
+
+	void ToolOptionParser::AddScratchDirectory(std::filesystem::path& directory)
+	{
+		directory = std::filesystem::temp_directory_path() / toolName;
+		Add("--directory", "path",
+			std::format("scratch directory, removed before and after the checks (default: {})",
+				directory.generic_string()),
+			directory);
+	}
+
+	bool ToolOptionParser::Parse(int argc, char** argv) const
+	{
+		for (int index = 1; index < argc; ++index)
+		{
+			const std::string_view argument = argv[index];
+			const auto option = std::ranges::find(options, argument, &Option::name);
+			if (option == options.end() || index + 1 == argc)
+			{
+				std::cerr << GetUsage();
+				return false;
+			}
+			try
+			{
+				option->parse(argv[++index]);
+			}
+			catch (const std::exception&)
+			{
+				std::cerr << std::format("Invalid value of {}: {}\n", argument, argv[index]);
+				std::cerr << GetUsage();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::string ToolOptionParser::GetUsage() const
+	{
+		std::string result = std::format("Usage: {} [options]\n", toolName);
+		for (const auto& option : options)
+		{
+			result += std::format("  {} <{}>", option.name, option.valueName);
+			if (result.size() - result.rfind('\n') - 1 >= SToolSupport::DescriptionColumn)
+			{
+				result += '\n';
+			}
+			SToolSupport::AppendDescription(result, option.description);
+		}
+		return result;
+	}
+
+	int RunToolChecks(std::span<const ToolCheck> checks, const std::filesystem::path& directory)
+	{
+		size_t failedCount = 0;
+		for (const auto& [name, func] : checks)
+		{
+			std::filesystem::remove_all(directory);
+			bool passed = false;
+			try
+			{
+				passed = func(directory);
+			}
+			catch (const std::exception& exception)
+			{
+				std::cerr << std::format("{}: {}\n", name, exception.what());
+			}
+			std::cout << std::format("{:<24}{}\n", name, passed ? "passed" : "FAILED");
+			failedCount += passed ? 0 : 1;
+		}
+		std::filesystem::remove_all(directory);
+
+		if (failedCount != 0)
+		{
+			std::cerr << std::format("{} checks failed\n", failedCount);
+			return 1;
+		}
+		std::cout << "All checks passed\n";
+		return 0;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SIE
+{
+	// Command line of the offline tools, every option is followed by its value. Descriptions
+	// state the default themselves and are wrapped when the usage is printed.
+	class ToolOptionParser
+	{
+	public:
+		using ParseFunc = std::function<void(const std::string& value)>;
+
+		explicit ToolOptionParser(std::string_view toolName);
+
+		void Add(std::string_view name, std::string_view valueName, std::string description,
+			ParseFunc parse);
+		void Add(std::string_view name, std::string_view valueName, std::string description,
+			size_t& value, size_t minValue = 0);
+		void Add(std::string_view name, std::string_view valueName, std::string description,
+			uint32_t& value);
+		void Add(std::string_view name, std::string_view valueName, std::string description,
+			std::string& value);
+		void Add(std::string_view name, std::string_view valueName, std::string description,
+			std::filesystem::path& value);
+
+		// Adds --directory, defaulting to <temp>/<tool name>.
+		void AddScratchDirectory(std::filesystem::path& directory);
+
+		// Prints the usage to cerr if the command line is invalid.
+		bool Parse(int argc, char** argv) const;
+		std::string GetUsage() const;
+
+	private:
+		struct Option
+		{
+			std::string_view name;
+			std::string_view valueName;
+			std::string description;
+			ParseFunc parse;
+		};
+
+		std::string_view toolName;
+		std::vector<Option> options;
+	};
+
+	struct ToolCheck
+	{
+		std::string_view name;
+		bool (*func)(const std::filesystem::path& directory);
+	};
+
+	// Runs every check in an emptied scratch directory and removes it afterwards. Returns the
+	// exit code of the tool.
+	int RunToolChecks(std::span<const ToolCheck> checks, const std::filesystem::path& directory);
+}
@@ -0,0 +1,234 @@
+#include "Core/ConcurrentShaderMap.h"
+#include "ToolSupport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace SIE
+{
+	namespace SConcurrentShaderMapBenchmark
+	{
+		struct Options
+		{
+			size_t maxInserterCount = 4;
+			size_t initialKeyCount = 4000;
+			size_t lookupCount = 1000000;
+			uint64_t compileTime = 200;
+			uint64_t createTime = 20000;
+			uint32_t seed = 1;
+		};
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("ConcurrentShaderMapBenchmark");
+			parser.Add("--inserters", "n",
+				"most concurrent inserter threads, runs are made with 0, 1, 2, 4... up to n "
+				"(default: 4)",
+				options.maxInserterCount);
+			parser.Add("--keys", "n", "shaders present before a run starts (default: 4000)",
+				options.initialKeyCount, 1);
+			parser.Add("--lookups", "n", "timed lookups of the reader per run (default: 1000000)",
+				options.lookupCount, 1);
+			parser.Add("--compile-us", "n",
+				"sleep of an inserter before creating each shader (default: 200)",
+				options.compileTime);
+			parser.Add("--create-ns", "n",
+				"busy work per created shader, standing in for device shader creation "
+				"(default: 20000)",
+				options.createTime);
+			parser.Add("--seed", "n", "seed of the synthetic keys (default: 1)", options.seed);
+			return parser.Parse(argc, argv);
+		}
+
+		struct Shader
+		{
+			uint32_t id = 0;
+		};
+
+		static std::unique_ptr<Shader> CreateShader(uint32_t key, uint64_t createTime)
+		{
+			const auto end =
+				std::chrono::steady_clock::now() + std::chrono::nanoseconds(createTime);
+			while (std::chrono::steady_clock::now() < end)
+			{
+			}
+			return std::make_unique<Shader>(key);
+		}
+
+		// Lookups as ShaderCache does them, the table is advanced to a new epoch every simulated
+		// frame so that retired tables are released.
+		class LockFreeMap
+		{
+		public:
+			static constexpr std::string_view Name = "Lock-free";
+
+			Shader* Find(uint32_t key, uint64_t frame) const { return shaders.Find(key, frame); }
+
+			void Insert(uint32_t key, uint64_t createTime)
+			{
+				shaders.Insert(key, CreateShader(key, createTime));
+			}
+
+			void OnFrame(uint64_t frame) { shaders.ReleaseRetiredTables(frame); }
+
+		private:
+			ConcurrentShaderMap<Shader> shaders;
+		};
+
+		// Per-class mutex that ShaderCache took before ConcurrentShaderMap, held by inserters
+		// while the shader is created.
+		class MutexMap
+		{
+		public:
+			static constexpr std::string_view Name = "Mutex";
+
+			Shader* Find(uint32_t key, uint64_t) const
+			{
+				std::lock_guard lock(mutex);
+				const auto it = shaders.find(key);
+				return it != shaders.end() ? it->second.get() : nullptr;
+			}
+
+			void Insert(uint32_t key, uint64_t createTime)
+			{
+				std::lock_guard lock(mutex);
+				shaders.try_emplace(key, CreateShader(key, createTime));
+			}
+
+			void OnFrame(uint64_t) {}
+
+		private:
+			std::unordered_map<uint32_t, std::unique_ptr<Shader>> shaders;
+			mutable std::mutex mutex;
+		};
+
+		struct Result
+		{
+			std::vector<uint64_t> latencies;
+			size_t insertCount = 0;
+			uint64_t checksum = 0;
+		};
+
+		template <typename Map>
+		static Result Measure(const Options& options, size_t inserterCount)
+		{
+			constexpr size_t LookupsPerFrame = 1000;
+
+			Map map;
+			std::mt19937 random(options.seed);
+			std::vector<uint32_t> keys(options.initialKeyCount);
+			for (auto& key : keys)
+			{
+				key = static_cast<uint32_t>(random());
+				map.Insert(key, 0);
+			}
+
+			std::atomic<bool> stop = false;
+			std::atomic<size_t> insertCount = 0;
+			std::vector<std::jthread> inserters;
+			for (size_t inserterIndex = 0; inserterIndex < inserterCount; ++inserterIndex)
+			{
+				inserters.emplace_back([&, inserterIndex] {
+					std::mt19937 inserterRandom(options.seed + 1 + inserterIndex);
+					while (!stop.load(std::memory_order_relaxed))
+					{
+						std::this_thread::sleep_for(std::chrono::microseconds(options.compileTime));
+						map.Insert(static_cast<uint32_t>(inserterRandom()), options.createTime);
+						insertCount.fetch_add(1, std::memory_order_relaxed);
+					}
+				});
+			}
+
+			// Half of the lookups miss, as draws do while their permutations are compiling.
+			Result result;
+			result.latencies.reserve(options.lookupCount);
+			std::uniform_int_distribution<size_t> keyDistribution(0, keys.size() - 1);
+			uint64_t frame = 0;
+			for (size_t lookupIndex = 0; lookupIndex < options.lookupCount; ++lookupIndex)
+			{
+				if (lookupIndex % LookupsPerFrame == 0)
+				{
+					map.OnFrame(++frame);
+				}
+				const uint32_t key = lookupIndex % 2 == 0 ? keys[keyDistribution(random)] :
+				                                            static_cast<uint32_t>(random());
+				const auto start = std::chrono::steady_clock::now();
+				const Shader* shader = map.Find(key, frame);
+				const auto end = std::chrono::steady_clock::now();
+				result.latencies.push_back(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+				result.checksum += shader != nullptr ? shader->id : 0;
+			}
+
+			stop = true;
+			inserters.clear();
+			result.insertCount = insertCount;
+			return result;
+		}
+
+		template <typename Map>
+		static void PrintRow(const Options& options, size_t inserterCount)
+		{
+			auto result = Measure<Map>(options, inserterCount);
+			auto& latencies = result.latencies;
+			std::ranges::sort(latencies);
+			const auto getPercentile = [&latencies](double percentile) {
+				return latencies[std::min(latencies.size() - 1,
+					static_cast<size_t>(percentile / 100. * latencies.size()))];
+			};
+			std::cout << std::format("{:<12}{:>10}{:>10}{:>10}{:>12}{:>12}{:>12}\n", Map::Name,
+				inserterCount, getPercentile(50.), getPercentile(99.), getPercentile(99.9),
+				latencies.back(), result.insertCount);
+		}
+
+		static int Run(const Options& options)
+		{
+			std::vector<size_t> inserterCounts = { 0 };
+			for (size_t inserterCount = 1; inserterCount < options.maxInserterCount;
+				 inserterCount *= 2)
+			{
+				inserterCounts.push_back(inserterCount);
+			}
+			if (options.maxInserterCount != 0)
+			{
+				inserterCounts.push_back(options.maxInserterCount);
+			}
+
+			std::cout << std::format(
+				"{} initial shaders, {} lookups per run, {} us to compile and {} ns to create a "
+				"shader\n\n",
+				options.initialKeyCount, options.lookupCount, options.compileTime,
+				options.createTime);
+			std::cout << std::format("{:<12}{:>10}{:>10}{:>10}{:>12}{:>12}{:>12}\n", "Map",
+				"Inserters", "p50 ns", "p99 ns", "p99.9 ns", "Max ns", "Inserted");
+			for (const size_t inserterCount : inserterCounts)
+			{
+				PrintRow<LockFreeMap>(options, inserterCount);
+				PrintRow<MutexMap>(options, inserterCount);
+			}
+			std::cout << "\nLatencies include one steady_clock read\n";
+			return 0;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SConcurrentShaderMapBenchmark::Options options;
+	if (!SIE::SConcurrentShaderMapBenchmark::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SConcurrentShaderMapBenchmark::Run(options);
+}
@@ -0,0 +1,288 @@
+#include "Core/FrameCapture.h"
+#include "ToolSupport.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace SIE
+{
+	namespace SFrameCaptureAnalyzer
+	{
+		// Must match RE::BSShader::Type.
+		constexpr std::array<std::string_view, 11> ShaderTypeNames = { "None", "Grass", "Sky",
+			"Water", "BloodSplatter", "ImageSpace", "Lighting", "Effect", "Utility", "DistantTree",
+			"Particle" };
+
+		constexpr std::array<std::string_view, static_cast<size_t>(FrameCaptureScope::Total)>
+			ScopeNames = { "Renderer", "RenderBatches", "FinishAccumulatingDispatch",
+				"AccumulatorUnk2B", "Depth", "Shadowmasks", "World", "FirstPersonView",
+				"WaterEffects", "PlayerView" };
+
+		struct Options
+		{
+			std::filesystem::path capturePath = "FrameCapture.bin";
+			size_t frameCount = 0;
+			size_t topCount = 20;
+			std::optional<uint32_t> orderFrame;
+		};
+
+		struct TypeStatistics
+		{
+			uint64_t draws = 0;
+			uint64_t duration = 0;
+			std::set<std::pair<uint32_t, uint32_t>> permutations;
+		};
+
+		struct PermutationStatistics
+		{
+			uint64_t draws = 0;
+			uint64_t duration = 0;
+		};
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("FrameCaptureAnalyzer");
+			parser.Add("--capture", "file",
+				"frame capture written by the game (default: FrameCapture.bin)",
+				options.capturePath);
+			parser.Add("--frames", "n",
+				"analyze only the last n complete frames (default: all)", options.frameCount);
+			parser.Add("--top", "n", "permutations listed in the histogram (default: 20)",
+				options.topCount);
+			parser.Add("--order", "frame",
+				"frame whose pass ordering is printed (default: last complete frame)",
+				[&options](const std::string& value) {
+					options.orderFrame = static_cast<uint32_t>(std::stoul(value));
+				});
+			return parser.Parse(argc, argv);
+		}
+
+		static std::string_view GetShaderTypeName(uint8_t type)
+		{
+			return type < ShaderTypeNames.size() ? ShaderTypeNames[type] : "Unknown";
+		}
+
+		static std::string_view GetScopeName(uint8_t scope)
+		{
+			return scope < ScopeNames.size() ? ScopeNames[scope] : "Unknown";
+		}
+
+		// Frames whose start and end are both held by the ring.
+		static std::vector<uint32_t> GetCompleteFrames(const FrameCapture& capture)
+		{
+			std::set<uint32_t> startedFrames;
+			for (const auto& record : capture.records)
+			{
+				if (record.type == FrameCaptureRecordType::Frame)
+				{
+					startedFrames.insert(record.frameIndex);
+				}
+			}
+
+			std::vector<uint32_t> result;
+			for (const uint32_t frameIndex : startedFrames)
+			{
+				if (startedFrames.contains(frameIndex + 1))
+				{
+					result.push_back(frameIndex);
+				}
+			}
+			return result;
+		}
+
+		static void PrintFrameSummary(const FrameCapture& capture,
+			const std::set<uint32_t>& frames, double timestampsPerMillisecond)
+		{
+			std::map<uint32_t, uint64_t> frameStarts;
+			for (const auto& record : capture.records)
+			{
+				if (record.type == FrameCaptureRecordType::Frame)
+				{
+					frameStarts[record.frameIndex] = record.timestamp;
+				}
+			}
+
+			std::vector<double> frameTimes;
+			for (const uint32_t frameIndex : frames)
+			{
+				frameTimes.push_back(
+					(frameStarts[frameIndex + 1] - frameStarts[frameIndex]) / timestampsPerMillisecond);
+			}
+			std::sort(frameTimes.begin(), frameTimes.end());
+
+			double totalTime = 0.;
+			for (const double frameTime : frameTimes)
+			{
+				totalTime += frameTime;
+			}
+			std::cout << std::format("{} frames {}-{}, average {:.2f} ms, p50 {:.2f} ms, max {:.2f} ms\n\n",
+				frames.size(), *frames.begin(), *frames.rbegin(), totalTime / frameTimes.size(),
+				frameTimes[frameTimes.size() / 2], frameTimes.back());
+		}
+
+		static void PrintShaderTypes(const FrameCapture& capture, const std::set<uint32_t>& frames,
+			double timestampsPerMillisecond, size_t topCount)
+		{
+			std::map<uint8_t, TypeStatistics> types;
+			std::map<std::tuple<uint8_t, uint32_t, uint32_t>, PermutationStatistics> permutations;
+			uint64_t totalDraws = 0;
+			for (const auto& record : capture.records)
+			{
+				if (record.type != FrameCaptureRecordType::Draw || !frames.contains(record.frameIndex))
+				{
+					continue;
+				}
+				auto& typeStatistics = types[record.kind];
+				++typeStatistics.draws;
+				typeStatistics.duration += record.duration;
+				typeStatistics.permutations.emplace(record.vertexDescriptor, record.pixelDescriptor);
+				auto& permutationStatistics =
+					permutations[{ record.kind, record.vertexDescriptor, record.pixelDescriptor }];
+				++permutationStatistics.draws;
+				permutationStatistics.duration += record.duration;
+				++totalDraws;
+			}
+
+			std::cout << std::format("{:<16}{:>12}{:>14}{:>14}{:>10}{:>14}\n", "Type", "Draws",
+				"Draws/frame", "Total ms", "Share", "Permutations");
+			for (const auto& [type, statistics] : types)
+			{
+				std::cout << std::format("{:<16}{:>12}{:>14.1f}{:>14.2f}{:>9.1f}%{:>14}\n",
+					GetShaderTypeName(type), statistics.draws,
+					statistics.draws / static_cast<double>(frames.size()),
+					statistics.duration / timestampsPerMillisecond,
+					100. * statistics.draws / std::max<uint64_t>(totalDraws, 1),
+					statistics.permutations.size());
+			}
+
+			std::vector<std::pair<std::tuple<uint8_t, uint32_t, uint32_t>, PermutationStatistics>>
+				sortedPermutations(permutations.begin(), permutations.end());
+			std::sort(sortedPermutations.begin(), sortedPermutations.end(),
+				[](const auto& first, const auto& second) {
+					return first.second.draws > second.second.draws;
+				});
+			sortedPermutations.resize(std::min(sortedPermutations.size(), topCount));
+
+			std::cout << std::format("\n{:<16}{:>12}{:>12}{:>12}{:>14}\n", "Type", "Vertex",
+				"Pixel", "Draws", "Total ms");
+			for (const auto& [key, statistics] : sortedPermutations)
+			{
+				const auto& [type, vertexDescriptor, pixelDescriptor] = key;
+				std::cout << std::format("{:<16}{:>12}{:>12}{:>12}{:>14.2f}\n",
+					GetShaderTypeName(type), std::format("{:08X}", vertexDescriptor),
+					std::format("{:08X}", pixelDescriptor), statistics.draws,
+					statistics.duration / timestampsPerMillisecond);
+			}
+			std::cout << '\n';
+		}
+
+		// Scopes in the order they began, runs of draws of one type and bucket are collapsed.
+		static void PrintPassOrdering(const FrameCapture& capture, uint32_t frameIndex,
+			double timestampsPerMillisecond)
+		{
+			std::vector<FrameCaptureRecord> records;
+			for (const auto& record : capture.records)
+			{
+				if (record.frameIndex == frameIndex && record.type != FrameCaptureRecordType::Frame)
+				{
+					records.push_back(record);
+				}
+			}
+			std::stable_sort(records.begin(), records.end(),
+				[](const FrameCaptureRecord& first, const FrameCaptureRecord& second) {
+					return std::tie(first.timestamp, first.depth) <
+					       std::tie(second.timestamp, second.depth);
+				});
+
+			std::cout << std::format("Pass ordering of frame {}\n", frameIndex);
+			for (size_t index = 0; index < records.size();)
+			{
+				const auto& record = records[index];
+				const std::string indent(2 * record.depth, ' ');
+				if (record.type == FrameCaptureRecordType::Scope)
+				{
+					std::cout << std::format("{}{} [{}] <{}> {:.3f} ms\n", indent,
+						GetScopeName(record.kind), record.index, record.renderFlags,
+						record.duration / timestampsPerMillisecond);
+					++index;
+					continue;
+				}
+
+				size_t runEnd = index;
+				uint64_t duration = 0;
+				std::set<uint32_t> passes;
+				for (; runEnd < records.size() &&
+				       records[runEnd].type == FrameCaptureRecordType::Draw &&
+				       records[runEnd].kind == record.kind && records[runEnd].index == record.index &&
+				       records[runEnd].depth == record.depth;
+					 ++runEnd)
+				{
+					duration += records[runEnd].duration;
+					passes.insert(records[runEnd].passEnum);
+				}
+				std::cout << std::format("{}{} x{} bucket {}, {} passes, {:.3f} ms\n", indent,
+					GetShaderTypeName(record.kind), runEnd - index, record.index, passes.size(),
+					duration / timestampsPerMillisecond);
+				index = runEnd;
+			}
+		}
+
+		static int Run(const Options& options)
+		{
+			FrameCapture capture;
+			if (!ReadFrameCapture(options.capturePath, capture))
+			{
+				std::cerr << std::format("Failed to read frame capture {}\n",
+					options.capturePath.string());
+				return 1;
+			}
+
+			auto completeFrames = GetCompleteFrames(capture);
+			if (completeFrames.empty())
+			{
+				std::cerr << "Capture holds no complete frame\n";
+				return 1;
+			}
+			if (options.frameCount != 0 && completeFrames.size() > options.frameCount)
+			{
+				completeFrames.erase(completeFrames.begin(),
+					completeFrames.end() - options.frameCount);
+			}
+			const std::set<uint32_t> frames(completeFrames.begin(), completeFrames.end());
+
+			double timestampsPerMillisecond = capture.header.timestampsPerNanosecond * 1000000.;
+			if (timestampsPerMillisecond <= 0.)
+			{
+				std::cerr << "Capture has no timestamp rate, times are reported in millions of ticks\n";
+				timestampsPerMillisecond = 1000000.;
+			}
+
+			std::cout << std::format("{} records, {} written in total\n", capture.records.size(),
+				capture.header.writeIndex);
+			PrintFrameSummary(capture, frames, timestampsPerMillisecond);
+			PrintShaderTypes(capture, frames, timestampsPerMillisecond, options.topCount);
+			PrintPassOrdering(capture, options.orderFrame.value_or(*frames.rbegin()),
+				timestampsPerMillisecond);
+			return 0;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SFrameCaptureAnalyzer::Options options;
+	if (!SIE::SFrameCaptureAnalyzer::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SFrameCaptureAnalyzer::Run(options);
+}
@@ -0,0 +1,430 @@
+#include "Serialization/RecordFormat.h"
+#include "ToolSupport.h"
+
+#include <array>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SIE
+{
+	namespace SRecordFormatBenchmark
+	{
+		struct Options
+		{
+			size_t formCount = 10000;
+			size_t iterationCount = 5;
+			uint32_t seed = 1;
+		};
+
+		constexpr std::array<std::string_view, 4> ColorTimes = { "Sunrise", "Day", "Sunset",
+			"Night" };
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("RecordFormatBenchmark");
+			parser.Add("--forms", "n",
+				"synthetic weathers, cells and waters to export (default: 10000)",
+				options.formCount);
+			parser.Add("--iterations", "n",
+				"timed runs of every step, the fastest is reported (default: 5)",
+				options.iterationCount, 1);
+			parser.Add("--seed", "n", "seed of the synthetic data (default: 1)", options.seed);
+			return parser.Parse(argc, argv);
+		}
+
+		// Mirrors the shapes written by Serialization/Json.cpp.
+		class FormGenerator
+		{
+		public:
+			explicit FormGenerator(uint32_t seed) :
+				random(seed)
+			{}
+
+			nlohmann::json Generate(size_t index)
+			{
+				switch (index % 3)
+				{
+				case 0:
+					return MakeRecord(index, "Weather", MakeWeather());
+				case 1:
+					return MakeRecord(index, "Cell", MakeCell());
+				default:
+					return MakeRecord(index, "Water", MakeWater());
+				}
+			}
+
+		private:
+			float GetFloat(float min, float max)
+			{
+				return std::uniform_real_distribution<float>(min, max)(random);
+			}
+
+			uint32_t GetUInt(uint32_t max)
+			{
+				return std::uniform_int_distribution<uint32_t>(0, max)(random);
+			}
+
+			std::string MakeColor()
+			{
+				return std::format("{}, {}, {}, {}", GetUInt(255), GetUInt(255), GetUInt(255),
+					GetUInt(255));
+			}
+
+			std::string MakeFormKey()
+			{
+				return std::format("{:06X}:{}", GetUInt(0xFFFFFF),
+					GetUInt(1) == 0 ? "Skyrim.esm" : "Update.esm");
+			}
+
+			nlohmann::json MakeColorData()
+			{
+				nlohmann::json result;
+				for (const auto time : ColorTimes)
+				{
+					result[std::string(time)] = MakeColor();
+				}
+				return result;
+			}
+
+			nlohmann::json MakeAmbientColors()
+			{
+				return { { "DirectionalXPlus", MakeColor() }, { "DirectionalXMinus", MakeColor() },
+					{ "DirectionalYPlus", MakeColor() }, { "DirectionalYMinus", MakeColor() },
+					{ "DirectionalZPlus", MakeColor() }, { "DirectionalZMinus", MakeColor() },
+					{ "Specular", MakeColor() }, { "Scale", GetFloat(0.f, 1.f) } };
+			}
+
+			nlohmann::json MakeWeather()
+			{
+				nlohmann::json result = { { "FogDistanceDayNear", GetFloat(-1000.f, 1000.f) },
+					{ "FogDistanceDayFar", GetFloat(0.f, 100000.f) },
+					{ "FogDistanceDayMax", GetFloat(0.f, 1.f) },
+					{ "FogDistanceDayPower", GetFloat(0.f, 4.f) },
+					{ "FogDistanceNightNear", GetFloat(-1000.f, 1000.f) },
+					{ "FogDistanceNightFar", GetFloat(0.f, 100000.f) },
+					{ "FogDistanceNightMax", GetFloat(0.f, 1.f) },
+					{ "FogDistanceNightPower", GetFloat(0.f, 4.f) },
+					{ "WindSpeed", GetUInt(255) / 255.f },
+					{ "WindDirection", GetUInt(255) / 255.f * 360.f },
+					{ "Flags", GetUInt(0xFF) } };
+
+				for (const auto colorType : { "SkyUpperColor", "FogNearColor", "CloudLayerColor",
+						 "AmbientColor", "SunlightColor", "SunColor", "StarsColor", "SkyLowerColor",
+						 "HorizonColor", "EffectLightingColor", "CloudLodDiffuseColor",
+						 "CloudLodAmbientColor", "FogFarColor", "SkyStaticsColor",
+						 "WaterMultiplierColor", "SunGlareColor", "MoonGlareColor" })
+				{
+					result[colorType] = MakeColorData();
+				}
+
+				nlohmann::json ambientColors;
+				nlohmann::json imageSpaces;
+				for (const auto time : ColorTimes)
+				{
+					ambientColors[std::string(time)] = MakeAmbientColors();
+					imageSpaces[std::string(time)] = MakeFormKey();
+				}
+				result["DirectionalAmbientLightingColors"] = std::move(ambientColors);
+				result["ImageSpaces"] = std::move(imageSpaces);
+
+				nlohmann::json clouds = nlohmann::json::array();
+				nlohmann::json cloudTextures = nlohmann::json::array();
+				for (size_t layerIndex = 0; layerIndex < 32; ++layerIndex)
+				{
+					nlohmann::json alphas;
+					for (const auto time : ColorTimes)
+					{
+						alphas[std::string(time)] = GetFloat(0.f, 1.f);
+					}
+					clouds.push_back({ { "Enabled", GetUInt(1) == 0 },
+						{ "XSpeed", GetUInt(255) / 1270.f - 0.1f },
+						{ "YSpeed", GetUInt(255) / 1270.f - 0.1f }, { "Colors", MakeColorData() },
+						{ "Alphas", std::move(alphas) } });
+					if (GetUInt(3) == 0)
+					{
+						cloudTextures.push_back(
+							std::format("Data\\Textures\\Sky\\Cloud{:02}.dds", layerIndex));
+					}
+					else
+					{
+						cloudTextures.push_back(nullptr);
+					}
+				}
+				result["Clouds"] = std::move(clouds);
+				result["CloudTextures"] = std::move(cloudTextures);
+				result["SkyStatics"] = { MakeFormKey(), MakeFormKey() };
+				result["Sounds"] = { { { "Sound", MakeFormKey() }, { "Type", GetUInt(3) } } };
+				return result;
+			}
+
+			nlohmann::json MakeCell()
+			{
+				return { { "Flags", GetUInt(0xFFFF) }, { "ImageSpace", MakeFormKey() },
+					{ "LightingTemplate", MakeFormKey() }, { "SkyAndWeatherFromRegion", MakeFormKey() },
+					{ "Water", MakeFormKey() },
+					{ "WaterEnvironmentMap", "Data\\Textures\\Cubemaps\\WRTemple_e.dds" },
+					{ "Lighting",
+						{ { "AmbientColor", MakeColor() }, { "AmbientColors", MakeAmbientColors() },
+							{ "DirectionalColor", MakeColor() },
+							{ "DirectionalFade", GetFloat(0.f, 1.f) },
+							{ "DirectionalRotationXY", GetUInt(360) },
+							{ "DirectionalRotationZ", GetUInt(360) },
+							{ "FogClipDistance", GetFloat(0.f, 10000.f) },
+							{ "FogFar", GetFloat(0.f, 10000.f) }, { "FogFarColor", MakeColor() },
+							{ "FogMax", GetFloat(0.f, 1.f) }, { "FogNear", GetFloat(0.f, 1000.f) },
+							{ "FogNearColor", MakeColor() }, { "FogPower", GetFloat(0.f, 4.f) },
+							{ "Inherits", GetUInt(0x3FF) },
+							{ "LightFadeEndDistance", GetFloat(0.f, 10000.f) },
+							{ "LightFadeStartDistance", GetFloat(0.f, 10000.f) } } } };
+			}
+
+			nlohmann::json MakeWater()
+			{
+				nlohmann::json result = { { "DeepColor", MakeColor() },
+					{ "ShallowColor", MakeColor() }, { "ReflectionColor", MakeColor() },
+					{ "ImageSpace", MakeFormKey() }, { "OpenSound", MakeFormKey() },
+					{ "Material", MakeFormKey() }, { "Spell", "null" },
+					{ "Opacity", GetUInt(100) }, { "Flags", GetUInt(0xFF) },
+					{ "DamagePerSecond", GetUInt(10) }, { "FlowNormalsNoiseTexture", "" },
+					{ "LinearVelocity",
+						{ { "X", GetFloat(0.f, 1.f) }, { "Y", GetFloat(0.f, 1.f) },
+							{ "Z", GetFloat(0.f, 1.f) } } },
+					{ "AngularVelocity",
+						{ { "X", GetFloat(0.f, 1.f) }, { "Y", GetFloat(0.f, 1.f) },
+							{ "Z", GetFloat(0.f, 1.f) } } } };
+
+				for (const auto field : { "DepthNormals", "DepthReflections", "DepthRefraction",
+						 "DepthSpecularLighting", "DisplacementDampner", "DisplacementFalloff",
+						 "DisplacementFoce", "DisplacementStartingSize", "DisplacementVelocity",
+						 "FogAboveWaterAmount", "FogAboveWaterDistanceFarPlane",
+						 "FogAboveWaterDistanceNearPlane", "FogUnderWaterAmount",
+						 "FogUnderWaterDistanceFarPlane", "FogUnderWaterDistanceNearPlane",
+						 "NoiseFalloff", "SpecularBrightness", "SpecularPower", "SpecularRadius",
+						 "SpecularSunPower", "SpecularSunSparkleMagnitude",
+						 "SpecularSunSparklePower", "SpecularSunSpecularMagnitude", "WaterFresnel",
+						 "WaterReflectionMagnitude", "WaterReflectivity",
+						 "WaterRefractionMagnitude" })
+				{
+					result[field] = GetFloat(0.f, 10000.f);
+				}
+				for (const auto layer : { "One", "Two", "Three" })
+				{
+					result[std::format("NoiseLayer{}AmplitudeScale", layer)] = GetFloat(0.f, 1.f);
+					result[std::format("NoiseLayer{}Texture", layer)] =
+						"Data\\Textures\\Water\\DefaultWater.dds";
+					result[std::format("NoiseLayer{}UvScale", layer)] = GetFloat(0.f, 10000.f);
+					result[std::format("NoiseLayer{}WindDirection", layer)] = GetFloat(0.f, 360.f);
+					result[std::format("NoiseLayer{}WindSpeed", layer)] = GetFloat(0.f, 1.f);
+				}
+				return result;
+			}
+
+			nlohmann::json MakeRecord(size_t index, std::string_view type, nlohmann::json&& form)
+			{
+				return { { "Master", "Skyrim.esm" }, { "Override", "Update.esm" },
+					{ "FormKey", std::format("{:06X}:Skyrim.esm", index) },
+					{ "Type", type }, { "Form", std::move(form) },
+					{ "References", { "Skyrim.esm", "Update.esm" } } };
+			}
+
+			std::mt19937 random;
+		};
+
+		static double Measure(size_t iterationCount, const std::function<void()>& func)
+		{
+			double bestTime = 0.;
+			for (size_t iteration = 0; iteration < iterationCount; ++iteration)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				func();
+				const double time =
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+						.count();
+				bestTime = iteration == 0 ? time : std::min(bestTime, time);
+			}
+			return bestTime;
+		}
+
+		// Visits every value without building a tree, the way a streaming reader consumes records.
+		static double SumValues(const RecordValue& value)
+		{
+			switch (value.GetType())
+			{
+			case RecordValueType::Array:
+				{
+					double result = 0.;
+					value.ForEachElement(
+						[&result](const RecordValue& element) { result += SumValues(element); });
+					return result;
+				}
+			case RecordValueType::Object:
+				{
+					double result = 0.;
+					value.ForEachMember([&result](std::string_view, const RecordValue& member) {
+						result += SumValues(member);
+					});
+					return result;
+				}
+			default:
+				return value.GetFloat();
+			}
+		}
+
+		static double SumValues(const nlohmann::json& value)
+		{
+			if (value.is_structured())
+			{
+				double result = 0.;
+				for (const auto& item : value)
+				{
+					result += SumValues(item);
+				}
+				return result;
+			}
+			return value.is_number() ? value.get<double>() : 0.;
+		}
+
+		static void PrintRow(std::string_view name, size_t size, double writeTime, double readTime,
+			double traverseTime)
+		{
+			const double megabytes = size / (1024. * 1024.);
+			std::cout << std::format("{:<8}{:>12.2f}{:>12.2f}{:>12.1f}{:>12.2f}{:>12.1f}{:>14.2f}\n",
+				name, megabytes, writeTime, megabytes / writeTime * 1000., readTime,
+				megabytes / readTime * 1000., traverseTime);
+		}
+
+		static int Run(const Options& options)
+		{
+			FormGenerator generator(options.seed);
+			std::vector<nlohmann::json> forms;
+			forms.reserve(options.formCount);
+			for (size_t index = 0; index < options.formCount; ++index)
+			{
+				forms.push_back(generator.Generate(index));
+			}
+
+			std::string jsonData;
+			const double jsonWriteTime = Measure(options.iterationCount, [&] {
+				std::ostringstream stream;
+				for (const auto& form : forms)
+				{
+					stream << form << '\n';
+				}
+				jsonData = std::move(stream).str();
+			});
+
+			std::vector<nlohmann::json> jsonForms;
+			const double jsonReadTime = Measure(options.iterationCount, [&] {
+				jsonForms.clear();
+				std::istringstream stream(jsonData);
+				std::string line;
+				while (std::getline(stream, line))
+				{
+					jsonForms.push_back(nlohmann::json::parse(line));
+				}
+			});
+
+			double jsonSum = 0.;
+			const double jsonTraverseTime = Measure(options.iterationCount, [&] {
+				jsonSum = 0.;
+				std::istringstream stream(jsonData);
+				std::string line;
+				while (std::getline(stream, line))
+				{
+					jsonSum += SumValues(nlohmann::json::parse(line));
+				}
+			});
+
+			std::string recordData;
+			const double recordWriteTime = Measure(options.iterationCount, [&] {
+				std::ostringstream stream;
+				RecordWriter writer(stream);
+				for (const auto& form : forms)
+				{
+					writer.Write(form);
+				}
+				writer.Finish();
+				recordData = std::move(stream).str();
+			});
+
+			RecordFile recordFile;
+			if (!recordFile.Open(std::as_bytes(std::span(recordData))) ||
+				recordFile.GetRecordCount() != forms.size())
+			{
+				std::cerr << "Failed to open written records\n";
+				return 1;
+			}
+
+			std::vector<nlohmann::json> recordForms;
+			const double recordReadTime = Measure(options.iterationCount, [&] {
+				recordForms.clear();
+				RecordFile file;
+				file.Open(std::as_bytes(std::span(recordData)));
+				for (uint32_t index = 0; index < file.GetRecordCount(); ++index)
+				{
+					recordForms.push_back(ToJson(file.GetRecord(index)));
+				}
+			});
+
+			double recordSum = 0.;
+			const double recordTraverseTime = Measure(options.iterationCount, [&] {
+				recordSum = 0.;
+				RecordFile file;
+				file.Open(std::as_bytes(std::span(recordData)));
+				for (uint32_t index = 0; index < file.GetRecordCount(); ++index)
+				{
+					recordSum += SumValues(file.GetRecord(index));
+				}
+			});
+
+			size_t mismatchCount = 0;
+			for (size_t index = 0; index < forms.size(); ++index)
+			{
+				if (jsonForms[index] != forms[index] || recordForms[index] != forms[index])
+				{
+					if (mismatchCount++ == 0)
+					{
+						std::cerr << std::format("Form {} does not round trip:\n{}\n{}\n", index,
+							forms[index].dump(), recordForms[index].dump());
+					}
+				}
+			}
+
+			std::cout << std::format("{} forms, fastest of {} runs\n\n", forms.size(),
+				options.iterationCount);
+			std::cout << std::format("{:<8}{:>12}{:>12}{:>12}{:>12}{:>12}{:>14}\n", "Format",
+				"Size MB", "Write ms", "Write MB/s", "Read ms", "Read MB/s", "Traverse ms");
+			PrintRow("NDJSON", jsonData.size(), jsonWriteTime, jsonReadTime, jsonTraverseTime);
+			PrintRow("Records", recordData.size(), recordWriteTime, recordReadTime,
+				recordTraverseTime);
+			std::cout << std::format("\nRead builds a json tree of every form, traverse visits every "
+									 "value without keeping one (sums {:.0f} and {:.0f})\n",
+				jsonSum, recordSum);
+
+			if (mismatchCount != 0)
+			{
+				std::cerr << std::format("{} forms do not round trip\n", mismatchCount);
+				return 1;
+			}
+			std::cout << "All forms round trip\n";
+			return 0;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SRecordFormatBenchmark::Options options;
+	if (!SIE::SRecordFormatBenchmark::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SRecordFormatBenchmark::Run(options);
+}
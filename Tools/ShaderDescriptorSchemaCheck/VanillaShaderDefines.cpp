@@ -0,0 +1,1032 @@
+#include "VanillaShaderDefines.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace SIE
+{
+	namespace SVanillaShaderDefines
+	{
+		static uint32_t GetTechnique(uint32_t descriptor)
+		{
+			return 0x3F & (descriptor >> 24);
+		}
+
+		enum class LightingShaderTechniques
+		{
+			None					= 0,
+			Envmap					= 1,
+			Glowmap					= 2,
+			Parallax				= 3,
+			Facegen					= 4,
+			FacegenRGBTint			= 5,
+			Hair					= 6,
+			ParallaxOcc				= 7,
+			MTLand					= 8,
+			LODLand					= 9,
+			Snow					= 10,	// unused
+			MultilayerParallax		= 11,
+			TreeAnim				= 12,
+			LODObjects				= 13,
+			MultiIndexSparkle		= 14,
+			LODObjectHD				= 15,
+			Eye						= 16,
+			Cloud					= 17,	// unused
+			LODLandNoise			= 18,
+			MTLandLODBlend			= 19,
+			Outline					= 20,
+		};
+
+		enum class LightingShaderFlags
+		{
+			VC						= 1 << 0,
+			Skinned					= 1 << 1,
+			ModelSpaceNormals		= 1 << 2,
+			// flags 3 to 8 are unused
+			Specular				= 1 << 9,
+			SoftLighting			= 1 << 10,
+			RimLighting				= 1 << 11,
+			BackLighting			= 1 << 12,
+			ShadowDir				= 1 << 13,
+			DefShadow				= 1 << 14,
+			ProjectedUV				= 1 << 15,
+			AnisoLighting			= 1 << 16,
+			AmbientSpecular			= 1 << 17,
+			WorldMap				= 1 << 18,
+			BaseObjectIsSnow		= 1 << 19,
+			DoAlphaTest				= 1 << 20,
+			Snow					= 1 << 21,
+			CharacterLight			= 1 << 22,
+			AdditionalAlphaMask		= 1 << 23,
+		};
+
+		// The editor called the game decoder through a relocation and only added OUTLINE in front
+		// of it, the game decoder is transcribed here from its technique and flag define tables.
+		static void GetLightingShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			const auto technique =
+				static_cast<LightingShaderTechniques>(GetTechnique(descriptor));
+
+			if (technique == LightingShaderTechniques::Outline)
+			{
+				defines[0] = { "OUTLINE", nullptr };
+				++defines;
+			}
+
+			switch (technique)
+			{
+			case LightingShaderTechniques::Envmap:
+				{
+					defines[0] = { "ENVMAP", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::Glowmap:
+				{
+					defines[0] = { "GLOWMAP", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::Parallax:
+				{
+					defines[0] = { "PARALLAX", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::Facegen:
+				{
+					defines[0] = { "FACEGEN", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::FacegenRGBTint:
+				{
+					defines[0] = { "FACEGEN_RGB_TINT", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::Hair:
+				{
+					defines[0] = { "HAIR", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::ParallaxOcc:
+				{
+					defines[0] = { "PARALLAX_OCC", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::MTLand:
+				{
+					defines[0] = { "MULTI_TEXTURE", nullptr };
+					defines[1] = { "LANDSCAPE", nullptr };
+					defines += 2;
+					break;
+				}
+			case LightingShaderTechniques::LODLand:
+				{
+					defines[0] = { "LODLANDSCAPE", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::MultilayerParallax:
+				{
+					defines[0] = { "MULTI_LAYER_PARALLAX", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::TreeAnim:
+				{
+					defines[0] = { "TREE_ANIM", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::LODObjects:
+				{
+					defines[0] = { "LODOBJECTS", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::MultiIndexSparkle:
+				{
+					defines[0] = { "MULTI_INDEX", nullptr };
+					defines[1] = { "SPARKLE", nullptr };
+					defines += 2;
+					break;
+				}
+			case LightingShaderTechniques::LODObjectHD:
+				{
+					defines[0] = { "LODOBJECTSHD", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::Eye:
+				{
+					defines[0] = { "EYE", nullptr };
+					++defines;
+					break;
+				}
+			case LightingShaderTechniques::LODLandNoise:
+				{
+					defines[0] = { "LODLANDSCAPE", nullptr };
+					defines[1] = { "LODLANDNOISE", nullptr };
+					defines += 2;
+					break;
+				}
+			case LightingShaderTechniques::MTLandLODBlend:
+				{
+					defines[0] = { "MULTI_TEXTURE", nullptr };
+					defines[1] = { "LANDSCAPE", nullptr };
+					defines[2] = { "LOD_LAND_BLEND", nullptr };
+					defines += 3;
+					break;
+				}
+			default:
+				break;
+			}
+
+			static constexpr std::array<std::pair<LightingShaderFlags, const char*>, 18>
+				flagDefines = { { { LightingShaderFlags::VC, "VC" },
+					{ LightingShaderFlags::Skinned, "SKINNED" },
+					{ LightingShaderFlags::ModelSpaceNormals, "MODELSPACENORMALS" },
+					{ LightingShaderFlags::Specular, "SPECULAR" },
+					{ LightingShaderFlags::SoftLighting, "SOFT_LIGHTING" },
+					{ LightingShaderFlags::RimLighting, "RIM_LIGHTING" },
+					{ LightingShaderFlags::BackLighting, "BACK_LIGHTING" },
+					{ LightingShaderFlags::ShadowDir, "SHADOW_DIR" },
+					{ LightingShaderFlags::DefShadow, "DEFSHADOW" },
+					{ LightingShaderFlags::ProjectedUV, "PROJECTED_UV" },
+					{ LightingShaderFlags::AnisoLighting, "ANISO_LIGHTING" },
+					{ LightingShaderFlags::AmbientSpecular, "AMBIENT_SPECULAR" },
+					{ LightingShaderFlags::WorldMap, "WORLD_MAP" },
+					{ LightingShaderFlags::BaseObjectIsSnow, "BASE_OBJECT_IS_SNOW" },
+					{ LightingShaderFlags::DoAlphaTest, "DO_ALPHA_TEST" },
+					{ LightingShaderFlags::Snow, "SNOW" },
+					{ LightingShaderFlags::CharacterLight, "CHARACTER_LIGHT" },
+					{ LightingShaderFlags::AdditionalAlphaMask, "ADDITIONAL_ALPHA_MASK" } } };
+			for (const auto& [flag, name] : flagDefines)
+			{
+				if (descriptor & static_cast<uint32_t>(flag))
+				{
+					defines[0] = { name, nullptr };
+					++defines;
+				}
+			}
+
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class BloodSplatterShaderTechniques
+		{
+			Splatter = 0,
+			Flare = 1,
+		};
+
+		static void GetBloodSplaterShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			if (descriptor == static_cast<uint32_t>(BloodSplatterShaderTechniques::Splatter))
+			{
+				defines[0] = { "SPLATTER", nullptr };
+				++defines;
+			}
+			else if (descriptor == static_cast<uint32_t>(BloodSplatterShaderTechniques::Flare))
+			{
+				defines[0] = { "FLARE", nullptr };
+				++defines;
+			}
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class DistantTreeShaderTechniques
+		{
+			DistantTreeBlock = 0,
+			Depth = 1,
+		};
+
+		enum class DistantTreeShaderFlags
+		{
+			AlphaTest = 0x10000,
+		};
+
+		static void GetDistantTreeShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			const auto technique = descriptor & 1;
+			if (technique == static_cast<uint32_t>(DistantTreeShaderTechniques::Depth))
+			{
+				defines[0] = { "RENDER_DEPTH", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(DistantTreeShaderFlags::AlphaTest))
+			{
+				defines[0] = { "DO_ALPHA_TEST", nullptr };
+				++defines;
+			}
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class SkyShaderTechniques
+		{
+			SunOcclude = 0,
+			SunGlare = 1,
+			MoonAndStarsMask = 2,
+			Stars = 3,
+			Clouds = 4,
+			CloudsLerp = 5,
+			CloudsFade = 6,
+			Texture = 7,
+			Sky = 8,
+		};
+
+		static void GetSkyShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			const auto technique = static_cast<SkyShaderTechniques>(descriptor);
+			switch (technique)
+			{
+			case SkyShaderTechniques::SunOcclude:
+				{
+					defines[0] = { "OCCLUSION", nullptr };
+					++defines;
+					break;
+				}
+			case SkyShaderTechniques::SunGlare:
+				{
+					defines[0] = { "TEX", nullptr };
+					defines[1] = { "DITHER", nullptr };
+					defines += 2;
+					break;
+				}
+			case SkyShaderTechniques::MoonAndStarsMask:
+				{
+					defines[0] = { "TEX", nullptr };
+					defines[1] = { "MOONMASK", nullptr };
+					defines += 2;
+					break;
+				}
+			case SkyShaderTechniques::Stars:
+				{
+					defines[0] = { "HORIZFADE", nullptr };
+					++defines;
+					break;
+				}
+			case SkyShaderTechniques::Clouds:
+				{
+					defines[0] = { "TEX", nullptr };
+					defines[1] = { "CLOUDS", nullptr };
+					defines += 2;
+					break;
+				}
+			case SkyShaderTechniques::CloudsLerp:
+				{
+					defines[0] = { "TEX", nullptr };
+					defines[1] = { "CLOUDS", nullptr };
+					defines[2] = { "TEXLERP", nullptr };
+					defines += 3;
+					break;
+				}
+			case SkyShaderTechniques::CloudsFade:
+				{
+					defines[0] = { "TEX", nullptr };
+					defines[1] = { "CLOUDS", nullptr };
+					defines[2] = { "TEXFADE", nullptr };
+					defines += 3;
+					break;
+				}
+			case SkyShaderTechniques::Texture:
+				{
+					defines[0] = { "TEX", nullptr };
+					++defines;
+					break;
+				}
+			case SkyShaderTechniques::Sky:
+				{
+					defines[0] = { "DITHER", nullptr };
+					++defines;
+					break;
+				}
+			}
+			
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class GrassShaderTechniques
+		{
+			VertLit = 0,
+			FlatLit = 1,
+			FlatLitSlope = 2,
+			VertLitSlope = 3,
+			VertLitBillboard = 4,
+			FlatLitBillboard = 5,
+			FlatLitSlopeBillboard = 6,
+			VertLitSlopeBillboard = 7,
+			RenderDepth = 8,
+		};
+
+		enum class GrassShaderFlags
+		{
+			AlphaTest = 0x10000,
+		};
+
+		static void GetGrassShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			const auto technique = descriptor & 0b1111;
+			if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLit))
+			{
+				defines[0] = { "VERTLIT", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::FlatLitSlope))
+			{
+				defines[0] = { "SLOPE", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLitSlope))
+			{
+				defines[0] = { "VERTLIT", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::VertLitBillboard))
+			{
+				defines[0] = { "VERTLIT", nullptr };
+				++defines;
+				defines[0] = { "BILLBOARD", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::FlatLitBillboard))
+			{
+				defines[0] = { "BILLBOARD", nullptr };
+				++defines;
+			}
+			else if (technique ==
+					 static_cast<uint32_t>(GrassShaderTechniques::FlatLitSlopeBillboard))
+			{
+				defines[0] = { "SLOPE", nullptr };
+				++defines;
+				defines[0] = { "BILLBOARD", nullptr };
+				++defines;
+			}
+			else if (technique ==
+					 static_cast<uint32_t>(GrassShaderTechniques::VertLitSlopeBillboard))
+			{
+				defines[0] = { "VERTLIT", nullptr };
+				++defines;
+				defines[0] = { "SLOPE", nullptr };
+				++defines;
+				defines[0] = { "BILLBOARD", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(GrassShaderTechniques::RenderDepth))
+			{
+				defines[0] = { "RENDER_DEPTH", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(GrassShaderFlags::AlphaTest))
+			{
+				defines[0] = { "DO_ALPHA_TEST", nullptr };
+				++defines;
+			}
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class ParticleShaderTechniques
+		{
+			Particles = 0,
+			ParticlesGryColor = 1,
+			ParticlesGryAlpha = 2,
+			ParticlesGryColorAlpha = 3,
+			EnvCubeSnow = 4,
+			EnvCubeRain = 5,
+		};
+
+		static void GetParticleShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			const auto technique = static_cast<ParticleShaderTechniques>(descriptor);
+			switch (technique)
+			{
+			case ParticleShaderTechniques::ParticlesGryColor:
+				{
+					defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
+					++defines;
+					break;
+				}
+			case ParticleShaderTechniques::ParticlesGryAlpha:
+				{
+					defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
+					++defines;
+					break;
+				}
+			case ParticleShaderTechniques::ParticlesGryColorAlpha:
+				{
+					defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
+					defines[1] = { "GRAYSCALE_TO_ALPHA", nullptr };
+					defines += 2;
+					break;
+				}
+			case ParticleShaderTechniques::EnvCubeSnow:
+				{
+					defines[0] = { "ENVCUBE", nullptr };
+					defines[1] = { "SNOW", nullptr };
+					defines += 2;
+					break;
+				}
+			case ParticleShaderTechniques::EnvCubeRain:
+				{
+					defines[0] = { "ENVCUBE", nullptr };
+					defines[1] = { "RAIN", nullptr };
+					defines += 2;
+					break;
+				}
+			default:
+				break;
+			}
+
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class EffectShaderFlags
+		{
+			Vc						= 1 << 0,
+			TexCoord				= 1 << 1,
+			TexCoordIndex			= 1 << 2,
+			Skinned					= 1 << 3,
+			Normals					= 1 << 4,
+			BinormalTangent			= 1 << 5,
+			Texture					= 1 << 6,
+			IndexedTexture			= 1 << 7,
+			Falloff					= 1 << 8,
+			AddBlend				= 1 << 10,
+			MultBlend				= 1 << 11,
+			Particles				= 1 << 12,
+			StripParticles			= 1 << 13,
+			Blood					= 1 << 14,
+			Membrane				= 1 << 15,
+			Lighting				= 1 << 16,
+			ProjectedUv				= 1 << 17,
+			Soft					= 1 << 18,
+			GrayscaleToColor		= 1 << 19,
+			GrayscaleToAlpha		= 1 << 20,
+			IgnoreTexAlpha			= 1 << 21,
+			MultBlendDecal			= 1 << 22,
+			AlphaTest				= 1 << 23,
+			SkyObject				= 1 << 24,
+			MsnSpuSkinned			= 1 << 25,
+			MotionVectorsNormals	= 1 << 26,
+		};
+
+		static void GetEffectShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Vc))
+			{
+				defines[0] = { "VC", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::TexCoord))
+			{
+				defines[0] = { "TEXCOORD", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::TexCoordIndex))
+			{
+				defines[0] = { "TEXCOORD_INDEX", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Skinned))
+			{
+				defines[0] = { "SKINNED", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Normals))
+			{
+				defines[0] = { "NORMALS", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::BinormalTangent))
+			{
+				defines[0] = { "BINORMAL_TANGENT", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Texture))
+			{
+				defines[0] = { "TEXTURE", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::IndexedTexture))
+			{
+				defines[0] = { "INDEXED_TEXTURE", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Falloff))
+			{
+				defines[0] = { "FALLOFF", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::AddBlend))
+			{
+				defines[0] = { "ADDBLEND", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MultBlend))
+			{
+				defines[0] = { "MULTBLEND", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Particles))
+			{
+				defines[0] = { "PARTICLES", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::StripParticles))
+			{
+				defines[0] = { "STRIP_PARTICLES", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Blood))
+			{
+				defines[0] = { "BLOOD", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Membrane))
+			{
+				defines[0] = { "MEMBRANE", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Lighting))
+			{
+				defines[0] = { "LIGHTING", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::ProjectedUv))
+			{
+				defines[0] = { "PROJECTED_UV", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::Soft))
+			{
+				defines[0] = { "SOFT", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::GrayscaleToColor))
+			{
+				defines[0] = { "GRAYSCALE_TO_COLOR", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::GrayscaleToAlpha))
+			{
+				defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::IgnoreTexAlpha))
+			{
+				defines[0] = { "IGNORE_TEX_ALPHA", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MultBlendDecal))
+			{
+				defines[0] = { "MULTBLEND_DECAL", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::AlphaTest))
+			{
+				defines[0] = { "ALPHA_TEST", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::SkyObject))
+			{
+				defines[0] = { "SKY_OBJECT", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MsnSpuSkinned))
+			{
+				defines[0] = { "MSN_SPU_SKINNED", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(EffectShaderFlags::MotionVectorsNormals))
+			{
+				defines[0] = { "MOTIONVECTORS_NORMALS", nullptr };
+				++defines;
+			}
+
+			defines[0] = { nullptr, nullptr };
+		}
+
+		enum class WaterShaderTechniques
+		{
+			Underwater = 8,
+			Lod = 9,
+			Stencil = 10,
+			Simple = 11,
+		};
+
+		enum class WaterShaderFlags
+		{
+			Vc = 1 << 0,
+			NormalTexCoord = 1 << 1,
+			Reflections = 1 << 2,
+			Refractions = 1 << 3,
+			Depth = 1 << 4,
+			Interior = 1 << 5,
+			Wading = 1 << 6,
+			VertexAlphaDepth = 1 << 7,
+			Cubemap = 1 << 8,
+			Flowmap = 1 << 9,
+			BlendNormals = 1 << 10,
+		};
+
+		static void GetWaterShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			defines[0] = { "WATER", nullptr };
+			defines[1] = { "FOG", nullptr };
+			defines += 2;
+
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Vc))
+			{
+				defines[0] = { "VC", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::NormalTexCoord))
+			{
+				defines[0] = { "NORMAL_TEXCOORD", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Reflections))
+			{
+				defines[0] = { "REFLECTIONS", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Refractions))
+			{
+				defines[0] = { "REFRACTIONS", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Depth))
+			{
+				defines[0] = { "DEPTH", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Interior))
+			{
+				defines[0] = { "INTERIOR", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Wading))
+			{
+				defines[0] = { "WADING", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::VertexAlphaDepth))
+			{
+				defines[0] = { "VERTEX_ALPHA_DEPTH", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Cubemap))
+			{
+				defines[0] = { "CUBEMAP", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::Flowmap))
+			{
+				defines[0] = { "FLOWMAP", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(WaterShaderFlags::BlendNormals))
+			{
+				defines[0] = { "BLEND_NORMALS", nullptr };
+				++defines;
+			}
+
+			const auto technique = (descriptor >> 11) & 0xF;
+			if (technique == static_cast<uint32_t>(WaterShaderTechniques::Underwater))
+			{
+				defines[0] = { "UNDERWATER", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Lod))
+			{
+				defines[0] = { "LOD", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Stencil))
+			{
+				defines[0] = { "STENCIL", nullptr };
+				++defines;
+			}
+			else if (technique == static_cast<uint32_t>(WaterShaderTechniques::Simple))
+			{
+				defines[0] = { "SIMPLE", nullptr };
+				++defines;
+			}
+			else if (technique < 8)
+			{
+				static constexpr std::array<const char*, 8> numLightDefines = { { "0", "1", "2", "3", "4",
+					"5", "6", "7" } };
+				defines[0] = { "SPECULAR", nullptr };
+				defines[1] = { "NUM_SPECULAR_LIGHTS", numLightDefines[technique] };
+				defines += 2;
+			}
+
+			defines[0] = { nullptr, nullptr };
+		}
+
+		static void GetUtilityShaderDefines(uint32_t descriptor, ShaderDefine* defines)
+		{
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Vc))
+			{
+				defines[0] = { "VC", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Texture))
+			{
+				defines[0] = { "TEXTURE", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Skinned))
+			{
+				defines[0] = { "SKINNED", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::Normals))
+			{
+				defines[0] = { "NORMALS", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::AlphaTest))
+			{
+				defines[0] = { "ALPHA_TEST", nullptr };
+				++defines;
+			}
+
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LodLandscape))
+			{
+				if (descriptor &
+					(static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask) |
+						static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot)))
+				{
+					defines[0] = { "FOCUS_SHADOW", nullptr };
+				}
+				else
+				{
+					defines[0] = { "LOD_LANDSCAPE", nullptr };
+				}
+				++defines;
+			}
+
+			if ((descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
+				!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
+			{
+				defines[0] = { "RENDER_NORMAL", nullptr };
+				++defines;
+			}
+			else if (!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
+					 (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
+			{
+				defines[0] = { "RENDER_NORMAL_CLEAR", nullptr };
+				++defines;
+			}
+			else if ((descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormal)) &&
+				(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClear)))
+			{
+				defines[0] = { "STENCIL_ABOVE_WATER", nullptr };
+				++defines;
+			}
+
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalFalloff))
+			{
+				defines[0] = { "RENDER_NORMAL_FALLOFF", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderNormalClamp))
+			{
+				defines[0] = { "RENDER_NORMAL_CLAMP", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderDepth))
+			{
+				defines[0] = { "RENDER_DEPTH", nullptr };
+				++defines;
+			}
+			
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::OpaqueEffect))
+			{
+				defines[0] = { "OPAQUE_EFFECT", nullptr };
+				++defines;
+				if (!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap)) &&
+					(descriptor & static_cast<uint32_t>(UtilityShaderFlags::AdditionalAlphaMask)))
+				{
+					defines[0] = { "ADDITIONAL_ALPHA_MASK", nullptr };
+					++defines;
+				}
+				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::GrayscaleToAlpha))
+				{
+					defines[0] = { "GRAYSCALE_TO_ALPHA", nullptr };
+					++defines;
+				}
+			}
+			else
+			{
+				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap))
+				{
+					defines[0] = { "RENDER_SHADOWMAP", nullptr };
+					++defines;
+					if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmapPb))
+					{
+						defines[0] = { "RENDER_SHADOWMAP_PB", nullptr };
+						++defines;
+					}
+				}
+				else if (descriptor &
+						 static_cast<uint32_t>(UtilityShaderFlags::AdditionalAlphaMask))
+				{
+					defines[0] = { "ADDITIONAL_ALPHA_MASK", nullptr };
+					++defines;
+				}
+				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmapClamped))
+				{
+					defines[0] = { "RENDER_SHADOWMAP_CLAMPED", nullptr };
+					++defines;
+				}
+			}
+
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::GrayscaleMask))
+			{
+				defines[0] = { "GRAYSCALE_MASK", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask))
+			{
+				defines[0] = { "RENDER_SHADOWMASK", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot))
+			{
+				defines[0] = { "RENDER_SHADOWMASKSPOT", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskPb))
+			{
+				defines[0] = { "RENDER_SHADOWMASKPB", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskDpb))
+			{
+				defines[0] = { "RENDER_SHADOWMASKDPB", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderBaseTexture))
+			{
+				defines[0] = { "RENDER_BASE_TEXTURE", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::TreeAnim))
+			{
+				defines[0] = { "TREE_ANIM", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LodObject))
+			{
+				defines[0] = { "LOD_OBJECT", nullptr };
+				++defines;
+			}
+			if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::LocalMapFogOfWar))
+			{
+				defines[0] = { "LOCALMAP_FOGOFWAR", nullptr };
+				++defines;
+			}
+
+			if (descriptor & (static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmask) |
+								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskDpb) |
+								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskPb) |
+								 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmaskSpot)))
+			{
+				static constexpr std::array<const char*, 5> shadowFilters = { { "0", "1", "2",
+					"3", "4" } };
+				const size_t shadowFilterIndex = std::clamp((descriptor >> 17) & 0b111, 0u, 4u);
+				defines[0] = { "SHADOWFILTER", shadowFilters[shadowFilterIndex] };
+				++defines;
+			}
+			else if ((!(descriptor & static_cast<uint32_t>(UtilityShaderFlags::OpaqueEffect)) &&
+						 (descriptor &
+							 static_cast<uint32_t>(UtilityShaderFlags::RenderShadowmap))) ||
+					 (descriptor & static_cast<uint32_t>(UtilityShaderFlags::RenderDepth)))
+			{
+				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::DepthWriteDecals))
+				{
+					defines[0] = { "DEPTH_WRITE_DECALS", nullptr };
+					++defines;
+				}
+			}
+			else
+			{
+				if (descriptor & (static_cast<uint32_t>(UtilityShaderFlags::DepthWriteDecals) |
+									 static_cast<uint32_t>(UtilityShaderFlags::DebugColor)))
+				{
+					defines[0] = { "DEBUG_COLOR", nullptr };
+					++defines;
+				}
+				if (descriptor & static_cast<uint32_t>(UtilityShaderFlags::DebugShadowSplit))
+				{
+					defines[0] = { "DEBUG_SHADOWSPLIT", nullptr };
+					++defines;
+				}
+			}
+
+			defines[0] = { "SHADOWSPLITCOUNT", "3" };
+			++defines;
+
+			if ((descriptor & 0x14000) != 0x14000 &&
+				((descriptor & 0x20004000) == 0x4000 || (descriptor & 0x1E02000) == 0x2000) &&
+				!(descriptor & 0x80) && (descriptor & 0x14000) != 0x10000)
+			{
+				defines[0] = { "NO_PIXEL_SHADER", nullptr };
+				++defines;
+			}
+
+			defines[0] = { nullptr, nullptr };
+		}
+	}
+
+	size_t GetVanillaShaderDefines(uint8_t shaderType, uint32_t descriptor,
+		std::span<ShaderDefine, VanillaShaderDefineCount> defines)
+	{
+		using namespace SVanillaShaderDefines;
+
+		defines[0] = { nullptr, nullptr };
+		switch (shaderType)
+		{
+		case 1:
+			GetGrassShaderDefines(descriptor, defines.data());
+			break;
+		case 2:
+			GetSkyShaderDefines(descriptor, defines.data());
+			break;
+		case 3:
+			GetWaterShaderDefines(descriptor, defines.data());
+			break;
+		case 4:
+			GetBloodSplaterShaderDefines(descriptor, defines.data());
+			break;
+		case 6:
+			GetLightingShaderDefines(descriptor, defines.data());
+			break;
+		case 7:
+			GetEffectShaderDefines(descriptor, defines.data());
+			break;
+		case 8:
+			GetUtilityShaderDefines(descriptor, defines.data());
+			break;
+		case 9:
+			GetDistantTreeShaderDefines(descriptor, defines.data());
+			break;
+		case 10:
+			GetParticleShaderDefines(descriptor, defines.data());
+			break;
+		default:
+			break;
+		}
+		return static_cast<size_t>(std::find_if(defines.begin(), defines.end(),
+									   [](const ShaderDefine& define) {
+										   return define.name == nullptr;
+									   }) -
+								   defines.begin());
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Core/ShaderDescriptorSchema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace SIE
+{
+	constexpr size_t VanillaShaderDefineCount = 64;
+
+	// Hand-written decoders the descriptor schemas replaced, kept unchanged as the reference the
+	// schemas are checked against. shaderType must match RE::BSShader::Type, imagespace is not
+	// covered. Writes defines terminated by a null name and returns their count.
+	size_t GetVanillaShaderDefines(uint8_t shaderType, uint32_t descriptor,
+		std::span<ShaderDefine, VanillaShaderDefineCount> defines);
+}
@@ -0,0 +1,217 @@
+#include "VanillaShaderDefines.h"
+
+#include "Core/ShaderDescriptorSchema.h"
+#include "ToolSupport.h"
+
+#include <array>
+#include <bit>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace SIE
+{
+	namespace SShaderDescriptorSchemaCheck
+	{
+		struct ShaderTypeInfo
+		{
+			std::string_view name;
+			// Must match RE::BSShader::Type.
+			uint8_t type;
+			const ShaderDescriptorSchema* schema;
+		};
+
+		// Imagespace rules are built in ShaderCache.cpp from the CommonLib effect enum.
+		constexpr std::array<ShaderTypeInfo, 9> ShaderTypes = { {
+			{ "Grass", 1, &GrassShaderSchema },
+			{ "Sky", 2, &SkyShaderSchema },
+			{ "Water", 3, &WaterShaderSchema },
+			{ "BloodSplatter", 4, &BloodSplatterShaderSchema },
+			{ "Lighting", 6, &LightingShaderSchema },
+			{ "Effect", 7, &EffectShaderSchema },
+			{ "Utility", 8, &UtilityShaderSchema },
+			{ "DistantTree", 9, &DistantTreeShaderSchema },
+			{ "Particle", 10, &ParticleShaderSchema },
+		} };
+
+		struct Options
+		{
+			size_t maxExhaustiveBits = 22;
+			size_t sampleCount = 1 << 21;
+			size_t encodeCount = 10000;
+			size_t printCount = 5;
+			uint32_t seed = 1;
+		};
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("ShaderDescriptorSchemaCheck");
+			parser.Add("--exhaustive-bits", "n",
+				"schemas reading at most n descriptor bits are checked for every combination of "
+				"them (default: 22)",
+				options.maxExhaustiveBits);
+			parser.Add("--samples", "n",
+				"random descriptors checked for larger schemas, a quarter as many with unused "
+				"bits set are checked for every schema (default: 2097152)",
+				options.sampleCount);
+			parser.Add("--encodes", "n",
+				"distinct define sets of valid descriptors encoded back per shader type "
+				"(default: 10000)",
+				options.encodeCount);
+			parser.Add("--print", "n", "mismatches printed per shader type (default: 5)",
+				options.printCount);
+			parser.Add("--seed", "n", "seed of the random descriptors (default: 1)",
+				options.seed);
+			return parser.Parse(argc, argv);
+		}
+
+		// Both decoders are compared after the canonicalization ShaderCache applies before
+		// compiling, define order and repeated names do not change the compiled shader.
+		static std::string GetSchemaDefines(const ShaderDescriptorSchema& schema,
+			uint32_t descriptor)
+		{
+			std::array<ShaderDefine, 64> defines;
+			const size_t count = CanonicalizeDefines(
+				std::span(defines).first(DecodeDescriptor(schema, descriptor, defines)));
+			return MergeDefinesString(std::span(defines).first(count));
+		}
+
+		static std::string GetVanillaDefines(uint8_t type, uint32_t descriptor)
+		{
+			std::array<ShaderDefine, VanillaShaderDefineCount> defines;
+			const size_t count = CanonicalizeDefines(
+				std::span(defines).first(GetVanillaShaderDefines(type, descriptor, defines)));
+			return MergeDefinesString(std::span(defines).first(count));
+		}
+
+		// Small descriptors are always checked, schemas comparing the whole descriptor only
+		// match a few of them.
+		static void ForEachDescriptor(const Options& options, const ShaderDescriptorSchema& schema,
+			std::mt19937& random, const std::function<void(uint32_t)>& func)
+		{
+			constexpr uint32_t SmallDescriptorCount = 0x10000;
+
+			for (uint32_t descriptor = 0; descriptor < SmallDescriptorCount; ++descriptor)
+			{
+				func(descriptor);
+			}
+
+			const uint32_t usedBits = GetUsedBits(schema);
+			if (static_cast<size_t>(std::popcount(usedBits)) <= options.maxExhaustiveBits)
+			{
+				uint32_t descriptor = 0;
+				do
+				{
+					func(descriptor);
+					descriptor = (descriptor - usedBits) & usedBits;
+				} while (descriptor != 0);
+			}
+			else
+			{
+				for (size_t index = 0; index < options.sampleCount; ++index)
+				{
+					func(static_cast<uint32_t>(random()) & usedBits);
+				}
+			}
+
+			for (size_t index = 0; index < options.sampleCount / 4; ++index)
+			{
+				func(static_cast<uint32_t>(random()));
+			}
+		}
+
+		struct TypeResult
+		{
+			size_t descriptorCount = 0;
+			size_t decodeMismatchCount = 0;
+			size_t encodeFailureCount = 0;
+			// One valid descriptor for each distinct define set checked by encoding.
+			std::unordered_map<std::string, uint32_t> defineSets;
+		};
+
+		static TypeResult CheckType(const Options& options, const ShaderTypeInfo& typeInfo,
+			std::mt19937& random)
+		{
+			TypeResult result;
+			ForEachDescriptor(options, *typeInfo.schema, random, [&](uint32_t descriptor) {
+				++result.descriptorCount;
+				auto schemaDefines = GetSchemaDefines(*typeInfo.schema, descriptor);
+				const auto vanillaDefines = GetVanillaDefines(typeInfo.type, descriptor);
+				if (schemaDefines != vanillaDefines)
+				{
+					if (result.decodeMismatchCount++ < options.printCount)
+					{
+						std::cerr << std::format(
+							"{} {:08X} decodes differently\n  schema:  {}\n  vanilla: {}\n",
+							typeInfo.name, descriptor, schemaDefines, vanillaDefines);
+					}
+				}
+				if (result.defineSets.size() < options.encodeCount &&
+					IsValidDescriptor(*typeInfo.schema, descriptor))
+				{
+					result.defineSets.try_emplace(std::move(schemaDefines), descriptor);
+				}
+			});
+
+			// Encoding must give back a descriptor with the same defines, though not
+			// necessarily the one they were decoded from.
+			size_t printedCount = 0;
+			for (const auto& [defines, descriptor] : result.defineSets)
+			{
+				std::array<ShaderDefine, 64> decoded;
+				const size_t count = DecodeDescriptor(*typeInfo.schema, descriptor, decoded);
+				const auto encoded =
+					EncodeDescriptor(*typeInfo.schema, std::span(decoded).first(count));
+				if (!encoded.has_value() || GetSchemaDefines(*typeInfo.schema, *encoded) != defines)
+				{
+					++result.encodeFailureCount;
+					if (printedCount++ < options.printCount)
+					{
+						std::cerr << std::format("{} defines of {:08X} do not encode back: {}\n",
+							typeInfo.name, descriptor, defines);
+					}
+				}
+			}
+			return result;
+		}
+
+		static int Run(const Options& options)
+		{
+			std::mt19937 random(options.seed);
+			size_t failureCount = 0;
+
+			std::cout << std::format("{:<16}{:>14}{:>14}{:>14}{:>14}\n", "Type", "Descriptors",
+				"Mismatches", "Encoded", "Not encoded");
+			for (const auto& typeInfo : ShaderTypes)
+			{
+				const auto result = CheckType(options, typeInfo, random);
+				std::cout << std::format("{:<16}{:>14}{:>14}{:>14}{:>14}\n", typeInfo.name,
+					result.descriptorCount, result.decodeMismatchCount, result.defineSets.size(),
+					result.encodeFailureCount);
+				failureCount += result.decodeMismatchCount + result.encodeFailureCount;
+			}
+
+			if (failureCount != 0)
+			{
+				std::cerr << std::format("{} checks failed\n", failureCount);
+				return 1;
+			}
+			std::cout << "\nEvery schema decodes like the decoder it replaced\n";
+			return 0;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SShaderDescriptorSchemaCheck::Options options;
+	if (!SIE::SShaderDescriptorSchemaCheck::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SShaderDescriptorSchemaCheck::Run(options);
+}
@@ -0,0 +1,257 @@
+#include "Core/ShaderDiskCache.h"
+#include "ToolSupport.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <string_view>
+
+namespace SIE
+{
+	namespace SShaderDiskCacheCheck
+	{
+		constexpr ShaderCacheKey Key = { 6, 1, 0x1234, 0x5678 };
+		constexpr std::string_view Defines = "VC;SKINNED;MODELSPACENORMALS;";
+
+		static ShaderCacheEntry MakeEntry(uint8_t seed)
+		{
+			ShaderCacheEntry entry;
+			entry.reflection.bufferSizes = { 16u + seed, 32, 48 };
+			entry.reflection.vertexDesc = 0x0000000b00000401ull + seed;
+			entry.reflection.constantTable = { 0, 4, -1, 8, static_cast<int8_t>(seed) };
+			for (size_t index = 0; index < 4096; ++index)
+			{
+				entry.byteCode.push_back(static_cast<uint8_t>(index * 31 + seed));
+			}
+			return entry;
+		}
+
+		static bool IsSameEntry(const std::optional<ShaderCacheEntry>& loaded,
+			const ShaderCacheEntry& expected)
+		{
+			return loaded.has_value() &&
+			       loaded->reflection.bufferSizes == expected.reflection.bufferSizes &&
+			       loaded->reflection.vertexDesc == expected.reflection.vertexDesc &&
+			       loaded->reflection.constantTable == expected.reflection.constantTable &&
+			       loaded->byteCode == expected.byteCode;
+		}
+
+		static std::filesystem::path FindEntryFile(const std::filesystem::path& directory)
+		{
+			for (const auto& item : std::filesystem::recursive_directory_iterator(directory))
+			{
+				if (item.is_regular_file() && item.path().extension() == ".bin")
+				{
+					return item.path();
+				}
+			}
+			return {};
+		}
+
+		static void WriteText(const std::filesystem::path& path, std::string_view text)
+		{
+			std::filesystem::create_directories(path.parent_path());
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file << text;
+		}
+
+		// Moves the write time forward, file system timestamps may be too coarse to notice a
+		// rewrite done right after the previous one.
+		static void Touch(const std::filesystem::path& path)
+		{
+			std::filesystem::last_write_time(path,
+				std::filesystem::last_write_time(path) + std::chrono::seconds(2));
+		}
+
+		static bool CheckHash(const std::filesystem::path&)
+		{
+			// FNV-1a reference values.
+			return HashString("") == 0xcbf29ce484222325ull &&
+			       HashString("a") == 0xaf63dc4c8601ec8cull &&
+			       HashString("b", HashString("a")) == HashString("ab");
+		}
+
+		static bool CheckRoundTrip(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			const auto entry = MakeEntry(1);
+			return cache.Store(Key, Defines, entry) && IsSameEntry(cache.Load(Key, Defines), entry);
+		}
+
+		static bool CheckOverwrite(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			const auto entry = MakeEntry(2);
+			return cache.Store(Key, Defines, MakeEntry(1)) && cache.Store(Key, Defines, entry) &&
+			       IsSameEntry(cache.Load(Key, Defines), entry);
+		}
+
+		static bool CheckMissingEntry(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			return !cache.Load(Key, Defines).has_value();
+		}
+
+		static bool CheckKeyMismatch(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			if (!cache.Store(Key, Defines, MakeEntry(1)))
+			{
+				return false;
+			}
+
+			auto otherSource = Key;
+			otherSource.sourceHash ^= 1;
+			auto otherType = Key;
+			otherType.shaderType = 8;
+			auto otherClass = Key;
+			otherClass.shaderClass = 0;
+			auto otherDefines = Key;
+			otherDefines.definesHash ^= 1;
+			return !cache.Load(otherSource, Defines).has_value() &&
+			       !cache.Load(otherType, Defines).has_value() &&
+			       !cache.Load(otherClass, Defines).has_value() &&
+			       !cache.Load(otherDefines, Defines).has_value() &&
+			       !cache.Load(Key, "VC;SKINNED;").has_value() &&
+			       !cache.Load(Key, "VC;SKINNED;MODELSPACENORMALX;").has_value();
+		}
+
+		static bool CheckCorruptPayload(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			if (!cache.Store(Key, Defines, MakeEntry(1)))
+			{
+				return false;
+			}
+
+			const auto entryPath = FindEntryFile(directory);
+			const auto size = std::filesystem::file_size(entryPath);
+			{
+				std::fstream file(entryPath, std::ios::binary | std::ios::in | std::ios::out);
+				file.seekg(static_cast<std::streamoff>(size - 100));
+				const char value = static_cast<char>(file.get());
+				file.seekp(static_cast<std::streamoff>(size - 100));
+				file.put(static_cast<char>(value ^ 0x40));
+			}
+			return !cache.Load(Key, Defines).has_value();
+		}
+
+		static bool CheckTruncatedEntry(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			if (!cache.Store(Key, Defines, MakeEntry(1)))
+			{
+				return false;
+			}
+
+			const auto entryPath = FindEntryFile(directory);
+			std::filesystem::resize_file(entryPath, std::filesystem::file_size(entryPath) - 1);
+			if (cache.Load(Key, Defines).has_value())
+			{
+				return false;
+			}
+			std::filesystem::resize_file(entryPath, 16);
+			return !cache.Load(Key, Defines).has_value();
+		}
+
+		static bool CheckVersionMismatch(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			if (!cache.Store(Key, Defines, MakeEntry(1)))
+			{
+				return false;
+			}
+
+			// Version follows the magic at the start of the header.
+			{
+				const uint32_t version = ShaderDiskCache::Version - 1;
+				std::fstream file(FindEntryFile(directory),
+					std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(sizeof(uint32_t));
+				file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+			}
+			return !cache.Load(Key, Defines).has_value();
+		}
+
+		static bool CheckClear(const std::filesystem::path& directory)
+		{
+			const ShaderDiskCache cache(directory);
+			if (!cache.Store(Key, Defines, MakeEntry(1)))
+			{
+				return false;
+			}
+			cache.Clear();
+			return !cache.Load(Key, Defines).has_value() && !std::filesystem::exists(directory);
+		}
+
+		static bool CheckSourceHashIncludes(const std::filesystem::path& directory)
+		{
+			const auto rootPath = directory / "Lighting.hlsl";
+			const auto includePath = directory / "Common" / "Color.hlsli";
+			WriteText(rootPath, "#include \"Common/Color.hlsli\"\nfloat4 main() : SV_Target;\n");
+			WriteText(includePath, "  #  include \"../Lighting.hlsl\"\nfloat3 Color;\n");
+
+			ShaderSourceStore sourceStore;
+			ShaderSourceHasher hasher(sourceStore);
+			const uint64_t hash = hasher.GetHash(rootPath);
+			if (hasher.GetHash(directory / "Common" / ".." / "Lighting.hlsl") != hash ||
+				!hasher.PollChanges().empty())
+			{
+				return false;
+			}
+
+			WriteText(includePath, "  #  include \"../Lighting.hlsl\"\nfloat4 Color;\n");
+			Touch(includePath);
+			const auto changes = hasher.PollChanges();
+			if (changes.size() != 1 || changes.front() != rootPath.lexically_normal())
+			{
+				return false;
+			}
+			const uint64_t changedHash = hasher.GetHash(rootPath);
+			if (changedHash == hash)
+			{
+				return false;
+			}
+
+			ShaderSourceStore otherStore;
+			ShaderSourceHasher otherHasher(otherStore);
+			return otherHasher.GetHash(rootPath) == changedHash;
+		}
+
+		static bool CheckMissingSource(const std::filesystem::path& directory)
+		{
+			ShaderSourceStore sourceStore;
+			ShaderSourceHasher hasher(sourceStore);
+			return sourceStore.Get(directory / "Missing.hlsl") == nullptr &&
+			       hasher.GetHash(directory / "Missing.hlsl") !=
+			           hasher.GetHash(directory / "Other.hlsl");
+		}
+
+		constexpr std::array<ToolCheck, 11> Checks = { {
+			{ "Hash", &CheckHash },
+			{ "Store and load", &CheckRoundTrip },
+			{ "Overwrite", &CheckOverwrite },
+			{ "Missing entry", &CheckMissingEntry },
+			{ "Key mismatch", &CheckKeyMismatch },
+			{ "Corrupt payload", &CheckCorruptPayload },
+			{ "Truncated entry", &CheckTruncatedEntry },
+			{ "Version mismatch", &CheckVersionMismatch },
+			{ "Clear", &CheckClear },
+			{ "Source hash includes", &CheckSourceHashIncludes },
+			{ "Missing source", &CheckMissingSource },
+		} };
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path directory;
+	SIE::ToolOptionParser parser("ShaderDiskCacheCheck");
+	parser.AddScratchDirectory(directory);
+	if (!parser.Parse(argc, argv))
+	{
+		return 2;
+	}
+	return SIE::RunToolChecks(SIE::SShaderDiskCacheCheck::Checks, directory);
+}
@@ -0,0 +1,63 @@
+#include "ShaderCompiler.h"
+
+#include <cstdlib>
+#include <format>
+
+namespace SIE
+{
+	namespace SShaderCompiler
+	{
+		static std::string Quote(const std::string& text)
+		{
+			return std::format("\"{}\"", text);
+		}
+
+		static void ReplaceAll(std::string& text, std::string_view pattern,
+			const std::string& replacement)
+		{
+			for (auto position = text.find(pattern); position != std::string::npos;
+				 position = text.find(pattern, position + replacement.size()))
+			{
+				text.replace(position, pattern.size(), replacement);
+			}
+		}
+	}
+
+	CommandLineShaderCompiler::CommandLineShaderCompiler(std::string aCommand) :
+		command(std::move(aCommand))
+	{}
+
+	bool CommandLineShaderCompiler::Compile(const ShaderCompileJob& job, std::string& error)
+	{
+		std::string defines;
+		for (const auto& define : job.defines)
+		{
+			if (define.name == nullptr)
+			{
+				break;
+			}
+			defines += define.definition != nullptr ?
+			               std::format(" -D {}={}", define.name, define.definition) :
+			               std::format(" -D {}", define.name);
+		}
+
+		std::error_code errorCode;
+		std::filesystem::create_directories(job.outputPath.parent_path(), errorCode);
+
+		auto commandLine = command;
+		SShaderCompiler::ReplaceAll(commandLine, "{source}",
+			SShaderCompiler::Quote(job.sourcePath.string()));
+		SShaderCompiler::ReplaceAll(commandLine, "{profile}", std::string(job.profile));
+		SShaderCompiler::ReplaceAll(commandLine, "{defines}", defines);
+		SShaderCompiler::ReplaceAll(commandLine, "{output}",
+			SShaderCompiler::Quote(job.outputPath.string()));
+
+		const int exitCode = std::system(commandLine.c_str());
+		if (exitCode != 0)
+		{
+			error = std::format("'{}' exited with {}", commandLine, exitCode);
+			return false;
+		}
+		return true;
+	}
+}
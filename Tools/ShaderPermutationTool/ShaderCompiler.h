@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Core/ShaderDescriptorSchema.h"
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace SIE
+{
+	struct ShaderCompileJob
+	{
+		std::filesystem::path sourcePath;
+		std::string_view profile;
+		std::span<const ShaderDefine> defines;
+		std::filesystem::path outputPath;
+	};
+
+	class ShaderCompiler
+	{
+	public:
+		virtual ~ShaderCompiler() = default;
+
+		// May be called from several threads at once.
+		virtual bool Compile(const ShaderCompileJob& job, std::string& error) = 0;
+	};
+
+	// Runs an external compiler, {source}, {profile}, {defines} and {output} in the command are
+	// replaced with values of the job, e.g. "dxc -T {profile} -E main {defines} -Fo {output} {source}".
+	class CommandLineShaderCompiler : public ShaderCompiler
+	{
+	public:
+		explicit CommandLineShaderCompiler(std::string command);
+
+		bool Compile(const ShaderCompileJob& job, std::string& error) override;
+
+	private:
+		std::string command;
+	};
+}
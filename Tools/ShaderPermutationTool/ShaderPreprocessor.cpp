@@ -0,0 +1,707 @@
+#include "ShaderPreprocessor.h"
+
+#include "Core/ShaderDiskCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace SIE
+{
+	namespace SShaderPreprocessor
+	{
+		using Token = ShaderPreprocessor::Token;
+		using SourceLine = ShaderPreprocessor::SourceLine;
+
+		constexpr size_t MaxExpansionDepth = 16;
+
+		static std::string_view Trim(std::string_view text)
+		{
+			const auto begin = text.find_first_not_of(" \t\r");
+			if (begin == std::string_view::npos)
+			{
+				return {};
+			}
+			const auto end = text.find_last_not_of(" \t\r");
+			return text.substr(begin, end - begin + 1);
+		}
+
+		static std::string StripComments(std::string_view text)
+		{
+			std::string result;
+			result.reserve(text.size());
+			for (size_t index = 0; index < text.size(); ++index)
+			{
+				if (text[index] == '/' && index + 1 < text.size())
+				{
+					if (text[index + 1] == '/')
+					{
+						break;
+					}
+					if (text[index + 1] == '*')
+					{
+						const auto commentEnd = text.find("*/", index + 2);
+						if (commentEnd == std::string_view::npos)
+						{
+							break;
+						}
+						index = commentEnd + 1;
+						result += ' ';
+						continue;
+					}
+				}
+				result += text[index];
+			}
+			return result;
+		}
+
+		static bool IsIdentifierStart(char character)
+		{
+			return std::isalpha(static_cast<unsigned char>(character)) || character == '_';
+		}
+
+		static bool IsIdentifierPart(char character)
+		{
+			return std::isalnum(static_cast<unsigned char>(character)) || character == '_';
+		}
+
+		static bool Tokenize(std::string_view text, std::vector<Token>& tokens, std::string& error)
+		{
+			static constexpr std::string_view TwoCharOperators[] = { "&&", "||", "==", "!=", "<=",
+				">=", "<<", ">>" };
+			static constexpr std::string_view OneCharOperators = "()!~+-*/%<>&|^";
+
+			size_t index = 0;
+			while (index < text.size())
+			{
+				const char character = text[index];
+				if (std::isspace(static_cast<unsigned char>(character)))
+				{
+					++index;
+				}
+				else if (IsIdentifierStart(character))
+				{
+					const size_t begin = index;
+					while (index < text.size() && IsIdentifierPart(text[index]))
+					{
+						++index;
+					}
+					tokens.push_back({ Token::Kind::Identifier, std::string(text.substr(begin, index - begin)) });
+				}
+				else if (std::isdigit(static_cast<unsigned char>(character)))
+				{
+					const size_t begin = index;
+					while (index < text.size() && IsIdentifierPart(text[index]))
+					{
+						++index;
+					}
+					auto number = std::string(text.substr(begin, index - begin));
+					while (!number.empty() && (number.back() == 'u' || number.back() == 'U' ||
+												  number.back() == 'l' || number.back() == 'L'))
+					{
+						number.pop_back();
+					}
+					size_t parsedSize = 0;
+					int64_t value = 0;
+					try
+					{
+						value = std::stoll(number, &parsedSize, 0);
+					}
+					catch (const std::exception&)
+					{
+						parsedSize = 0;
+					}
+					if (parsedSize != number.size())
+					{
+						error = std::format("invalid number '{}'", text.substr(begin, index - begin));
+						return false;
+					}
+					tokens.push_back({ Token::Kind::Number, std::move(number), value });
+				}
+				else
+				{
+					const auto twoChars = text.substr(index, 2);
+					if (std::find(std::begin(TwoCharOperators), std::end(TwoCharOperators), twoChars) !=
+						std::end(TwoCharOperators))
+					{
+						tokens.push_back({ Token::Kind::Operator, std::string(twoChars) });
+						index += 2;
+					}
+					else if (OneCharOperators.find(character) != std::string_view::npos)
+					{
+						tokens.push_back({ Token::Kind::Operator, std::string(1, character) });
+						++index;
+					}
+					else
+					{
+						error = std::format("unexpected character '{}'", character);
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		template <typename MacroMap>
+		class ExpressionEvaluator
+		{
+		public:
+			ExpressionEvaluator(std::span<const Token> aTokens, const MacroMap& aMacros,
+				size_t aDepth, std::string& aError) :
+				tokens(aTokens),
+				macros(aMacros), depth(aDepth), error(aError)
+			{}
+
+			std::optional<int64_t> Evaluate()
+			{
+				const auto result = ParseBinary(0);
+				if (result.has_value() && position != tokens.size())
+				{
+					return Fail(std::format("unexpected token '{}'", tokens[position].text));
+				}
+				return result;
+			}
+
+		private:
+			// Binary operators from the lowest to the highest precedence.
+			static constexpr std::array<std::array<std::string_view, 4>, 10> Precedence = { {
+				{ "||" },
+				{ "&&" },
+				{ "|" },
+				{ "^" },
+				{ "&" },
+				{ "==", "!=" },
+				{ "<", ">", "<=", ">=" },
+				{ "<<", ">>" },
+				{ "+", "-" },
+				{ "*", "/", "%" },
+			} };
+
+			std::nullopt_t Fail(std::string message)
+			{
+				if (error.empty())
+				{
+					error = std::move(message);
+				}
+				return std::nullopt;
+			}
+
+			bool IsOperator(std::string_view text) const
+			{
+				return position < tokens.size() && tokens[position].kind == Token::Kind::Operator &&
+				       tokens[position].text == text;
+			}
+
+			std::optional<int64_t> ParseBinary(size_t level)
+			{
+				if (level == Precedence.size())
+				{
+					return ParseUnary();
+				}
+
+				auto left = ParseBinary(level + 1);
+				while (left.has_value() && position < tokens.size() &&
+					   tokens[position].kind == Token::Kind::Operator)
+				{
+					const auto& operators = Precedence[level];
+					const auto op = tokens[position].text;
+					if (std::find(operators.begin(), operators.end(), op) == operators.end())
+					{
+						break;
+					}
+					++position;
+					const auto right = ParseBinary(level + 1);
+					if (!right.has_value())
+					{
+						return std::nullopt;
+					}
+					left = Apply(op, *left, *right);
+				}
+				return left;
+			}
+
+			std::optional<int64_t> Apply(std::string_view op, int64_t left, int64_t right)
+			{
+				using Operation = int64_t (*)(int64_t, int64_t);
+				static constexpr std::pair<std::string_view, Operation> Operations[] = {
+					{ "||", [](int64_t l, int64_t r) -> int64_t { return l != 0 || r != 0; } },
+					{ "&&", [](int64_t l, int64_t r) -> int64_t { return l != 0 && r != 0; } },
+					{ "|", [](int64_t l, int64_t r) { return l | r; } },
+					{ "^", [](int64_t l, int64_t r) { return l ^ r; } },
+					{ "&", [](int64_t l, int64_t r) { return l & r; } },
+					{ "==", [](int64_t l, int64_t r) -> int64_t { return l == r; } },
+					{ "!=", [](int64_t l, int64_t r) -> int64_t { return l != r; } },
+					{ "<", [](int64_t l, int64_t r) -> int64_t { return l < r; } },
+					{ ">", [](int64_t l, int64_t r) -> int64_t { return l > r; } },
+					{ "<=", [](int64_t l, int64_t r) -> int64_t { return l <= r; } },
+					{ ">=", [](int64_t l, int64_t r) -> int64_t { return l >= r; } },
+					{ "<<", [](int64_t l, int64_t r) { return l << r; } },
+					{ ">>", [](int64_t l, int64_t r) { return l >> r; } },
+					{ "+", [](int64_t l, int64_t r) { return l + r; } },
+					{ "-", [](int64_t l, int64_t r) { return l - r; } },
+					{ "*", [](int64_t l, int64_t r) { return l * r; } },
+					{ "/", [](int64_t l, int64_t r) { return l / r; } },
+					{ "%", [](int64_t l, int64_t r) { return l % r; } },
+				};
+
+				if ((op == "/" || op == "%") && right == 0)
+				{
+					return Fail("division by zero");
+				}
+				for (const auto& [name, operation] : Operations)
+				{
+					if (name == op)
+					{
+						return operation(left, right);
+					}
+				}
+				return Fail(std::format("unknown operator '{}'", op));
+			}
+
+			std::optional<int64_t> ParseUnary()
+			{
+				using Operation = int64_t (*)(int64_t);
+				static constexpr std::pair<std::string_view, Operation> Operations[] = {
+					{ "!", [](int64_t value) -> int64_t { return value == 0; } },
+					{ "~", [](int64_t value) { return ~value; } },
+					{ "-", [](int64_t value) { return -value; } },
+					{ "+", [](int64_t value) { return value; } },
+				};
+
+				for (const auto& [name, operation] : Operations)
+				{
+					if (IsOperator(name))
+					{
+						++position;
+						const auto operand = ParseUnary();
+						if (!operand.has_value())
+						{
+							return std::nullopt;
+						}
+						return operation(*operand);
+					}
+				}
+				return ParsePrimary();
+			}
+
+			std::optional<int64_t> ParsePrimary()
+			{
+				if (position == tokens.size())
+				{
+					return Fail("unexpected end of expression");
+				}
+
+				const auto& token = tokens[position++];
+				if (token.kind == Token::Kind::Number)
+				{
+					return token.value;
+				}
+				if (token.kind == Token::Kind::Operator)
+				{
+					if (token.text != "(")
+					{
+						return Fail(std::format("unexpected token '{}'", token.text));
+					}
+					const auto result = ParseBinary(0);
+					if (!IsOperator(")"))
+					{
+						return Fail("missing ')'");
+					}
+					++position;
+					return result;
+				}
+				if (token.text == "defined")
+				{
+					const bool hasParentheses = IsOperator("(");
+					position += hasParentheses ? 1 : 0;
+					if (position == tokens.size() ||
+						tokens[position].kind != Token::Kind::Identifier)
+					{
+						return Fail("'defined' without macro name");
+					}
+					const bool isDefined = macros.contains(tokens[position++].text);
+					if (hasParentheses)
+					{
+						if (!IsOperator(")"))
+						{
+							return Fail("missing ')' after 'defined'");
+						}
+						++position;
+					}
+					return isDefined ? 1 : 0;
+				}
+
+				const auto macroIt = macros.find(token.text);
+				if (macroIt == macros.end())
+				{
+					return 0;
+				}
+				if (depth == MaxExpansionDepth)
+				{
+					return Fail(std::format("macro '{}' expands recursively", token.text));
+				}
+				std::vector<Token> expansion;
+				if (!Tokenize(macroIt->second, expansion, error))
+				{
+					return std::nullopt;
+				}
+				if (expansion.empty())
+				{
+					return Fail(std::format("macro '{}' expands to nothing", token.text));
+				}
+				return ExpressionEvaluator(expansion, macros, depth + 1, error).Evaluate();
+			}
+
+			std::span<const Token> tokens;
+			const MacroMap& macros;
+			size_t depth = 0;
+			size_t position = 0;
+			std::string& error;
+		};
+
+		static SourceLine::Kind GetDirectiveKind(std::string_view name)
+		{
+			using enum SourceLine::Kind;
+			static constexpr std::pair<std::string_view, SourceLine::Kind> Directives[] = {
+				{ "if", If }, { "ifdef", Ifdef }, { "ifndef", Ifndef }, { "elif", Elif },
+				{ "else", Else }, { "endif", Endif }, { "define", Define }, { "undef", Undef },
+				{ "include", Include }, { "error", Error }
+			};
+			for (const auto& [directiveName, kind] : Directives)
+			{
+				if (name == directiveName)
+				{
+					return kind;
+				}
+			}
+			return Other;
+		}
+
+		static std::string_view ParseIdentifier(std::string_view text)
+		{
+			size_t size = 0;
+			while (size < text.size() && IsIdentifierPart(text[size]))
+			{
+				++size;
+			}
+			return text.substr(0, size);
+		}
+	}
+
+	const ShaderPreprocessor::SourceFile& ShaderPreprocessor::Load(const std::filesystem::path& path)
+	{
+		const auto normalizedPath = path.lexically_normal();
+		if (const auto it = files.find(normalizedPath.native()); it != files.end())
+		{
+			return *it->second;
+		}
+
+		auto& file = *files.emplace(normalizedPath.native(), std::make_unique<SourceFile>())
+						  .first->second;
+		file.path = normalizedPath;
+
+		std::ifstream stream(normalizedPath, std::ios::binary);
+		if (!stream.is_open())
+		{
+			file.error = std::format("cannot open '{}'", normalizedPath.generic_string());
+			return file;
+		}
+		std::ostringstream contentStream;
+		contentStream << stream.rdbuf();
+		const std::string content = std::move(contentStream).str();
+
+		std::vector<std::filesystem::path> includes;
+		std::string_view remaining = content;
+		uint32_t lineNumber = 0;
+		while (!remaining.empty())
+		{
+			// Directives may continue on following lines after a backslash.
+			std::string physicalLine;
+			const uint32_t firstLineNumber = ++lineNumber;
+			while (true)
+			{
+				const auto lineEnd = remaining.find('\n');
+				auto line = remaining.substr(0, lineEnd);
+				remaining.remove_prefix(lineEnd == std::string_view::npos ? remaining.size() : lineEnd + 1);
+				line = SShaderPreprocessor::Trim(line);
+				if (!line.empty() && line.back() == '\\' && !remaining.empty())
+				{
+					physicalLine.append(line.substr(0, line.size() - 1));
+					physicalLine += ' ';
+					++lineNumber;
+					continue;
+				}
+				physicalLine.append(line);
+				break;
+			}
+
+			const auto text = SShaderPreprocessor::StripComments(physicalLine);
+			const auto trimmedText = SShaderPreprocessor::Trim(text);
+			if (trimmedText.empty())
+			{
+				continue;
+			}
+
+			SourceLine sourceLine;
+			sourceLine.lineNumber = firstLineNumber;
+			if (trimmedText.front() != '#')
+			{
+				sourceLine.textHash = HashString(trimmedText);
+				file.lines.push_back(std::move(sourceLine));
+				continue;
+			}
+
+			auto directive = SShaderPreprocessor::Trim(trimmedText.substr(1));
+			const auto name = SShaderPreprocessor::ParseIdentifier(directive);
+			const auto argument = SShaderPreprocessor::Trim(directive.substr(name.size()));
+			sourceLine.kind = SShaderPreprocessor::GetDirectiveKind(name);
+			sourceLine.textHash = HashString(trimmedText);
+			sourceLine.argument = argument;
+
+			using enum SourceLine::Kind;
+			if (sourceLine.kind == If || sourceLine.kind == Elif)
+			{
+				std::string error;
+				if (!SShaderPreprocessor::Tokenize(argument, sourceLine.tokens, error))
+				{
+					sourceLine.kind = Error;
+					sourceLine.argument = std::format("invalid expression: {}", error);
+				}
+			}
+			else if (sourceLine.kind == Include)
+			{
+				const auto openQuote = argument.find('"');
+				const auto closeQuote = argument.find('"', openQuote + 1);
+				if (openQuote == std::string_view::npos || closeQuote == std::string_view::npos)
+				{
+					sourceLine.kind = Error;
+					sourceLine.argument = std::format("unsupported include '{}'", argument);
+				}
+				else
+				{
+					const auto includePath =
+						(normalizedPath.parent_path() /
+							argument.substr(openQuote + 1, closeQuote - openQuote - 1))
+							.lexically_normal();
+					sourceLine.argument = includePath.string();
+					includes.push_back(includePath);
+				}
+			}
+			file.lines.push_back(std::move(sourceLine));
+		}
+
+		for (const auto& includePath : includes)
+		{
+			Load(includePath);
+		}
+		return file;
+	}
+
+	PreprocessResult ShaderPreprocessor::Preprocess(const std::filesystem::path& path,
+		std::span<const ShaderDefine> defines) const
+	{
+		PreprocessResult result;
+		const auto it = files.find(path.lexically_normal().native());
+		if (it == files.end())
+		{
+			result.error = std::format("'{}' was not loaded", path.generic_string());
+			return result;
+		}
+
+		MacroMap macros;
+		result.hash = HashSeed;
+		for (const auto& define : defines)
+		{
+			if (define.name == nullptr)
+			{
+				break;
+			}
+			macros.insert_or_assign(define.name,
+				define.definition != nullptr ? define.definition : "");
+			// Values may be used outside of directives, so they always take part in the hash.
+			if (define.definition != nullptr)
+			{
+				result.hash = HashString(std::format("{}={}", define.name, define.definition),
+					result.hash);
+			}
+		}
+
+		std::vector<const SourceFile*> stack;
+		if (!Preprocess(*it->second, macros, result.hash, stack, result.error))
+		{
+			result.hash = 0;
+		}
+		return result;
+	}
+
+	bool ShaderPreprocessor::Preprocess(const SourceFile& file, MacroMap& macros, uint64_t& hash,
+		std::vector<const SourceFile*>& stack, std::string& error) const
+	{
+		if (!file.error.empty())
+		{
+			error = file.error;
+			return false;
+		}
+		if (std::find(stack.cbegin(), stack.cend(), &file) != stack.cend())
+		{
+			error = std::format("'{}' includes itself", file.path.generic_string());
+			return false;
+		}
+
+		struct Conditional
+		{
+			bool isActive = false;
+			bool isTaken = false;
+			bool isParentActive = false;
+			bool hasElse = false;
+		};
+
+		stack.push_back(&file);
+		std::vector<Conditional> conditionals;
+		bool isActive = true;
+		const auto fail = [&](const SourceLine& line, std::string_view message) {
+			error = std::format("{}({}): {}", file.path.generic_string(), line.lineNumber, message);
+			return false;
+		};
+		const auto evaluate = [&](const SourceLine& line) -> std::optional<bool> {
+			std::string expressionError;
+			const auto value = SShaderPreprocessor::ExpressionEvaluator<MacroMap>(line.tokens,
+				macros, 0, expressionError)
+			                       .Evaluate();
+			if (!value.has_value())
+			{
+				fail(line, std::format("#{} {}: {}", line.kind == SourceLine::Kind::If ? "if" : "elif",
+							   line.argument, expressionError));
+				return std::nullopt;
+			}
+			return *value != 0;
+		};
+
+		for (const auto& line : file.lines)
+		{
+			using enum SourceLine::Kind;
+			switch (line.kind)
+			{
+			case If:
+			case Ifdef:
+			case Ifndef:
+				{
+					bool condition = false;
+					if (isActive)
+					{
+						if (line.kind == If)
+						{
+							const auto value = evaluate(line);
+							if (!value.has_value())
+							{
+								return false;
+							}
+							condition = *value;
+						}
+						else
+						{
+							const auto name = SShaderPreprocessor::ParseIdentifier(line.argument);
+							condition = macros.contains(name) == (line.kind == Ifdef);
+						}
+					}
+					conditionals.push_back({ condition, condition, isActive, false });
+					isActive = condition;
+					break;
+				}
+			case Elif:
+			case Else:
+				{
+					if (conditionals.empty() || conditionals.back().hasElse)
+					{
+						return fail(line, line.kind == Elif ? "unexpected #elif" : "unexpected #else");
+					}
+					auto& conditional = conditionals.back();
+					conditional.isActive = false;
+					if (conditional.isParentActive && !conditional.isTaken)
+					{
+						if (line.kind == Else)
+						{
+							conditional.isActive = true;
+						}
+						else
+						{
+							const auto value = evaluate(line);
+							if (!value.has_value())
+							{
+								return false;
+							}
+							conditional.isActive = *value;
+						}
+						conditional.isTaken = conditional.isActive;
+					}
+					conditional.hasElse = line.kind == Else;
+					isActive = conditional.isActive;
+					break;
+				}
+			case Endif:
+				{
+					if (conditionals.empty())
+					{
+						return fail(line, "unexpected #endif");
+					}
+					isActive = conditionals.back().isParentActive;
+					conditionals.pop_back();
+					break;
+				}
+			default:
+				{
+					if (!isActive)
+					{
+						break;
+					}
+					if (line.kind == Error)
+					{
+						return fail(line, std::format("#error {}", line.argument));
+					}
+					if (line.kind == Define)
+					{
+						const auto name = SShaderPreprocessor::ParseIdentifier(line.argument);
+						const auto value = std::string_view(line.argument).substr(name.size());
+						// Function-like macros are only tracked as defined.
+						macros.insert_or_assign(std::string(name),
+							value.starts_with('(') ? std::string() :
+													 std::string(SShaderPreprocessor::Trim(value)));
+					}
+					else if (line.kind == Undef)
+					{
+						const auto name = SShaderPreprocessor::ParseIdentifier(line.argument);
+						if (const auto it = macros.find(name); it != macros.end())
+						{
+							macros.erase(it);
+						}
+					}
+					else if (line.kind == Include)
+					{
+						const auto it = files.find(std::filesystem::path(line.argument).native());
+						if (it == files.end())
+						{
+							return fail(line, std::format("'{}' was not loaded", line.argument));
+						}
+						if (!Preprocess(*it->second, macros, hash, stack, error))
+						{
+							return false;
+						}
+						break;
+					}
+					hash = HashBytes(&line.textHash, sizeof(line.textHash), hash);
+					break;
+				}
+			}
+		}
+		stack.pop_back();
+
+		if (!conditionals.empty())
+		{
+			error = std::format("{}: unterminated conditional", file.path.generic_string());
+			return false;
+		}
+		return true;
+	}
+}
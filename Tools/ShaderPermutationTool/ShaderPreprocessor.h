@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core/ShaderDescriptorSchema.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SIE
+{
+	struct PreprocessResult
+	{
+		uint64_t hash = 0;
+		std::string error;
+	};
+
+	// Evaluates conditional directives of HLSL sources for a set of defines and hashes the text
+	// that stays active, so that permutations producing identical code can be detected without
+	// compiling them. Only object-like macros are expanded and only inside directives.
+	class ShaderPreprocessor
+	{
+	public:
+		struct Token
+		{
+			enum class Kind
+			{
+				Number,
+				Identifier,
+				Operator,
+			};
+
+			Kind kind = Kind::Number;
+			std::string text;
+			int64_t value = 0;
+		};
+
+		struct SourceLine
+		{
+			enum class Kind
+			{
+				Text,
+				If,
+				Ifdef,
+				Ifndef,
+				Elif,
+				Else,
+				Endif,
+				Define,
+				Undef,
+				Include,
+				Error,
+				Other,
+			};
+
+			Kind kind = Kind::Text;
+			uint32_t lineNumber = 0;
+			uint64_t textHash = 0;
+			std::string argument;
+			std::vector<Token> tokens;
+		};
+
+		struct SourceFile
+		{
+			std::filesystem::path path;
+			std::vector<SourceLine> lines;
+			std::string error;
+		};
+
+		// Loads the file and everything it includes. Not thread safe, Preprocess may be called
+		// concurrently once all roots are loaded.
+		const SourceFile& Load(const std::filesystem::path& path);
+
+		PreprocessResult Preprocess(const std::filesystem::path& path,
+			std::span<const ShaderDefine> defines) const;
+
+	private:
+		using MacroMap = std::map<std::string, std::string, std::less<>>;
+
+		bool Preprocess(const SourceFile& file, MacroMap& macros, uint64_t& hash,
+			std::vector<const SourceFile*>& stack, std::string& error) const;
+
+		std::unordered_map<std::filesystem::path::string_type, std::unique_ptr<SourceFile>> files;
+	};
+}
@@ -0,0 +1,408 @@
+#include "ShaderCompiler.h"
+#include "ToolSupport.h"
+#include "ShaderPreprocessor.h"
+
+#include "Core/ShaderDescriptorSchema.h"
+#include "Core/ShaderDiskCache.h"
+#include "Core/ShaderTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <format>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+namespace SIE
+{
+	namespace SShaderPermutationTool
+	{
+		struct ShaderTypeInfo
+		{
+			std::string_view name;
+			// Must match RE::BSShader::Type, manifest records are read back by the game.
+			uint8_t type;
+			std::string_view fileName;
+			const ShaderDescriptorSchema* schema;
+		};
+
+		// Imagespace is missing as its descriptors are CommonLib effect enum values.
+		constexpr std::array<ShaderTypeInfo, 9> ShaderTypes = { {
+			{ "Grass", 1, "RunGrass", &GrassShaderSchema },
+			{ "Sky", 2, "Sky", &SkyShaderSchema },
+			{ "Water", 3, "Water", &WaterShaderSchema },
+			{ "BloodSplatter", 4, "BloodSplatter", &BloodSplatterShaderSchema },
+			{ "Lighting", 6, "Lighting", &LightingShaderSchema },
+			{ "Effect", 7, "Effect", &EffectShaderSchema },
+			{ "Utility", 8, "Utility", &UtilityShaderSchema },
+			{ "DistantTree", 9, "DistantTree", &DistantTreeShaderSchema },
+			{ "Particle", 10, "Particle", &ParticleShaderSchema },
+		} };
+
+		struct ShaderClassInfo
+		{
+			std::string_view name;
+			// Must match SIE::ShaderClass.
+			uint8_t shaderClass;
+			const char* define;
+			std::string_view profile;
+		};
+
+		constexpr std::array<ShaderClassInfo, 2> ShaderClasses = { {
+			{ "Vertex", 0, "VSHADER", "vs_5_0" },
+			{ "Pixel", 1, "PSHADER", "ps_5_0" },
+		} };
+
+		struct Options
+		{
+			std::filesystem::path shadersPath = "Shaders";
+			std::filesystem::path manifestPath;
+			std::filesystem::path tracePath;
+			std::filesystem::path compileOutputPath = "CompiledShaders";
+			std::string compilerCommand;
+			std::set<std::string, std::less<>> types;
+			size_t maxPermutations = 1 << 16;
+			size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+			size_t maxReportedErrors = 20;
+		};
+
+		struct Permutation
+		{
+			const ShaderTypeInfo* typeInfo = nullptr;
+			const ShaderClassInfo* classInfo = nullptr;
+			std::vector<uint32_t> descriptors;
+			std::array<ShaderDefine, 64> defines;
+			std::string definesString;
+			PreprocessResult result;
+		};
+
+		struct Statistics
+		{
+			size_t descriptors = 0;
+			size_t defineSets = 0;
+			size_t unique = 0;
+			size_t errors = 0;
+		};
+
+		static bool ParseOptions(int argc, char** argv, Options& options)
+		{
+			ToolOptionParser parser("ShaderPermutationTool");
+			parser.Add("--shaders", "dir", "directory with HLSL sources (default: Shaders)",
+				options.shadersPath);
+			parser.Add("--types", "A,B,...", "shader types to process (default: all)",
+				[&options](const std::string& value) {
+					for (size_t begin = 0; begin <= value.size();)
+					{
+						const auto end = std::min(value.find(',', begin), value.size());
+						options.types.insert(value.substr(begin, end - begin));
+						begin = end + 1;
+					}
+				});
+			parser.Add("--trace", "file",
+				"take descriptors from a shader trace instead of enumerating them",
+				options.tracePath);
+			parser.Add("--max-permutations", "n",
+				"skip enumeration of types with more descriptors per class (default: 65536)",
+				options.maxPermutations);
+			parser.Add("--threads", "n", "worker thread count (default: all cores)",
+				options.threadCount, 1);
+			parser.Add("--manifest", "file",
+				"write valid descriptors as a shader trace the game pre-warms from "
+				"(ShaderManifest.bin)",
+				options.manifestPath);
+			parser.Add("--compiler", "command",
+				"compile unique permutations with an external compiler, see ShaderCompiler.h for "
+				"placeholders",
+				options.compilerCommand);
+			parser.Add("--output", "dir", "compiled shader directory (default: CompiledShaders)",
+				options.compileOutputPath);
+			return parser.Parse(argc, argv);
+		}
+
+		// Every combination of used flag bits with every valid technique.
+		static std::optional<std::vector<uint32_t>> EnumerateDescriptors(
+			const ShaderDescriptorSchema& schema, size_t maxCount)
+		{
+			const uint32_t flagBits = GetUsedBits(schema) & ~schema.techniqueMask;
+			std::vector<uint32_t> techniques(schema.techniques.begin(), schema.techniques.end());
+			if (techniques.empty())
+			{
+				for (uint32_t technique = 0;; technique = (technique - schema.techniqueMask) &
+				                                          schema.techniqueMask)
+				{
+					techniques.push_back(technique);
+					if (technique == schema.techniqueMask)
+					{
+						break;
+					}
+				}
+			}
+
+			const auto flagBitCount = std::popcount(flagBits);
+			if (flagBitCount >= 32 || (size_t(1) << flagBitCount) > maxCount / techniques.size())
+			{
+				return std::nullopt;
+			}
+
+			std::vector<uint32_t> result;
+			result.reserve(techniques.size() << flagBitCount);
+			for (const uint32_t technique : techniques)
+			{
+				for (uint32_t flags = 0;; flags = (flags - flagBits) & flagBits)
+				{
+					if (IsValidDescriptor(schema, technique | flags))
+					{
+						result.push_back(technique | flags);
+					}
+					if (flags == flagBits)
+					{
+						break;
+					}
+				}
+			}
+			return result;
+		}
+
+		template <typename Func>
+		static void ParallelFor(size_t count, size_t threadCount, Func&& func)
+		{
+			std::atomic<size_t> nextIndex = 0;
+			std::vector<std::jthread> threads;
+			for (size_t threadIndex = 0; threadIndex < std::min(threadCount, count); ++threadIndex)
+			{
+				threads.emplace_back([&] {
+					for (size_t index = nextIndex++; index < count; index = nextIndex++)
+					{
+						func(index);
+					}
+				});
+			}
+		}
+
+		static std::filesystem::path GetSourcePath(const Options& options,
+			const ShaderTypeInfo& typeInfo)
+		{
+			return (options.shadersPath / std::format("{}.hlsl", typeInfo.fileName))
+			    .lexically_normal();
+		}
+
+		static int Run(const Options& options)
+		{
+			std::vector<ShaderTraceRecord> traceRecords;
+			if (!options.tracePath.empty())
+			{
+				traceRecords = ReadShaderTrace(options.tracePath);
+				std::cout << std::format("Read {} records from {}\n", traceRecords.size(),
+					options.tracePath.generic_string());
+			}
+
+			std::vector<std::unique_ptr<Permutation>> permutations;
+			std::map<std::pair<size_t, size_t>, Statistics> statistics;
+			ShaderPreprocessor preprocessor;
+
+			for (const auto& typeInfo : ShaderTypes)
+			{
+				if (!options.types.empty() && !options.types.contains(typeInfo.name))
+				{
+					continue;
+				}
+
+				preprocessor.Load(GetSourcePath(options, typeInfo));
+
+				std::optional<std::vector<uint32_t>> enumeratedDescriptors;
+				if (options.tracePath.empty())
+				{
+					enumeratedDescriptors =
+						EnumerateDescriptors(*typeInfo.schema, options.maxPermutations);
+					if (!enumeratedDescriptors.has_value())
+					{
+						std::cout << std::format(
+							"{}: skipped, more than {} descriptors, use --trace or raise "
+							"--max-permutations\n",
+							typeInfo.name, options.maxPermutations);
+						continue;
+					}
+				}
+
+				for (const auto& classInfo : ShaderClasses)
+				{
+					std::vector<uint32_t> descriptors;
+					if (enumeratedDescriptors.has_value())
+					{
+						descriptors = *enumeratedDescriptors;
+					}
+					else
+					{
+						for (const auto& record : traceRecords)
+						{
+							if (record.shaderType == typeInfo.type &&
+								record.shaderClass == classInfo.shaderClass)
+							{
+								descriptors.push_back(record.descriptor);
+							}
+						}
+					}
+
+					auto& typeStatistics =
+						statistics[{ &typeInfo - ShaderTypes.data(), &classInfo - ShaderClasses.data() }];
+					std::unordered_map<std::string, Permutation*> permutationsByDefines;
+					for (const uint32_t descriptor : descriptors)
+					{
+						++typeStatistics.descriptors;
+
+						std::array<ShaderDefine, 64> defines;
+						defines[0] = { classInfo.define, nullptr };
+						size_t count = 1 + DecodeDescriptor(*typeInfo.schema, descriptor,
+											   std::span(defines).subspan(1, defines.size() - 2));
+						count = CanonicalizeDefines(std::span(defines).first(count));
+						std::fill(defines.begin() + count, defines.end(), ShaderDefine{});
+
+						auto definesString = MergeDefinesString(defines);
+						auto& permutation = permutationsByDefines[definesString];
+						if (permutation == nullptr)
+						{
+							auto& newPermutation = permutations.emplace_back(std::make_unique<Permutation>());
+							newPermutation->typeInfo = &typeInfo;
+							newPermutation->classInfo = &classInfo;
+							newPermutation->defines = defines;
+							newPermutation->definesString = std::move(definesString);
+							permutation = newPermutation.get();
+						}
+						permutation->descriptors.push_back(descriptor);
+					}
+					typeStatistics.defineSets = permutationsByDefines.size();
+				}
+			}
+
+			ParallelFor(permutations.size(), options.threadCount, [&](size_t index) {
+				auto& permutation = *permutations[index];
+				permutation.result = preprocessor.Preprocess(
+					GetSourcePath(options, *permutation.typeInfo), permutation.defines);
+			});
+
+			std::map<std::pair<size_t, size_t>, std::set<uint64_t>> uniqueHashes;
+			std::vector<Permutation*> uniquePermutations;
+			size_t reportedErrors = 0;
+			for (const auto& permutation : permutations)
+			{
+				const std::pair<size_t, size_t> statisticsKey = {
+					permutation->typeInfo - ShaderTypes.data(),
+					permutation->classInfo - ShaderClasses.data()
+				};
+				auto& typeStatistics = statistics[statisticsKey];
+				if (!permutation->result.error.empty())
+				{
+					++typeStatistics.errors;
+					if (reportedErrors++ < options.maxReportedErrors)
+					{
+						std::cout << std::format("error: {} {} {:08X} [{}]: {}\n",
+							permutation->typeInfo->name, permutation->classInfo->name,
+							permutation->descriptors.front(), permutation->definesString,
+							permutation->result.error);
+					}
+					continue;
+				}
+				if (uniqueHashes[statisticsKey].insert(permutation->result.hash).second)
+				{
+					++typeStatistics.unique;
+					uniquePermutations.push_back(permutation.get());
+				}
+			}
+
+			Statistics total;
+			std::cout << std::format("{:<16}{:<8}{:>12}{:>12}{:>12}{:>12}{:>10}\n", "Type", "Class",
+				"Descriptors", "Define sets", "Unique", "Duplicates", "Errors");
+			for (const auto& [key, typeStatistics] : statistics)
+			{
+				std::cout << std::format("{:<16}{:<8}{:>12}{:>12}{:>12}{:>12}{:>10}\n",
+					ShaderTypes[key.first].name, ShaderClasses[key.second].name,
+					typeStatistics.descriptors, typeStatistics.defineSets, typeStatistics.unique,
+					typeStatistics.descriptors - typeStatistics.unique - typeStatistics.errors,
+					typeStatistics.errors);
+				total.descriptors += typeStatistics.descriptors;
+				total.defineSets += typeStatistics.defineSets;
+				total.unique += typeStatistics.unique;
+				total.errors += typeStatistics.errors;
+			}
+			std::cout << std::format("{:<24}{:>12}{:>12}{:>12}{:>12}{:>10}\n", "Total",
+				total.descriptors, total.defineSets, total.unique,
+				total.descriptors - total.unique - total.errors, total.errors);
+
+			size_t compileFailures = 0;
+			if (!options.compilerCommand.empty())
+			{
+				CommandLineShaderCompiler compiler(options.compilerCommand);
+				std::atomic<size_t> failures = 0;
+				ParallelFor(uniquePermutations.size(), options.threadCount, [&](size_t index) {
+					const auto& permutation = *uniquePermutations[index];
+					ShaderCompileJob job;
+					job.sourcePath = GetSourcePath(options, *permutation.typeInfo);
+					job.profile = permutation.classInfo->profile;
+					job.defines = permutation.defines;
+					job.outputPath = options.compileOutputPath / permutation.typeInfo->name /
+					                 permutation.classInfo->name /
+					                 std::format("{:016X}.cso", permutation.result.hash);
+					std::string error;
+					if (!compiler.Compile(job, error))
+					{
+						++failures;
+						std::cerr << std::format("compile error: {} {} [{}]: {}\n",
+							permutation.typeInfo->name, permutation.classInfo->name,
+							permutation.definesString, error);
+					}
+				});
+				compileFailures = failures;
+				std::cout << std::format("Compiled {} permutations, {} failed\n",
+					uniquePermutations.size() - compileFailures, compileFailures);
+			}
+
+			if (!options.manifestPath.empty())
+			{
+				ShaderTraceWriter manifest(options.manifestPath);
+				manifest.Remove();
+				size_t recordCount = 0;
+				for (const auto& permutation : permutations)
+				{
+					if (!permutation->result.error.empty())
+					{
+						continue;
+					}
+					for (const uint32_t descriptor : permutation->descriptors)
+					{
+						ShaderTraceRecord record;
+						record.descriptor = descriptor;
+						record.shaderType = permutation->typeInfo->type;
+						record.shaderClass = permutation->classInfo->shaderClass;
+						if (!manifest.Append(record))
+						{
+							std::cerr << std::format("Failed to write {}\n",
+								options.manifestPath.generic_string());
+							return 1;
+						}
+						++recordCount;
+					}
+				}
+				manifest.Close();
+				std::cout << std::format("Wrote {} records to {}\n", recordCount,
+					options.manifestPath.generic_string());
+			}
+
+			return total.errors == 0 && compileFailures == 0 ? 0 : 1;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SIE::SShaderPermutationTool::Options options;
+	if (!SIE::SShaderPermutationTool::ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+	return SIE::SShaderPermutationTool::Run(options);
+}
@@ -0,0 +1,176 @@
+#include "Core/ShaderTrace.h"
+#include "ToolSupport.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace SIE
+{
+	namespace SShaderTraceCheck
+	{
+		static std::vector<ShaderTraceRecord> MakeRecords(size_t count, uint32_t firstDescriptor)
+		{
+			std::vector<ShaderTraceRecord> result;
+			for (size_t index = 0; index < count; ++index)
+			{
+				result.push_back({ static_cast<uint32_t>(firstDescriptor + index * 0x01010101),
+					static_cast<uint8_t>(index % 11), static_cast<uint8_t>(index % 3), 0 });
+			}
+			return result;
+		}
+
+		static bool IsSameTrace(const std::vector<ShaderTraceRecord>& trace,
+			const std::vector<ShaderTraceRecord>& expected)
+		{
+			return std::ranges::equal(trace, expected,
+				[](const ShaderTraceRecord& left, const ShaderTraceRecord& right) {
+					return left.GetKey() == right.GetKey() && left.reserved == right.reserved;
+				});
+		}
+
+		static bool Write(ShaderTraceWriter& writer, const std::vector<ShaderTraceRecord>& records)
+		{
+			for (const auto& record : records)
+			{
+				if (!writer.Append(record))
+				{
+					return false;
+				}
+			}
+			return writer.Flush();
+		}
+
+		static void AppendBytes(const std::filesystem::path& path, std::string_view bytes)
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::app);
+			file << bytes;
+		}
+
+		static bool CheckKey(const std::filesystem::path&)
+		{
+			const ShaderTraceRecord record = { 0x89abcdef, 6, 1, 0 };
+			const ShaderTraceRecord otherType = { 0x89abcdef, 8, 1, 0 };
+			const ShaderTraceRecord otherClass = { 0x89abcdef, 6, 0, 0 };
+			return record.GetKey() == 0x060189abcdefull && otherType.GetKey() != record.GetKey() &&
+			       otherClass.GetKey() != record.GetKey();
+		}
+
+		static bool CheckRoundTrip(const std::filesystem::path& directory)
+		{
+			const auto path = directory / "Trace" / "ShaderTrace.bin";
+			const auto records = MakeRecords(5000, 1);
+			ShaderTraceWriter writer(path);
+			return Write(writer, records) && IsSameTrace(ReadShaderTrace(path), records);
+		}
+
+		static bool CheckAppend(const std::filesystem::path& directory)
+		{
+			const auto path = directory / "ShaderTrace.bin";
+			auto records = MakeRecords(100, 1);
+			{
+				ShaderTraceWriter writer(path);
+				if (!Write(writer, records))
+				{
+					return false;
+				}
+				writer.Close();
+			}
+
+			const auto appendedRecords = MakeRecords(100, 7);
+			ShaderTraceWriter writer(path);
+			if (!Write(writer, appendedRecords))
+			{
+				return false;
+			}
+			records.insert(records.end(), appendedRecords.cbegin(), appendedRecords.cend());
+			return IsSameTrace(ReadShaderTrace(path), records);
+		}
+
+		static bool CheckPartialRecord(const std::filesystem::path& directory)
+		{
+			const auto path = directory / "ShaderTrace.bin";
+			auto records = MakeRecords(10, 1);
+			{
+				ShaderTraceWriter writer(path);
+				if (!Write(writer, records))
+				{
+					return false;
+				}
+			}
+			AppendBytes(path, "\x01\x02\x03");
+
+			const auto appendedRecords = MakeRecords(10, 7);
+			ShaderTraceWriter writer(path);
+			if (!Write(writer, appendedRecords))
+			{
+				return false;
+			}
+			records.insert(records.end(), appendedRecords.cbegin(), appendedRecords.cend());
+			return IsSameTrace(ReadShaderTrace(path), records);
+		}
+
+		static bool CheckInvalidHeader(const std::filesystem::path& directory)
+		{
+			const auto path = directory / "ShaderTrace.bin";
+			std::filesystem::create_directories(directory);
+			// Magic of another file format followed by a current version.
+			AppendBytes(path, std::string_view("SIEB\x01\x00\x00\x00garbage!", 16));
+			if (!ReadShaderTrace(path).empty())
+			{
+				return false;
+			}
+
+			const auto records = MakeRecords(10, 1);
+			ShaderTraceWriter writer(path);
+			return Write(writer, records) && IsSameTrace(ReadShaderTrace(path), records);
+		}
+
+		static bool CheckMissingTrace(const std::filesystem::path& directory)
+		{
+			return ReadShaderTrace(directory / "Missing.bin").empty();
+		}
+
+		static bool CheckRemove(const std::filesystem::path& directory)
+		{
+			const auto path = directory / "ShaderTrace.bin";
+			ShaderTraceWriter writer(path);
+			if (!Write(writer, MakeRecords(10, 1)))
+			{
+				return false;
+			}
+			writer.Remove();
+			if (std::filesystem::exists(path))
+			{
+				return false;
+			}
+
+			const auto records = MakeRecords(10, 7);
+			return Write(writer, records) && IsSameTrace(ReadShaderTrace(path), records);
+		}
+
+		constexpr std::array<ToolCheck, 7> Checks = { {
+			{ "Key", &CheckKey },
+			{ "Write and read", &CheckRoundTrip },
+			{ "Append", &CheckAppend },
+			{ "Partial record", &CheckPartialRecord },
+			{ "Invalid header", &CheckInvalidHeader },
+			{ "Missing trace", &CheckMissingTrace },
+			{ "Remove", &CheckRemove },
+		} };
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path directory;
+	SIE::ToolOptionParser parser("ShaderTraceCheck");
+	parser.AddScratchDirectory(directory);
+	if (!parser.Parse(argc, argv))
+	{
+		return 2;
+	}
+	return SIE::RunToolChecks(SIE::SShaderTraceCheck::Checks, directory);
+}